@@ -41,6 +41,7 @@ group ""
 
 include "Resonance-Editor/Build-Editor.lua"
 include "Resonance-Runtime/Build-Runtime.lua"
+include "Resonance-Tests/Build-Tests.lua"
 
 
 
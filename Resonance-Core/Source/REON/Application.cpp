@@ -35,6 +35,8 @@ Application::Application(const WindowProperties& properties)
     REON_CORE_ASSERT(!s_Instance, "Application already exists")
     s_Instance = this;
 
+    m_JobSystem = std::make_unique<JobSystem>();
+
     EventBus::Get().subscribe<WindowCloseEvent>(REON_BIND_EVENT_FN(Application::OnWindowClose));
     EventBus::Get().subscribe<WindowResizeEvent>(REON_BIND_EVENT_FN(Application::OnWindowResize));
 
@@ -86,13 +88,16 @@ void Application::Run()
         try
         {
             m_FrameNumber++;
+            m_FramePipelining = m_FramePipeliningRequested;
             FrameStartEvent frameStartEvent;
             EventBus::Get().publish(frameStartEvent);
             {
                 m_Context->startFrame();
                 ////glClear(GL_COLOR_BUFFER_BIT);
-                for (Layer* layer : m_LayerStack)
-                    layer->OnUpdate();
+                if (m_FramePipelining)
+                    updateLayersPipelined();
+                else
+                    updateLayers();
 
                 // m_Context->render();
                 m_ImGuiLayer->Begin();
@@ -117,6 +122,39 @@ void Application::Run()
     }
 }
 
+void Application::updateLayers()
+{
+    // Simulation, capture and recording one after another on this thread.
+    for (Layer* layer : m_LayerStack)
+        layer->OnUpdate();
+}
+
+void Application::updateLayersPipelined()
+{
+    // The render layer records the snapshot captured at the end of the previous frame while the simulation already
+    // advances the scene. A fresh scene has nothing captured yet, so it gets one from its current state first.
+    if (!m_RenderLayer->HasSnapshot())
+        m_RenderLayer->CaptureSnapshot();
+
+    // Input is polled here, GLFW only allows that on the main thread.
+    m_GameLogicLayer->CheckKeyPressed();
+
+    // Worker affinity keeps the waits inside recording from picking the whole simulation up on this thread
+    JobCounter simulationDone;
+    m_JobSystem->Run([this]() { m_GameLogicLayer->Simulate(); }, &simulationDone, nullptr, JobAffinity::Worker);
+    m_RenderLayer->OnUpdate();
+    m_JobSystem->Wait(simulationDone);
+
+    // Remaining layers (editor tools) touch the scene, so they only run once the simulation is done.
+    for (Layer* layer : m_LayerStack)
+    {
+        if (layer != m_GameLogicLayer && layer != m_RenderLayer)
+            layer->OnUpdate();
+    }
+
+    m_RenderLayer->CaptureSnapshot();
+}
+
 void Application::Init(std::filesystem::path assetManifestPath) 
 {
     m_EngineServices.Init(assetManifestPath.parent_path(), assetManifestPath);
@@ -11,6 +11,7 @@
 #include "Rendering/RenderContext.h"
 #include "ResourceManagement/ResourceManager.h"
 #include "EngineServices.h"
+#include "Jobs/JobSystem.h"
 
 namespace REON {
 
@@ -34,6 +35,11 @@ namespace REON {
 
 		uint64_t GetFrameNumber() { return m_FrameNumber; }
 
+		// When enabled the simulation of the next frame runs on the job system while the current one is recorded, at
+		// the cost of one frame of latency. Takes effect at the start of the next frame.
+		void SetFramePipelining(bool enabled) { m_FramePipeliningRequested = enabled; }
+		bool IsFramePipelining() const { return m_FramePipelining; }
+
 		const RenderContext* GetRenderContext() const { return m_Context; }
 
 		inline EngineServices& GetEngineServices()
@@ -41,12 +47,22 @@ namespace REON {
             return m_EngineServices;
         }
 
+		inline JobSystem& GetJobSystem() { return *m_JobSystem; }
+
 	private:
+		void updateLayers();
+		void updateLayersPipelined();
+
 		void OnWindowClose(const WindowCloseEvent& event);
 		void OnWindowResize(const WindowResizeEvent& event);
 
 	private:
 		bool m_Running = true;
+		bool m_FramePipelining = false;
+		bool m_FramePipeliningRequested = false;
+
+		// Declared first so it outlives every system that may still have jobs in flight during destruction.
+		std::unique_ptr<JobSystem> m_JobSystem;
 
 		RenderContext* m_Context;
 		std::unique_ptr<Window> m_Window;
@@ -207,6 +207,8 @@ enum : AssetTypeId
     ASSET_MODEL = 4,
     ASSET_SKELETON = 5,
     ASSET_RIG = 6,
+    ASSET_SHADER_PACK = 7,
+    ASSET_ANIMATION_CLIP = 8,
 };
 
 struct AssetKey
@@ -43,4 +43,8 @@ struct MatBinHeader
     uint8_t specularTex[16];
     uint8_t specularColorTex[16];
 };
+
+// The MaterialShaderFlags a cooked material is drawn with. Shared by the material loader and the shader cook, so the
+// shader pack holds exactly the permutations the runtime asks for.
+uint32_t GetMaterialShaderFlags(const MatBinHeader& header);
 } // namespace REON
\ No newline at end of file
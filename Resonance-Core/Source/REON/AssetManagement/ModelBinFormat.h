@@ -1,6 +1,8 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <type_traits>
 
 static constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
 {
@@ -14,6 +16,8 @@ enum class ChunkType : uint32_t
     MESH_DATA = 3,
     SKIN_DATA = 4,
     RIG = 5,
+    MESHLETS = 6,
+    ANIMATIONS = 7,
 };
 
 constexpr uint32_t FILE_MAGIC = MakeFourCC('R', 'E', 'O', 'N');
@@ -45,11 +49,18 @@ struct ChunkEntry
 };
 
 constexpr uint32_t MESH_MAGIC = MakeFourCC('M', 'E', 'S', 'H');
+constexpr uint32_t MESH_VERSION = 4; // 2: added mesh and submesh bounds, 3: packed vertex streams, 4: levels of detail
+
+struct MeshBounds
+{
+    float min[3];
+    float max[3];
+};
 
 struct MeshHeader
 {
     uint32_t magic = MESH_MAGIC;
-    uint32_t version = 1;
+    uint32_t version = MESH_VERSION;
     uint32_t flags = 0;
     uint32_t vertexCount = 0;
     uint32_t indexCount = 0;
@@ -67,8 +78,30 @@ struct MeshHeader
 
     uint32_t subMeshOffset = 0; // byte offset from start of mesh blob
     uint32_t subMeshCount = 0;
+
+    // version >= 2
+    MeshBounds bounds{};
+    uint32_t subMeshBoundsOffset = 0; // MeshBounds[subMeshCount], byte offset from start of mesh blob
+
+    // version >= 3, the streams of REON::VertexStreams. The unpacked offsets above other than posOffset and idxOffset
+    // are zero, flags holds the VertexFormatFlags.
+    uint32_t attributeOffset = 0; // PackedVertexAttributes[vertexCount]
+    uint32_t packedColorOffset = 0; // R8G8B8A8 unorm [vertexCount], if flags has VERTEX_FORMAT_COLOR
+    uint32_t skinOffset = 0; // PackedVertexSkin[vertexCount], if flags has VERTEX_FORMAT_SKIN
+
+    // version >= 4, coarser levels after the base one. indexCount includes their indices, which follow the base
+    // submeshes' in the index stream and reference the same vertices.
+    uint32_t lodCount = 0;
+    uint32_t lodOffset = 0;      // MeshLodEntry[lodCount]
+    uint32_t lodRangeOffset = 0; // SubMeshLodEntry[lodCount * subMeshCount], level by level
 };
 
+// Version 1 headers end right after subMeshCount, version 2 headers after subMeshBoundsOffset, version 3 after
+// skinOffset
+constexpr size_t MESH_HEADER_V1_SIZE = offsetof(MeshHeader, bounds);
+constexpr size_t MESH_HEADER_V2_SIZE = offsetof(MeshHeader, attributeOffset);
+constexpr size_t MESH_HEADER_V3_SIZE = offsetof(MeshHeader, lodCount);
+
 struct SubMeshEntry
 {
     uint32_t indexOffset; // in indices (not bytes)
@@ -77,6 +110,54 @@ struct SubMeshEntry
     uint32_t reserved;
 };
 
+struct MeshLodEntry
+{
+    float error; // largest distance the simplified surface moved, in mesh units
+    uint32_t reserved;
+};
+
+struct SubMeshLodEntry
+{
+    uint32_t indexOffset; // in indices (not bytes)
+    uint32_t indexCount;
+};
+
+// MESHLETS chunk: a header, a MeshletMeshEntry per clustered mesh, then the meshlets. Offsets are from the chunk start.
+constexpr uint32_t MESHLET_CHUNK_VERSION = 1;
+
+struct MeshletChunkHeader
+{
+    uint32_t version = MESHLET_CHUNK_VERSION;
+    uint32_t meshCount = 0;
+    uint32_t meshTableOffset = 0; // MeshletMeshEntry[meshCount]
+    uint32_t reserved = 0;
+};
+
+struct MeshletMeshEntry
+{
+    uint8_t meshId[16];
+    uint32_t meshletOffset; // MeshletEntry[meshletCount], sorted by subMesh
+    uint32_t meshletCount;
+    uint32_t reserved[2];
+};
+
+// Cluster of at most 64 vertices and 124 triangles of one submesh, stored as a contiguous index range. Bounds are in
+// mesh space. The layout is std430 compatible, so the same records can be uploaded for culling on the GPU.
+struct MeshletEntry
+{
+    float center[3]; // bounding sphere
+    float radius;
+    float coneApex[3];
+    float coneCutoff; // culled when dot(normalize(coneApex - eye), coneAxis) >= coneCutoff, never when it is 1
+    float coneAxis[3];
+    uint32_t indexOffset; // in indices (not bytes), like SubMeshEntry
+    uint32_t triangleCount;
+    uint32_t vertexCount;
+    uint32_t subMesh;
+    uint32_t reserved;
+};
+static_assert(sizeof(MeshletEntry) == 64);
+
 struct MeshIndexEntry
 {
     uint8_t id[16];
@@ -100,9 +181,11 @@ struct SkinRecord
     uint32_t ibmOffset;    // glm::mat4[jointCount]
 };
 
+constexpr uint32_t RIG_CHUNK_VERSION = 2; // 2: joint records with parents and rest pose
+
 struct RigChunkHeader
 {
-    uint32_t version = 1;
+    uint32_t version = RIG_CHUNK_VERSION;
     uint8_t rigId[16];
 
     uint32_t jointCount;
@@ -111,6 +194,82 @@ struct RigChunkHeader
     uint32_t jointNodeIdsOffset;
 
     uint32_t skinOffset; // uint32_t[skinIndexCount]
+
+    // version >= 2, zero when the rig was cooked without its joint hierarchy
+    uint32_t jointRecordOffset; // RigJointRecord[jointCount]
+};
+
+// Version 1 header, RigChunkHeader up to and including skinOffset. Read first, its version tells whether the rest of
+// RigChunkHeader follows.
+struct RigChunkHeaderV1
+{
+    uint32_t version;
+    uint8_t rigId[16];
+    uint32_t jointCount;
+    uint32_t skinCount;
+    uint32_t jointNodeIdsOffset;
+    uint32_t skinOffset;
+};
+
+constexpr size_t RIG_CHUNK_HEADER_V1_SIZE = sizeof(RigChunkHeaderV1);
+static_assert(std::is_trivially_copyable_v<RigChunkHeaderV1>);
+static_assert(std::is_trivially_copyable_v<RigChunkHeader>);
+static_assert(RIG_CHUNK_HEADER_V1_SIZE == offsetof(RigChunkHeader, jointRecordOffset));
+
+// Joints are stored parents first, so a pose can be composed into model space in one pass.
+struct RigJointRecord
+{
+    int32_t parent; // joint index, -1 for joints without a joint among their ancestors
+    float t[3];     // rest pose, the joint node's local transform
+    float r[4];     // x, y, z, w
+    float s[3];
+    // Transform of the nodes between the joint and its parent joint, usually identity. Joints without a parent joint
+    // are relative to the model's root node instead, whose own transform belongs to the object the rig is on.
+    float parentOffset[16];
+};
+
+// ANIMATIONS chunk: a header, then an AnimationClipEntry per clip. The clips themselves are stored like meshes, as
+// blobs anywhere in the file that are loaded on their own.
+constexpr uint32_t ANIMATION_CHUNK_VERSION = 1;
+
+struct AnimationChunkHeader
+{
+    uint32_t version = ANIMATION_CHUNK_VERSION;
+    uint32_t clipCount = 0;
+    uint32_t clipTableOffset = 0; // AnimationClipEntry[clipCount]
+    uint32_t reserved = 0;
+};
+
+struct AnimationClipEntry
+{
+    uint8_t clipId[16];
+    uint64_t dataOffset; // file absolute, like MeshIndexEntry
+    uint64_t dataSize;
+};
+
+constexpr uint32_t CLIP_MAGIC = MakeFourCC('C', 'L', 'I', 'P');
+constexpr uint32_t CLIP_VERSION = 1;
+
+// Keyframes of every animated channel of a rig's joints. Track (joint * 3 + channel) covers translation, rotation and
+// scale in that order, a track without keys leaves the joint at its rest pose. Offsets are from the clip start.
+struct AnimationClipHeader
+{
+    uint32_t magic = CLIP_MAGIC;
+    uint32_t version = CLIP_VERSION;
+    uint8_t rigId[16];
+    char name[64];
+    float duration = 0.0f; // seconds
+    uint32_t jointCount = 0;
+    uint32_t keyCount = 0;
+    uint32_t trackOffset = 0; // AnimationTrackEntry[jointCount * 3]
+    uint32_t timeOffset = 0;  // float[keyCount], ascending within a track
+    uint32_t valueOffset = 0; // float[4 * keyCount], xyz for translation and scale, xyzw for rotation
+};
+
+struct AnimationTrackEntry
+{
+    uint32_t firstKey;
+    uint32_t keyCount;
 };
 
 struct SceneNode
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "REON/AssetManagement/Asset.h"
+
+#include <cstdint>
+
+namespace REON
+{
+static constexpr uint32_t SHADER_PACK_MAGIC = 0x4B505348u; // "SHPK"
+static constexpr uint16_t SHADER_PACK_VERSION = 1;
+
+// There is one shader pack per cooked project, it is always registered in the manifest under this id.
+static constexpr AssetId SHADER_PACK_ASSET_ID{
+    {'R', 'E', 'O', 'N', '-', 'S', 'H', 'A', 'D', 'E', 'R', '-', 'P', 'A', 'C', 'K'}};
+
+#pragma pack(push, 1)
+
+// Layout: header | entries | string table | SPIR-V blobs. Offsets are from the start of the pack.
+struct ShaderPackHeader
+{
+    uint32_t magic = SHADER_PACK_MAGIC;
+    uint16_t version = SHADER_PACK_VERSION;
+    uint16_t headerSize = sizeof(ShaderPackHeader);
+
+    uint32_t entryCount;
+    uint32_t reserved0;
+
+    uint64_t entriesOffset;
+    uint64_t stringsOffset;
+};
+
+// SPIR-V of one shader source compiled with one set of MaterialShaderFlags
+struct ShaderPackEntry
+{
+    uint32_t sourceOffset; // into string table, the path the shader is requested by
+    uint32_t sourceLength; // bytes (not null-terminated)
+    uint32_t flags;
+    uint32_t reserved0;
+    uint64_t codeOffset;
+    uint64_t codeSize;
+};
+
+#pragma pack(pop)
+} // namespace REON
@@ -5,6 +5,8 @@
 #include "ResourceManagement/loaders/TextureLoader.h"
 #include "ResourceManagement/loaders/MaterialLoader.h"
 #include "ResourceManagement/loaders/RigLoader.h"
+#include "ResourceManagement/loaders/AnimationClipLoader.h"
+#include "ResourceManagement/loaders/ShaderPackLoader.h"
 
 
 namespace REON
@@ -14,9 +16,13 @@ struct EngineServices
     ResourceManager resources;
     IAssetResolver* resolver = nullptr;
     IBlobReader* blobReader = nullptr;
+    // Directory of the cooked manifest, device specific caches are stored next to it
+    std::filesystem::path cookedRoot;
 
     void Init(const std::filesystem::path& cookedRoot, const std::filesystem::path& manifestPath)
     {
+        this->cookedRoot = cookedRoot;
+
         auto tempResolver = std::make_shared<ManifestAssetResolver>();
         tempResolver->StartWatchingFile(manifestPath);
 
@@ -31,6 +37,8 @@ struct EngineServices
         resources.RegisterLoader(std::make_unique<TextureLoader>());
         resources.RegisterLoader(std::make_unique<MeshLoader>());
         resources.RegisterLoader(std::make_unique<RigLoader>());
+        resources.RegisterLoader(std::make_unique<AnimationClipLoader>());
+        resources.RegisterLoader(std::make_unique<ShaderPackLoader>());
     }
 };
 }
\ No newline at end of file
@@ -11,22 +11,62 @@ Animator::Animator(ResourceHandle<Rig> rig) : m_Rig(rig) {}
 void Animator::update(float deltaTime)
 {
     auto rig = m_Rig.Lock();
-    auto object = get_owner();
+    if (!rig || m_SkinPalettes.size() != rig->skins.size())
+        return;
+
+    const std::shared_ptr<AnimationClip> clip = m_Playing ? m_Clip.Lock() : nullptr;
+    if (clip && rig->hasHierarchy)
+        updateFromClip(*rig, *clip, deltaTime);
+    else
+        updateFromJoints(*rig);
+}
+
+void Animator::Play(const ResourceHandle<AnimationClip>& clip, bool loop)
+{
+    m_Clip = clip;
+    m_Loop = loop;
+    m_Time = 0.0f;
+    m_Playing = true;
+}
+
+void Animator::Stop()
+{
+    m_Playing = false;
+}
 
-    for (int i = 0; i < rig->skins.size(); ++i)
+void Animator::updateFromClip(const Rig& rig, const AnimationClip& clip, float deltaTime)
+{
+    m_Time += deltaTime;
+    if (clip.duration > 0.0f)
+        m_Time = m_Loop ? std::fmod(m_Time, clip.duration) : std::min(m_Time, clip.duration);
+
+    m_LocalPose.resize(AnimationSampler::GetGroupCount(rig.joints.size()));
+    m_ModelPose.resize(rig.joints.size());
+    m_Sampler.Sample(clip, rig, m_Time, m_LocalPose);
+    AnimationSampler::ComputeModelPose(rig, m_LocalPose, m_ModelPose);
+
+    // The model pose is relative to the owner, the same space the joint objects hang from
+    const glm::mat4& world = get_owner()->GetTransform()->GetWorldTransform();
+    for (size_t s = 0; s < rig.skins.size(); ++s)
+        AnimationSampler::ComputeSkinPalette(rig.skins[s], world, m_ModelPose, m_SkinPalettes[s]);
+}
+
+void Animator::updateFromJoints(const Rig& rig)
+{
+    for (size_t s = 0; s < rig.skins.size(); ++s)
     {
-        auto& skin = rig->skins[i];
-        auto& bindings = m_SkinJointBindings[i];
-        auto& palette = m_SkinPalettes[i];
+        auto& skin = rig.skins[s];
+        auto& bindings = m_SkinJointBindings[s];
+        auto& palette = m_SkinPalettes[s];
 
         for (size_t i = 0; i < bindings.size(); ++i)
         {
             auto joint = bindings[i].lock();
-            glm::mat4 jointWorld = joint->GetWorldTransform();
-
-            glm::mat4 jointMesh = object->GetTransform()->GetWorldTransform() * jointWorld;
+            if (!joint)
+                continue;
 
-            palette[i] = jointMesh * skin.inverseBindMatrices[i];
+            // Joint objects are children of the owner, their world transform already includes it
+            palette[i] = joint->GetWorldTransform() * skin.inverseBindMatrices[i];
         }
     }
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "REON/GameHierarchy/Components/Component.h"
+#include "REON/Rendering/Animation/AnimationClip.h"
+#include "REON/Rendering/Animation/AnimationSampler.h"
 #include "REON/Rendering/Animation/Rig.h"
 #include "REON/ResourceManagement/Resource.h"
 #include "REON/GameHierarchy/Components/Transform.h"
@@ -26,9 +28,42 @@ class Animator final : public ComponentBase<Animator>
 
     std::vector<glm::mat4> getPalettes();
 
+    // Clips cooked with the model, in import order
+    void SetClips(std::vector<ResourceHandle<AnimationClip>> clips)
+    {
+        m_Clips = std::move(clips);
+    }
+    const std::vector<ResourceHandle<AnimationClip>>& GetClips() const
+    {
+        return m_Clips;
+    }
+
+    // Plays clip from its start. While a clip plays the pose is sampled from it and the joint objects are left alone,
+    // once stopped the palettes follow the joint transforms again.
+    void Play(const ResourceHandle<AnimationClip>& clip, bool loop = true);
+    void Stop();
+    bool IsPlaying() const
+    {
+        return m_Playing;
+    }
+
+  private:
+    void updateFromClip(const Rig& rig, const AnimationClip& clip, float deltaTime);
+    void updateFromJoints(const Rig& rig);
+
   private:
     ResourceHandle<Rig> m_Rig;
 
+    std::vector<ResourceHandle<AnimationClip>> m_Clips;
+    ResourceHandle<AnimationClip> m_Clip;
+    bool m_Playing = false;
+    bool m_Loop = true;
+    float m_Time = 0.0f;
+
+    AnimationSampler m_Sampler;
+    std::vector<SoaTransform> m_LocalPose;
+    std::vector<glm::mat4> m_ModelPose; // per rig joint
+
     std::vector<std::vector<glm::mat4>> m_SkinPalettes;
 
     std::vector<std::vector<std::weak_ptr<Transform>>> m_SkinJointBindings;
@@ -23,6 +23,28 @@ void Renderer::update(float deltaTime)
     }
     m_ModelMatrix = m_Transform->GetWorldTransform();
     m_TransposeInverseModelMatrix = glm::transpose(glm::inverse(m_ModelMatrix));
+
+    updateWorldBounds();
+}
+
+void Renderer::updateWorldBounds()
+{
+    auto meshPtr = mesh.Lock();
+    if (!meshPtr || m_SkinIndex || !meshPtr->bounds.IsValid())
+    {
+        m_WorldBounds = AABB{};
+        m_SubMeshWorldBounds.clear();
+        return;
+    }
+
+    m_WorldBounds = meshPtr->bounds.Transformed(m_ModelMatrix);
+
+    m_SubMeshWorldBounds.resize(meshPtr->subMeshes.size());
+    for (size_t i = 0; i < meshPtr->subMeshes.size(); i++)
+    {
+        const AABB& local = meshPtr->subMeshes[i].bounds;
+        m_SubMeshWorldBounds[i] = local.IsValid() ? local.Transformed(m_ModelMatrix) : m_WorldBounds;
+    }
 }
 
 void Renderer::set_owner(std::shared_ptr<GameObject> owner)
@@ -42,39 +64,6 @@ void Renderer::cleanup()
 Renderer::Renderer(ResourceHandle<Mesh> mesh, std::vector<ResourceHandle<Material>> materials)
     : mesh(std::move(mesh)), materials(materials)
 {
-    const VulkanContext* context = static_cast<const VulkanContext*>(Application::Get().GetRenderContext());
-
-    VkDeviceSize bufferSize = sizeof(ObjectRenderData);
-
-    objectDataBuffers.resize(context->MAX_FRAMES_IN_FLIGHT);
-
-    for (size_t i = 0; i < context->MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        BufferCreateInfo bufCreateInfo;
-        bufCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-        bufCreateInfo.cpuAccess = CpuAccessPattern::SequentialWrite;
-        bufCreateInfo.memoryHint = BufferMemoryHint::CpuToGpu;
-        bufCreateInfo.persistentlyMapped = true;
-        bufCreateInfo.size = bufferSize;
-
-        objectDataBuffers[i] = context->createBuffer(bufCreateInfo);
-    }
-
-    bufferSize = sizeof(glm::mat4);
-
-    shadowObjectDataBuffers.resize(context->MAX_FRAMES_IN_FLIGHT);
-
-    for (size_t i = 0; i < context->MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        BufferCreateInfo bufCreateInfo;
-        bufCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-        bufCreateInfo.cpuAccess = CpuAccessPattern::SequentialWrite;
-        bufCreateInfo.memoryHint = BufferMemoryHint::CpuToGpu;
-        bufCreateInfo.persistentlyMapped = true;
-        bufCreateInfo.size = bufferSize;
-
-        shadowObjectDataBuffers[i] = context->createBuffer(bufCreateInfo);
-    }
 }
 
 Renderer::~Renderer() {}
@@ -96,8 +85,10 @@ void Renderer::RebuildDrawCommands()
     if (!mesh.Lock())
         return;
 
-    for (auto submesh : mesh.Lock()->subMeshes)
+    const auto& subMeshes = mesh.Lock()->subMeshes;
+    for (uint32_t i = 0; i < subMeshes.size(); i++)
     {
+        const SubMesh& submesh = subMeshes[i];
         if (submesh.materialIndex >= materials.size() || submesh.materialIndex < 0)
             continue;
 
@@ -108,6 +99,7 @@ void Renderer::RebuildDrawCommands()
         cmd.shader = {};
         cmd.startIndex = submesh.indexOffset;
         cmd.indexCount = submesh.indexCount;
+        cmd.subMeshIndex = i;
         cmd.owner = this;
         if (m_SkinIndex)
         {
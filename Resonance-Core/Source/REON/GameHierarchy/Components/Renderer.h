@@ -4,9 +4,11 @@
 #include <vector>
 
 #include "REON/GameHierarchy/Components/Component.h"
+#include "REON/Math/AABB.h"
 #include "REON/Rendering/Material.h"
 #include "REON/Rendering/Mesh.h"
 #include "REON/Rendering/Shader.h"
+#include "REON/Rendering/ShadowCascades.h"
 #include "REON/Rendering/Structs/LightData.h"
 #include "glm/glm.hpp"
 #include <REON/Rendering/LightManager.h>
@@ -26,7 +28,14 @@ struct alignas(16) GlobalRenderData
     glm::mat4 viewProj;
     glm::mat4 inverseView;
     int lightCount;
-    glm::vec3 _padding;
+    int globalLightCount; // lights[0, globalLightCount) light every pixel, the rest are found through the clusters
+    glm::vec2 _padding;
+    glm::mat4 view;
+    glm::uvec4 clusterGrid; // cluster counts along x, y and depth
+    glm::vec4 clusterScale; // see LightClusterer::GetClusterScale
+    glm::mat4 shadowCascades[ShadowCascades::MaxCascades]; // main light view projection of each shadow map tile
+    int shadowCascadeCount;
+    glm::vec3 _cascadePadding;
 };
 
 struct alignas(16) ObjectRenderData
@@ -35,7 +44,8 @@ struct alignas(16) ObjectRenderData
     glm::mat4 transposeInverseModel;
     int paletteOffset = -1;
     int jointCount = -1;
-    glm::vec2 _padding;
+    uint32_t materialIndex = 0; // record in the material table, filled in per frame by the render manager
+    float _padding;
 };
 
 class [[clang::annotate("serialize")]] Renderer : public ComponentBase<Renderer>,
@@ -61,6 +71,16 @@ class [[clang::annotate("serialize")]] Renderer : public ComponentBase<Renderer>
         return m_TransposeInverseModelMatrix;
     }
 
+    // Invalid bounds mean the renderer can't be culled (no mesh yet, or skinned past its bind pose).
+    const AABB& GetWorldBounds() const
+    {
+        return m_WorldBounds;
+    }
+    const AABB& GetWorldBounds(uint32_t subMeshIndex) const
+    {
+        return subMeshIndex < m_SubMeshWorldBounds.size() ? m_SubMeshWorldBounds[subMeshIndex] : m_WorldBounds;
+    }
+
     virtual void on_game_object_added_to_scene() override;
     virtual void on_component_detach() override;
 
@@ -82,16 +102,16 @@ class [[clang::annotate("serialize")]] Renderer : public ComponentBase<Renderer>
     std::vector<DrawCommand> drawCommands;
     bool drawCommandsDirty = true;
 
-    std::vector<VkDescriptorSet> objectDescriptorSets;
-    std::vector<BufferHandle> objectDataBuffers{};
-
-    std::vector<VkDescriptorSet> shadowObjectDescriptorSets;
-    std::vector<BufferHandle> shadowObjectDataBuffers;
+  private:
+    void updateWorldBounds();
 
   private:
     glm::mat4 m_ModelMatrix{};
     glm::mat4 m_TransposeInverseModelMatrix{};
 
+    AABB m_WorldBounds;
+    std::vector<AABB> m_SubMeshWorldBounds;
+
     std::shared_ptr<Transform> m_Transform = nullptr;
 
     template <typename ClassType, typename FieldType, FieldType ClassType::* field> friend struct ReflectionAccessor;
@@ -104,6 +124,7 @@ struct DrawCommand
     ResourceHandle<Mesh> mesh;
     uint32_t startIndex;
     uint32_t indexCount;
+    uint32_t subMeshIndex = 0;
     Renderer* owner;
     uint32_t jointCount = 0;
     uint32_t joinOffset = 0;
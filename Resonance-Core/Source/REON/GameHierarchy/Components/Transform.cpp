@@ -13,6 +13,8 @@
 namespace REON
 {
 
+Transform::Transform() : m_Store(TransformStore::Detached()), m_Handle(m_Store->Create()) {}
+
 void Transform::update(float deltaTime) {}
 
 // Set the world transform based on the provided matrix
@@ -24,62 +26,88 @@ void Transform::SetWorldTransform(const glm::mat4& worldTransform)
     glm::mat4 localTransform = glm::inverse(parentWorldTransform) * worldTransform;
 
     // Extract translation
-    localPosition = glm::vec3(localTransform[3]); // Assuming 4th column contains translation
+    glm::vec3 position = glm::vec3(localTransform[3]); // Assuming 4th column contains translation
 
     // Extract scale
-    localScale =
+    glm::vec3 scale =
         glm::vec3(glm::length(localTransform[0]), glm::length(localTransform[1]), glm::length(localTransform[2]));
 
     const float minScale = 0.001f;
-    localScale = glm::max(localScale, glm::vec3(minScale));
+    scale = glm::max(scale, glm::vec3(minScale));
 
     // Remove scale from localTransform to isolate rotation
-    localTransform[0] /= localScale.x;
-    localTransform[1] /= localScale.y;
-    localTransform[2] /= localScale.z;
+    localTransform[0] /= scale.x;
+    localTransform[1] /= scale.y;
+    localTransform[2] /= scale.z;
 
     // Extract rotation using the upper-left 3x3 part
     glm::mat3 rotationMatrix = glm::mat3(localTransform);
     glm::quat quat = glm::normalize(glm::quat_cast(rotationMatrix)); // Convert to quaternion and normalize
 
-    localRotation.x = quat.x;
-    localRotation.y = quat.y;
-    localRotation.z = quat.z;
-    localRotation.w = quat.w;
-    // Optionally, update the local matrix
-    // UpdateLocalMatrix();
+    SetLocalPosition(position);
+    SetLocalRotation(quat);
+    SetLocalScale(scale);
 }
 
 void Transform::SetFromMatrix(const std::vector<float>& matrixData)
 {
-    DecomposeMatrix(matrixData, localPosition, localRotation, localScale);
+    glm::vec3 position;
+    glm::quat rotation;
+    glm::vec3 scale;
+    DecomposeMatrix(matrixData, position, rotation, scale);
+
+    SetLocalPosition(position);
+    SetLocalRotation(rotation);
+    SetLocalScale(scale);
 }
 
-void Transform::UpdateLocalMatrix()
+const glm::vec3& Transform::GetLocalPosition() const
 {
-    glm::mat4 translation = glm::translate(glm::mat4(1.0f), localPosition);
-    glm::mat4 rotation = glm::toMat4(localRotation);
-    glm::mat4 scale = glm::scale(glm::mat4(1.0f), localScale);
+    return m_Store->GetPosition(m_Handle);
+}
 
-    glm::quat q = glm::normalize(localRotation);
-    glm::mat3 R = glm::mat3_cast(q);
+const glm::quat& Transform::GetLocalRotation() const
+{
+    return m_Store->GetRotation(m_Handle);
+}
 
-    std::cout << "quat x=" << q.x << " y=" << q.y << " z=" << q.z << " w=" << q.w << "\n";
+const glm::vec3& Transform::GetLocalScale() const
+{
+    return m_Store->GetScale(m_Handle);
+}
 
-    std::cout << "R columns:\n";
-    std::cout << R[0][0] << " " << R[0][1] << " " << R[0][2] << "\n";
-    std::cout << R[1][0] << " " << R[1][1] << " " << R[1][2] << "\n";
-    std::cout << R[2][0] << " " << R[2][1] << " " << R[2][2] << "\n";
+void Transform::SetLocalPosition(const glm::vec3& position)
+{
+    m_Store->SetPosition(m_Handle, position);
+}
 
-    glm::vec3 right = R * glm::vec3(1, 0, 0);
-    glm::vec3 up = R * glm::vec3(0, 1, 0);
-    glm::vec3 forward = R * glm::vec3(0, 0, -1);
+void Transform::SetLocalRotation(const glm::quat& rotation)
+{
+    m_Store->SetRotation(m_Handle, rotation);
+}
 
-    std::cout << "right   = " << right.x << ", " << right.y << ", " << right.z << "\n";
-    std::cout << "up      = " << up.x << ", " << up.y << ", " << up.z << "\n";
-    std::cout << "forward = " << forward.x << ", " << forward.y << ", " << forward.z << "\n";
+void Transform::SetLocalScale(const glm::vec3& scale)
+{
+    m_Store->SetScale(m_Handle, scale);
+}
+
+void Transform::SetParent(const Transform* parent)
+{
+    const bool sameStore = parent && parent->m_Store == m_Store;
+    m_Store->SetParent(m_Handle, sameStore ? parent->m_Handle : TransformStore::InvalidIndex);
+}
+
+void Transform::MoveToStore(const std::shared_ptr<TransformStore>& store)
+{
+    if (m_Store == store)
+        return;
+
+    const TransformStore::Handle handle =
+        store->Create(GetLocalPosition(), GetLocalRotation(), GetLocalScale());
+    m_Store->Destroy(m_Handle);
 
-    m_LocalMatrix = translation * rotation * scale;
+    m_Store = store;
+    m_Handle = handle;
 }
 
 void Transform::cleanup() {}
@@ -110,46 +138,41 @@ void Transform::DecomposeMatrix(const std::vector<float>& matData, glm::vec3& po
     rotation = glm::quat_cast(rotationMatrix);
 }
 
-Transform::~Transform() {}
+Transform::~Transform()
+{
+    m_Store->Destroy(m_Handle);
+}
 
 glm::mat4 Transform::GetTransformationMatrix() const
 {
-    glm::mat4 translation = glm::translate(glm::mat4(1.0f), localPosition);
-    glm::mat4 rotation = glm::toMat4(localRotation);
-    glm::mat4 scale = glm::scale(glm::mat4(1.0f), localScale);
-    return translation * rotation * scale;
+    return m_Store->GetLocalMatrix(m_Handle);
 }
 
-glm::mat4 Transform::GetWorldTransform() const
+const glm::mat4& Transform::GetWorldTransform() const
 {
-    glm::mat4 translation = glm::translate(glm::mat4(1.0f), localPosition);
-    glm::mat4 rotation = glm::toMat4(localRotation); // Convert quaternion to matrix
-    glm::mat4 scale = glm::scale(glm::mat4(1.0f), localScale);
-
-    return (get_owner()->GetParent() ? get_owner()->GetParent()->GetTransform()->GetWorldTransform()
-                                     : glm::mat4(1.0f)) *
-           translation * rotation * scale;
+    return m_Store->GetWorldMatrix(m_Handle);
 }
 
 glm::vec3 Transform::GetForwardVector() const
 {
-    glm::vec3 forward = glm::mat3_cast(glm::normalize(localRotation)) * glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 forward = glm::mat3_cast(glm::normalize(GetLocalRotation())) * glm::vec3(0.0f, 0.0f, -1.0f);
     return glm::normalize(forward);
 }
 
 glm::vec3 Transform::GetWorldPosition() const
 {
-    glm::mat4 worldTransform = GetWorldTransform();
+    const glm::mat4& worldTransform = GetWorldTransform();
     return glm::vec3(worldTransform[3]); // Extract translation from the world transform
 }
 
 Quaternion Transform::GetWorldRotation() const
 {
-    Quaternion worldRotation = localRotation;
+    Quaternion worldRotation;
+    worldRotation = GetLocalRotation();
     std::shared_ptr<GameObject> parent = get_owner()->GetParent();
     while (parent != nullptr)
     {
-        worldRotation *= parent->GetTransform()->localRotation;
+        worldRotation *= parent->GetTransform()->GetLocalRotation();
         parent = parent->GetParent();
     }
     return worldRotation;
@@ -157,16 +180,16 @@ Quaternion Transform::GetWorldRotation() const
 
 glm::vec3 Transform::GetWorldScale() const
 {
-    glm::vec3 worldScale = localScale;
+    glm::vec3 worldScale = GetLocalScale();
 
     std::shared_ptr<GameObject> parent = get_owner()->GetParent();
     while (parent != nullptr)
     {
-        worldScale *= parent->GetTransform()->localScale;
+        worldScale *= parent->GetTransform()->GetLocalScale();
         parent = parent->GetParent();
     }
 
     return worldScale;
 }
 
-} // namespace REON
\ No newline at end of file
+} // namespace REON
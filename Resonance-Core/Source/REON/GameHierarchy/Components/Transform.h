@@ -1,6 +1,7 @@
 #pragma once
 
 #include "REON/GameHierarchy/Components/Component.h"
+#include "REON/GameHierarchy/TransformStore.h"
 #include "REON/Math/Quaternion.h"
 #include "glm/glm.hpp"
 #include <glm/gtc/type_ptr.hpp>
@@ -11,21 +12,22 @@ class GameObject;
 namespace REON
 {
 
+// Handle into the TransformStore of the scene the owning object lives in. The local position, rotation and scale are
+// stored there, so they can only be changed through the setters.
 class [[clang::annotate("serialize")]] Transform : public ComponentBase<Transform>
 {
   public:
-    Transform()
-        : localPosition(glm::vec3(0.0f)), localRotation(1.0f, 0.0f, 0.0f, 0.0f), localScale(glm::vec3(1.0f)),
-          m_LocalMatrix(1.0f)
-    {
-    }
-
+    Transform();
     ~Transform();
 
+    Transform(const Transform&) = delete;
+    Transform& operator=(const Transform&) = delete;
+
     // Get the transformation matrix
     glm::mat4 GetTransformationMatrix() const;
 
-    glm::mat4 GetWorldTransform() const;
+    // Cached in the store, only rebuilt when this transform or one of its parents changed
+    const glm::mat4& GetWorldTransform() const;
 
     glm::vec3 GetForwardVector() const;
 
@@ -33,32 +35,42 @@ class [[clang::annotate("serialize")]] Transform : public ComponentBase<Transfor
     Quaternion GetWorldRotation() const;
     glm::vec3 GetWorldScale() const;
 
+    const glm::vec3& GetLocalPosition() const;
+    const glm::quat& GetLocalRotation() const;
+    const glm::vec3& GetLocalScale() const;
+
+    void SetLocalPosition(const glm::vec3& position);
+    void SetLocalRotation(const glm::quat& rotation);
+    void SetLocalScale(const glm::vec3& scale);
+
     virtual void update(float deltaTime) override;
 
     void SetWorldTransform(const glm::mat4& matrix);
 
     void SetFromMatrix(const std::vector<float>& matrixData);
 
-    void UpdateLocalMatrix();
+    // Parent has to be in the same store, otherwise this becomes a root until both are moved into one.
+    void SetParent(const Transform* parent);
+    void MoveToStore(const std::shared_ptr<TransformStore>& store);
+
+    const std::shared_ptr<TransformStore>& GetStore() const
+    {
+        return m_Store;
+    }
+    TransformStore::Handle GetHandle() const
+    {
+        return m_Handle;
+    }
 
     virtual void cleanup() override;
 
 
   public:
-    glm::vec3 localPosition;  // Position (translation)
-    Quaternion localRotation; // Quaternion for rotation
     glm::vec3 eulerCache;
-    glm::vec3 localScale; // Scale factors (x, y, z)
 
     bool eulerDirty = true;
 
   private:
-    // Create the rotation matrix from a quaternion
-    static glm::mat4 CreateRotationMatrix(const Quaternion& quat)
-    {
-        return glm::mat4_cast(quat);
-    }
-
     // Inherited via Component
     virtual void on_game_object_added_to_scene() override;
     virtual void on_component_detach() override;
@@ -66,7 +78,8 @@ class [[clang::annotate("serialize")]] Transform : public ComponentBase<Transfor
     void DecomposeMatrix(const std::vector<float>& matData, glm::vec3& position, glm::quat& rotation, glm::vec3& scale);
 
   private:
-    glm::mat4 m_LocalMatrix;
+    std::shared_ptr<TransformStore> m_Store;
+    TransformStore::Handle m_Handle = TransformStore::InvalidIndex;
 
     template <typename ClassType, typename FieldType, FieldType ClassType::* field> friend struct ReflectionAccessor;
 };
@@ -36,6 +36,11 @@ namespace REON {
 	void GameLogicLayer::OnUpdate()
 	{
 		CheckKeyPressed();
+		Simulate();
+	}
+
+	void GameLogicLayer::Simulate()
+	{
 		if (auto scene = SceneManager::Get()->GetCurrentScene()) {
 			scene->UpdateScene(deltaTime);
 		}
@@ -72,14 +77,14 @@ namespace REON {
 		//    cube->GetTransform()->localScale = glm::vec3(0.5f, 0.5f, 0.5f);
 		//    cube->GetTransform()->localRotation.setFromEulerAngles(0.0f, 12.5f, 0.0f);
 
-		backPack->GetTransform()->localPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+		backPack->GetTransform()->SetLocalPosition(glm::vec3(0.0f, 0.0f, 0.0f));
 		//backPack->GetTransform()->localScale = glm::vec3(0.01f, 0.01f, 0.01f);
 
 		std::shared_ptr<GameObject> light = std::make_shared<GameObject>();
 		std::shared_ptr<Light> lightComponent = std::make_shared<Light>(LightType::Point, 10, glm::vec3(30.0f, 0.5f, 0.5f));
 		m_Scene->AddGameObject(light);
 		light->AddComponent<Light>(lightComponent);
-		light->GetTransform()->localPosition = glm::vec3(-7, 3, 3);
+		light->GetTransform()->SetLocalPosition(glm::vec3(-7, 3, 3));
 		light->SetName("light1");
 		m_Scene->lightManager->AddLight(lightComponent);
 
@@ -87,7 +92,7 @@ namespace REON {
 		std::shared_ptr<Light> lightComponent2 = std::make_shared<Light>(LightType::Point, 3, glm::vec3(1.0f, 1.0f, 1.0f));
 		m_Scene->AddGameObject(light2);
 		light2->AddComponent<Light>(lightComponent2);
-		light2->GetTransform()->localPosition = glm::vec3(-5, 4, 3);
+		light2->GetTransform()->SetLocalPosition(glm::vec3(-5, 4, 3));
 		light2->SetName("light2");
 		m_Scene->lightManager->AddLight(lightComponent2);
 
@@ -95,7 +100,9 @@ namespace REON {
 		std::shared_ptr<Light> lightComponent4 = std::make_shared<Light>(LightType::Directional, 3, glm::vec3(1, 1, 1));
 		m_Scene->AddGameObject(light3);
 		light3->AddComponent<Light>(lightComponent4);
-		light3->GetTransform()->localRotation.setFromEulerAngles(110, 0, 0);
+		Quaternion light3Rotation;
+		light3Rotation.setFromEulerAngles(110, 0, 0);
+		light3->GetTransform()->SetLocalRotation(light3Rotation);
 		light3->SetName("light3");
 		m_Scene->lightManager->AddLight(lightComponent4);
 	}
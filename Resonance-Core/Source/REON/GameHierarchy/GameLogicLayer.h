@@ -22,6 +22,9 @@ namespace REON {
 		void OnUpdate() override;
 		void OnImGuiRender() override;
 
+		// The scene update part of OnUpdate, without polling input. Safe to run off the main thread.
+		void Simulate();
+
 		void InitializeTestScene();
 
 		void CheckKeyPressed();
@@ -58,6 +58,11 @@ std::shared_ptr<GameObject> GameObject::GetParent()
 void GameObject::SetParent(std::shared_ptr<GameObject> newParent)
 {
     m_Parent = std::move(newParent);
+    if (m_Transform)
+    {
+        auto parent = m_Parent.lock();
+        m_Transform->SetParent(parent ? parent->GetTransform().get() : nullptr);
+    }
 }
 
 std::shared_ptr<Transform> GameObject::GetTransform()
@@ -78,6 +83,8 @@ void GameObject::SetScene(std::shared_ptr<Scene> newScene)
     else
         m_Scene = newScene; // Explicitly reset scene
     m_Transform->set_owner(shared_from_this());
+    if (newScene)
+        MoveTransformsToStore(newScene->GetTransformStore());
     for (const auto& component : m_Components)
     {
         component->on_game_object_added_to_scene();
@@ -99,6 +106,17 @@ void GameObject::OnGameObjectDeleted()
     m_Transform.reset();
 }
 
+void GameObject::MoveTransformsToStore(const std::shared_ptr<TransformStore>& store)
+{
+    // Children may have been attached while this object was not in a scene yet, they follow it into the new store.
+    m_Transform->MoveToStore(store);
+    if (auto parent = GetParent())
+        m_Transform->SetParent(parent->GetTransform().get());
+
+    for (const auto& child : m_Children)
+        child->MoveTransformsToStore(store);
+}
+
 bool GameObject::IsDescendantOf(std::shared_ptr<GameObject> other) const
 {
     auto parent = m_Parent.lock();
@@ -12,6 +12,7 @@ namespace REON
 
 class Scene;
 class Transform;
+class TransformStore;
 
 class [[clang::annotate("serialize")]] GameObject : public Object, public std::enable_shared_from_this<GameObject>
 {
@@ -90,6 +91,7 @@ class [[clang::annotate("serialize")]] GameObject : public Object, public std::e
 
   private:
     void SetParent(std::shared_ptr<GameObject> newParent);
+    void MoveTransformsToStore(const std::shared_ptr<TransformStore>& store);
 
   private:
     std::vector<std::shared_ptr<Component>> m_Components;
@@ -2,6 +2,7 @@
 
 #include "Scene.h"
 
+#include "REON/Application.h"
 #include "REON/GameHierarchy/Components/Transform.h"
 #include "REON/GameHierarchy/GameObject.h"
 
@@ -22,12 +23,20 @@ void Scene::DeleteGameObject(std::shared_ptr<GameObject> gameObject)
 
 void Scene::UpdateScene(float deltaTime)
 {
+    UpdateTransforms();
+
     for (const auto& gameObject : m_GameObjects)
     {
         gameObject->update(deltaTime);
     }
 }
 
+void Scene::UpdateTransforms()
+{
+    // One linear sweep over the store, level by level, instead of walking the object tree.
+    m_TransformStore->Update(&Application::Get().GetJobSystem());
+}
+
 void Scene::ProcessGameObjectAddingAndDeletion()
 {
     for (const auto gameObject : m_GameObjectsToAdd)
@@ -56,7 +65,9 @@ void Scene::InitializeSceneWithObjects()
     std::shared_ptr<Light> lightComponent = std::make_shared<Light>(LightType::Directional, 3, glm::vec3(1, 1, 1));
     AddGameObject(MainLight);
     MainLight->AddComponent<Light>(lightComponent);
-    MainLight->GetTransform()->localRotation.setFromEulerAngles(110, 0, 0);
+    Quaternion rotation;
+    rotation.setFromEulerAngles(110, 0, 0);
+    MainLight->GetTransform()->SetLocalRotation(rotation);
     MainLight->SetName("MainLight");
 }
 
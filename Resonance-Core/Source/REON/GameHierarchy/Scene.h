@@ -2,6 +2,7 @@
 
 #include "REON/EditorCamera.h"
 #include "REON/GameHierarchy/GameObject.h"
+#include "REON/GameHierarchy/TransformStore.h"
 #include "REON/Rendering/LightManager.h"
 #include "REON/Rendering/RenderManager.h"
 #include <memory>
@@ -21,11 +22,16 @@ class [[clang::annotate("serialize")]] Scene : public Object, public std::enable
     void AddGameObject(std::shared_ptr<GameObject> gameObject);
     void DeleteGameObject(std::shared_ptr<GameObject> gameObject);
     void UpdateScene(float deltaTime);
+    void UpdateTransforms();
     void ProcessGameObjectAddingAndDeletion();
     void InitializeSceneWithObjects();
     std::shared_ptr<GameObject> GetGameObject(int index);
     std::vector<std::shared_ptr<GameObject>> GetRootObjects();
     std::shared_ptr<EditorCamera> GetEditorCamera();
+    const std::shared_ptr<TransformStore>& GetTransformStore() const
+    {
+        return m_TransformStore;
+    }
 
   public:
     // std::shared_ptr<EditorCamera> camera;
@@ -39,6 +45,8 @@ class [[clang::annotate("serialize")]] Scene : public Object, public std::enable
     std::vector<std::weak_ptr<GameObject>> m_GameObjectsToDelete;
     std::vector<std::shared_ptr<GameObject>> m_GameObjectsToAdd;
 
+    std::shared_ptr<TransformStore> m_TransformStore = std::make_shared<TransformStore>();
+
     template <typename ClassType, typename FieldType, FieldType ClassType::* field> friend struct ReflectionAccessor;
 };
 
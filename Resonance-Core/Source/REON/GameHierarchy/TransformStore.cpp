@@ -0,0 +1,380 @@
+#include "reonpch.h"
+
+#include "TransformStore.h"
+
+#include "REON/Jobs/JobSystem.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define REON_TRANSFORM_SSE 1
+#include <xmmintrin.h>
+#else
+#define REON_TRANSFORM_SSE 0
+#endif
+
+namespace REON
+{
+
+namespace
+{
+// Below this many nodes a level is cheaper to update inline than to hand out.
+constexpr uint32_t ParallelLevelThreshold = 2048;
+constexpr uint32_t ParallelBatchSize = 512;
+
+// Column major out = a * b. Every output column is a linear combination of a's columns, four lanes at a time.
+inline void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#if REON_TRANSFORM_SSE
+    const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+    for (int column = 0; column < 4; column++)
+    {
+        __m128 result = _mm_mul_ps(a0, _mm_set1_ps(b[column][0]));
+        result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+        result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+        result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+        _mm_storeu_ps(&out[column][0], result);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+inline glm::mat4 ComposeLocal(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    glm::mat4 local = glm::mat4_cast(rotation);
+    local[0] *= scale.x;
+    local[1] *= scale.y;
+    local[2] *= scale.z;
+    local[3] = glm::vec4(position, 1.0f);
+    return local;
+}
+} // namespace
+
+const std::shared_ptr<TransformStore>& TransformStore::Detached()
+{
+    static const std::shared_ptr<TransformStore> store = std::make_shared<TransformStore>();
+    return store;
+}
+
+TransformStore::Handle TransformStore::Create(const glm::vec3& position, const glm::quat& rotation,
+                                              const glm::vec3& scale)
+{
+    Handle handle;
+    if (!m_FreeHandles.empty())
+    {
+        handle = m_FreeHandles.back();
+        m_FreeHandles.pop_back();
+    }
+    else
+    {
+        handle = static_cast<Handle>(m_HandleToIndex.size());
+        m_HandleToIndex.push_back(InvalidIndex);
+    }
+
+    m_HandleToIndex[handle] = static_cast<uint32_t>(m_Positions.size());
+
+    m_Positions.push_back(position);
+    m_Rotations.push_back(rotation);
+    m_Scales.push_back(scale);
+    m_Parents.push_back(InvalidIndex);
+    m_FirstChild.push_back(0);
+    m_ChildCount.push_back(0);
+    m_WorldMatrices.emplace_back(1.0f);
+    m_Dirty.push_back(1);
+    m_Alive.push_back(1);
+    m_IndexToHandle.push_back(handle);
+
+    // Appended at the end as a root, which breaks the level ranges until the next rebuild.
+    m_OrderDirty = true;
+    return handle;
+}
+
+void TransformStore::Destroy(Handle handle)
+{
+    // Left as a tombstone so the dense indices other nodes point at stay valid until the order is rebuilt.
+    const uint32_t index = m_HandleToIndex[handle];
+    m_Alive[index] = 0;
+    m_DeadCount++;
+    m_OrderDirty = true;
+
+    // Stores that never get updated (the detached one) would otherwise only grow.
+    if (m_DeadCount > 64 && m_DeadCount * 2 > m_Positions.size())
+        rebuildOrder();
+}
+
+void TransformStore::SetParent(Handle handle, Handle parent)
+{
+    const uint32_t index = m_HandleToIndex[handle];
+    const uint32_t parentIndex = parent == InvalidIndex ? InvalidIndex : m_HandleToIndex[parent];
+    if (m_Parents[index] == parentIndex)
+        return;
+
+    m_Parents[index] = parentIndex;
+    m_Dirty[index] = 1;
+    m_OrderDirty = true;
+}
+
+void TransformStore::SetPosition(Handle handle, const glm::vec3& position)
+{
+    const uint32_t index = m_HandleToIndex[handle];
+    m_Positions[index] = position;
+    markDirty(index);
+}
+
+void TransformStore::SetRotation(Handle handle, const glm::quat& rotation)
+{
+    const uint32_t index = m_HandleToIndex[handle];
+    m_Rotations[index] = rotation;
+    markDirty(index);
+}
+
+void TransformStore::SetScale(Handle handle, const glm::vec3& scale)
+{
+    const uint32_t index = m_HandleToIndex[handle];
+    m_Scales[index] = scale;
+    markDirty(index);
+}
+
+glm::mat4 TransformStore::GetLocalMatrix(Handle handle) const
+{
+    const uint32_t index = m_HandleToIndex[handle];
+    return ComposeLocal(m_Positions[index], m_Rotations[index], m_Scales[index]);
+}
+
+const glm::mat4& TransformStore::GetWorldMatrix(Handle handle)
+{
+    const uint32_t index = m_HandleToIndex[handle];
+    if (!m_OrderDirty && !m_Dirty[index])
+        return m_WorldMatrices[index];
+    return resolveWorld(index);
+}
+
+void TransformStore::Update(JobSystem* jobSystem)
+{
+    if (m_OrderDirty)
+        rebuildOrder();
+
+    // Nodes of one level only read world matrices of earlier levels, so a level can be split freely as long as it is
+    // finished before the next one starts.
+    for (size_t level = 0; level + 1 < m_LevelOffsets.size(); level++)
+    {
+        const uint32_t levelBegin = m_LevelOffsets[level];
+        const uint32_t levelEnd = m_LevelOffsets[level + 1];
+        if (!jobSystem || levelEnd - levelBegin < ParallelLevelThreshold)
+        {
+            updateRange(levelBegin, levelEnd);
+            continue;
+        }
+
+        jobSystem->ParallelFor(levelEnd - levelBegin, ParallelBatchSize,
+                               [this, levelBegin](uint32_t begin, uint32_t end)
+                               { updateRange(levelBegin + begin, levelBegin + end); });
+    }
+}
+
+void TransformStore::markDirty(uint32_t index)
+{
+    if (m_OrderDirty)
+    {
+        // Child ranges are stale, the rebuild pushes this flag down instead.
+        m_Dirty[index] = 1;
+        return;
+    }
+
+    // A dirty node always has dirty descendants, so already flagged subtrees are skipped.
+    if (m_Dirty[index])
+        return;
+
+    m_DirtyStack.assign(1, index);
+    while (!m_DirtyStack.empty())
+    {
+        const uint32_t current = m_DirtyStack.back();
+        m_DirtyStack.pop_back();
+        m_Dirty[current] = 1;
+
+        const uint32_t end = m_FirstChild[current] + m_ChildCount[current];
+        for (uint32_t child = m_FirstChild[current]; child < end; child++)
+        {
+            if (!m_Dirty[child])
+                m_DirtyStack.push_back(child);
+        }
+    }
+}
+
+const glm::mat4& TransformStore::resolveWorld(uint32_t index)
+{
+    // While the order is stale a clean flag proves nothing about the parents, so the whole chain is recomputed and
+    // the flags are left for Update to clear.
+    if (!m_OrderDirty && !m_Dirty[index])
+        return m_WorldMatrices[index];
+
+    const glm::mat4 local = ComposeLocal(m_Positions[index], m_Rotations[index], m_Scales[index]);
+    const uint32_t parent = m_Parents[index];
+    if (parent != InvalidIndex)
+        MultiplyMatrices(resolveWorld(parent), local, m_WorldMatrices[index]);
+    else
+        m_WorldMatrices[index] = local;
+
+    if (!m_OrderDirty)
+        m_Dirty[index] = 0;
+    return m_WorldMatrices[index];
+}
+
+void TransformStore::updateRange(uint32_t begin, uint32_t end)
+{
+    static const glm::mat4 identity(1.0f);
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        if (!m_Dirty[i])
+            continue;
+
+        const uint32_t parent = m_Parents[i];
+        const glm::mat4 local = ComposeLocal(m_Positions[i], m_Rotations[i], m_Scales[i]);
+        MultiplyMatrices(parent != InvalidIndex ? m_WorldMatrices[parent] : identity, local, m_WorldMatrices[i]);
+        m_Dirty[i] = 0;
+    }
+}
+
+void TransformStore::rebuildOrder()
+{
+    const uint32_t count = static_cast<uint32_t>(m_Positions.size());
+
+    // Children per node as one flat array, so the breadth first walk below touches no per node allocations.
+    std::vector<uint32_t> childStart(count + 1, 0);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t parent = m_Parents[i];
+        if (m_Alive[i] && parent != InvalidIndex && m_Alive[parent])
+            childStart[parent + 1]++;
+    }
+    for (uint32_t i = 0; i < count; i++)
+        childStart[i + 1] += childStart[i];
+
+    std::vector<uint32_t> children(childStart[count]);
+    std::vector<uint32_t> cursor(childStart.begin(), childStart.end() - 1);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t parent = m_Parents[i];
+        if (m_Alive[i] && parent != InvalidIndex && m_Alive[parent])
+            children[cursor[parent]++] = i;
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(count - m_DeadCount);
+    std::vector<uint32_t> firstChild;
+    std::vector<uint32_t> childCount;
+    std::vector<uint8_t> visited(count, 0);
+    m_LevelOffsets.assign(1, 0);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t parent = m_Parents[i];
+        if (m_Alive[i] && (parent == InvalidIndex || !m_Alive[parent]))
+        {
+            // Orphaned by a destroyed parent, the cached world matrix still contains that parent.
+            if (parent != InvalidIndex)
+                m_Dirty[i] = 1;
+            order.push_back(i);
+            visited[i] = 1;
+        }
+    }
+
+    size_t levelBegin = 0;
+    while (levelBegin < order.size())
+    {
+        const size_t levelEnd = order.size();
+        for (size_t k = levelBegin; k < levelEnd; k++)
+        {
+            const uint32_t node = order[k];
+            firstChild.push_back(static_cast<uint32_t>(order.size()));
+            childCount.push_back(childStart[node + 1] - childStart[node]);
+            for (uint32_t c = childStart[node]; c < childStart[node + 1]; c++)
+            {
+                order.push_back(children[c]);
+                visited[children[c]] = 1;
+            }
+        }
+        m_LevelOffsets.push_back(static_cast<uint32_t>(levelEnd));
+        levelBegin = levelEnd;
+    }
+
+    if (order.size() != count - m_DeadCount)
+    {
+        // Only a parent cycle leaves live nodes unreachable from a root. Walking up from an unreached node always ends
+        // in the cycle, the first node seen twice is detached and everything below it stays attached.
+        std::vector<uint32_t> walkStamp(count, InvalidIndex);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (!m_Alive[i] || visited[i])
+                continue;
+
+            uint32_t node = i;
+            while (node != InvalidIndex && !visited[node] && walkStamp[node] != i)
+            {
+                walkStamp[node] = i;
+                node = m_Parents[node];
+            }
+
+            if (node != InvalidIndex && !visited[node] && walkStamp[node] == i)
+            {
+                REON_CORE_ERROR("Transform hierarchy contains a parent cycle, detaching one transform to break it");
+                m_Parents[node] = InvalidIndex;
+                visited[node] = 1;
+            }
+        }
+        rebuildOrder();
+        return;
+    }
+
+    std::vector<uint32_t> oldToNew(count, InvalidIndex);
+    for (uint32_t i = 0; i < order.size(); i++)
+        oldToNew[order[i]] = i;
+
+    auto gather = [&](auto& stream) {
+        std::remove_reference_t<decltype(stream)> sorted;
+        sorted.reserve(order.size());
+        for (uint32_t old : order)
+            sorted.push_back(stream[old]);
+        stream.swap(sorted);
+    };
+    gather(m_Positions);
+    gather(m_Rotations);
+    gather(m_Scales);
+    gather(m_WorldMatrices);
+    gather(m_Dirty);
+    gather(m_Parents);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (!m_Alive[i])
+        {
+            m_HandleToIndex[m_IndexToHandle[i]] = InvalidIndex;
+            m_FreeHandles.push_back(m_IndexToHandle[i]);
+        }
+    }
+    gather(m_IndexToHandle);
+    for (uint32_t i = 0; i < order.size(); i++)
+        m_HandleToIndex[m_IndexToHandle[i]] = i;
+
+    // Parents come before their children now, so one forward pass both remaps them and pushes dirty flags down.
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        uint32_t& parent = m_Parents[i];
+        parent = (parent != InvalidIndex && oldToNew[parent] != InvalidIndex) ? oldToNew[parent] : InvalidIndex;
+        if (parent != InvalidIndex)
+            m_Dirty[i] |= m_Dirty[parent];
+    }
+
+    m_FirstChild.swap(firstChild);
+    m_ChildCount.swap(childCount);
+    m_Alive.assign(order.size(), 1);
+
+    m_DeadCount = 0;
+    m_OrderDirty = false;
+}
+
+} // namespace REON
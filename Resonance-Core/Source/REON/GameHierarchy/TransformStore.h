@@ -0,0 +1,102 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace REON
+{
+
+class JobSystem;
+
+// Scene owned structure-of-arrays storage for every transform in the hierarchy. Nodes are kept in breadth first order,
+// so each depth level is one contiguous range whose parents all live in earlier ranges, and the children of a node are
+// contiguous in the next one. Transform components only hold a handle into this store.
+class TransformStore
+{
+  public:
+    using Handle = uint32_t;
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    // Transforms that are not part of a scene yet live here until their object is added to one.
+    static const std::shared_ptr<TransformStore>& Detached();
+
+    Handle Create(const glm::vec3& position = glm::vec3(0.0f),
+                  const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                  const glm::vec3& scale = glm::vec3(1.0f));
+    void Destroy(Handle handle);
+
+    // Pass InvalidIndex to make the node a root. Parents have to live in the same store.
+    void SetParent(Handle handle, Handle parent);
+
+    const glm::vec3& GetPosition(Handle handle) const
+    {
+        return m_Positions[m_HandleToIndex[handle]];
+    }
+    const glm::quat& GetRotation(Handle handle) const
+    {
+        return m_Rotations[m_HandleToIndex[handle]];
+    }
+    const glm::vec3& GetScale(Handle handle) const
+    {
+        return m_Scales[m_HandleToIndex[handle]];
+    }
+
+    void SetPosition(Handle handle, const glm::vec3& position);
+    void SetRotation(Handle handle, const glm::quat& rotation);
+    void SetScale(Handle handle, const glm::vec3& scale);
+
+    glm::mat4 GetLocalMatrix(Handle handle) const;
+    // Up to date even between Update calls, stale nodes are resolved through their parent chain on demand.
+    const glm::mat4& GetWorldMatrix(Handle handle);
+
+    // Restores breadth first order if the hierarchy changed, then rebuilds every stale world matrix level by level. Wide
+    // levels are split across the job system when one is given.
+    void Update(JobSystem* jobSystem = nullptr);
+
+    size_t Size() const
+    {
+        return m_Positions.size() - m_DeadCount;
+    }
+    size_t GetLevelCount() const
+    {
+        return m_LevelOffsets.empty() ? 0 : m_LevelOffsets.size() - 1;
+    }
+
+  private:
+    void markDirty(uint32_t index);
+    const glm::mat4& resolveWorld(uint32_t index);
+    void updateRange(uint32_t begin, uint32_t end);
+    void rebuildOrder();
+
+  private:
+    // Dense, indexed by position in breadth first order
+    std::vector<glm::vec3> m_Positions;
+    std::vector<glm::quat> m_Rotations;
+    std::vector<glm::vec3> m_Scales;
+    std::vector<uint32_t> m_Parents;
+    std::vector<uint32_t> m_FirstChild;
+    std::vector<uint32_t> m_ChildCount;
+    std::vector<glm::mat4> m_WorldMatrices;
+    std::vector<uint8_t> m_Dirty;
+    std::vector<uint8_t> m_Alive;
+    std::vector<Handle> m_IndexToHandle;
+
+    std::vector<uint32_t> m_HandleToIndex;
+    std::vector<Handle> m_FreeHandles;
+
+    // m_LevelOffsets[d]..m_LevelOffsets[d + 1] is depth d
+    std::vector<uint32_t> m_LevelOffsets;
+
+    // Set when nodes were added, removed or reparented. Until the next rebuild the child ranges and level offsets are
+    // stale, so dirty flags are not pushed down and world matrices are resolved through the parent chain instead.
+    bool m_OrderDirty = false;
+    size_t m_DeadCount = 0;
+
+    std::vector<uint32_t> m_DirtyStack;
+};
+
+} // namespace REON
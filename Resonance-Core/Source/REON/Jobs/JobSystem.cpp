@@ -0,0 +1,252 @@
+#include "reonpch.h"
+
+#include "JobSystem.h"
+
+namespace REON
+{
+
+namespace
+{
+thread_local const JobSystem* s_WorkerOwner = nullptr;
+thread_local uint32_t s_WorkerIndex = JobSystem::InvalidWorker;
+} // namespace
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+    if (workerCount == 0)
+    {
+        const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    m_Queues.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++)
+        m_Queues.push_back(std::make_unique<WorkerQueue>());
+
+    m_Workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++)
+        m_Workers.emplace_back(&JobSystem::workerLoop, this, i);
+
+    REON_CORE_INFO("Job system started with {} workers", workerCount);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_ShuttingDown = true;
+    }
+    m_WakeCondition.notify_all();
+
+    for (std::thread& worker : m_Workers)
+        worker.join();
+}
+
+void JobSystem::Run(JobFunction job, JobCounter* counter, JobCounter* dependency, JobAffinity affinity)
+{
+    if (counter)
+        counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+    Job entry{std::move(job), counter, affinity};
+    if (dependency)
+    {
+        // Checked under the lock finish() takes, so the job is either parked before the dependency completes or
+        // pushed right away, never dropped in between.
+        std::lock_guard<std::mutex> lock(dependency->m_ContinuationMutex);
+        if (!dependency->IsDone())
+        {
+            dependency->m_Continuations.emplace_back(
+                [this, entry = std::move(entry)]() mutable { push(std::move(entry)); });
+            return;
+        }
+    }
+
+    push(std::move(entry));
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+    while (!counter.IsDone())
+    {
+        Job job;
+        if (tryPop(job))
+            execute(job);
+        else
+            std::this_thread::yield();
+    }
+
+    // The last job may still be inside finish() releasing continuations, the counter is only safe to destroy after it
+    // let go of the lock.
+    std::lock_guard<std::mutex> lock(counter.m_ContinuationMutex);
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const RangeFunction& function)
+{
+    if (count == 0)
+        return;
+
+    batchSize = std::max(batchSize, 1u);
+    if (count <= batchSize)
+    {
+        function(0, count);
+        return;
+    }
+
+    JobCounter counter;
+    for (uint32_t begin = 0; begin < count; begin += batchSize)
+    {
+        const uint32_t end = std::min(begin + batchSize, count);
+        Run([&function, begin, end]() { function(begin, end); }, &counter);
+    }
+    Wait(counter);
+}
+
+uint32_t JobSystem::GetCurrentWorkerIndex()
+{
+    return s_WorkerIndex;
+}
+
+void JobSystem::workerLoop(uint32_t workerIndex)
+{
+    s_WorkerOwner = this;
+    s_WorkerIndex = workerIndex;
+
+    while (true)
+    {
+        Job job;
+        if (tryPop(job))
+        {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_SleepMutex);
+        m_WakeCondition.wait(lock, [this]() {
+            return m_ShuttingDown || m_QueuedJobs.load(std::memory_order_acquire) > 0;
+        });
+
+        // Queued work is drained before shutting down so no counter is left waiting forever.
+        if (m_ShuttingDown && m_QueuedJobs.load(std::memory_order_acquire) == 0)
+            return;
+    }
+}
+
+void JobSystem::push(Job job)
+{
+    WorkerQueue& queue = job.affinity == JobAffinity::Worker ? m_WorkerOnlyQueue
+                         : s_WorkerOwner == this           ? *m_Queues[s_WorkerIndex]
+                                                           : m_SharedQueue;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+
+    m_QueuedJobs.fetch_add(1, std::memory_order_release);
+    {
+        // Taken so a worker between checking the predicate and going to sleep cannot miss this notification.
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+    }
+    m_WakeCondition.notify_one();
+}
+
+bool JobSystem::tryPop(Job& job)
+{
+    if (m_QueuedJobs.load(std::memory_order_acquire) == 0)
+        return false;
+
+    const bool isWorker = s_WorkerOwner == this;
+    if (isWorker)
+    {
+        {
+            // Newest first on the own deque, the data it touches is most likely still in cache.
+            WorkerQueue& queue = *m_Queues[s_WorkerIndex];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty())
+            {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+                m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_WorkerOnlyQueue.mutex);
+        if (!m_WorkerOnlyQueue.jobs.empty())
+        {
+            job = std::move(m_WorkerOnlyQueue.jobs.front());
+            m_WorkerOnlyQueue.jobs.pop_front();
+            m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_SharedQueue.mutex);
+        if (!m_SharedQueue.jobs.empty())
+        {
+            job = std::move(m_SharedQueue.jobs.front());
+            m_SharedQueue.jobs.pop_front();
+            m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return trySteal(isWorker ? s_WorkerIndex : InvalidWorker, job);
+}
+
+bool JobSystem::trySteal(uint32_t thiefIndex, Job& job)
+{
+    const uint32_t queueCount = static_cast<uint32_t>(m_Queues.size());
+    const uint32_t start = thiefIndex == InvalidWorker ? 0 : thiefIndex + 1;
+    for (uint32_t i = 0; i < queueCount; i++)
+    {
+        const uint32_t victim = (start + i) % queueCount;
+        if (victim == thiefIndex)
+            continue;
+
+        // Oldest first from the victim, those are the largest chunks of work left and the least likely to be hot in
+        // the victim's cache.
+        WorkerQueue& queue = *m_Queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(Job& job)
+{
+    try
+    {
+        job.function();
+    }
+    catch (const std::exception& ex)
+    {
+        REON_CORE_ERROR("Job threw an exception: {}", ex.what());
+    }
+
+    finish(job.counter);
+}
+
+void JobSystem::finish(JobCounter* counter)
+{
+    if (!counter)
+        return;
+
+    std::vector<std::function<void()>> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_ContinuationMutex);
+        if (counter->m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            continuations.swap(counter->m_Continuations);
+    }
+
+    for (auto& continuation : continuations)
+        continuation();
+}
+
+} // namespace REON
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace REON
+{
+
+class JobSystem;
+
+// Counts the jobs that were started with it and have not finished yet. Waiting on a counter helps running other jobs
+// instead of blocking, and jobs can be held back until a counter drops to zero to express dependencies.
+class JobCounter
+{
+  public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const
+    {
+        return m_Pending.load(std::memory_order_acquire) == 0;
+    }
+
+  private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_Pending = 0;
+
+    // Jobs waiting for this counter, released by whichever job brings it to zero.
+    mutable std::mutex m_ContinuationMutex;
+    std::vector<std::function<void()>> m_Continuations;
+};
+
+// Which threads may pick a job up. Threads outside the pool run queued jobs while they wait, which is what keeps
+// them busy, but a long job they happen to pick up stalls them until it is done.
+enum class JobAffinity : uint8_t
+{
+    Any,    // any worker, or a thread outside the pool that waits on a counter
+    Worker, // only pool workers, for long jobs that run next to a thread outside the pool
+};
+
+// Fixed pool of worker threads, each owning a deque. Workers pop their own jobs from the back and steal from the
+// front of the others when they run dry, threads outside the pool submit into a shared queue. The thread that calls
+// Wait runs jobs as well, so a pool of N workers keeps N + 1 cores busy. JobAffinity::Worker jobs sit in a queue of
+// their own that only workers drain.
+class JobSystem
+{
+  public:
+    using JobFunction = std::function<void()>;
+    using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+
+    // 0 sizes the pool to the machine, leaving one core for the thread that owns it.
+    explicit JobSystem(uint32_t workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // counter may be null for fire and forget jobs. When dependency is given the job only starts once it is done.
+    void Run(JobFunction job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr,
+             JobAffinity affinity = JobAffinity::Any);
+
+    // Blocks until the counter is done, executing queued jobs in the meantime.
+    void Wait(const JobCounter& counter);
+
+    // Splits [0, count) into batches of batchSize and waits for all of them. Small ranges run inline.
+    void ParallelFor(uint32_t count, uint32_t batchSize, const RangeFunction& function);
+
+    uint32_t GetWorkerCount() const
+    {
+        return static_cast<uint32_t>(m_Workers.size());
+    }
+
+    // Index of the calling worker, or InvalidWorker on threads outside the pool.
+    static uint32_t GetCurrentWorkerIndex();
+    static constexpr uint32_t InvalidWorker = UINT32_MAX;
+
+  private:
+    struct Job
+    {
+        JobFunction function;
+        JobCounter* counter = nullptr;
+        JobAffinity affinity = JobAffinity::Any;
+    };
+
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void workerLoop(uint32_t workerIndex);
+    void push(Job job);
+    bool tryPop(Job& job);
+    bool trySteal(uint32_t thiefIndex, Job& job);
+    void execute(Job& job);
+    void finish(JobCounter* counter);
+
+  private:
+    std::vector<std::thread> m_Workers;
+    std::vector<std::unique_ptr<WorkerQueue>> m_Queues;
+
+    // Jobs submitted from threads outside the pool
+    WorkerQueue m_SharedQueue;
+    // JobAffinity::Worker jobs, from any thread, only ever popped by workers
+    WorkerQueue m_WorkerOnlyQueue;
+
+    std::atomic<uint32_t> m_QueuedJobs = 0;
+    std::mutex m_SleepMutex;
+    std::condition_variable m_WakeCondition;
+    bool m_ShuttingDown = false;
+};
+
+} // namespace REON
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <limits>
+
+namespace REON
+{
+
+struct AABB
+{
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+    bool IsValid() const
+    {
+        return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+    }
+
+    void Expand(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    glm::vec3 GetCenter() const
+    {
+        return (min + max) * 0.5f;
+    }
+
+    glm::vec3 GetExtents() const
+    {
+        return (max - min) * 0.5f;
+    }
+
+    // Bounds of the box after an affine transform, the extents are projected onto the absolute basis vectors so the
+    // result stays tight for rotations without touching all eight corners.
+    AABB Transformed(const glm::mat4& matrix) const
+    {
+        const glm::vec3 center = glm::vec3(matrix * glm::vec4(GetCenter(), 1.0f));
+        const glm::vec3 extents = glm::abs(glm::vec3(matrix[0])) * GetExtents().x +
+                                  glm::abs(glm::vec3(matrix[1])) * GetExtents().y +
+                                  glm::abs(glm::vec3(matrix[2])) * GetExtents().z;
+        return AABB{center - extents, center + extents};
+    }
+};
+
+} // namespace REON
@@ -9,6 +9,7 @@ namespace REON {
     public:
         Quaternion() : glm::quat() {}
         Quaternion(float w, float x, float y, float z) : glm::quat(w, x, y, z) {}
+        Quaternion(const glm::quat& q) : glm::quat(q) {}
         // Set the quaternion using Euler angles (in radians)
         void setFromEulerAngles(float roll, float pitch, float yaw);
         void setFromEulerAngles(glm::vec3 euler);
@@ -50,6 +50,10 @@ class VulkanBuffer
     {
         return m_createInfo.size;
     }
+    void* GetMappedData() const
+    {
+        return m_allocInfo.pMappedData;
+    }
 
     void Write(const void* data, size_t size);
 
@@ -33,6 +33,9 @@ void VulkanContext::init()
     m_Queue.init(m_Device, m_SwapChain, m_queueFamily, 0);
     createDescriptorPool();
     createSyncObjects();
+
+    m_GeometryPool = std::make_unique<GeometryPool>();
+    m_GeometryPool->Init(this);
 }
 
 VulkanContext::VulkanContext(GLFWwindow* window) : m_WindowHandle(window)
@@ -56,6 +59,9 @@ void VulkanContext::startFrame()
 
     res = vkResetFences(m_Device, 1, &m_InFlightFences[currentFrame]);
     REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to reset fences");
+
+    // Nothing of this frame in flight reads the geometry freed while it was recorded anymore
+    m_GeometryPool->ReleaseFrame(currentFrame);
 }
 
 void VulkanContext::endFrame()
@@ -103,6 +109,8 @@ void VulkanContext::cleanup()
 
     vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
 
+    m_GeometryPool->Cleanup();
+
     vmaDestroyAllocator(m_Allocator);
 
     vkDestroyDevice(m_Device, nullptr);
@@ -250,13 +258,14 @@ BufferHandle VulkanContext::createBuffer(BufferCreateInfo createInfo, const void
     return bufHandle;
 }
 
-void VulkanContext::copyBuffer(BufferHandle& srcBuffer, BufferHandle& dstBuffer, VkDeviceSize size) const
+void VulkanContext::copyBuffer(BufferHandle& srcBuffer, BufferHandle& dstBuffer, VkDeviceSize size,
+                               VkDeviceSize dstOffset) const
 {
     VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
     VkBufferCopy copyRegion{};
     copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
+    copyRegion.dstOffset = dstOffset;
     copyRegion.size = size;
     vkCmdCopyBuffer(commandBuffer, srcBuffer->GetVkBuffer(), dstBuffer->GetVkBuffer(), 1, &copyRegion);
 
@@ -642,7 +651,7 @@ void VulkanContext::createVmaAllocator()
 
 void VulkanContext::createDescriptorPool()
 {
-    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    std::array<VkDescriptorPoolSize, 5> poolSizes{};
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     poolSizes[0].descriptorCount = static_cast<uint32_t>(1000);
 
@@ -652,6 +661,12 @@ void VulkanContext::createDescriptorPool()
     poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     poolSizes[2].descriptorCount = static_cast<uint32_t>(1000);
 
+    poolSizes[3].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    poolSizes[3].descriptorCount = static_cast<uint32_t>(100);
+
+    poolSizes[4].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[4].descriptorCount = static_cast<uint32_t>(100);
+
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
@@ -747,7 +762,7 @@ constexpr static uint32_t VkFormatBytesPerPixel(VkFormat format)
     }
 }
 
-ImageHandle VulkanContext::createImage(ImageCreateInfo createInfo, const void* initial) const
+static VkImageCreateInfo toVkImageCreateInfo(const ImageCreateInfo& createInfo)
 {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -763,6 +778,41 @@ ImageHandle VulkanContext::createImage(ImageCreateInfo createInfo, const void* i
     imageInfo.usage = createInfo.usage;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.samples = createInfo.samples;
+    return imageInfo;
+}
+
+VkMemoryRequirements VulkanContext::getImageMemoryRequirements(const ImageCreateInfo& createInfo) const
+{
+    VkImageCreateInfo imageInfo = toVkImageCreateInfo(createInfo);
+
+    VkDeviceImageMemoryRequirements requirementsInfo{};
+    requirementsInfo.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS;
+    requirementsInfo.pCreateInfo = &imageInfo;
+
+    VkMemoryRequirements2 requirements{};
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    vkGetDeviceImageMemoryRequirements(m_Device, &requirementsInfo, &requirements);
+    return requirements.memoryRequirements;
+}
+
+ImageHandle VulkanContext::createAliasedImage(ImageCreateInfo createInfo, VmaAllocation allocation,
+                                              VkDeviceSize offset) const
+{
+    VkImageCreateInfo imageInfo = toVkImageCreateInfo(createInfo);
+
+    VkImage image;
+    VkResult res = vmaCreateAliasingImage2(m_Allocator, allocation, offset, &imageInfo, &image);
+    REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create aliased image");
+
+    VkImageView view = createImageView(image, createInfo.format, formatToAspectMask(createInfo.format),
+                                       createInfo.levels);
+
+    return std::make_shared<VulkanImage>(VulkanImage(this, image, view, nullptr, createInfo));
+}
+
+ImageHandle VulkanContext::createImage(ImageCreateInfo createInfo, const void* initial) const
+{
+    VkImageCreateInfo imageInfo = toVkImageCreateInfo(createInfo);
 
     VmaAllocationCreateInfo allocInfo{};
     allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
@@ -1022,6 +1072,24 @@ int VulkanContext::rateDeviceSuitability(VkPhysicalDevice device)
     notSuitable |= !deviceFeatures.independentBlend;
     notSuitable |= !deviceFeatures.sampleRateShading;
     notSuitable |= !deviceFeatures.fillModeNonSolid;
+    // Indirect draws select their object data through firstInstance
+    notSuitable |= !deviceFeatures.drawIndirectFirstInstance;
+
+    VkPhysicalDeviceVulkan13Features vulkan13Features{};
+    vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.pNext = &vulkan13Features;
+    VkPhysicalDeviceFeatures2 deviceFeatures2{};
+    deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    deviceFeatures2.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
+    notSuitable |= !vulkan12Features.timelineSemaphore;
+    // The material table indexes one texture array with a per pixel material index
+    notSuitable |= !vulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+    notSuitable |= !vulkan12Features.descriptorBindingSampledImageUpdateAfterBind;
+    notSuitable |= !vulkan12Features.descriptorBindingPartiallyBound;
+    notSuitable |= !vulkan13Features.synchronization2;
     notSuitable |= !findQueueFamilies(device).isComplete();
     bool extensionsSupported = checkDeviceExtensions(device);
     notSuitable |= !extensionsSupported;
@@ -1106,11 +1174,31 @@ void VulkanContext::createLogicalDevice()
     deviceFeatures.fillModeNonSolid = VK_TRUE;
     deviceFeatures.geometryShader = VK_TRUE;
     deviceFeatures.tessellationShader = VK_TRUE;
+    deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(getPhysicalDevice(), &supportedFeatures);
+    m_MultiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
 
     VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamicState3Features{};
     dynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
     dynamicState3Features.extendedDynamicState3PolygonMode = VK_TRUE;
 
+    // Passes are submitted as one vkQueueSubmit2 per frame and ordered on a timeline semaphore
+    VkPhysicalDeviceVulkan13Features vulkan13Features{};
+    vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    vulkan13Features.synchronization2 = VK_TRUE;
+    vulkan13Features.pNext = &dynamicState3Features;
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.timelineSemaphore = VK_TRUE;
+    vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+    vulkan12Features.pNext = &vulkan13Features;
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -1118,7 +1206,7 @@ void VulkanContext::createLogicalDevice()
     createInfo.pEnabledFeatures = &deviceFeatures;
     createInfo.enabledExtensionCount = static_cast<uint32_t>(m_DeviceExtensions.size());
     createInfo.ppEnabledExtensionNames = m_DeviceExtensions.data();
-    createInfo.pNext = &dynamicState3Features;
+    createInfo.pNext = &vulkan12Features;
 
     VkResult res = vkCreateDevice(getPhysicalDevice(), &createInfo, nullptr, &m_Device);
     REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create logical device");
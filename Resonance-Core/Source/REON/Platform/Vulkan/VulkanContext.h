@@ -1,5 +1,6 @@
 #pragma once
 
+#include "REON/Rendering/GeometryPool.h"
 #include "REON/Rendering/RenderContext.h"
 #include "VulkanBuffer.h"
 #include "VulkanDevice.h"
@@ -161,6 +162,16 @@ class VulkanContext : public RenderContext
     {
         return m_SwapChainImageViews.size();
     }
+    // Shared vertex and index buffers all meshes are allocated from
+    GeometryPool* getGeometryPool() const
+    {
+        return m_GeometryPool.get();
+    }
+    // Without it every indirect draw record is issued on its own
+    bool supportsMultiDrawIndirect() const
+    {
+        return m_MultiDrawIndirect;
+    }
 
     const int MAX_FRAMES_IN_FLIGHT = 2;
 
@@ -168,12 +179,17 @@ class VulkanContext : public RenderContext
     VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
                                 uint32_t mipLevels) const;
     ImageHandle createImage(ImageCreateInfo createInfo, const void* initialData = nullptr) const;
+    // Requirements of an image before it exists, so memory can be shared between images that are never alive together
+    VkMemoryRequirements getImageMemoryRequirements(const ImageCreateInfo& createInfo) const;
+    // Image placed at offset inside memory owned by someone else, the handle does not free it
+    ImageHandle createAliasedImage(ImageCreateInfo createInfo, VmaAllocation allocation, VkDeviceSize offset) const;
     void transitionImageLayout(ImageHandle& image, VkImageLayout newLayout) const;
     void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) const;
     void copyBufferToImage(BufferHandle& buffer, ImageHandle& image) const;
 
     BufferHandle createBuffer(BufferCreateInfo createInfo, const void* initialData = nullptr) const;
-    void copyBuffer(BufferHandle& srcBuffer, BufferHandle& dstBuffer, VkDeviceSize size) const;
+    void copyBuffer(BufferHandle& srcBuffer, BufferHandle& dstBuffer, VkDeviceSize size,
+                    VkDeviceSize dstOffset = 0) const;
     VkShaderModule createShaderModule(const std::vector<char>& code) const;
     VkFormat findDepthFormat() const;
     void createCommandPool(VkCommandPool& commandPool, uint32_t queueFamilyIndex) const;
@@ -260,6 +276,9 @@ class VulkanContext : public RenderContext
     uint32_t m_MipLevels;
 
     VkSampleCountFlagBits m_MsaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    bool m_MultiDrawIndirect = false;
+
+    std::unique_ptr<GeometryPool> m_GeometryPool;
 
     bool framebufferResized = false;
 
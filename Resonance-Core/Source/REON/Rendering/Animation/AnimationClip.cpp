@@ -1 +1,3 @@
-#include "reonpch.h"
\ No newline at end of file
+#include "reonpch.h"
+
+#include "AnimationClip.h"
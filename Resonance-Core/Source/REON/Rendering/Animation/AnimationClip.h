@@ -1,13 +1,47 @@
 #pragma once
 
-#include <vector>
-#include <unordered_map>
+#include "REON/AssetManagement/Asset.h"
+#include "REON/ResourceManagement/Resource.h"
+
+#include <glm/glm.hpp>
+
 #include <string>
+#include <vector>
 
 namespace REON
 {
-class AnimationClip
+// Keyframes of a rig's joints, cooked from the model's animations. Every joint has a track per channel, a track without
+// keys leaves that channel at the joint's rest pose. Keys of all tracks share one time and one value stream.
+struct AnimationClip : public ResourceBase
 {
+    static constexpr AssetTypeId kType = ASSET_ANIMATION_CLIP;
+
+    enum Channel : uint32_t
+    {
+        Translation = 0,
+        Rotation = 1,
+        Scale = 2,
+        ChannelCount = 3,
+    };
+
+    struct Track
+    {
+        uint32_t firstKey = 0;
+        uint32_t keyCount = 0;
+    };
+
+    std::string name;
+    AssetId rigId;
+    float duration = 0.0f; // seconds
+    uint32_t jointCount = 0;
+
+    std::vector<Track> tracks;     // jointCount * ChannelCount, joint by joint
+    std::vector<float> times;      // ascending within a track
+    std::vector<glm::vec4> values; // xyz for translation and scale, xyzw for rotation
 
+    const Track& GetTrack(uint32_t joint, Channel channel) const
+    {
+        return tracks[joint * ChannelCount + channel];
+    }
 };
-}
\ No newline at end of file
+} // namespace REON
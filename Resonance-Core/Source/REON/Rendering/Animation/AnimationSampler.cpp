@@ -0,0 +1,324 @@
+#include "reonpch.h"
+
+#include "AnimationSampler.h"
+
+#include "glm/gtc/quaternion.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define REON_ANIMATION_SSE 1
+#include <xmmintrin.h>
+#else
+#define REON_ANIMATION_SSE 0
+#endif
+
+namespace REON
+{
+
+namespace
+{
+constexpr SoaTransform IdentityGroup = {
+    {0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0},
+    {0, 0, 0, 0}, {1, 1, 1, 1}, {1, 1, 1, 1}, {1, 1, 1, 1}, {1, 1, 1, 1},
+};
+
+void SetChannel(SoaTransform& group, uint32_t lane, AnimationClip::Channel channel, const glm::vec4& value)
+{
+    switch (channel)
+    {
+    case AnimationClip::Translation:
+        group.tx[lane] = value.x;
+        group.ty[lane] = value.y;
+        group.tz[lane] = value.z;
+        break;
+    case AnimationClip::Rotation:
+        group.rx[lane] = value.x;
+        group.ry[lane] = value.y;
+        group.rz[lane] = value.z;
+        group.rw[lane] = value.w;
+        break;
+    default:
+        group.sx[lane] = value.x;
+        group.sy[lane] = value.y;
+        group.sz[lane] = value.z;
+        break;
+    }
+}
+
+// Local matrices of the four joints of a group, translation * rotation * scale
+void ComposeLocalGroup(const SoaTransform& group, glm::mat4* locals)
+{
+#if REON_ANIMATION_SSE
+    const __m128 x = _mm_load_ps(group.rx), y = _mm_load_ps(group.ry);
+    const __m128 z = _mm_load_ps(group.rz), w = _mm_load_ps(group.rw);
+    const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+
+    const __m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+    const __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+    const __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+    const __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+    const __m128 sx = _mm_load_ps(group.sx), sy = _mm_load_ps(group.sy), sz = _mm_load_ps(group.sz);
+
+    // Row r of column c for all four joints, transposed into each joint's column
+    __m128 columns[4][4] = {
+        {_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx), _mm_mul_ps(_mm_add_ps(xy, wz), sx),
+         _mm_mul_ps(_mm_sub_ps(xz, wy), sx), _mm_setzero_ps()},
+        {_mm_mul_ps(_mm_sub_ps(xy, wz), sy), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+         _mm_mul_ps(_mm_add_ps(yz, wx), sy), _mm_setzero_ps()},
+        {_mm_mul_ps(_mm_add_ps(xz, wy), sz), _mm_mul_ps(_mm_sub_ps(yz, wx), sz),
+         _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz), _mm_setzero_ps()},
+        {_mm_load_ps(group.tx), _mm_load_ps(group.ty), _mm_load_ps(group.tz), one},
+    };
+    for (int column = 0; column < 4; column++)
+    {
+        __m128* rows = columns[column];
+        _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+        for (uint32_t lane = 0; lane < AnimationSampler::LaneCount; lane++)
+            _mm_storeu_ps(&locals[lane][column][0], rows[lane]);
+    }
+#else
+    for (uint32_t lane = 0; lane < AnimationSampler::LaneCount; lane++)
+    {
+        glm::mat4& local = locals[lane];
+        local = glm::mat4_cast(glm::quat(group.rw[lane], group.rx[lane], group.ry[lane], group.rz[lane]));
+        local[0] *= group.sx[lane];
+        local[1] *= group.sy[lane];
+        local[2] *= group.sz[lane];
+        local[3] = glm::vec4(group.tx[lane], group.ty[lane], group.tz[lane], 1.0f);
+    }
+#endif
+}
+
+// Column major out = a * b. Every output column is a linear combination of a's columns, four lanes at a time.
+inline void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#if REON_ANIMATION_SSE
+    const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+    for (int column = 0; column < 4; column++)
+    {
+        __m128 result = _mm_mul_ps(a0, _mm_set1_ps(b[column][0]));
+        result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+        result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+        result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+        _mm_storeu_ps(&out[column][0], result);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+#if REON_ANIMATION_SSE
+inline __m128 Lerp(const float* from, const float* to, __m128 alpha)
+{
+    const __m128 a = _mm_load_ps(from);
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(to), a), alpha));
+}
+#endif
+
+// Lerps translation and scale and nlerps rotation of four joints. Rotations take the shorter arc, the target is
+// flipped when the two quaternions lie in opposite hemispheres.
+void InterpolateGroup(const SoaTransform& from, const SoaTransform& to, const float* translationAlpha,
+                      const float* rotationAlpha, const float* scaleAlpha, SoaTransform& out)
+{
+#if REON_ANIMATION_SSE
+    const __m128 at = _mm_load_ps(translationAlpha);
+    _mm_store_ps(out.tx, Lerp(from.tx, to.tx, at));
+    _mm_store_ps(out.ty, Lerp(from.ty, to.ty, at));
+    _mm_store_ps(out.tz, Lerp(from.tz, to.tz, at));
+
+    const __m128 as = _mm_load_ps(scaleAlpha);
+    _mm_store_ps(out.sx, Lerp(from.sx, to.sx, as));
+    _mm_store_ps(out.sy, Lerp(from.sy, to.sy, as));
+    _mm_store_ps(out.sz, Lerp(from.sz, to.sz, as));
+
+    const __m128 fx = _mm_load_ps(from.rx), fy = _mm_load_ps(from.ry);
+    const __m128 fz = _mm_load_ps(from.rz), fw = _mm_load_ps(from.rw);
+    __m128 tx = _mm_load_ps(to.rx), ty = _mm_load_ps(to.ry);
+    __m128 tz = _mm_load_ps(to.rz), tw = _mm_load_ps(to.rw);
+
+    const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(fx, tx), _mm_mul_ps(fy, ty)),
+                                  _mm_add_ps(_mm_mul_ps(fz, tz), _mm_mul_ps(fw, tw)));
+    const __m128 sign = _mm_and_ps(dot, _mm_set1_ps(-0.0f));
+    tx = _mm_xor_ps(tx, sign);
+    ty = _mm_xor_ps(ty, sign);
+    tz = _mm_xor_ps(tz, sign);
+    tw = _mm_xor_ps(tw, sign);
+
+    const __m128 ar = _mm_load_ps(rotationAlpha);
+    const __m128 qx = _mm_add_ps(fx, _mm_mul_ps(_mm_sub_ps(tx, fx), ar));
+    const __m128 qy = _mm_add_ps(fy, _mm_mul_ps(_mm_sub_ps(ty, fy), ar));
+    const __m128 qz = _mm_add_ps(fz, _mm_mul_ps(_mm_sub_ps(tz, fz), ar));
+    const __m128 qw = _mm_add_ps(fw, _mm_mul_ps(_mm_sub_ps(tw, fw), ar));
+
+    // Reciprocal square root estimate refined by one Newton-Raphson step, close to full float precision
+    const __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)),
+                                       _mm_add_ps(_mm_mul_ps(qz, qz), _mm_mul_ps(qw, qw)));
+    __m128 inverse = _mm_rsqrt_ps(lengthSq);
+    inverse = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), inverse),
+                         _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_mul_ps(lengthSq, inverse), inverse)));
+    _mm_store_ps(out.rx, _mm_mul_ps(qx, inverse));
+    _mm_store_ps(out.ry, _mm_mul_ps(qy, inverse));
+    _mm_store_ps(out.rz, _mm_mul_ps(qz, inverse));
+    _mm_store_ps(out.rw, _mm_mul_ps(qw, inverse));
+#else
+    for (uint32_t lane = 0; lane < AnimationSampler::LaneCount; lane++)
+    {
+        const float at = translationAlpha[lane], as = scaleAlpha[lane], ar = rotationAlpha[lane];
+        out.tx[lane] = glm::mix(from.tx[lane], to.tx[lane], at);
+        out.ty[lane] = glm::mix(from.ty[lane], to.ty[lane], at);
+        out.tz[lane] = glm::mix(from.tz[lane], to.tz[lane], at);
+        out.sx[lane] = glm::mix(from.sx[lane], to.sx[lane], as);
+        out.sy[lane] = glm::mix(from.sy[lane], to.sy[lane], as);
+        out.sz[lane] = glm::mix(from.sz[lane], to.sz[lane], as);
+
+        const glm::vec4 a(from.rx[lane], from.ry[lane], from.rz[lane], from.rw[lane]);
+        glm::vec4 b(to.rx[lane], to.ry[lane], to.rz[lane], to.rw[lane]);
+        if (glm::dot(a, b) < 0.0f)
+            b = -b;
+        const glm::vec4 q = glm::normalize(glm::mix(a, b, ar));
+        out.rx[lane] = q.x;
+        out.ry[lane] = q.y;
+        out.rz[lane] = q.z;
+        out.rw[lane] = q.w;
+    }
+#endif
+}
+} // namespace
+
+void AnimationSampler::Sample(const AnimationClip& clip, const Rig& rig, float time, std::span<SoaTransform> pose)
+{
+    const uint32_t jointCount = static_cast<uint32_t>(rig.joints.size());
+    const uint32_t groupCount = GetGroupCount(jointCount);
+    REON_CORE_ASSERT(pose.size() >= groupCount, "Pose is smaller than the rig");
+
+    if (&clip != m_Clip || &rig != m_Rig || m_Cursors.size() != clip.tracks.size() || m_From.size() != groupCount)
+        reset(clip, rig);
+
+    // Gather the two keys around time and the factor between them. Keys are only copied when the cursor moved, which
+    // at frame rate is most of the time not the case. Channels without keys were set to the rest pose with a zero
+    // factor by reset and are never touched again.
+    const uint32_t animatedJoints = std::min(jointCount, clip.jointCount);
+    for (uint32_t joint = 0; joint < animatedJoints; joint++)
+    {
+        const uint32_t group = joint / LaneCount;
+        const uint32_t lane = joint % LaneCount;
+
+        auto gather = [&](AnimationClip::Channel channel, float* alphas) {
+            const uint32_t track = joint * AnimationClip::ChannelCount + channel;
+            if (clip.tracks[track].keyCount == 0)
+                return;
+
+            const uint32_t previous = m_Cursors[track];
+            uint32_t fromKey, toKey;
+            alphas[lane] = seek(clip, track, time, fromKey, toKey);
+            if (m_Cursors[track] == previous)
+                return;
+
+            SetChannel(m_From[group], lane, channel, clip.values[fromKey]);
+            SetChannel(m_To[group], lane, channel, clip.values[toKey]);
+        };
+        gather(AnimationClip::Translation, m_Blend[group].translation);
+        gather(AnimationClip::Rotation, m_Blend[group].rotation);
+        gather(AnimationClip::Scale, m_Blend[group].scale);
+    }
+
+    // Interpolate four joints at a time, lanes past the last joint interpolate identities
+    for (uint32_t group = 0; group < groupCount; group++)
+    {
+        const SoaBlend& blend = m_Blend[group];
+        InterpolateGroup(m_From[group], m_To[group], blend.translation, blend.rotation, blend.scale, pose[group]);
+    }
+}
+
+void AnimationSampler::ComputeModelPose(const Rig& rig, std::span<const SoaTransform> pose,
+                                        std::span<glm::mat4> modelPose)
+{
+    REON_CORE_ASSERT(rig.hasHierarchy, "Rig has no joint hierarchy to compose a pose with");
+    REON_CORE_ASSERT(pose.size() >= GetGroupCount(rig.joints.size()) && modelPose.size() >= rig.joints.size(),
+                     "Pose is smaller than the rig");
+
+    glm::mat4 locals[LaneCount];
+    for (uint32_t joint = 0; joint < rig.joints.size(); joint++)
+    {
+        const uint32_t lane = joint % LaneCount;
+        if (lane == 0)
+            ComposeLocalGroup(pose[joint / LaneCount], locals);
+        const glm::mat4& local = locals[lane];
+
+        const Rig::Joint& rigJoint = rig.joints[joint];
+        if (rigJoint.parentIndex < 0)
+        {
+            MultiplyMatrices(rigJoint.parentOffset, local, modelPose[joint]);
+        }
+        else if (!rigJoint.hasParentOffset)
+        {
+            MultiplyMatrices(modelPose[rigJoint.parentIndex], local, modelPose[joint]);
+        }
+        else
+        {
+            glm::mat4 parent;
+            MultiplyMatrices(modelPose[rigJoint.parentIndex], rigJoint.parentOffset, parent);
+            MultiplyMatrices(parent, local, modelPose[joint]);
+        }
+    }
+}
+
+void AnimationSampler::ComputeSkinPalette(const Rig::Skin& skin, const glm::mat4& world,
+                                          std::span<const glm::mat4> modelPose, std::span<glm::mat4> palette)
+{
+    REON_CORE_ASSERT(palette.size() >= skin.jointIdx.size(), "Palette is smaller than the skin");
+
+    for (size_t i = 0; i < skin.jointIdx.size(); i++)
+    {
+        glm::mat4 joint;
+        MultiplyMatrices(world, modelPose[skin.jointIdx[i]], joint);
+        MultiplyMatrices(joint, skin.inverseBindMatrices[i], palette[i]);
+    }
+}
+
+void AnimationSampler::reset(const AnimationClip& clip, const Rig& rig)
+{
+    m_Clip = &clip;
+    m_Rig = &rig;
+    m_Cursors.assign(clip.tracks.size(), UINT32_MAX);
+
+    const uint32_t groupCount = GetGroupCount(rig.joints.size());
+    m_From.assign(groupCount, IdentityGroup);
+    m_Blend.assign(groupCount, SoaBlend{});
+    for (uint32_t joint = 0; joint < rig.joints.size(); joint++)
+    {
+        const Rig::Joint& rigJoint = rig.joints[joint];
+        const glm::quat& r = rigJoint.restRotation;
+        SoaTransform& group = m_From[joint / LaneCount];
+        const uint32_t lane = joint % LaneCount;
+        SetChannel(group, lane, AnimationClip::Translation, glm::vec4(rigJoint.restTranslation, 0.0f));
+        SetChannel(group, lane, AnimationClip::Rotation, glm::vec4(r.x, r.y, r.z, r.w));
+        SetChannel(group, lane, AnimationClip::Scale, glm::vec4(rigJoint.restScale, 0.0f));
+    }
+    m_To = m_From;
+}
+
+float AnimationSampler::seek(const AnimationClip& clip, uint32_t track, float time, uint32_t& from, uint32_t& to)
+{
+    const AnimationClip::Track& keys = clip.tracks[track];
+    const float* times = clip.times.data() + keys.firstKey;
+
+    uint32_t& cursor = m_Cursors[track];
+    if (cursor >= keys.keyCount || times[cursor] > time)
+        cursor = 0;
+    while (cursor + 1 < keys.keyCount && times[cursor + 1] <= time)
+        cursor++;
+
+    const uint32_t next = std::min(cursor + 1, keys.keyCount - 1);
+    from = keys.firstKey + cursor;
+    to = keys.firstKey + next;
+
+    const float span = times[next] - times[cursor];
+    return span > 0.0f ? glm::clamp((time - times[cursor]) / span, 0.0f, 1.0f) : 0.0f;
+}
+
+} // namespace REON
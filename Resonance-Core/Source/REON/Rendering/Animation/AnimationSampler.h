@@ -0,0 +1,74 @@
+#pragma once
+
+#include "AnimationClip.h"
+#include "Rig.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace REON
+{
+
+// Local transforms of four joints in structure-of-arrays form, a lane per joint, so interpolation runs on four joints
+// at once. Joint j lives in lane j % 4 of group j / 4, rotations are x, y, z, w quaternions.
+struct alignas(16) SoaTransform
+{
+    float tx[4], ty[4], tz[4];
+    float rx[4], ry[4], rz[4], rw[4];
+    float sx[4], sy[4], sz[4];
+};
+
+// Samples clips on a rig. Every track keeps a cursor at the key it was last sampled at, so playing forward only steps
+// over the keys passed since the previous sample instead of searching the track. Jumping back restarts the track.
+class AnimationSampler
+{
+  public:
+    static constexpr uint32_t LaneCount = 4;
+
+    static uint32_t GetGroupCount(size_t jointCount)
+    {
+        return static_cast<uint32_t>((jointCount + LaneCount - 1) / LaneCount);
+    }
+
+    // Writes the clip's local pose at time into pose, which needs GetGroupCount(rig.joints.size()) groups. Times
+    // outside the keys hold the first or last key, looping is up to the caller. Channels the clip does not animate
+    // keep the rig's rest pose.
+    void Sample(const AnimationClip& clip, const Rig& rig, float time, std::span<SoaTransform> pose);
+
+    // Composes a local pose into the model space of the rig's root object. Parents come first, so it is one pass in
+    // joint order. Needs a rig with a hierarchy.
+    static void ComputeModelPose(const Rig& rig, std::span<const SoaTransform> pose, std::span<glm::mat4> modelPose);
+
+    // Skinning matrices of a skin from a model pose. world is the rig's root object, the model pose is relative to it
+    // like the joint objects are, so it is applied once.
+    static void ComputeSkinPalette(const Rig::Skin& skin, const glm::mat4& world, std::span<const glm::mat4> modelPose,
+                                   std::span<glm::mat4> palette);
+
+  private:
+    // Blend factors between m_From and m_To, per channel
+    struct alignas(16) SoaBlend
+    {
+        float translation[4];
+        float rotation[4];
+        float scale[4];
+    };
+
+    void reset(const AnimationClip& clip, const Rig& rig);
+    // Moves the track's cursor to the key at or before time, returns the keys around it and the factor between them.
+    float seek(const AnimationClip& clip, uint32_t track, float time, uint32_t& from, uint32_t& to);
+
+  private:
+    const AnimationClip* m_Clip = nullptr;
+    const Rig* m_Rig = nullptr;
+    std::vector<uint32_t> m_Cursors; // per track, key index within the track, UINT32_MAX until first sampled
+
+    // Keys around the sampled time, gathered per joint for the SIMD pass
+    std::vector<SoaTransform> m_From;
+    std::vector<SoaTransform> m_To;
+    std::vector<SoaBlend> m_Blend;
+};
+
+} // namespace REON
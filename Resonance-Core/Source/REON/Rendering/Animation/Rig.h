@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include "REON/AssetManagement/Asset.h"
 #include "REON/ResourceManagement/Resource.h"
 
@@ -15,10 +16,22 @@ struct Rig : public ResourceBase
     struct Joint
     {
         AssetId nodeId;
-        int parentIndex; // -1 for root
+        int parentIndex = -1; // -1 for root
+
+        // Local transform of the joint's node as imported, what a clip falls back to for channels it does not animate
+        glm::vec3 restTranslation{0.0f};
+        glm::quat restRotation{1.0f, 0.0f, 0.0f, 0.0f};
+        glm::vec3 restScale{1.0f};
+        // Transform of the nodes between the joint and its parent joint, or between it and the model's root object for
+        // joints without a parent joint. Only used for parent joints when hasParentOffset is set.
+        glm::mat4 parentOffset{1.0f};
+        bool hasParentOffset = false;
     };
 
+    // Parents come before their children when hasHierarchy is set
     std::vector<Joint> joints;
+    // Rigs cooked before joint records existed only know their joints' node ids, they cannot be animated by clips
+    bool hasHierarchy = false;
 
     struct Skin
     {
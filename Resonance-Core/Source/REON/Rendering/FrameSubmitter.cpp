@@ -0,0 +1,111 @@
+#include "reonpch.h"
+
+#include "FrameSubmitter.h"
+
+#include "REON/Platform/Vulkan/VulkanContext.h"
+
+namespace REON
+{
+
+void FrameSubmitter::Init(const VulkanContext* context)
+{
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    createInfo.pNext = &typeInfo;
+
+    VkResult res = vkCreateSemaphore(context->getDevice(), &createInfo, nullptr, &m_Timeline);
+    REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create pass timeline semaphore");
+}
+
+void FrameSubmitter::Cleanup(const VulkanContext* context)
+{
+    vkDestroySemaphore(context->getDevice(), m_Timeline, nullptr);
+    m_Timeline = VK_NULL_HANDLE;
+}
+
+void FrameSubmitter::AddPass(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 waitStage)
+{
+    m_Passes.push_back({commandBuffer, waitStage});
+}
+
+void FrameSubmitter::Submit(const VulkanContext* context, VkSemaphore imageAvailable, VkSemaphore renderFinished)
+{
+    if (m_Passes.empty())
+        m_Passes.push_back({VK_NULL_HANDLE, VK_PIPELINE_STAGE_2_NONE});
+
+    const size_t passCount = m_Passes.size();
+
+    // Every batch waits on at most two semaphores and signals at most two, sized up front so the pointers handed to
+    // the submit infos stay valid.
+    std::vector<std::array<VkSemaphoreSubmitInfo, 2>> waits(passCount);
+    std::vector<std::array<VkSemaphoreSubmitInfo, 2>> signals(passCount);
+    std::vector<VkCommandBufferSubmitInfo> commandBuffers(passCount);
+    std::vector<VkSubmitInfo2> submits(passCount);
+
+    for (size_t i = 0; i < passCount; i++)
+    {
+        const Pass& pass = m_Passes[i];
+        VkSubmitInfo2& submit = submits[i];
+        submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+
+        if (pass.commandBuffer != VK_NULL_HANDLE)
+        {
+            commandBuffers[i].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+            commandBuffers[i].commandBuffer = pass.commandBuffer;
+            submit.commandBufferInfoCount = 1;
+            submit.pCommandBufferInfos = &commandBuffers[i];
+        }
+
+        // The first pass of a frame waits on the last one of the previous frame as well, timeline values have to be
+        // signalled in increasing order.
+        uint32_t waitCount = 0;
+        if (m_TimelineValue > 0)
+        {
+            VkSemaphoreSubmitInfo& wait = waits[i][waitCount++];
+            wait.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+            wait.semaphore = m_Timeline;
+            wait.value = m_TimelineValue;
+            wait.stageMask = i == 0 ? VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT : pass.waitStage;
+        }
+        if (i == 0)
+        {
+            VkSemaphoreSubmitInfo& wait = waits[i][waitCount++];
+            wait.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+            wait.semaphore = imageAvailable;
+            wait.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        }
+        submit.waitSemaphoreInfoCount = waitCount;
+        submit.pWaitSemaphoreInfos = waits[i].data();
+
+        uint32_t signalCount = 0;
+        {
+            VkSemaphoreSubmitInfo& signal = signals[i][signalCount++];
+            signal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+            signal.semaphore = m_Timeline;
+            signal.value = ++m_TimelineValue;
+            signal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        }
+        if (i == passCount - 1)
+        {
+            VkSemaphoreSubmitInfo& signal = signals[i][signalCount++];
+            signal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+            signal.semaphore = renderFinished;
+            signal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        }
+        submit.signalSemaphoreInfoCount = signalCount;
+        submit.pSignalSemaphoreInfos = signals[i].data();
+    }
+
+    VkResult res = vkQueueSubmit2(context->getGraphicsQueue(), static_cast<uint32_t>(passCount), submits.data(),
+                                  VK_NULL_HANDLE);
+    REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to submit frame");
+
+    m_Passes.clear();
+}
+
+} // namespace REON
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace REON
+{
+
+class VulkanContext;
+
+// Collects the command buffers every pass recorded this frame and hands them to the queue with a single
+// vkQueueSubmit2. Each pass is its own batch that waits on the previous one through a timeline semaphore, so passes
+// still run in the order they were added without a binary semaphore per pass.
+class FrameSubmitter
+{
+  public:
+    void Init(const VulkanContext* context);
+    void Cleanup(const VulkanContext* context);
+
+    // Runs the pass after everything added before it, this frame or earlier. waitStage is the first stage that reads
+    // what the previous passes wrote.
+    void AddPass(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 waitStage);
+
+    // Submits every pass added since the last call. The first batch waits for the swap chain image and the last one
+    // signals renderFinished, a frame without passes still submits an empty batch to keep that pair balanced.
+    void Submit(const VulkanContext* context, VkSemaphore imageAvailable, VkSemaphore renderFinished);
+
+  private:
+    struct Pass
+    {
+        VkCommandBuffer commandBuffer;
+        VkPipelineStageFlags2 waitStage;
+    };
+
+    std::vector<Pass> m_Passes;
+
+    VkSemaphore m_Timeline = VK_NULL_HANDLE;
+    // Value signalled by the last pass submitted so far
+    uint64_t m_TimelineValue = 0;
+};
+
+} // namespace REON
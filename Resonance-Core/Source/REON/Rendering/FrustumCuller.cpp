@@ -0,0 +1,150 @@
+#include "reonpch.h"
+
+#include "FrustumCuller.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define REON_CULL_SSE 1
+#include <xmmintrin.h>
+#else
+#define REON_CULL_SSE 0
+#endif
+
+namespace REON
+{
+
+namespace
+{
+constexpr size_t LaneCount = 4;
+
+// Large enough to straddle every plane, small enough that |n| * extent stays finite.
+constexpr float UnboundedExtent = 1e30f;
+} // namespace
+
+Frustum Frustum::FromMatrix(const glm::mat4& viewProj)
+{
+    auto row = [&](int i) { return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]); };
+
+    Frustum frustum;
+    frustum.planes[0] = row(3) + row(0); // left
+    frustum.planes[1] = row(3) - row(0); // right
+    frustum.planes[2] = row(3) + row(1); // bottom
+    frustum.planes[3] = row(3) - row(1); // top
+    frustum.planes[4] = row(2);          // near, clip depth is [0, 1]
+    frustum.planes[5] = row(3) - row(2); // far
+
+    for (glm::vec4& plane : frustum.planes)
+        plane /= glm::max(glm::length(glm::vec3(plane)), 1e-6f);
+
+    return frustum;
+}
+
+void FrustumCuller::Resize(size_t count)
+{
+    m_Count = count;
+
+    // Padded to whole lanes so the SIMD loop never needs a scalar tail.
+    const size_t padded = (count + LaneCount - 1) / LaneCount * LaneCount;
+    for (auto* stream : {&m_CenterX, &m_CenterY, &m_CenterZ, &m_ExtentX, &m_ExtentY, &m_ExtentZ})
+        stream->resize(padded, 0.0f);
+}
+
+void FrustumCuller::SetBounds(size_t index, const AABB& bounds)
+{
+    if (!bounds.IsValid())
+    {
+        m_CenterX[index] = m_CenterY[index] = m_CenterZ[index] = 0.0f;
+        m_ExtentX[index] = m_ExtentY[index] = m_ExtentZ[index] = UnboundedExtent;
+        return;
+    }
+
+    const glm::vec3 center = bounds.GetCenter();
+    const glm::vec3 extents = bounds.GetExtents();
+    m_CenterX[index] = center.x;
+    m_CenterY[index] = center.y;
+    m_CenterZ[index] = center.z;
+    m_ExtentX[index] = extents.x;
+    m_ExtentY[index] = extents.y;
+    m_ExtentZ[index] = extents.z;
+}
+
+uint32_t FrustumCuller::Cull(const Frustum& frustum, uint8_t visibleBit, std::span<uint8_t> masks) const
+{
+    REON_CORE_ASSERT(masks.size() >= m_Count, "Visibility masks are smaller than the culled set");
+
+    uint32_t culled = 0;
+    auto store = [&](size_t index, bool outside) {
+        if (outside)
+        {
+            masks[index] &= uint8_t(~visibleBit);
+            culled++;
+        }
+        else
+        {
+            masks[index] |= visibleBit;
+        }
+    };
+
+#if REON_CULL_SSE
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    __m128 absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; p++)
+    {
+        const glm::vec4& plane = frustum.planes[p];
+        planeX[p] = _mm_set1_ps(plane.x);
+        planeY[p] = _mm_set1_ps(plane.y);
+        planeZ[p] = _mm_set1_ps(plane.z);
+        planeW[p] = _mm_set1_ps(plane.w);
+        absX[p] = _mm_set1_ps(glm::abs(plane.x));
+        absY[p] = _mm_set1_ps(glm::abs(plane.y));
+        absZ[p] = _mm_set1_ps(glm::abs(plane.z));
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    for (size_t i = 0; i < m_Count; i += LaneCount)
+    {
+        const __m128 cx = _mm_loadu_ps(m_CenterX.data() + i);
+        const __m128 cy = _mm_loadu_ps(m_CenterY.data() + i);
+        const __m128 cz = _mm_loadu_ps(m_CenterZ.data() + i);
+        const __m128 ex = _mm_loadu_ps(m_ExtentX.data() + i);
+        const __m128 ey = _mm_loadu_ps(m_ExtentY.data() + i);
+        const __m128 ez = _mm_loadu_ps(m_ExtentZ.data() + i);
+
+        // A box is outside once its most positive corner along a plane normal is still behind that plane.
+        __m128 outside = zero;
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(planeX[p], cx), planeW[p]);
+            distance = _mm_add_ps(distance, _mm_mul_ps(planeY[p], cy));
+            distance = _mm_add_ps(distance, _mm_mul_ps(planeZ[p], cz));
+
+            __m128 radius = _mm_mul_ps(absX[p], ex);
+            radius = _mm_add_ps(radius, _mm_mul_ps(absY[p], ey));
+            radius = _mm_add_ps(radius, _mm_mul_ps(absZ[p], ez));
+
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        const int outsideBits = _mm_movemask_ps(outside);
+        const size_t lanes = std::min(LaneCount, m_Count - i);
+        for (size_t lane = 0; lane < lanes; lane++)
+            store(i + lane, (outsideBits >> lane) & 1);
+    }
+#else
+    for (size_t i = 0; i < m_Count; i++)
+    {
+        bool outside = false;
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            const float distance = plane.x * m_CenterX[i] + plane.y * m_CenterY[i] + plane.z * m_CenterZ[i] + plane.w;
+            const float radius = glm::abs(plane.x) * m_ExtentX[i] + glm::abs(plane.y) * m_ExtentY[i] +
+                                 glm::abs(plane.z) * m_ExtentZ[i];
+            outside |= distance + radius < 0.0f;
+        }
+        store(i, outside);
+    }
+#endif
+
+    return culled;
+}
+
+} // namespace REON
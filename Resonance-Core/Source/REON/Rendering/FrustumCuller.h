@@ -0,0 +1,44 @@
+#pragma once
+
+#include "REON/Math/AABB.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace REON
+{
+
+// Six normalized, inward facing planes (xyz normal, w distance), a point p is inside when dot(n, p) + w >= 0 for all
+// of them.
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    static Frustum FromMatrix(const glm::mat4& viewProj);
+};
+
+// Boxes stored as structure-of-arrays (center/extents per axis) so four of them are tested against a plane with a
+// handful of SSE instructions. Slots whose bounds are invalid always pass.
+class FrustumCuller
+{
+  public:
+    void Resize(size_t count);
+    void SetBounds(size_t index, const AABB& bounds);
+
+    // ORs visibleBit into masks[i] for every box touching the frustum and clears it for the rest, returns how many
+    // boxes were rejected.
+    uint32_t Cull(const Frustum& frustum, uint8_t visibleBit, std::span<uint8_t> masks) const;
+
+    size_t Size() const
+    {
+        return m_Count;
+    }
+
+  private:
+    size_t m_Count = 0;
+    std::vector<float> m_CenterX, m_CenterY, m_CenterZ;
+    std::vector<float> m_ExtentX, m_ExtentY, m_ExtentZ;
+};
+
+} // namespace REON
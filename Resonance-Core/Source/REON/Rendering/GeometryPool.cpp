@@ -0,0 +1,279 @@
+#include "reonpch.h"
+
+#include "GeometryPool.h"
+
+#include "REON/Platform/Vulkan/VulkanContext.h"
+
+namespace REON
+{
+
+void GeometryPool::Init(const VulkanContext* context)
+{
+    m_Context = context;
+    m_PendingFrees.resize(context->MAX_FRAMES_IN_FLIGHT);
+
+    DefaultVertex defaultVertex{};
+    defaultVertex.color = PackVertexColor(glm::vec4(1.0f));
+    defaultVertex.skin.weights[0] = UINT16_MAX;
+
+    BufferCreateInfo bufCreateInfo;
+    bufCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    bufCreateInfo.cpuAccess = CpuAccessPattern::None;
+    bufCreateInfo.memoryHint = BufferMemoryHint::GpuOnly;
+    bufCreateInfo.persistentlyMapped = false;
+    bufCreateInfo.size = sizeof(DefaultVertex);
+    m_DefaultVertexBuffer = context->createBuffer(bufCreateInfo);
+    upload(m_DefaultVertexBuffer, 0, &defaultVertex, sizeof(DefaultVertex));
+
+    createBlock(0, BlockVertexCount, BlockIndexCount);
+}
+
+void GeometryPool::Cleanup()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (uint32_t i = 0; i < m_BlockCount.load(std::memory_order_relaxed); i++)
+        m_Blocks[i] = Block{};
+    m_BlockCount.store(0, std::memory_order_release);
+    m_DefaultVertexBuffer.reset();
+    m_PendingFrees.clear();
+    m_Context = nullptr;
+}
+
+GeometryAllocation GeometryPool::Allocate(const VertexStreams& vertices, const uint32_t* indices, uint32_t indexCount)
+{
+    const uint32_t vertexCount = vertices.GetVertexCount();
+    REON_CORE_ASSERT(vertices.attributes.size() == vertexCount, "Vertex streams differ in length");
+    REON_CORE_ASSERT(!hasStream(vertices.format, VertexStream::Color) || vertices.colors.size() == vertexCount,
+                     "Vertex streams differ in length");
+    REON_CORE_ASSERT(!hasStream(vertices.format, VertexStream::Skin) || vertices.skin.size() == vertexCount,
+                     "Vertex streams differ in length");
+
+    GeometryAllocation allocation;
+    allocation.vertexCount = vertexCount;
+    allocation.indexCount = indexCount;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        REON_CORE_ASSERT(m_Context, "Geometry pool used before Init or after Cleanup");
+
+        const uint32_t blockCount = m_BlockCount.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < blockCount && !allocation.IsValid(); i++)
+        {
+            Block& block = m_Blocks[i];
+            if (block.format != vertices.format)
+                continue;
+            if (!block.vertices.Allocate(vertexCount, allocation.vertexOffset))
+                continue;
+            if (!block.indices.Allocate(indexCount, allocation.firstIndex))
+            {
+                block.vertices.Free(allocation.vertexOffset, vertexCount);
+                continue;
+            }
+            allocation.block = i;
+        }
+
+        if (!allocation.IsValid())
+        {
+            allocation.block = createBlock(vertices.format, std::max(vertexCount, BlockVertexCount),
+                                           std::max(indexCount, BlockIndexCount));
+            Block& block = m_Blocks[allocation.block];
+            block.vertices.Allocate(vertexCount, allocation.vertexOffset);
+            block.indices.Allocate(indexCount, allocation.firstIndex);
+        }
+    }
+
+    // The ranges belong to this allocation alone, uploading them needs no lock
+    const Block& block = m_Blocks[allocation.block];
+    const void* streams[] = {vertices.positions.data(), vertices.attributes.data(), vertices.colors.data(),
+                             vertices.skin.data()};
+    for (uint32_t i = 0; i < uint32_t(VertexStream::Count); i++)
+    {
+        if (!block.vertexBuffers[i])
+            continue;
+        const VkDeviceSize stride = VertexLayout::GetStride(VertexStream(i));
+        upload(block.vertexBuffers[i], VkDeviceSize(allocation.vertexOffset) * stride, streams[i],
+               VkDeviceSize(vertexCount) * stride);
+    }
+    upload(block.indexBuffer, VkDeviceSize(allocation.firstIndex) * sizeof(uint32_t), indices,
+           VkDeviceSize(indexCount) * sizeof(uint32_t));
+    return allocation;
+}
+
+void GeometryPool::Free(const GeometryAllocation& allocation)
+{
+    if (!allocation.IsValid())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // Meshes released after shutdown have nothing left to return their ranges to
+    if (!m_Context)
+        return;
+    m_PendingFrees[m_Context->getCurrentFrame()].push_back(allocation);
+}
+
+void GeometryPool::ReleaseFrame(int frame)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (const GeometryAllocation& allocation : m_PendingFrees[frame])
+    {
+        Block& block = m_Blocks[allocation.block];
+        block.vertices.Free(allocation.vertexOffset, allocation.vertexCount);
+        block.indices.Free(allocation.firstIndex, allocation.indexCount);
+    }
+    m_PendingFrees[frame].clear();
+}
+
+void GeometryPool::Bind(VkCommandBuffer commandBuffer, uint32_t block) const
+{
+    constexpr uint32_t streamCount = uint32_t(VertexStream::Count);
+    VkBuffer vertexBuffers[streamCount];
+    VkDeviceSize offsets[streamCount];
+    VkDeviceSize strides[streamCount];
+    for (uint32_t i = 0; i < streamCount; i++)
+    {
+        const VertexStream stream = VertexStream(i);
+        vertexBuffers[i] = GetVertexBuffer(block, stream);
+        offsets[i] = 0;
+        strides[i] = VertexLayout::GetStride(stream);
+        if (vertexBuffers[i] == VK_NULL_HANDLE)
+        {
+            vertexBuffers[i] = m_DefaultVertexBuffer->GetVkBuffer();
+            offsets[i] = stream == VertexStream::Skin ? offsetof(DefaultVertex, skin) : offsetof(DefaultVertex, color);
+            strides[i] = 0;
+        }
+    }
+    vkCmdBindVertexBuffers2(commandBuffer, 0, streamCount, vertexBuffers, offsets, nullptr, strides);
+
+    vkCmdBindIndexBuffer(commandBuffer, GetIndexBuffer(block), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void GeometryPool::BindPositions(VkCommandBuffer commandBuffer, uint32_t block) const
+{
+    VkBuffer vertexBuffers[] = {GetVertexBuffer(block, VertexStream::Position)};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+    vkCmdBindIndexBuffer(commandBuffer, GetIndexBuffer(block), 0, VK_INDEX_TYPE_UINT32);
+}
+
+bool GeometryPool::hasStream(uint32_t format, VertexStream stream)
+{
+    switch (stream)
+    {
+    case VertexStream::Color:
+        return (format & VERTEX_FORMAT_COLOR) != 0;
+    case VertexStream::Skin:
+        return (format & VERTEX_FORMAT_SKIN) != 0;
+    default:
+        return true;
+    }
+}
+
+uint32_t GeometryPool::createBlock(uint32_t format, uint32_t vertexCount, uint32_t indexCount)
+{
+    const uint32_t index = m_BlockCount.load(std::memory_order_relaxed);
+    REON_CORE_ASSERT(index < MaxBlockCount, "Geometry pool ran out of blocks");
+
+    BufferCreateInfo bufCreateInfo;
+    bufCreateInfo.cpuAccess = CpuAccessPattern::None;
+    bufCreateInfo.memoryHint = BufferMemoryHint::GpuOnly;
+    bufCreateInfo.persistentlyMapped = false;
+
+    Block& block = m_Blocks[index];
+    block.format = format;
+    bufCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    for (uint32_t i = 0; i < uint32_t(VertexStream::Count); i++)
+    {
+        if (!hasStream(format, VertexStream(i)))
+            continue;
+        bufCreateInfo.size = VkDeviceSize(vertexCount) * VertexLayout::GetStride(VertexStream(i));
+        block.vertexBuffers[i] = m_Context->createBuffer(bufCreateInfo);
+    }
+
+    bufCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    bufCreateInfo.size = VkDeviceSize(indexCount) * sizeof(uint32_t);
+    block.indexBuffer = m_Context->createBuffer(bufCreateInfo);
+
+    block.vertices.ranges = {{0, vertexCount}};
+    block.indices.ranges = {{0, indexCount}};
+
+    // Publishes the block to recording threads
+    m_BlockCount.store(index + 1, std::memory_order_release);
+
+    REON_CORE_INFO("Geometry pool block {0}: format {1}, {2} vertices, {3} indices", index, format, vertexCount,
+                   indexCount);
+    return index;
+}
+
+void GeometryPool::upload(const BufferHandle& destination, VkDeviceSize offset, const void* data, VkDeviceSize size)
+{
+    if (size == 0)
+        return;
+
+    BufferCreateInfo bufCreateInfo;
+    bufCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufCreateInfo.memoryHint = BufferMemoryHint::CpuToGpu;
+    bufCreateInfo.cpuAccess = CpuAccessPattern::SequentialWrite;
+    bufCreateInfo.persistentlyMapped = false;
+    bufCreateInfo.size = size;
+
+    BufferHandle stagingBuffer = m_Context->createBuffer(bufCreateInfo, data);
+    BufferHandle target = destination;
+    m_Context->copyBuffer(stagingBuffer, target, size, offset);
+}
+
+bool GeometryPool::FreeList::Allocate(uint32_t count, uint32_t& offset)
+{
+    if (count == 0)
+    {
+        offset = 0;
+        return true;
+    }
+
+    for (auto it = ranges.begin(); it != ranges.end(); ++it)
+    {
+        if (it->count < count)
+            continue;
+
+        offset = it->offset;
+        it->offset += count;
+        it->count -= count;
+        if (it->count == 0)
+            ranges.erase(it);
+        return true;
+    }
+    return false;
+}
+
+void GeometryPool::FreeList::Free(uint32_t offset, uint32_t count)
+{
+    if (count == 0)
+        return;
+
+    auto next = std::lower_bound(ranges.begin(), ranges.end(), offset,
+                                 [](const Range& range, uint32_t value) { return range.offset < value; });
+
+    // Merge with the free range right before and/or right after
+    const bool mergePrevious = next != ranges.begin() && std::prev(next)->offset + std::prev(next)->count == offset;
+    const bool mergeNext = next != ranges.end() && offset + count == next->offset;
+
+    if (mergePrevious && mergeNext)
+    {
+        std::prev(next)->count += count + next->count;
+        ranges.erase(next);
+    }
+    else if (mergePrevious)
+    {
+        std::prev(next)->count += count;
+    }
+    else if (mergeNext)
+    {
+        next->offset = offset;
+        next->count += count;
+    }
+    else
+    {
+        ranges.insert(next, {offset, count});
+    }
+}
+
+} // namespace REON
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "REON/Platform/Vulkan/VulkanBuffer.h"
+#include "REON/Rendering/Structs/Vertex.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace REON
+{
+
+class VulkanContext;
+
+// Where a mesh lives in the geometry pool. Its indices stay relative to the mesh, draws add firstIndex to their index
+// range and pass vertexOffset.
+struct GeometryAllocation
+{
+    uint32_t block = UINT32_MAX;
+    uint32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+
+    bool IsValid() const
+    {
+        return block != UINT32_MAX;
+    }
+};
+
+// Large vertex and index buffers every mesh is suballocated from, so draws of different meshes share one binding and
+// can be batched into a single indirect draw. Blocks are only added while the context lives and never moved, recording
+// threads read their buffers without locking.
+//
+// Each block holds meshes of one vertex format and has a buffer per vertex stream it needs. Streams a format lacks are
+// bound to a single default element with a stride of zero, so one pipeline draws every format and switching formats
+// costs no more than switching blocks.
+class GeometryPool
+{
+  public:
+    void Init(const VulkanContext* context);
+    void Cleanup();
+
+    // Uploads the mesh through a staging buffer and blocks until the copy finished.
+    GeometryAllocation Allocate(const VertexStreams& vertices, const uint32_t* indices, uint32_t indexCount);
+    // The ranges are handed out again once the frame in flight that may still draw from them has finished.
+    void Free(const GeometryAllocation& allocation);
+    // Called after the fence of a frame in flight was waited on.
+    void ReleaseFrame(int frame);
+
+    // VK_NULL_HANDLE if the block's format has no such stream
+    VkBuffer GetVertexBuffer(uint32_t block, VertexStream stream) const
+    {
+        const BufferHandle& buffer = m_Blocks[block].vertexBuffers[size_t(stream)];
+        return buffer ? buffer->GetVkBuffer() : VK_NULL_HANDLE;
+    }
+    uint32_t GetFormat(uint32_t block) const
+    {
+        return m_Blocks[block].format;
+    }
+    VkBuffer GetIndexBuffer(uint32_t block) const
+    {
+        return m_Blocks[block].indexBuffer->GetVkBuffer();
+    }
+    uint32_t GetBlockCount() const
+    {
+        return m_BlockCount.load(std::memory_order_acquire);
+    }
+    // Binds the vertex and index buffers of a block, draws of every allocation in it then only differ in offsets. The
+    // bound pipeline needs dynamic vertex input binding strides and the layout of VertexLayout::getBindingDescriptions.
+    void Bind(VkCommandBuffer commandBuffer, uint32_t block) const;
+    // Binds only the position stream at binding 0 and the index buffer, for pipelines built with
+    // VertexLayout::getPositionBindingDescription.
+    void BindPositions(VkCommandBuffer commandBuffer, uint32_t block) const;
+
+  private:
+    struct Range
+    {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    // First fit over the free ranges, kept sorted by offset so neighbours merge on free
+    struct FreeList
+    {
+        std::vector<Range> ranges;
+
+        bool Allocate(uint32_t count, uint32_t& offset);
+        void Free(uint32_t offset, uint32_t count);
+    };
+
+    struct Block
+    {
+        uint32_t format = 0; // VertexFormatFlags
+        std::array<BufferHandle, size_t(VertexStream::Count)> vertexBuffers;
+        BufferHandle indexBuffer;
+        FreeList vertices;
+        FreeList indices;
+    };
+
+    // What absent optional streams read, a white color and a skin fully bound to joint 0
+    struct DefaultVertex
+    {
+        uint32_t color;
+        uint32_t _padding[3];
+        PackedVertexSkin skin;
+    };
+
+    static constexpr uint32_t MaxBlockCount = 32;
+    // 6 MB of unskinned, uncolored vertices and 4 MB of indices, meshes that do not fit get a block of their own size
+    static constexpr uint32_t BlockVertexCount = 1u << 18;
+    static constexpr uint32_t BlockIndexCount = 1u << 20;
+
+    static bool hasStream(uint32_t format, VertexStream stream);
+    uint32_t createBlock(uint32_t format, uint32_t vertexCount, uint32_t indexCount);
+    void upload(const BufferHandle& destination, VkDeviceSize offset, const void* data, VkDeviceSize size);
+
+  private:
+    const VulkanContext* m_Context = nullptr;
+    std::array<Block, MaxBlockCount> m_Blocks;
+    std::atomic<uint32_t> m_BlockCount = 0;
+    BufferHandle m_DefaultVertexBuffer;
+    // Allocations freed while a frame in flight was being recorded, per frame in flight
+    std::vector<std::vector<GeometryAllocation>> m_PendingFrees;
+    std::mutex m_Mutex;
+};
+
+} // namespace REON
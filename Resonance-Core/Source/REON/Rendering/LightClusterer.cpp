@@ -0,0 +1,272 @@
+#include "reonpch.h"
+
+#include "LightClusterer.h"
+
+#include "REON/GameHierarchy/Components/Light.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define REON_CLUSTER_SSE 1
+#include <xmmintrin.h>
+#else
+#define REON_CLUSTER_SSE 0
+#endif
+
+namespace REON
+{
+
+namespace
+{
+constexpr uint32_t LaneCount = 4;
+static_assert(LightClusterer::ClusterCountX % LaneCount == 0, "Cluster rows are tested four clusters at a time");
+
+struct SpotCone
+{
+    glm::vec3 apex;
+    glm::vec3 axis;
+    float cosine;
+    float sine;
+    float range;
+};
+
+// Bounding sphere of the cluster against the cone, after Bart Wronski's cone culling: rejects clusters outside the
+// cone's angle, beyond its range or behind its apex.
+bool ConeTouchesCluster(const SpotCone& cone, const glm::vec3& min, const glm::vec3& max)
+{
+    const glm::vec3 center = (min + max) * 0.5f;
+    const float radius = glm::length(max - min) * 0.5f;
+
+    const glm::vec3 offset = center - cone.apex;
+    const float lengthSq = glm::dot(offset, offset);
+    const float alongAxis = glm::dot(offset, cone.axis);
+    const float closest = cone.cosine * glm::sqrt(glm::max(lengthSq - alongAxis * alongAxis, 0.0f)) -
+                          alongAxis * cone.sine;
+
+    return closest <= radius && alongAxis <= radius + cone.range && alongAxis >= -radius;
+}
+} // namespace
+
+void LightClusterer::Build(const RenderView& view, std::span<const LightData> lights, uint32_t firstLight)
+{
+    if (view.projection != m_Projection || view.nearPlane != m_NearPlane || view.farPlane != m_FarPlane)
+        buildClusterBounds(view);
+
+    m_Hits.clear();
+    for (uint32_t i = firstLight; i < lights.size(); i++)
+        binLight(view, lights[i], i);
+
+    // Counting sort by cluster, lights stay in order within each cluster
+    m_Clusters.assign(ClusterCount, LightCluster{0, 0});
+    for (const Hit& hit : m_Hits)
+        m_Clusters[hit.cluster].count++;
+
+    uint32_t offset = 0;
+    for (LightCluster& cluster : m_Clusters)
+    {
+        cluster.offset = offset;
+        offset += cluster.count;
+        cluster.count = 0;
+    }
+
+    m_LightIndices.resize(m_Hits.size());
+    for (const Hit& hit : m_Hits)
+    {
+        LightCluster& cluster = m_Clusters[hit.cluster];
+        m_LightIndices[cluster.offset + cluster.count++] = hit.light;
+    }
+}
+
+glm::vec4 LightClusterer::GetClusterScale(const RenderView& view) const
+{
+    const float nearPlane = glm::max(view.nearPlane, 1e-4f);
+    const float logRange = glm::log(glm::max(view.farPlane, nearPlane * 1.001f) / nearPlane);
+    return glm::vec4(float(ClusterCountX) / float(glm::max(view.viewportSize.x, 1u)),
+                     float(ClusterCountY) / float(glm::max(view.viewportSize.y, 1u)), float(ClusterCountZ) / logRange,
+                     -float(ClusterCountZ) * glm::log(nearPlane) / logRange);
+}
+
+void LightClusterer::buildClusterBounds(const RenderView& view)
+{
+    m_Projection = view.projection;
+    m_NearPlane = view.nearPlane;
+    m_FarPlane = view.farPlane;
+
+    const float nearPlane = glm::max(view.nearPlane, 1e-4f);
+    const float farPlane = glm::max(view.farPlane, nearPlane * 1.001f);
+    m_SliceDepths.resize(ClusterCountZ + 1);
+    for (uint32_t k = 0; k <= ClusterCountZ; k++)
+        m_SliceDepths[k] = nearPlane * glm::pow(farPlane / nearPlane, float(k) / float(ClusterCountZ));
+
+    for (auto* stream : {&m_MinX, &m_MinY, &m_MinZ, &m_MaxX, &m_MaxY, &m_MaxZ})
+        stream->resize(ClusterCount);
+
+    // Every tile corner is a line through view space, found from two depths so orthographic projections work too
+    const glm::mat4 inverseProjection = glm::inverse(view.projection);
+    auto unproject = [&](float x, float y, float z) {
+        const glm::vec4 p = inverseProjection * glm::vec4(x, y, z, 1.0f);
+        return glm::vec3(p) / p.w;
+    };
+
+    for (uint32_t y = 0; y < ClusterCountY; y++)
+    {
+        for (uint32_t x = 0; x < ClusterCountX; x++)
+        {
+            std::array<glm::vec3, 4> nearCorners, farCorners;
+            for (uint32_t corner = 0; corner < 4; corner++)
+            {
+                const float ndcX = -1.0f + 2.0f * float(x + (corner & 1)) / float(ClusterCountX);
+                const float ndcY = -1.0f + 2.0f * float(y + (corner >> 1)) / float(ClusterCountY);
+                nearCorners[corner] = unproject(ndcX, ndcY, 0.0f);
+                farCorners[corner] = unproject(ndcX, ndcY, 1.0f);
+            }
+
+            auto cornerAt = [&](uint32_t corner, float depth) {
+                const glm::vec3& a = nearCorners[corner];
+                const glm::vec3& b = farCorners[corner];
+                // View space looks down -Z, so the far point has the smaller z
+                const float t = (-depth - a.z) / glm::min(b.z - a.z, -1e-6f);
+                return a + (b - a) * t;
+            };
+
+            for (uint32_t k = 0; k < ClusterCountZ; k++)
+            {
+                glm::vec3 min(std::numeric_limits<float>::max());
+                glm::vec3 max(std::numeric_limits<float>::lowest());
+                for (uint32_t corner = 0; corner < 4; corner++)
+                {
+                    for (float depth : {m_SliceDepths[k], m_SliceDepths[k + 1]})
+                    {
+                        const glm::vec3 point = cornerAt(corner, depth);
+                        min = glm::min(min, point);
+                        max = glm::max(max, point);
+                    }
+                }
+
+                const size_t index = (size_t(k) * ClusterCountY + y) * ClusterCountX + x;
+                m_MinX[index] = min.x;
+                m_MinY[index] = min.y;
+                m_MinZ[index] = min.z;
+                m_MaxX[index] = max.x;
+                m_MaxY[index] = max.y;
+                m_MaxZ[index] = max.z;
+            }
+        }
+    }
+}
+
+void LightClusterer::binLight(const RenderView& view, const LightData& light, uint32_t index)
+{
+    const float radius = light.range;
+    if (radius <= 0.0f)
+        return;
+
+    const glm::vec3 center = glm::vec3(view.view * glm::vec4(glm::vec3(light.position), 1.0f));
+    const float depth = -center.z;
+    if (depth + radius < m_SliceDepths.front() || depth - radius > m_SliceDepths.back())
+        return;
+
+    // Slices the sphere's depth range overlaps
+    auto sliceOf = [&](auto bound) {
+        return uint32_t(glm::clamp<ptrdiff_t>(bound - m_SliceDepths.begin() - 1, 0, ClusterCountZ - 1));
+    };
+    const uint32_t firstSlice = sliceOf(std::upper_bound(m_SliceDepths.begin(), m_SliceDepths.end(), depth - radius));
+    const uint32_t lastSlice = sliceOf(std::lower_bound(m_SliceDepths.begin(), m_SliceDepths.end(), depth + radius));
+
+    // Tiles under the projected corners of the sphere's box, all of them once it reaches the near plane
+    uint32_t firstX = 0, lastX = ClusterCountX - 1, firstY = 0, lastY = ClusterCountY - 1;
+    if (depth - radius > m_SliceDepths.front())
+    {
+        glm::vec2 ndcMin(std::numeric_limits<float>::max());
+        glm::vec2 ndcMax(std::numeric_limits<float>::lowest());
+        for (uint32_t corner = 0; corner < 8; corner++)
+        {
+            const glm::vec3 offset((corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius,
+                                   (corner & 4) ? radius : -radius);
+            const glm::vec4 clip = view.projection * glm::vec4(center + offset, 1.0f);
+            const glm::vec2 ndc = glm::vec2(clip) / clip.w;
+            ndcMin = glm::min(ndcMin, ndc);
+            ndcMax = glm::max(ndcMax, ndc);
+        }
+        if (ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f)
+            return;
+
+        auto toTile = [](float ndc, uint32_t count) {
+            return uint32_t(glm::clamp((ndc * 0.5f + 0.5f) * float(count), 0.0f, float(count - 1)));
+        };
+        firstX = toTile(ndcMin.x, ClusterCountX);
+        lastX = toTile(ndcMax.x, ClusterCountX);
+        firstY = toTile(ndcMin.y, ClusterCountY);
+        lastY = toTile(ndcMax.y, ClusterCountY);
+    }
+
+    const bool isSpot = light.type == int(LightType::Spot) && light.outerCutoff > 0.0f && light.outerCutoff < 90.0f;
+    SpotCone cone{};
+    if (isSpot)
+    {
+        cone.apex = center;
+        cone.axis = glm::normalize(glm::mat3(view.view) * glm::vec3(light.direction));
+        cone.cosine = glm::cos(glm::radians(light.outerCutoff));
+        cone.sine = glm::sin(glm::radians(light.outerCutoff));
+        cone.range = radius;
+    }
+
+    auto addHit = [&](size_t cluster) {
+        if (isSpot)
+        {
+            const glm::vec3 min(m_MinX[cluster], m_MinY[cluster], m_MinZ[cluster]);
+            const glm::vec3 max(m_MaxX[cluster], m_MaxY[cluster], m_MaxZ[cluster]);
+            if (!ConeTouchesCluster(cone, min, max))
+                return;
+        }
+        m_Hits.push_back({uint32_t(cluster), index});
+    };
+
+#if REON_CLUSTER_SSE
+    const __m128 centerX = _mm_set1_ps(center.x);
+    const __m128 centerY = _mm_set1_ps(center.y);
+    const __m128 centerZ = _mm_set1_ps(center.z);
+    const __m128 radiusSq = _mm_set1_ps(radius * radius);
+    const __m128 zero = _mm_setzero_ps();
+#endif
+
+    for (uint32_t k = firstSlice; k <= lastSlice; k++)
+    {
+        for (uint32_t y = firstY; y <= lastY; y++)
+        {
+            const size_t row = (size_t(k) * ClusterCountY + y) * ClusterCountX;
+            for (uint32_t x = firstX / LaneCount * LaneCount; x <= lastX; x += LaneCount)
+            {
+                const size_t i = row + x;
+#if REON_CLUSTER_SSE
+                // Squared distance from the sphere center to each box, per axis max(min - c, c - max, 0)
+                auto axisDistance = [&](const float* min, const float* max, __m128 c) {
+                    const __m128 below = _mm_sub_ps(_mm_loadu_ps(min + i), c);
+                    const __m128 above = _mm_sub_ps(c, _mm_loadu_ps(max + i));
+                    const __m128 d = _mm_max_ps(_mm_max_ps(below, above), zero);
+                    return _mm_mul_ps(d, d);
+                };
+                __m128 distanceSq = axisDistance(m_MinX.data(), m_MaxX.data(), centerX);
+                distanceSq = _mm_add_ps(distanceSq, axisDistance(m_MinY.data(), m_MaxY.data(), centerY));
+                distanceSq = _mm_add_ps(distanceSq, axisDistance(m_MinZ.data(), m_MaxZ.data(), centerZ));
+                const int insideBits = _mm_movemask_ps(_mm_cmple_ps(distanceSq, radiusSq));
+#else
+                int insideBits = 0;
+                for (uint32_t lane = 0; lane < LaneCount; lane++)
+                {
+                    const size_t c = i + lane;
+                    const glm::vec3 d = glm::max(glm::max(glm::vec3(m_MinX[c], m_MinY[c], m_MinZ[c]) - center,
+                                                          center - glm::vec3(m_MaxX[c], m_MaxY[c], m_MaxZ[c])),
+                                                 glm::vec3(0.0f));
+                    insideBits |= int(glm::dot(d, d) <= radius * radius) << lane;
+                }
+#endif
+                for (uint32_t lane = 0; lane < LaneCount; lane++)
+                {
+                    if ((insideBits >> lane) & 1 && x + lane >= firstX && x + lane <= lastX)
+                        addHit(i + lane);
+                }
+            }
+        }
+    }
+}
+
+} // namespace REON
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "REON/Rendering/Structs/LightData.h"
+#include "RenderSnapshot.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace REON
+{
+
+// Range of the light index list one cluster uses, laid out like LightCluster in light_clusters.hlsl
+struct LightCluster
+{
+    uint32_t offset;
+    uint32_t count;
+};
+static_assert(sizeof(LightCluster) == 8, "LightCluster no longer matches light_clusters.hlsl");
+
+// Froxel grid over one camera's view: screen tiles split into slices that grow exponentially with view depth. Lights
+// with a range are binned into every cluster their sphere (or, for spot lights, cone) touches, so a pixel only shades
+// the lights of its own cluster. The grid bounds are cached and rebuilt when the projection changes.
+class LightClusterer
+{
+  public:
+    static constexpr uint32_t ClusterCountX = 16;
+    static constexpr uint32_t ClusterCountY = 9;
+    static constexpr uint32_t ClusterCountZ = 24;
+    static constexpr uint32_t ClusterCount = ClusterCountX * ClusterCountY * ClusterCountZ;
+
+    // Bins lights[firstLight, lights.size()) and rebuilds the cluster ranges and index list. Indices refer to lights.
+    void Build(const RenderView& view, std::span<const LightData> lights, uint32_t firstLight);
+
+    std::span<const LightCluster> GetClusters() const
+    {
+        return m_Clusters;
+    }
+    std::span<const uint32_t> GetLightIndices() const
+    {
+        return m_LightIndices;
+    }
+
+    // Maps a fragment to its cluster: xy scale pixel coordinates to tiles, the depth slice is
+    // log(view depth) * z + w.
+    glm::vec4 GetClusterScale(const RenderView& view) const;
+
+  private:
+    void buildClusterBounds(const RenderView& view);
+    void binLight(const RenderView& view, const LightData& light, uint32_t index);
+
+  private:
+    glm::mat4 m_Projection{0.0f};
+    float m_NearPlane = 0.0f;
+    float m_FarPlane = 0.0f;
+
+    // View space bounds of every cluster, x fastest, stored as structure-of-arrays so four clusters of a row are
+    // tested against a light at once.
+    std::vector<float> m_MinX, m_MinY, m_MinZ;
+    std::vector<float> m_MaxX, m_MaxY, m_MaxZ;
+    std::vector<float> m_SliceDepths; // view depth where slice i starts, one past the last slice included
+
+    struct Hit
+    {
+        uint32_t cluster;
+        uint32_t light;
+    };
+    std::vector<Hit> m_Hits;
+    std::vector<LightCluster> m_Clusters;
+    std::vector<uint32_t> m_LightIndices;
+};
+
+} // namespace REON
@@ -2,8 +2,6 @@
 
 #include "REON/GameHierarchy/Components/Light.h"
 
-#define REON_MAX_LIGHTS 50
-
 namespace REON
 {
 
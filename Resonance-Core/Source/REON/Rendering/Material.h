@@ -65,6 +65,17 @@ class [[clang::annotate("serialize")]] Material : public ResourceBase
         return m_DoubleSided;
     }
 
+    // The renderer only re-uploads a material's record when this changed, call it after editing the flat data or
+    // swapping a texture of a material that is already drawn.
+    void MarkDirty()
+    {
+        m_Revision++;
+    }
+
+    uint32_t GetRevision() const
+    {
+        return m_Revision;
+    }
 
 
   public:
@@ -80,11 +91,9 @@ class [[clang::annotate("serialize")]] Material : public ResourceBase
     RenderingModes renderingMode = Opaque;
     BlendingModes blendingMode = Blend;
 
-    std::vector<BufferHandle> flatDataBuffers;
-    std::vector<VkDescriptorSet> descriptorSets;
-
   private:
     bool m_DoubleSided;
+    uint32_t m_Revision = 0;
     // void createDescriptorSets();
 };
 } // namespace REON
@@ -0,0 +1,309 @@
+#include "reonpch.h"
+
+#include "MaterialTable.h"
+
+#include "REON/Platform/Vulkan/VulkanContext.h"
+#include "REON/Rendering/Material.h"
+#include "REON/Rendering/Structs/Texture.h"
+
+namespace REON
+{
+
+void MaterialTable::Init(const VulkanContext* context, VkImageView dummyView, VkSampler dummySampler)
+{
+    m_Context = context;
+    const uint32_t frameCount = static_cast<uint32_t>(context->MAX_FRAMES_IN_FLIGHT);
+
+    VkDescriptorSetLayoutBinding recordBinding{};
+    recordBinding.binding = 0;
+    recordBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    recordBinding.descriptorCount = 1;
+    recordBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutBinding textureBinding{};
+    textureBinding.binding = 1;
+    textureBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    textureBinding.descriptorCount = MaxTextures;
+    textureBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // Update after bind only for its much higher descriptor limits, every frame still writes its own set while the
+    // set is idle. Slots no material uses are never written.
+    std::array<VkDescriptorBindingFlags, 2> bindingFlags{
+        0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT};
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{recordBinding, textureBinding};
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    VkResult res = vkCreateDescriptorSetLayout(context->getDevice(), &layoutInfo, nullptr, &m_Layout);
+    REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create material table descriptor set layout");
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = frameCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = frameCount * MaxTextures;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = frameCount;
+
+    res = vkCreateDescriptorPool(context->getDevice(), &poolInfo, nullptr, &m_DescriptorPool);
+    REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create material table descriptor pool");
+
+    // Slot 0 is the dummy texture and never handed out
+    m_Textures.resize(1);
+    m_Textures[0].references = UINT32_MAX;
+
+    m_Frames.resize(frameCount);
+    for (FrameData& frame : m_Frames)
+    {
+        BufferCreateInfo bufCreateInfo;
+        bufCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        bufCreateInfo.memoryHint = BufferMemoryHint::CpuToGpu;
+        bufCreateInfo.cpuAccess = CpuAccessPattern::SequentialWrite;
+        bufCreateInfo.persistentlyMapped = true;
+        bufCreateInfo.size = sizeof(MaterialRecord) * MaxMaterials;
+        frame.records = context->createBuffer(bufCreateInfo);
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = m_DescriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &m_Layout;
+
+        res = vkAllocateDescriptorSets(context->getDevice(), &allocInfo, &frame.descriptorSet);
+        REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to allocate material table descriptor set");
+
+        VkDescriptorBufferInfo recordInfo{};
+        recordInfo.buffer = frame.records->GetVkBuffer();
+        recordInfo.offset = 0;
+        recordInfo.range = VK_WHOLE_SIZE;
+
+        VkDescriptorImageInfo dummyInfo{};
+        dummyInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        dummyInfo.imageView = dummyView;
+        dummyInfo.sampler = dummySampler;
+
+        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = frame.descriptorSet;
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pBufferInfo = &recordInfo;
+
+        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[1].dstSet = frame.descriptorSet;
+        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].dstArrayElement = 0;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[1].descriptorCount = 1;
+        descriptorWrites[1].pImageInfo = &dummyInfo;
+
+        vkUpdateDescriptorSets(context->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
+                               descriptorWrites.data(), 0, nullptr);
+    }
+}
+
+void MaterialTable::Cleanup()
+{
+    if (!m_Context)
+        return;
+
+    // Destroying the pool frees its sets
+    vkDestroyDescriptorPool(m_Context->getDevice(), m_DescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_Context->getDevice(), m_Layout, nullptr);
+    m_DescriptorPool = VK_NULL_HANDLE;
+    m_Layout = VK_NULL_HANDLE;
+
+    m_Entries.clear();
+    m_Frames.clear();
+    m_Textures.clear();
+    m_TextureSlots.clear();
+    m_FreeTextures.clear();
+    m_Context = nullptr;
+}
+
+void MaterialTable::Update(std::span<const ResourceHandle<Material>> materials, int frame)
+{
+    REON_CORE_ASSERT(materials.size() <= MaxMaterials, "More materials than the material table can hold");
+
+    FrameData& frameData = m_Frames[frame];
+    // The work that could still sample these finished with this frame's fence
+    for (uint32_t slot : frameData.retiredTextures)
+    {
+        m_Textures[slot] = TextureSlot{};
+        m_FreeTextures.push_back(slot);
+    }
+    frameData.retiredTextures.clear();
+
+    if (m_Entries.size() < materials.size())
+        m_Entries.resize(materials.size());
+    if (frameData.uploadedVersions.size() < materials.size())
+        frameData.uploadedVersions.resize(materials.size(), 0);
+
+    auto* records = static_cast<MaterialRecord*>(frameData.records->GetMappedData());
+    for (size_t i = 0; i < materials.size(); i++)
+    {
+        Entry& entry = m_Entries[i];
+        auto material = materials[i].Lock();
+        if (!material)
+        {
+            // Nothing draws with an unloaded material, only its textures have to go
+            if (entry.resolved)
+            {
+                for (uint32_t slot : entry.textures)
+                    releaseTexture(slot, frame);
+                entry = Entry{};
+            }
+            continue;
+        }
+
+        if (entry.resolved != material.get() || entry.material.expired() ||
+            entry.revision != material->GetRevision())
+            resolve(entry, material, frame);
+
+        if (frameData.uploadedVersions[i] != entry.version)
+        {
+            records[i] = entry.record;
+            frameData.uploadedVersions[i] = entry.version;
+        }
+    }
+
+    writePendingTextures(frame);
+}
+
+void MaterialTable::resolve(Entry& entry, const std::shared_ptr<Material>& material, int frame)
+{
+    const std::array<std::shared_ptr<Texture>, TexturesPerMaterial> textures{
+        material->albedoTexture.Lock(),   material->normalTexture.Lock(),   material->metallicRoughnessTexture.Lock(),
+        material->emissiveTexture.Lock(), material->specularTexture.Lock(), material->specularColorTexture.Lock()};
+
+    // Acquire before releasing, so textures the material keeps also keep their slots
+    std::array<uint32_t, TexturesPerMaterial> slots{};
+    for (size_t i = 0; i < TexturesPerMaterial; i++)
+        slots[i] = acquireTexture(textures[i]);
+    for (uint32_t slot : entry.textures)
+        releaseTexture(slot, frame);
+
+    entry.material = material;
+    entry.resolved = material.get();
+    entry.revision = material->GetRevision();
+    entry.version = m_NextVersion++;
+    entry.textures = slots;
+
+    const FlatData& flat = material->flatData;
+    MaterialRecord& record = entry.record;
+    record.albedo = flat.albedo;
+    record.roughness = flat.roughness;
+    record.metallic = flat.metallic;
+    record.normalScalar = flat.normalScalar;
+    record.normalYScale = flat.normalYScale;
+    record.emissiveFactor = flat.emissiveFactor;
+    record.specularFactor = flat.specularFactor;
+    record.preCompF0 = flat.preCompF0;
+    record.albedoTexture = slots[0];
+    record.normalTexture = slots[1];
+    record.metallicRoughnessTexture = slots[2];
+    record.emissiveTexture = slots[3];
+    record.specularTexture = slots[4];
+    record.specularColorTexture = slots[5];
+}
+
+uint32_t MaterialTable::acquireTexture(const std::shared_ptr<Texture>& texture)
+{
+    if (!texture)
+        return 0;
+
+    auto it = m_TextureSlots.find(texture.get());
+    if (it != m_TextureSlots.end())
+    {
+        m_Textures[it->second].references++;
+        return it->second;
+    }
+
+    uint32_t slot;
+    if (!m_FreeTextures.empty())
+    {
+        slot = m_FreeTextures.back();
+        m_FreeTextures.pop_back();
+    }
+    else if (m_Textures.size() < MaxTextures)
+    {
+        slot = static_cast<uint32_t>(m_Textures.size());
+        m_Textures.emplace_back();
+    }
+    else
+    {
+        if (!m_WarnedTextureCapacity)
+            REON_CORE_WARN("Material table is out of texture slots, further textures draw with the dummy texture");
+        m_WarnedTextureCapacity = true;
+        return 0;
+    }
+
+    m_Textures[slot] = {texture, 1};
+    m_TextureSlots.insert({texture.get(), slot});
+    for (FrameData& frame : m_Frames)
+        frame.pendingTextures.push_back(slot);
+    return slot;
+}
+
+void MaterialTable::releaseTexture(uint32_t slot, int frame)
+{
+    if (slot == 0 || --m_Textures[slot].references > 0)
+        return;
+
+    m_TextureSlots.erase(m_Textures[slot].texture.get());
+    m_Frames[frame].retiredTextures.push_back(slot);
+}
+
+void MaterialTable::writePendingTextures(int frame)
+{
+    FrameData& frameData = m_Frames[frame];
+    if (frameData.pendingTextures.empty())
+        return;
+
+    std::vector<VkDescriptorImageInfo> imageInfos;
+    imageInfos.reserve(frameData.pendingTextures.size());
+    std::vector<VkWriteDescriptorSet> descriptorWrites;
+    descriptorWrites.reserve(frameData.pendingTextures.size());
+    for (uint32_t slot : frameData.pendingTextures)
+    {
+        // Freed again before this frame came around, nothing in this frame's records points at it
+        const std::shared_ptr<Texture>& texture = m_Textures[slot].texture;
+        if (!texture)
+            continue;
+
+        VkDescriptorImageInfo& imageInfo = imageInfos.emplace_back();
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = texture->getTextureView();
+        imageInfo.sampler = texture->getSampler();
+
+        VkWriteDescriptorSet& write = descriptorWrites.emplace_back();
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = frameData.descriptorSet;
+        write.dstBinding = 1;
+        write.dstArrayElement = slot;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.descriptorCount = 1;
+        write.pImageInfo = &imageInfo;
+    }
+    frameData.pendingTextures.clear();
+
+    vkUpdateDescriptorSets(m_Context->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
+                           descriptorWrites.data(), 0, nullptr);
+}
+
+} // namespace REON
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "REON/Platform/Vulkan/VulkanBuffer.h"
+#include "REON/ResourceManagement/Resource.h"
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace REON
+{
+
+class Material;
+class Texture;
+class VulkanContext;
+
+// GPU copy of a material, laid out like MaterialRecord in material_table.hlsl. The texture fields index the table's
+// texture array, slot 0 holds the dummy texture for the ones a material does not set.
+struct alignas(16) MaterialRecord
+{
+    glm::vec4 albedo;
+    float roughness;
+    float metallic;
+    float normalScalar;
+    int normalYScale;
+    glm::vec4 emissiveFactor; // w = alphaCutoff
+    glm::vec4 specularFactor;
+    float preCompF0;
+    uint32_t albedoTexture;
+    uint32_t normalTexture;
+    uint32_t metallicRoughnessTexture;
+    uint32_t emissiveTexture;
+    uint32_t specularTexture;
+    uint32_t specularColorTexture;
+    uint32_t _padding;
+};
+static_assert(sizeof(MaterialRecord) == 96, "MaterialRecord no longer matches material_table.hlsl");
+
+// Every material the renderer draws with as one storage buffer of records plus one descriptor indexed texture array,
+// bound once per pass as set 1. Draws pick their record through the material index in their object data, so changing
+// materials between draws binds nothing.
+//
+// Records are only rewritten when a material was replaced or marked dirty. Each frame in flight has its own copy of the
+// records and its own descriptor set, both are only written in Update after that frame's fence was waited on.
+class MaterialTable
+{
+  public:
+    // One record per DrawKey material slot, the render queue cannot address more.
+    static constexpr uint32_t MaxMaterials = 1u << 14;
+    // Must match MATERIAL_TEXTURE_CAPACITY in material_table.hlsl
+    static constexpr uint32_t MaxTextures = 4096;
+
+    void Init(const VulkanContext* context, VkImageView dummyView, VkSampler dummySampler);
+    void Cleanup();
+
+    // Brings the frame's copy up to date, record i belongs to materials[i]. Call once per frame before any command
+    // buffer binds the frame's set.
+    void Update(std::span<const ResourceHandle<Material>> materials, int frame);
+
+    VkDescriptorSetLayout GetLayout() const
+    {
+        return m_Layout;
+    }
+    VkDescriptorSet GetDescriptorSet(int frame) const
+    {
+        return m_Frames[frame].descriptorSet;
+    }
+
+  private:
+    static constexpr uint32_t TexturesPerMaterial = 6;
+
+    struct Entry
+    {
+        // Reloading a material hands out a new object under the same handle, the raw pointer alone could be reused
+        std::weak_ptr<Material> material;
+        const Material* resolved = nullptr;
+        uint32_t revision = 0;
+        uint32_t version = 0; // of record, compared against what each frame uploaded
+        std::array<uint32_t, TexturesPerMaterial> textures{};
+        MaterialRecord record{};
+    };
+
+    struct TextureSlot
+    {
+        std::shared_ptr<Texture> texture; // keeps the view alive while a frame in flight may sample it
+        uint32_t references = 0;
+    };
+
+    struct FrameData
+    {
+        BufferHandle records;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        std::vector<uint32_t> uploadedVersions; // per entry
+        std::vector<uint32_t> pendingTextures;  // slots this frame's set does not point at yet
+        std::vector<uint32_t> retiredTextures;  // freed while this frame was current, reusable when it comes back
+    };
+
+    void resolve(Entry& entry, const std::shared_ptr<Material>& material, int frame);
+    uint32_t acquireTexture(const std::shared_ptr<Texture>& texture);
+    void releaseTexture(uint32_t slot, int frame);
+    void writePendingTextures(int frame);
+
+  private:
+    const VulkanContext* m_Context = nullptr;
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_Layout = VK_NULL_HANDLE;
+
+    std::vector<Entry> m_Entries;
+    std::vector<FrameData> m_Frames;
+    uint32_t m_NextVersion = 1;
+
+    std::vector<TextureSlot> m_Textures;
+    std::unordered_map<const Texture*, uint32_t> m_TextureSlots;
+    std::vector<uint32_t> m_FreeTextures;
+    bool m_WarnedTextureCapacity = false;
+};
+
+} // namespace REON
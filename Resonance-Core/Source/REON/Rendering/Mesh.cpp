@@ -11,81 +11,54 @@ namespace REON
 
 Mesh::~Mesh()
 {
+    const VulkanContext* context = static_cast<const VulkanContext*>(Application::Get().GetRenderContext());
+    context->getGeometryPool()->Free(geometry);
 }
 
-void Mesh::setupMesh()
+void Mesh::setupMesh(const VertexStreams& vertices)
 {
-    setupBuffers();
+    setupBuffers(vertices);
 }
 
-void Mesh::setupBuffers()
+void Mesh::setupBuffers(const VertexStreams& vertices)
 {
-    m_Vertices.resize(positions.size());
-
-    for (size_t i = 0; i < positions.size(); ++i)
-    {
-        Vertex vertex{};
-        vertex.Position = positions[i];
-        vertex.Color = colors[i];
-        vertex.Normal = normals[i];
-        vertex.TexCoords = texCoords[i];
-        vertex.Tangent = tangents.size() > i ? tangents[i] : glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
-
-        m_Vertices[i] = vertex;
-    }
-
-    VkDeviceSize bufferSize = sizeof(m_Vertices[0]) * m_Vertices.size();
+    vertexFormat = vertices.format;
 
     const VulkanContext* context = static_cast<const VulkanContext*>(Application::Get().GetRenderContext());
 
-    BufferCreateInfo bufCreateInfo;
-    bufCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    bufCreateInfo.memoryHint = BufferMemoryHint::CpuToGpu;
-    bufCreateInfo.cpuAccess = CpuAccessPattern::SequentialWrite;
-    bufCreateInfo.persistentlyMapped = false;
-    bufCreateInfo.size = bufferSize;
-
-    BufferHandle stagingBuffer = context->createBuffer(bufCreateInfo, m_Vertices.data());
-
-    bufCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-    bufCreateInfo.cpuAccess = CpuAccessPattern::None;
-    bufCreateInfo.memoryHint = BufferMemoryHint::GpuOnly;
-    bufCreateInfo.persistentlyMapped = false;
-    bufCreateInfo.size = bufferSize;
-
-    m_VertexBuffer = context->createBuffer(bufCreateInfo);
-
-    context->copyBuffer(stagingBuffer, m_VertexBuffer, bufferSize);
-
-    bufferSize = sizeof(indices[0]) * indices.size();
-
-    bufCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    bufCreateInfo.memoryHint = BufferMemoryHint::CpuToGpu;
-    bufCreateInfo.cpuAccess = CpuAccessPattern::SequentialWrite;
-    bufCreateInfo.persistentlyMapped = false;
-    bufCreateInfo.size = bufferSize;
-
-    stagingBuffer = context->createBuffer(bufCreateInfo, indices.data());
-
-    bufCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-    bufCreateInfo.cpuAccess = CpuAccessPattern::None;
-    bufCreateInfo.memoryHint = BufferMemoryHint::GpuOnly;
-    bufCreateInfo.persistentlyMapped = false;
-    bufCreateInfo.size = bufferSize;
-
-    m_IndexBuffer = context->createBuffer(bufCreateInfo);
-
-    context->copyBuffer(stagingBuffer, m_IndexBuffer, bufferSize);
+    geometry =
+        context->getGeometryPool()->Allocate(vertices, indices.data(), static_cast<uint32_t>(indices.size()));
 }
 
 Mesh::Mesh(const DecodedMeshData& data)
 {
     positions = data.positions;
-    colors = data.colors;
-    normals = data.normals;
-    texCoords = data.texCoords;
-    tangents = data.tangents;
     indices = data.indices;
-    setupMesh();
+    setupMesh(PackVertexStreams(data.positions, data.normals, data.tangents, data.texCoords, data.colors,
+                                data.joints_0, data.joints_1, data.weights_0, data.weights_1));
+}
+
+Mesh::Mesh(const VertexStreams& vertices, std::vector<uint> meshIndices) : indices(std::move(meshIndices))
+{
+    positions = vertices.positions;
+    setupMesh(vertices);
+}
+
+void Mesh::ComputeBounds()
+{
+    bounds = AABB{};
+    for (const glm::vec3& position : positions)
+        bounds.Expand(position);
+
+    for (SubMesh& subMesh : subMeshes)
+    {
+        subMesh.bounds = AABB{};
+        const size_t end = std::min<size_t>(size_t(subMesh.indexOffset) + subMesh.indexCount, indices.size());
+        for (size_t i = subMesh.indexOffset; i < end; i++)
+        {
+            if (indices[i] < positions.size())
+                subMesh.bounds.Expand(positions[indices[i]]);
+        }
+    }
 }
 } // namespace REON
\ No newline at end of file
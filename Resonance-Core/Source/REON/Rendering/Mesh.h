@@ -1,5 +1,7 @@
 #pragma once
 
+#include "REON/Math/AABB.h"
+#include "REON/Rendering/GeometryPool.h"
 #include "REON/Rendering/Material.h"
 #include "REON/Rendering/Structs/LightData.h"
 #include "REON/Rendering/Structs/Vertex.h"
@@ -15,11 +17,39 @@
 namespace REON
 {
 
+struct SubMeshLod
+{
+    uint32_t indexCount;
+    uint32_t indexOffset;
+};
+
+// Cluster of a submesh's triangles, a contiguous index range with bounds in mesh space. Laid out like MeshletEntry,
+// which is std430 compatible, so the array can be uploaded for GPU culling as is.
+struct Meshlet
+{
+    glm::vec3 center;
+    float radius;
+    glm::vec3 coneApex;
+    float coneCutoff; // sine of the normal cone's half angle, 1 when it can not be culled
+    glm::vec3 coneAxis;
+    uint32_t indexOffset;
+    uint32_t triangleCount;
+    uint32_t vertexCount;
+    uint32_t subMesh;
+    uint32_t reserved;
+};
+
 struct SubMesh
 {
     int indexCount;
     int indexOffset;
     int materialIndex;
+    AABB bounds;
+    // Coarser index ranges over the same vertices, lods[i] is level i + 1
+    std::vector<SubMeshLod> lods;
+    // Range in Mesh::meshlets, which together cover the full detail index range
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
 };
 
 struct DecodedMeshData
@@ -30,8 +60,8 @@ struct DecodedMeshData
     std::vector<glm::vec2> texCoords;
     std::vector<glm::vec4> tangents;
     std::vector<uint> indices;
-    std::vector<glm::vec4> joints_0;
-    std::vector<glm::vec4> joints_1;
+    std::vector<glm::u16vec4> joints_0;
+    std::vector<glm::u16vec4> joints_1;
     std::vector<glm::vec4> weights_0;
     std::vector<glm::vec4> weights_1;
 };
@@ -41,39 +71,42 @@ class [[clang::annotate("serialize")]] Mesh : public ResourceBase
   public:
     static constexpr AssetTypeId kType = ASSET_MESH;
 
+    // Packs unpacked vertex data, for meshes cooked before the packed format.
     Mesh(const DecodedMeshData& data);
+    Mesh(const VertexStreams& vertices, std::vector<uint> meshIndices);
     ~Mesh();
 
+    // Rebuilds the mesh and submesh bounds from the vertex data, for meshes cooked without bounds.
+    void ComputeBounds();
+
+    // Kept on the CPU for bounds and picking, the other streams only live in the geometry pool
     std::vector<glm::vec3> positions;
-    std::vector<glm::vec4> colors;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> texCoords;
-    std::vector<glm::vec4> tangents;
     std::vector<uint> indices;
-    std::vector<glm::vec4> joints_0;
-    std::vector<glm::vec4> joints_1;
-    std::vector<glm::vec4> weights_0;
-    std::vector<glm::vec4> weights_1;
+    // VertexFormatFlags of the streams in the geometry pool
+    uint32_t vertexFormat = 0;
 
     std::vector<SubMesh> subMeshes;
+    AABB bounds;
+    // Simplification error of level i + 1 in mesh units, the RenderQueue picks levels by its size on screen
+    std::vector<float> lodErrors;
+    std::vector<Meshlet> meshlets;
 
-    BufferHandle m_VertexBuffer;
-    BufferHandle m_IndexBuffer;
+    // Vertices and indices in the shared geometry pool
+    GeometryAllocation geometry;
 
     uint32_t vertexCount = 0;
     uint32_t indexCount = 0;
 
   private:
     // initializes all the buffer objects/arrays
-    void setupMesh();
+    void setupMesh(const VertexStreams& vertices);
 
-    void setupBuffers();
+    void setupBuffers(const VertexStreams& vertices);
 
   private:
     //  render data
     unsigned int m_VBO, m_EBO;
     unsigned int m_DepthMap;
-    std::vector<Vertex> m_Vertices;
     // mesh data
     unsigned int m_VAO, m_SSBO;
 
@@ -0,0 +1,55 @@
+#include "reonpch.h"
+
+#include "MeshletCuller.h"
+
+namespace REON
+{
+
+uint32_t MeshletCuller::Cull(const Mesh& mesh, const SubMesh& subMesh, const glm::mat4& model,
+                             const MeshletCullView& view, bool backfaceCulling, std::vector<DrawRange>& ranges)
+{
+    const float scale = glm::max(glm::max(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1]))),
+                                 glm::length(glm::vec3(model[2])));
+
+    // Which side of a triangle's plane the eye is on survives any affine transform, so the cone is tested in mesh
+    // space. A mirroring transform flips the winding the rasterizer culls by, those keep all their meshlets.
+    const glm::vec3 eye = glm::vec3(glm::inverse(model) * glm::vec4(view.eye, 1.0f));
+    backfaceCulling = backfaceCulling && glm::determinant(glm::mat3(model)) > 0.0f;
+
+    uint32_t culled = 0;
+    const uint32_t end = glm::min<uint32_t>(subMesh.firstMeshlet + subMesh.meshletCount,
+                                            static_cast<uint32_t>(mesh.meshlets.size()));
+    for (uint32_t i = subMesh.firstMeshlet; i < end; i++)
+    {
+        const Meshlet& meshlet = mesh.meshlets[i];
+
+        const glm::vec3 center = glm::vec3(model * glm::vec4(meshlet.center, 1.0f));
+        const float radius = meshlet.radius * scale;
+        bool outside = false;
+        for (const glm::vec4& plane : view.frustum.planes)
+            outside |= glm::dot(glm::vec3(plane), center) + plane.w < -radius;
+
+        // Seen from inside the cone behind the apex every triangle faces away
+        if (!outside && backfaceCulling && meshlet.coneCutoff < 1.0f)
+        {
+            const glm::vec3 toApex = meshlet.coneApex - eye;
+            const float distance = glm::length(toApex);
+            outside = distance > 0.0f && glm::dot(toApex, meshlet.coneAxis) >= meshlet.coneCutoff * distance;
+        }
+
+        if (outside)
+        {
+            culled++;
+            continue;
+        }
+
+        const uint32_t indexCount = meshlet.triangleCount * 3;
+        if (!ranges.empty() && ranges.back().startIndex + ranges.back().indexCount == meshlet.indexOffset)
+            ranges.back().indexCount += indexCount;
+        else
+            ranges.push_back({meshlet.indexOffset, indexCount});
+    }
+    return culled;
+}
+
+} // namespace REON
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "FrustumCuller.h"
+#include "Mesh.h"
+#include "RenderQueue.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace REON
+{
+
+// What the meshlets of one view are tested against, in world space
+struct MeshletCullView
+{
+    Frustum frustum;
+    glm::vec3 eye{0.0f};
+};
+
+// CPU culling of the meshlets of a single drawn submesh. Works on the same Meshlet records the model file stores, a
+// compute path can run the identical sphere and cone tests on the GPU from an upload of Mesh::meshlets.
+class MeshletCuller
+{
+  public:
+    // Appends the index ranges of the submesh's meshlets that touch the frustum and, with backface culling, face the
+    // eye with at least one triangle. Survivors that follow each other in the index buffer merge into one range.
+    // Returns how many meshlets were rejected.
+    static uint32_t Cull(const Mesh& mesh, const SubMesh& subMesh, const glm::mat4& model, const MeshletCullView& view,
+                         bool backfaceCulling, std::vector<DrawRange>& ranges);
+};
+
+} // namespace REON
@@ -0,0 +1,171 @@
+#include "reonpch.h"
+
+#include "ParallelCommandRecorder.h"
+
+#include "REON/Jobs/JobSystem.h"
+#include "REON/Platform/Vulkan/VulkanContext.h"
+#include "REON/Rendering/Material.h"
+
+namespace REON
+{
+
+void ParallelCommandRecorder::Init(const VulkanContext* context, JobSystem* jobSystem)
+{
+    m_JobSystem = jobSystem;
+    m_SlotCount = jobSystem->GetWorkerCount() + 1;
+    m_Pools.resize(static_cast<size_t>(context->MAX_FRAMES_IN_FLIGHT) * m_SlotCount);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = context->findQueueFamilies(context->getPhysicalDevice()).graphicsFamily.value();
+
+    for (ThreadPool& pool : m_Pools)
+    {
+        VkResult res = vkCreateCommandPool(context->getDevice(), &poolInfo, nullptr, &pool.pool);
+        REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create recording command pool");
+    }
+}
+
+void ParallelCommandRecorder::Cleanup(const VulkanContext* context)
+{
+    for (ThreadPool& pool : m_Pools)
+    {
+        // Destroying the pool frees its buffers.
+        vkDestroyCommandPool(context->getDevice(), pool.pool, nullptr);
+    }
+    m_Pools.clear();
+}
+
+void ParallelCommandRecorder::BeginFrame(const VulkanContext* context)
+{
+    const size_t first = static_cast<size_t>(context->getCurrentFrame()) * m_SlotCount;
+    for (size_t i = first; i < first + m_SlotCount; i++)
+    {
+        if (m_Pools[i].used == 0)
+            continue;
+
+        vkResetCommandPool(context->getDevice(), m_Pools[i].pool, 0);
+        m_Pools[i].used = 0;
+    }
+    m_DrawCount.store(0, std::memory_order_relaxed);
+}
+
+void ParallelCommandRecorder::SetThreadCount(uint32_t threadCount)
+{
+    m_ThreadCount = std::max(threadCount, 1u);
+}
+
+void ParallelCommandRecorder::Record(const VulkanContext* context, VkCommandBuffer primary, VkRenderPass renderPass,
+                                     uint32_t subpass, VkFramebuffer framebuffer, uint32_t itemCount,
+                                     const RecordFunction& record)
+{
+    const uint32_t chunkCount = getChunkCount(itemCount);
+    if (chunkCount <= 1)
+    {
+        if (itemCount > 0)
+            record(primary, 0, itemCount);
+        return;
+    }
+
+    const int frame = context->getCurrentFrame();
+    const uint32_t chunkSize = (itemCount + chunkCount - 1) / chunkCount;
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = subpass;
+    inheritanceInfo.framebuffer = framebuffer;
+
+    std::vector<VkCommandBuffer> secondaries(chunkCount, VK_NULL_HANDLE);
+    m_JobSystem->ParallelFor(chunkCount, 1, [&](uint32_t firstChunk, uint32_t lastChunk) {
+        for (uint32_t chunk = firstChunk; chunk < lastChunk; chunk++)
+        {
+            VkCommandBuffer commandBuffer = acquireBuffer(context, frame);
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags =
+                VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+            VkResult res = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+            REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to begin recording secondary command buffer");
+
+            const uint32_t begin = chunk * chunkSize;
+            const uint32_t end = std::min(begin + chunkSize, itemCount);
+            record(commandBuffer, begin, end);
+
+            res = vkEndCommandBuffer(commandBuffer);
+            REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to record secondary command buffer");
+
+            secondaries[chunk] = commandBuffer;
+        }
+    });
+
+    vkCmdExecuteCommands(primary, chunkCount, secondaries.data());
+}
+
+void ParallelCommandRecorder::ResolveMaterialBindings(const RenderQueue& queue, std::span<const RenderQueueItem> items,
+                                                      const PipelineLookup& lookup,
+                                                      std::vector<MaterialBinding>& bindings)
+{
+    bindings.assign(queue.GetMaterials().size(), MaterialBinding{});
+
+    // Items are sorted by material, so every slot is one run.
+    uint32_t lastSlot = UINT32_MAX;
+    for (const RenderQueueItem& item : items)
+    {
+        const uint32_t materialSlot = DrawKey::GetMaterialSlot(item.key);
+        if (materialSlot == lastSlot)
+            continue;
+        lastSlot = materialSlot;
+
+        auto material = queue.GetCommand(item).material.Lock();
+        if (!material)
+            continue;
+
+        // May queue a permutation compile, which is why this cannot happen inside the recording jobs. The pipeline
+        // is then a fallback for this frame and gets resolved again next frame.
+        VkPipeline pipeline = lookup(material->materialFlags);
+        if (pipeline == VK_NULL_HANDLE)
+            continue;
+
+        MaterialBinding& binding = bindings[materialSlot];
+        binding.material = std::move(material);
+        binding.pipeline = pipeline;
+    }
+}
+
+uint32_t ParallelCommandRecorder::getChunkCount(uint32_t itemCount) const
+{
+    if (m_ThreadCount <= 1 || itemCount < 2 * MinItemsPerChunk)
+        return 1;
+
+    return std::min(m_ThreadCount, itemCount / MinItemsPerChunk);
+}
+
+VkCommandBuffer ParallelCommandRecorder::acquireBuffer(const VulkanContext* context, int frame)
+{
+    const uint32_t workerIndex = JobSystem::GetCurrentWorkerIndex();
+    const uint32_t slot = workerIndex == JobSystem::InvalidWorker ? m_SlotCount - 1 : workerIndex;
+    ThreadPool& pool = m_Pools[static_cast<size_t>(frame) * m_SlotCount + slot];
+
+    if (pool.used == pool.buffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = pool.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        VkResult res = vkAllocateCommandBuffers(context->getDevice(), &allocInfo, &commandBuffer);
+        REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to allocate secondary command buffer");
+        pool.buffers.push_back(commandBuffer);
+    }
+
+    return pool.buffers[pool.used++];
+}
+
+} // namespace REON
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "REON/Rendering/RenderQueue.h"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace REON
+{
+
+class JobSystem;
+class Material;
+class VulkanContext;
+
+// Material state resolved once per pass on the recording thread, indexed by DrawKey material slot. Recording jobs only
+// read this table, so they never lock resources or create pipelines.
+struct MaterialBinding
+{
+    std::shared_ptr<Material> material;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+};
+
+// Region of the frame's indirect buffer one view records its draws into. Like InstanceSlots every item owns the record
+// at its object index, a chunk starting at item begin writes its records from GetObjectIndex(items[begin]) on.
+struct IndirectCommands
+{
+    VkDrawIndexedIndirectCommand* data = nullptr;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0; // of the view's region in buffer
+};
+
+// Collects consecutive draws that share all bound state into one multi draw indirect. Flush before anything the draws
+// depend on is rebound.
+class IndirectDrawBatch
+{
+  public:
+    IndirectDrawBatch(const IndirectCommands& commands, uint32_t firstCommand, bool multiDraw)
+        : m_Commands(commands), m_First(firstCommand), m_Next(firstCommand), m_MultiDraw(multiDraw)
+    {
+    }
+
+    void Add(const VkDrawIndexedIndirectCommand& command)
+    {
+        m_Commands.data[m_Next++] = command;
+    }
+
+    // Records the pending draws and returns the number of draw calls that took.
+    uint32_t Flush(VkCommandBuffer commandBuffer)
+    {
+        const uint32_t count = m_Next - m_First;
+        if (count == 0)
+            return 0;
+
+        constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        const VkDeviceSize offset = m_Commands.offset + VkDeviceSize(m_First) * stride;
+        uint32_t drawCalls = 1;
+        if (m_MultiDraw)
+        {
+            vkCmdDrawIndexedIndirect(commandBuffer, m_Commands.buffer, offset, count, stride);
+        }
+        else
+        {
+            for (uint32_t i = 0; i < count; i++)
+                vkCmdDrawIndexedIndirect(commandBuffer, m_Commands.buffer, offset + VkDeviceSize(i) * stride, 1, stride);
+            drawCalls = count;
+        }
+        m_First = m_Next;
+        return drawCalls;
+    }
+
+  private:
+    IndirectCommands m_Commands;
+    uint32_t m_First;
+    uint32_t m_Next;
+    bool m_MultiDraw;
+};
+
+// Splits the draws of a render pass over the job system. Every job records a contiguous chunk of the sorted queue into
+// its own secondary command buffer, which the pass then executes in order from its primary buffer. Secondary buffers
+// come from one command pool per recording thread and frame in flight, so no pool is ever touched by two threads and a
+// whole frame's worth is released with a single pool reset.
+class ParallelCommandRecorder
+{
+  public:
+    // Records the queue items [begin, end) into commandBuffer. Runs on job system workers, so it may only read shared
+    // state and has to set every piece of state it relies on, nothing is inherited from the primary buffer.
+    using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end)>;
+    using PipelineLookup = std::function<VkPipeline(uint32_t materialFlags)>;
+
+    void Init(const VulkanContext* context, JobSystem* jobSystem);
+    void Cleanup(const VulkanContext* context);
+
+    // Releases every secondary buffer of the current frame in flight, once per frame after its fence was waited on.
+    void BeginFrame(const VulkanContext* context);
+
+    // 1 records inline into the primary buffer, which is the single threaded baseline.
+    void SetThreadCount(uint32_t threadCount);
+    uint32_t GetThreadCount() const
+    {
+        return m_ThreadCount;
+    }
+
+    // Contents to begin the subpass with, Record has to be called with the same item count afterwards.
+    VkSubpassContents GetSubpassContents(uint32_t itemCount) const
+    {
+        return getChunkCount(itemCount) > 1 ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+                                            : VK_SUBPASS_CONTENTS_INLINE;
+    }
+
+    // Records itemCount items inside the current subpass of primary, either inline or as secondary buffers executed
+    // in item order.
+    void Record(const VulkanContext* context, VkCommandBuffer primary, VkRenderPass renderPass, uint32_t subpass,
+                VkFramebuffer framebuffer, uint32_t itemCount, const RecordFunction& record);
+
+    // Record functions report the draw calls of their chunk, summed over every pass since BeginFrame.
+    void CountDraws(uint32_t drawCount)
+    {
+        m_DrawCount.fetch_add(drawCount, std::memory_order_relaxed);
+    }
+    uint32_t GetDrawCount() const
+    {
+        return m_DrawCount.load(std::memory_order_relaxed);
+    }
+
+    // Fills bindings for every material drawn from items. Their records were already uploaded by the material table.
+    static void ResolveMaterialBindings(const RenderQueue& queue, std::span<const RenderQueueItem> items,
+                                        const PipelineLookup& lookup, std::vector<MaterialBinding>& bindings);
+
+  private:
+    struct ThreadPool
+    {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;
+        uint32_t used = 0;
+    };
+
+    uint32_t getChunkCount(uint32_t itemCount) const;
+    VkCommandBuffer acquireBuffer(const VulkanContext* context, int frame);
+
+  private:
+    JobSystem* m_JobSystem = nullptr;
+
+    // MAX_FRAMES_IN_FLIGHT * m_SlotCount pools. A slot per worker plus one for the thread that called Record, which
+    // helps with the jobs while it waits.
+    std::vector<ThreadPool> m_Pools;
+    uint32_t m_SlotCount = 0;
+    uint32_t m_ThreadCount = 1;
+    std::atomic<uint32_t> m_DrawCount = 0;
+
+    // Fewer draws than this per chunk cost more in job and secondary buffer overhead than they save.
+    static constexpr uint32_t MinItemsPerChunk = 64;
+};
+
+} // namespace REON
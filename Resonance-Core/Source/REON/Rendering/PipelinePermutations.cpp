@@ -0,0 +1,179 @@
+#include "reonpch.h"
+
+#include "PipelinePermutations.h"
+
+#include "REON/Jobs/JobSystem.h"
+#include "REON/Rendering/Material.h"
+
+#include <bit>
+
+namespace REON
+{
+
+PipelinePermutations::~PipelinePermutations()
+{
+    // Only reached without Cleanup when the renderer never shut down properly, the pipelines leak with the device.
+    if (m_Thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Queued.clear();
+            m_ShuttingDown = true;
+        }
+        m_WakeCondition.notify_all();
+        m_Thread.join();
+    }
+}
+
+void PipelinePermutations::Init(CreateFunction create)
+{
+    REON_CORE_ASSERT(!m_Thread.joinable(), "Pipeline permutations initialised twice");
+    m_Create = std::move(create);
+    m_ShuttingDown = false;
+    m_Thread = std::thread([this]() { compileLoop(); });
+}
+
+void PipelinePermutations::Clear(VkDevice device)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Queued.clear();
+        m_IdleCondition.wait(lock, [this]() { return !m_Compiling; });
+
+        for (auto [flags, pipeline] : m_Finished)
+            vkDestroyPipeline(device, pipeline, nullptr);
+        m_Finished.clear();
+    }
+
+    for (auto [flags, pipeline] : m_Pipelines)
+        vkDestroyPipeline(device, pipeline, nullptr);
+    m_Pipelines.clear();
+}
+
+void PipelinePermutations::Cleanup(VkDevice device)
+{
+    Clear(device);
+
+    if (m_Thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_ShuttingDown = true;
+        }
+        m_WakeCondition.notify_all();
+        m_Thread.join();
+    }
+    m_Create = nullptr;
+}
+
+void PipelinePermutations::Add(uint32_t flags, VkPipeline pipeline)
+{
+    m_Pipelines.insert({flags, pipeline});
+}
+
+void PipelinePermutations::Prebake(std::span<const uint32_t> permutations, JobSystem& jobs)
+{
+    std::vector<uint32_t> missing;
+    for (uint32_t flags : permutations)
+    {
+        if (!m_Pipelines.contains(flags) && std::find(missing.begin(), missing.end(), flags) == missing.end())
+            missing.push_back(flags);
+    }
+
+    // Every permutation compiles its own shaders and creates its pipeline against the internally synchronized
+    // pipeline cache, nothing is shared between them
+    std::vector<VkPipeline> pipelines(missing.size(), VK_NULL_HANDLE);
+    jobs.ParallelFor(static_cast<uint32_t>(missing.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+            pipelines[i] = m_Create(missing[i]);
+    });
+
+    for (size_t i = 0; i < missing.size(); i++)
+        m_Pipelines.insert({missing[i], pipelines[i]});
+}
+
+VkPipeline PipelinePermutations::Get(uint32_t flags)
+{
+    adoptFinished();
+
+    auto it = m_Pipelines.find(flags);
+    if (it != m_Pipelines.end() && it->second != VK_NULL_HANDLE)
+        return it->second;
+
+    if (it == m_Pipelines.end())
+    {
+        m_Pipelines.insert({flags, VK_NULL_HANDLE});
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Queued.push_back(flags);
+        }
+        m_WakeCondition.notify_one();
+    }
+
+    return getFallback(flags);
+}
+
+void PipelinePermutations::compileLoop()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true)
+    {
+        m_WakeCondition.wait(lock, [this]() { return m_ShuttingDown || !m_Queued.empty(); });
+        if (m_ShuttingDown)
+            return;
+
+        const uint32_t flags = m_Queued.front();
+        m_Queued.pop_front();
+        m_Compiling = true;
+
+        lock.unlock();
+        const auto start = std::chrono::high_resolution_clock::now();
+        VkPipeline pipeline = m_Create(flags);
+        if (pipeline == VK_NULL_HANDLE)
+            REON_CORE_ERROR("Pipeline permutation {0} failed to compile, its materials keep using a fallback", flags);
+        else
+            REON_CORE_INFO("Pipeline permutation {0} compiled in the background in {1:.1f} ms", flags,
+                           std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start)
+                               .count());
+        lock.lock();
+
+        m_Finished.push_back({flags, pipeline});
+        m_Compiling = false;
+        m_IdleCondition.notify_all();
+    }
+}
+
+void PipelinePermutations::adoptFinished()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (auto [flags, pipeline] : m_Finished)
+    {
+        // Failed permutations stay VK_NULL_HANDLE, so they are not compiled again every frame
+        m_Pipelines[flags] = pipeline;
+    }
+    m_Finished.clear();
+}
+
+VkPipeline PipelinePermutations::getFallback(uint32_t flags) const
+{
+    // Any ready permutation whose flags are a subset of the requested ones uses the same layout and bindings and only
+    // ignores some of the material's textures. Keeping the alpha cutoff wins over everything else, dropping it changes
+    // the silhouette instead of just the shading.
+    VkPipeline fallback = VK_NULL_HANDLE;
+    int bestScore = -1;
+    for (const auto& [permutation, pipeline] : m_Pipelines)
+    {
+        if (pipeline == VK_NULL_HANDLE || (permutation & ~flags) != 0)
+            continue;
+
+        const int score = std::popcount(permutation) + ((permutation & AlphaCutoff) ? 32 : 0);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            fallback = pipeline;
+        }
+    }
+    return fallback;
+}
+
+} // namespace REON
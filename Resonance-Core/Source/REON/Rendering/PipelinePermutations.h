@@ -0,0 +1,77 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace REON
+{
+
+class JobSystem;
+
+// The material pipeline permutations of one pass, keyed by MaterialShaderFlags. Permutations that were not prebaked are
+// compiled on a background thread the first time a material asks for them. Until then the material draws with the
+// closest permutation that is ready, and switches over in the first frame after the compile finished.
+//
+// The compile thread is deliberately not a job system worker: JobSystem::Wait runs queued jobs on the waiting thread,
+// so a frame waiting on its recording jobs could pick up a compile and stall on it after all.
+class PipelinePermutations
+{
+  public:
+    // Creates the pipeline of a permutation, returns VK_NULL_HANDLE on failure. Called from the compile thread, so it
+    // may only touch state that stays alive and unchanged until Clear or Cleanup.
+    using CreateFunction = std::function<VkPipeline(uint32_t flags)>;
+
+    PipelinePermutations() = default;
+    ~PipelinePermutations();
+
+    PipelinePermutations(const PipelinePermutations&) = delete;
+    PipelinePermutations& operator=(const PipelinePermutations&) = delete;
+
+    void Init(CreateFunction create);
+    // Drops queued compiles, waits for the one in progress and destroys every permutation. The thread keeps running,
+    // permutations can be added again afterwards.
+    void Clear(VkDevice device);
+    // Clear and stop the compile thread.
+    void Cleanup(VkDevice device);
+
+    // Blocking, for the permutations prebaked at startup. Neither replaces a permutation that already exists.
+    void Add(uint32_t flags, VkPipeline pipeline);
+    // Compiles the permutations side by side on the job system and waits for all of them.
+    void Prebake(std::span<const uint32_t> permutations, JobSystem& jobs);
+
+    // Render thread only. Returns the permutation if it is ready, otherwise queues it and returns the fallback.
+    VkPipeline Get(uint32_t flags);
+
+  private:
+    void compileLoop();
+    void adoptFinished();
+    VkPipeline getFallback(uint32_t flags) const;
+
+  private:
+    CreateFunction m_Create;
+
+    // Owned by the render thread. Permutations that are compiling or failed to compile are VK_NULL_HANDLE, which keeps
+    // them from being queued again.
+    std::unordered_map<uint32_t, VkPipeline> m_Pipelines;
+
+    std::thread m_Thread;
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCondition;
+    std::condition_variable m_IdleCondition;
+    std::deque<uint32_t> m_Queued;
+    std::vector<std::pair<uint32_t, VkPipeline>> m_Finished;
+    bool m_Compiling = false;
+    bool m_ShuttingDown = false;
+};
+
+} // namespace REON
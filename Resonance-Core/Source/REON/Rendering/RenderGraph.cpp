@@ -0,0 +1,427 @@
+#include "reonpch.h"
+
+#include "RenderGraph.h"
+
+namespace REON
+{
+
+namespace
+{
+
+struct AccessInfo
+{
+    VkImageLayout layout;
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 readAccess;
+    VkAccessFlags2 writeAccess;
+};
+
+AccessInfo getAccessInfo(RenderGraphAccess access)
+{
+    switch (access)
+    {
+    case RenderGraphAccess::ColorAttachment:
+        return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT};
+    case RenderGraphAccess::DepthAttachment:
+        return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+    case RenderGraphAccess::TransferDestination:
+        return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_NONE,
+                VK_ACCESS_2_TRANSFER_WRITE_BIT};
+    case RenderGraphAccess::Sampled:
+    default:
+        return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_ACCESS_2_NONE};
+    }
+}
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+void RenderGraph::Reset()
+{
+    m_Passes.clear();
+    m_Resources.clear();
+    m_Order.clear();
+    m_Heaps.clear();
+    m_UnaliasedSize = 0;
+    m_CulledPassCount = 0;
+}
+
+RenderGraph::Resource RenderGraph::ImportImage(const char* name, VkImage image, VkImageAspectFlags aspect,
+                                               VkImageLayout initialLayout, VkImageLayout finalLayout)
+{
+    ResourceNode& node = m_Resources.emplace_back();
+    node.name = name;
+    node.image = image;
+    node.aspect = aspect;
+    node.imported = true;
+    node.initialLayout = initialLayout;
+    node.finalLayout = finalLayout;
+    return static_cast<Resource>(m_Resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::CreateImage(const char* name, VkImageAspectFlags aspect,
+                                               const RenderGraphImageDesc& desc)
+{
+    REON_CORE_ASSERT(desc.alignment > 0, "Transient image alignment has to be non-zero");
+    ResourceNode& node = m_Resources.emplace_back();
+    node.name = name;
+    node.aspect = aspect;
+    node.desc = desc;
+    return static_cast<Resource>(m_Resources.size() - 1);
+}
+
+void RenderGraph::BindImage(Resource resource, VkImage image)
+{
+    m_Resources[resource].image = image;
+}
+
+void RenderGraph::MarkOutput(Resource resource)
+{
+    m_Resources[resource].output = true;
+}
+
+RenderGraph::Pass RenderGraph::AddPass(const char* name)
+{
+    PassNode& node = m_Passes.emplace_back();
+    node.name = name;
+    return static_cast<Pass>(m_Passes.size() - 1);
+}
+
+void RenderGraph::Read(Pass pass, Resource resource, RenderGraphAccess access)
+{
+    VkImageLayout layout = getAccessInfo(access).layout;
+    addUse(pass, {resource, access, true, false, layout, layout});
+}
+
+void RenderGraph::Write(Pass pass, Resource resource, RenderGraphAccess access)
+{
+    VkImageLayout layout = getAccessInfo(access).layout;
+    addUse(pass, {resource, access, false, true, layout, layout});
+}
+
+void RenderGraph::Attachment(Pass pass, Resource resource, RenderGraphAccess access, VkImageLayout initialLayout,
+                             VkImageLayout finalLayout)
+{
+    addUse(pass, {resource, access, initialLayout != VK_IMAGE_LAYOUT_UNDEFINED, true, initialLayout, finalLayout});
+}
+
+void RenderGraph::addUse(Pass pass, const ImageUse& use)
+{
+    REON_CORE_ASSERT(pass < m_Passes.size() && use.resource < m_Resources.size(), "Unknown render graph handle");
+    m_Passes[pass].uses.push_back(use);
+}
+
+void RenderGraph::Compile()
+{
+    cullPasses();
+    assignHeaps();
+    buildBarriers();
+}
+
+void RenderGraph::cullPasses()
+{
+    // Walk backwards tracking which images still have a reader waiting for their contents. A pass only survives when
+    // it writes one of those, everything it reads then becomes wanted in turn.
+    std::vector<bool> wanted(m_Resources.size());
+    for (size_t i = 0; i < m_Resources.size(); i++)
+        wanted[i] = m_Resources[i].output;
+
+    m_CulledPassCount = 0;
+    for (size_t p = m_Passes.size(); p-- > 0;)
+    {
+        PassNode& pass = m_Passes[p];
+
+        pass.culled = true;
+        for (const ImageUse& use : pass.uses)
+        {
+            if (use.write && wanted[use.resource])
+                pass.culled = false;
+        }
+        if (pass.culled)
+        {
+            m_CulledPassCount++;
+            continue;
+        }
+
+        for (const ImageUse& use : pass.uses)
+        {
+            if (use.write && !use.read)
+                wanted[use.resource] = false;
+        }
+        for (const ImageUse& use : pass.uses)
+        {
+            if (use.read)
+                wanted[use.resource] = true;
+        }
+    }
+
+    m_Order.clear();
+    for (Pass p = 0; p < m_Passes.size(); p++)
+    {
+        if (!m_Passes[p].culled)
+            m_Order.push_back(p);
+    }
+
+    for (uint32_t i = 0; i < m_Order.size(); i++)
+    {
+        for (const ImageUse& use : m_Passes[m_Order[i]].uses)
+        {
+            ResourceNode& resource = m_Resources[use.resource];
+            if (resource.firstUse == Invalid)
+                resource.firstUse = i;
+            resource.lastUse = i;
+        }
+    }
+}
+
+void RenderGraph::assignHeaps()
+{
+    std::vector<Resource> transients;
+    for (Resource r = 0; r < m_Resources.size(); r++)
+    {
+        const ResourceNode& resource = m_Resources[r];
+        if (!resource.imported && resource.firstUse != Invalid)
+            transients.push_back(r);
+    }
+
+    // Largest first keeps the packing tight, ties broken by declaration order so identical graphs place identically
+    std::stable_sort(transients.begin(), transients.end(), [&](Resource a, Resource b) {
+        return m_Resources[a].desc.size > m_Resources[b].desc.size;
+    });
+
+    auto livesOverlap = [](const ResourceNode& a, const ResourceNode& b) {
+        return a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+    };
+    auto memoryOverlaps = [](const ResourceNode& a, const ResourceNode& b) {
+        return a.offset < b.offset + b.desc.size && b.offset < a.offset + a.desc.size;
+    };
+
+    std::vector<Resource> placed;
+    std::vector<uint64_t> candidates;
+    for (Resource r : transients)
+    {
+        ResourceNode& resource = m_Resources[r];
+        m_UnaliasedSize += resource.desc.size;
+
+        uint32_t heapIndex = Invalid;
+        for (uint32_t h = 0; h < m_Heaps.size(); h++)
+        {
+            if (m_Heaps[h].memoryTypeBits == resource.desc.memoryTypeBits)
+                heapIndex = h;
+        }
+        if (heapIndex == Invalid)
+        {
+            heapIndex = static_cast<uint32_t>(m_Heaps.size());
+            m_Heaps.push_back({0, 1, resource.desc.memoryTypeBits});
+        }
+        resource.heap = heapIndex;
+
+        // The lowest offset that does not collide with anything alive at the same time lies either at the start of
+        // the heap or right behind one of those images.
+        candidates.clear();
+        candidates.push_back(0);
+        for (Resource other : placed)
+        {
+            const ResourceNode& node = m_Resources[other];
+            if (node.heap == heapIndex && livesOverlap(node, resource))
+                candidates.push_back(alignUp(node.offset + node.desc.size, resource.desc.alignment));
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        for (uint64_t offset : candidates)
+        {
+            resource.offset = offset;
+            bool fits = true;
+            for (Resource other : placed)
+            {
+                const ResourceNode& node = m_Resources[other];
+                if (node.heap == heapIndex && livesOverlap(node, resource) && memoryOverlaps(node, resource))
+                {
+                    fits = false;
+                    break;
+                }
+            }
+            if (fits)
+                break;
+        }
+
+        RenderGraphHeap& heap = m_Heaps[heapIndex];
+        heap.size = std::max(heap.size, resource.offset + resource.desc.size);
+        heap.alignment = std::max(heap.alignment, resource.desc.alignment);
+        placed.push_back(r);
+    }
+
+    for (Resource r : placed)
+    {
+        ResourceNode& resource = m_Resources[r];
+        resource.aliasedBefore.clear();
+        for (Resource other : placed)
+        {
+            const ResourceNode& node = m_Resources[other];
+            if (other != r && node.heap == resource.heap && node.lastUse < resource.firstUse &&
+                memoryOverlaps(node, resource))
+                resource.aliasedBefore.push_back(other);
+        }
+    }
+}
+
+void RenderGraph::buildBarriers()
+{
+    std::vector<ImageState> states(m_Resources.size());
+    for (size_t i = 0; i < m_Resources.size(); i++)
+        states[i].layout = m_Resources[i].initialLayout;
+
+    for (uint32_t i = 0; i < m_Order.size(); i++)
+    {
+        PassNode& pass = m_Passes[m_Order[i]];
+        pass.barriersBefore.clear();
+        pass.barriersAfter.clear();
+
+        for (const ImageUse& use : pass.uses)
+        {
+            const AccessInfo info = getAccessInfo(use.access);
+            const ResourceNode& resource = m_Resources[use.resource];
+            ImageState& state = states[use.resource];
+
+            const bool attachment =
+                use.access == RenderGraphAccess::ColorAttachment || use.access == RenderGraphAccess::DepthAttachment;
+            const bool discard = !use.read;
+            // Render passes transition the attachments they discard themselves, anything else is transitioned here
+            const bool transition =
+                discard ? !attachment && state.layout != info.layout : state.layout != use.initialLayout;
+            const bool writes = use.write || transition;
+
+            RenderGraphBarrier barrier{};
+            barrier.resource = use.resource;
+            barrier.oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+            barrier.newLayout = discard ? info.layout : use.initialLayout;
+            barrier.dstStages = info.stages;
+            barrier.dstAccess = attachment  ? info.readAccess | info.writeAccess
+                                : use.write ? info.writeAccess
+                                            : info.readAccess;
+
+            bool needed = transition;
+            if (writes && (state.writeStages | state.readStages) != VK_PIPELINE_STAGE_2_NONE)
+            {
+                // Write after write needs the earlier write made available, write after read only has to wait
+                barrier.srcStages |= state.writeStages | state.readStages;
+                barrier.srcAccess |= state.writeAccess;
+                needed = true;
+            }
+            else if (!writes && state.writeStages != VK_PIPELINE_STAGE_2_NONE && (info.stages & ~state.readStages) != 0)
+            {
+                barrier.srcStages |= state.writeStages;
+                barrier.srcAccess |= state.writeAccess;
+                needed = true;
+            }
+
+            // The first use of an aliased image has to wait for whatever used the same memory before it
+            if (!resource.imported && resource.firstUse == i)
+            {
+                for (Resource previous : resource.aliasedBefore)
+                {
+                    const ImageState& previousState = states[previous];
+                    barrier.srcStages |= previousState.writeStages | previousState.readStages;
+                    barrier.srcAccess |= previousState.writeAccess;
+                    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                    if (barrier.newLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+                        barrier.newLayout = info.layout;
+                    needed = true;
+                }
+            }
+
+            if (needed)
+                pass.barriersBefore.push_back(barrier);
+
+            if (use.write)
+            {
+                state.writeStages = info.stages;
+                state.writeAccess = info.writeAccess;
+                state.readStages = VK_PIPELINE_STAGE_2_NONE;
+            }
+            else
+            {
+                state.readStages |= needed ? barrier.dstStages : info.stages;
+            }
+            state.layout = use.finalLayout;
+        }
+
+        // Imported images leave the frame in the layout their owner expects
+        for (const ImageUse& use : pass.uses)
+        {
+            const ResourceNode& resource = m_Resources[use.resource];
+            ImageState& state = states[use.resource];
+            if (!resource.imported || resource.lastUse != i || resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED ||
+                state.layout == resource.finalLayout)
+                continue;
+
+            RenderGraphBarrier barrier{};
+            barrier.resource = use.resource;
+            barrier.oldLayout = state.layout;
+            barrier.newLayout = resource.finalLayout;
+            barrier.srcStages = state.writeStages | state.readStages;
+            barrier.srcAccess = state.writeAccess;
+            barrier.dstStages = VK_PIPELINE_STAGE_2_NONE;
+            barrier.dstAccess = VK_ACCESS_2_NONE;
+            pass.barriersAfter.push_back(barrier);
+            state.layout = resource.finalLayout;
+        }
+    }
+}
+
+void RenderGraph::RecordBarriersBefore(VkCommandBuffer commandBuffer, Pass pass) const
+{
+    recordBarriers(commandBuffer, m_Passes[pass].barriersBefore);
+}
+
+void RenderGraph::RecordBarriersAfter(VkCommandBuffer commandBuffer, Pass pass) const
+{
+    recordBarriers(commandBuffer, m_Passes[pass].barriersAfter);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<RenderGraphBarrier>& barriers) const
+{
+    if (barriers.empty())
+        return;
+
+    std::vector<VkImageMemoryBarrier2> imageBarriers(barriers.size());
+    for (size_t i = 0; i < barriers.size(); i++)
+    {
+        const RenderGraphBarrier& barrier = barriers[i];
+        const ResourceNode& resource = m_Resources[barrier.resource];
+        REON_CORE_ASSERT(resource.image != VK_NULL_HANDLE, "Render graph image {} was never bound", resource.name);
+
+        VkImageMemoryBarrier2& imageBarrier = imageBarriers[i];
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        imageBarrier.srcStageMask = barrier.srcStages;
+        imageBarrier.srcAccessMask = barrier.srcAccess;
+        imageBarrier.dstStageMask = barrier.dstStages;
+        imageBarrier.dstAccessMask = barrier.dstAccess;
+        imageBarrier.oldLayout = barrier.oldLayout;
+        imageBarrier.newLayout = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = resource.image;
+        imageBarrier.subresourceRange.aspectMask = resource.aspect;
+        imageBarrier.subresourceRange.baseMipLevel = 0;
+        imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        imageBarrier.subresourceRange.baseArrayLayer = 0;
+        imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+    }
+
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+    dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+} // namespace REON
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace REON
+{
+
+// How a pass touches an image, decides the natural layout, the stages and the accesses to synchronize.
+enum class RenderGraphAccess : uint8_t
+{
+    ColorAttachment,
+    DepthAttachment,
+    Sampled,             // fragment shader reads
+    TransferDestination, // copy target
+};
+
+// Memory requirements of a transient image. They come from the device when the graph is built, so compiling itself
+// never needs one.
+struct RenderGraphImageDesc
+{
+    uint64_t size = 0;
+    uint64_t alignment = 1;
+    uint32_t memoryTypeBits = ~0u;
+};
+
+struct RenderGraphBarrier
+{
+    uint32_t resource;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+    VkPipelineStageFlags2 srcStages;
+    VkAccessFlags2 srcAccess;
+    VkPipelineStageFlags2 dstStages;
+    VkAccessFlags2 dstAccess;
+};
+
+// One block of memory the transient images of a compiled graph are placed in. Images whose lifetimes do not overlap
+// share the same range.
+struct RenderGraphHeap
+{
+    uint64_t size = 0;
+    uint64_t alignment = 1;
+    uint32_t memoryTypeBits = ~0u;
+};
+
+// Frame graph of passes and the images they read and write. Passes are declared in execution order. Compile culls the
+// passes nothing depends on, derives the barriers each remaining pass needs from the tracked image states and packs
+// transient images into heaps by lifetime. Compiling only looks at the declarations, the Vulkan handles are carried
+// along for recording and never dereferenced.
+class RenderGraph
+{
+  public:
+    using Resource = uint32_t;
+    using Pass = uint32_t;
+    static constexpr uint32_t Invalid = UINT32_MAX;
+
+    // Drops every declaration but keeps the allocations, graphs are rebuilt every frame.
+    void Reset();
+
+    // Images that live outside the graph. initialLayout is their layout when the frame starts, finalLayout the one they
+    // are transitioned to after their last use, VK_IMAGE_LAYOUT_UNDEFINED leaves them in whatever the last use needed.
+    Resource ImportImage(const char* name, VkImage image, VkImageAspectFlags aspect,
+                         VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                         VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+    // Images only used within the frame. Their memory is assigned by Compile and the image bound afterwards.
+    Resource CreateImage(const char* name, VkImageAspectFlags aspect, const RenderGraphImageDesc& desc);
+    void BindImage(Resource resource, VkImage image);
+
+    // Passes writing an output are never culled, everything they depend on is kept alive through them.
+    void MarkOutput(Resource resource);
+
+    Pass AddPass(const char* name);
+    void Read(Pass pass, Resource resource, RenderGraphAccess access);
+    void Write(Pass pass, Resource resource, RenderGraphAccess access);
+    // Render pass attachment, mirroring its VkAttachmentDescription. An initialLayout of VK_IMAGE_LAYOUT_UNDEFINED
+    // discards the contents, the render pass then does the transition itself and only hazards need a barrier.
+    void Attachment(Pass pass, Resource resource, RenderGraphAccess access, VkImageLayout initialLayout,
+                    VkImageLayout finalLayout);
+
+    void Compile();
+
+    bool IsCulled(Pass pass) const
+    {
+        return m_Passes[pass].culled;
+    }
+    const std::vector<RenderGraphBarrier>& GetBarriersBefore(Pass pass) const
+    {
+        return m_Passes[pass].barriersBefore;
+    }
+    const std::vector<RenderGraphBarrier>& GetBarriersAfter(Pass pass) const
+    {
+        return m_Passes[pass].barriersAfter;
+    }
+
+    const std::vector<RenderGraphHeap>& GetHeaps() const
+    {
+        return m_Heaps;
+    }
+    // Heap and byte offset of a transient image, Invalid heap when no live pass uses it.
+    uint32_t GetHeapIndex(Resource resource) const
+    {
+        return m_Resources[resource].heap;
+    }
+    uint64_t GetHeapOffset(Resource resource) const
+    {
+        return m_Resources[resource].offset;
+    }
+    // Memory the transient images would take without aliasing, to compare against the heaps.
+    uint64_t GetUnaliasedSize() const
+    {
+        return m_UnaliasedSize;
+    }
+    uint32_t GetCulledPassCount() const
+    {
+        return m_CulledPassCount;
+    }
+
+    void RecordBarriersBefore(VkCommandBuffer commandBuffer, Pass pass) const;
+    void RecordBarriersAfter(VkCommandBuffer commandBuffer, Pass pass) const;
+
+  private:
+    struct ImageUse
+    {
+        Resource resource;
+        RenderGraphAccess access;
+        bool read; // depends on the previous contents
+        bool write;
+        VkImageLayout initialLayout;
+        VkImageLayout finalLayout;
+    };
+
+    struct PassNode
+    {
+        const char* name;
+        std::vector<ImageUse> uses;
+        std::vector<RenderGraphBarrier> barriersBefore;
+        std::vector<RenderGraphBarrier> barriersAfter;
+        bool culled = false;
+    };
+
+    struct ResourceNode
+    {
+        const char* name;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageAspectFlags aspect = 0;
+        bool imported = false;
+        bool output = false;
+        VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        RenderGraphImageDesc desc;
+
+        // Filled by Compile
+        uint32_t firstUse = Invalid; // index into m_Order
+        uint32_t lastUse = Invalid;
+        uint32_t heap = Invalid;
+        uint64_t offset = 0;
+        std::vector<Resource> aliasedBefore; // earlier occupants of overlapping memory
+    };
+
+    // Synchronization state of one image while walking the passes
+    struct ImageState
+    {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+        // Stages that read since the last write, and so already see it
+        VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;
+    };
+
+    void addUse(Pass pass, const ImageUse& use);
+    void cullPasses();
+    void assignHeaps();
+    void buildBarriers();
+    void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<RenderGraphBarrier>& barriers) const;
+
+  private:
+    std::vector<PassNode> m_Passes;
+    std::vector<ResourceNode> m_Resources;
+    std::vector<Pass> m_Order; // live passes in execution order
+    std::vector<RenderGraphHeap> m_Heaps;
+    uint64_t m_UnaliasedSize = 0;
+    uint32_t m_CulledPassCount = 0;
+};
+
+} // namespace REON
@@ -16,13 +16,28 @@ namespace REON {
 	void RenderLayer::OnUpdate()
 	{
 		if (auto scene = SceneManager::Get()->GetCurrentScene()) {
+			if (!Application::Get().IsFramePipelining())
+				scene->renderManager->CaptureSnapshot();
+
 			scene->renderManager->preRender();
-			scene->renderManager->Render(scene->GetEditorCamera());
-			if (scene->cameras.size() > 1) {
-				scene->renderManager->Render(scene->cameras[1]);
+			for (const RenderView& view : scene->renderManager->GetSnapshot().views) {
+				scene->renderManager->Render(view.camera);
 			}
+			scene->renderManager->SubmitFrame();
 		}
 	}
+
+	void RenderLayer::CaptureSnapshot()
+	{
+		if (auto scene = SceneManager::Get()->GetCurrentScene())
+			scene->renderManager->CaptureSnapshot();
+	}
+
+	bool RenderLayer::HasSnapshot() const
+	{
+		auto scene = SceneManager::Get()->GetCurrentScene();
+		return !scene || scene->renderManager->HasSnapshot();
+	}
 	void RenderLayer::OnCleanup()
 	{
 		if (auto scene = SceneManager::Get()->GetCurrentScene())
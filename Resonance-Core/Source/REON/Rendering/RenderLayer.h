@@ -21,6 +21,11 @@ namespace REON {
 		//void OnEvent(Event& event) override;
 		void OnCleanup() override;
 
+		// Copies the current scene state for the next OnUpdate. Called from OnUpdate itself unless frames are
+		// pipelined, then the application calls it once the simulation step is done.
+		void CaptureSnapshot();
+		bool HasSnapshot() const;
+
 	private:
 	};
 
@@ -5,7 +5,11 @@
 #include "REON/Application.h"
 #include "REON/EditorCamera.h"
 #include "REON/GameHierarchy/Components/Transform.h"
+#include "REON/AssetManagement/ShaderPackFormat.h"
 #include "REON/GameHierarchy/GameObject.h"
+#include "REON/Rendering/MeshletCuller.h"
+#include "REON/Rendering/ShaderPack.h"
+#include "REON/Rendering/ShaderPrograms.h"
 #include "stb_image_wrapper.h"
 
 #include <REON/GameHierarchy/SceneManager.h>
@@ -17,71 +21,204 @@ uint RenderManager::QuadVAO;
 
 void RenderManager::Render(std::shared_ptr<Camera> camera)
 {
-    if (m_SwapChainResourcesByCamera[camera].empty())
-    {
-        createCameraResources(camera);
-    }
+    const RenderView* view = m_Snapshot.FindView(camera);
+    REON_CORE_ASSERT(view, "Camera was not part of the captured snapshot");
 
     resized = false;
-    prepareDrawCommands(m_Context->getCurrentFrame());
-    if (m_DrawCommandsByShaderMaterial.empty())
-    {
-        VkSemaphore signalSemaphores[] = {m_Context->getCurrentRenderFinishedSemaphore()};
-        VkSemaphore waitSemaphores[] = {m_Context->getCurrentImageAvailableSemaphore(),
-                                        m_DirectionalShadowsGenerated[m_Context->getCurrentFrame()]};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                                             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.waitSemaphoreCount = 2;
-        submitInfo.pSignalSemaphores = signalSemaphores;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
-
-        vkQueueSubmit(m_Context->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
+    if (m_RenderQueue.Empty())
         return;
-    }
-    setGlobalData(camera);
+    setGlobalData(camera, *view);
+
+    // Every camera overwrites the camera bit right before its own passes are recorded.
+    const uint32_t culled = m_RenderQueue.Cull(Frustum::FromMatrix(view->projection * view->view), CULL_VIEW_CAMERA);
+    if (camera == m_Camera)
+        m_CullStats.cameraCulled = culled;
 
     if (renderMode != LIT)
     {
-        // m_UnlitPass.render(m_Context, m_DrawCommandsByShaderMaterial,
+        // m_UnlitPass.render(m_Context, m_RenderQueue,
         // m_FrameData[m_Context->getCurrentFrame()].cameraData[camera].globalDescriptorSet,
+        // m_MaterialTable.GetDescriptorSet(m_Context->getCurrentFrame()),
+        // m_FrameData[m_Context->getCurrentFrame()].objectDescriptorSet,
+        // getInstanceSlots(getViewInstanceRegion(camera)),
         // m_Context->getCurrentRenderFinishedSemaphore(), renderMode);
         return;
     }
-    RenderOpaques(camera);
-    RenderTransparents(camera);
+    const auto recordStart = std::chrono::high_resolution_clock::now();
+    RenderOpaques(*view);
+    RenderTransparents(*view);
+    m_RecordStats.recordMs +=
+        std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
+}
+
+void RenderManager::CaptureSnapshot()
+{
+    applyPendingChanges();
+    prepareDrawCommands();
+
+    // Bounds and matrices come from this frame's Renderer::update.
+    m_RenderQueue.Capture();
+
+    m_Snapshot.frameNumber = Application::Get().GetFrameNumber();
+    m_Snapshot.views.clear();
+    captureView(m_Camera);
+    const auto& scene = SceneManager::Get()->GetCurrentScene();
+    if (scene && scene->cameras.size() > 1)
+        captureView(scene->cameras[1]);
+
+    updateShadowCascades();
+    captureLights();
+    m_HasSnapshot = true;
+}
+
+void RenderManager::captureView(const std::shared_ptr<Camera>& camera)
+{
+    RenderView& view = m_Snapshot.views.emplace_back();
+    view.camera = camera;
+    view.view = camera->GetViewMatrix();
+    view.projection = camera->GetProjectionMatrix();
+    view.nearPlane = camera->nearPlane;
+    view.farPlane = camera->farPlane;
+    view.viewportSize = camera->viewportSize;
+}
+
+void RenderManager::applyPendingChanges()
+{
+    std::vector<PendingRendererChange> changes;
+    {
+        std::lock_guard<std::mutex> lock(m_PendingMutex);
+        changes.swap(m_PendingRenderers);
+    }
+
+    for (auto& change : changes)
+    {
+        if (change.add)
+        {
+            m_Renderers.push_back(std::move(change.renderer));
+            continue;
+        }
+
+        m_Renderers.erase(std::remove(m_Renderers.begin(), m_Renderers.end(), change.renderer), m_Renderers.end());
+        m_RenderQueue.RemoveRenderer(change.renderer.get());
+    }
 }
 
 void RenderManager::preRender()
 {
+    REON_CORE_ASSERT(m_HasSnapshot, "Rendering without a captured snapshot");
+
+    // Everything below reads the snapshot only. The shadow cascades are culled once here, cameras in Render. Against
+    // their cache regions, which contain them, so a redrawn cache holds every static caster the cascade can move over.
+    m_CullStats.shadowCulled = 0;
+    for (uint32_t cascade = 0; cascade < m_Snapshot.shadowCascadeCount; cascade++)
+    {
+        m_CullStats.shadowCulled += m_RenderQueue.Cull(
+            Frustum::FromMatrix(m_DirectionalShadowPass.getCacheRegion(cascade)), GetShadowCascadeView(cascade));
+    }
+
+    m_RenderQueue.Sort(*m_Snapshot.FindView(m_Camera));
+    m_CullStats.drawCount = static_cast<uint32_t>(m_RenderQueue.GetItems().size());
+
+    // Before anything is recorded, new textures are written into this frame's descriptor set
+    m_MaterialTable.Update(m_RenderQueue.GetMaterials(), m_Context->getCurrentFrame());
+    writeObjectData();
+    writeLightData();
+
+    for (const RenderView& view : m_Snapshot.views)
+    {
+        if (m_SwapChainResourcesByCamera[view.camera].empty())
+            createCameraResources(view.camera);
+    }
+    buildFrameGraph();
+
+    // The fence of this frame in flight was waited on in startFrame, its secondary buffers are free again.
+    m_CommandRecorder.BeginFrame(m_Context);
+    m_RecordStats.threadCount = m_CommandRecorder.GetThreadCount();
+    m_RecordStats.shadowCacheHitRate = m_DirectionalShadowPass.getCacheHitRate();
+
+    const auto recordStart = std::chrono::high_resolution_clock::now();
     GenerateShadows();
+    m_RecordStats.recordMs =
+        std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
+}
+
+void RenderManager::SubmitFrame()
+{
+    m_RecordStats.drawCalls = m_CommandRecorder.GetDrawCount();
+    m_FrameSubmitter.Submit(m_Context, m_Context->getCurrentImageAvailableSemaphore(),
+                            m_Context->getCurrentRenderFinishedSemaphore());
+
+    if (IsRecordBenchmarkRunning())
+        stepRecordBenchmark();
+}
+
+void RenderManager::StartRecordBenchmark(uint32_t framesPerStep)
+{
+    if (IsRecordBenchmarkRunning())
+        return;
+
+    m_RecordBenchmark.restoreThreadCount = m_CommandRecorder.GetThreadCount();
+    m_RecordBenchmark.framesPerStep = std::max(framesPerStep, 1u);
+    m_RecordBenchmark.step = 0;
+    m_RecordBenchmark.frame = 0;
+    m_RecordBenchmark.totalMs = 0.0;
+    m_CommandRecorder.SetThreadCount(RecordBenchmark::ThreadCounts[0]);
+    REON_CORE_INFO("Record benchmark started: {} draw calls, {} frames per thread count", m_RecordStats.drawCalls,
+                   m_RecordBenchmark.framesPerStep);
+}
+
+// Called once per frame after submission, m_RecordStats then holds the full record time of the frame
+void RenderManager::stepRecordBenchmark()
+{
+    RecordBenchmark& benchmark = m_RecordBenchmark;
+    if (benchmark.frame++ >= RecordBenchmark::WarmupFrames)
+        benchmark.totalMs += m_RecordStats.recordMs;
+    if (benchmark.frame < RecordBenchmark::WarmupFrames + benchmark.framesPerStep)
+        return;
+
+    const float averageMs = static_cast<float>(benchmark.totalMs / benchmark.framesPerStep);
+    benchmark.averageMs[benchmark.step] = averageMs;
+    REON_CORE_INFO("Record benchmark: {} threads {:.3f} ms, {:.2f}x of 1 thread",
+                   RecordBenchmark::ThreadCounts[benchmark.step], averageMs,
+                   averageMs > 0.0f ? benchmark.averageMs[0] / averageMs : 0.0f);
+
+    benchmark.frame = 0;
+    benchmark.totalMs = 0.0;
+    if (++benchmark.step < RecordBenchmark::ThreadCounts.size())
+    {
+        m_CommandRecorder.SetThreadCount(RecordBenchmark::ThreadCounts[benchmark.step]);
+        return;
+    }
+
+    m_CommandRecorder.SetThreadCount(benchmark.restoreThreadCount);
+    REON_CORE_INFO("Record benchmark finished, 1/2/4/8 threads: {:.3f} / {:.3f} / {:.3f} / {:.3f} ms",
+                   benchmark.averageMs[0], benchmark.averageMs[1], benchmark.averageMs[2], benchmark.averageMs[3]);
 }
 
 void RenderManager::AddRenderer(const std::shared_ptr<Renderer>& renderer)
 {
-    m_Renderers.push_back(renderer);
-    createOpaqueObjectDescriptorSets(renderer);
+    std::lock_guard<std::mutex> lock(m_PendingMutex);
+    m_PendingRenderers.push_back({renderer, true});
 }
 
 void RenderManager::RemoveRenderer(std::shared_ptr<Renderer> renderer)
 {
     REON_CORE_WARN("Removing renderer from object: {0}", renderer->get_owner()->GetName());
     REON_CORE_WARN("Renderer use count: {0}", renderer.use_count());
-    REON_CORE_WARN("Renderers size: {0}", m_Renderers.size());
-    m_Renderers.erase(std::remove(m_Renderers.begin(), m_Renderers.end(), renderer), m_Renderers.end());
-    REON_CORE_INFO("Succesfully Removed renderer from object: {0}", renderer->get_owner()->GetName());
+    // The queued reference keeps the renderer alive until its draws left the queue at the next capture.
+    std::lock_guard<std::mutex> lock(m_PendingMutex);
+    m_PendingRenderers.push_back({std::move(renderer), false});
 }
 
 void RenderManager::AddAnimator(const std::shared_ptr<Animator>& animator) 
 {
+    std::lock_guard<std::mutex> lock(m_PendingMutex);
     m_Animators.push_back(animator);
 }
 
 void RenderManager::RemoveAnimator(std::shared_ptr<Animator> animator) 
 {
+    std::lock_guard<std::mutex> lock(m_PendingMutex);
     m_Animators.erase(std::remove(m_Animators.begin(), m_Animators.end(), animator), m_Animators.end());
 }
 
@@ -93,206 +230,251 @@ void RenderManager::createCommandBuffers()
     m_Context->createCommandBuffers(m_CmdBufs, m_NumImages);
 }
 
-void RenderManager::RenderOpaques(std::shared_ptr<Camera> camera)
+void RenderManager::RenderOpaques(const RenderView& view)
 {
+    // Only a key into the per camera resources, everything recorded comes from the snapshot view
+    const std::shared_ptr<Camera>& camera = view.camera;
     int currentFrame = m_Context->getCurrentFrame();
-    int currentImageIndex = m_Context->getCurrentImageIndex();
 
     auto commandBuffer = m_FrameData[currentFrame].cameraData.at(camera).commandBuffer;
 
-    for (const auto& pair : m_DrawCommandsByShaderMaterial)
-    {
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = 0;
-        beginInfo.pInheritanceInfo = nullptr;
-
-        VkResult res = vkBeginCommandBuffer(commandBuffer, &beginInfo);
-        REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to begin recording command buffer");
-
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = m_OpaqueRenderPass;
-        renderPassInfo.framebuffer =
-            m_SwapChainResourcesByCamera[camera][m_Context->getCurrentImageIndex()].framebuffer;
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = {camera->viewportSize.x, camera->viewportSize.y};
-
-        std::array<VkClearValue, 4> clearValues{};
-        clearValues[0].color = {0.1f, 0.1f, 0.1f, 1.0f};
-        clearValues[1].depthStencil = {1.0f, 0};
-        clearValues[2].color = {0.1f, 0.1f, 0.1f, 1.0f};
-        clearValues[3].depthStencil = {1.0f, 0};
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassInfo.pClearValues = clearValues.data();
-
-        VkImageMemoryBarrier barrier{};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image = m_SwapChainResourcesByCamera[camera][currentImageIndex].colorResolveImage->getVkImage();
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-
-        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-        barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-        barrier.image = m_SwapChainResourcesByCamera[camera][currentImageIndex].depthResolveImage->getVkImage();
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-        barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-
-        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                             VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        const auto& materialFromShader = pair.second;
-        for (const auto& material : materialFromShader)
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = 0;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    VkResult res = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to begin recording command buffer");
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = m_OpaqueRenderPass;
+    renderPassInfo.framebuffer = m_SwapChainResourcesByCamera[camera][m_Context->getCurrentImageIndex()].framebuffer;
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = {view.viewportSize.x, view.viewportSize.y};
+
+    std::array<VkClearValue, 4> clearValues{};
+    clearValues[0].color = {0.1f, 0.1f, 0.1f, 1.0f};
+    clearValues[1].depthStencil = {1.0f, 0};
+    clearValues[2].color = {0.1f, 0.1f, 0.1f, 1.0f};
+    clearValues[3].depthStencil = {1.0f, 0};
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    // Makes the shadow map readable and, when the multisampled targets alias another camera's, waits for that one
+    const RenderGraph::Pass graphPass = m_TransientImagesByCamera.at(camera).opaquePass;
+    m_FrameGraph.RecordBarriersBefore(commandBuffer, graphPass);
+
+    const std::span<const RenderQueueItem> items = m_RenderQueue.GetBucket(RenderBucket::Opaque);
+    ParallelCommandRecorder::ResolveMaterialBindings(
+        m_RenderQueue, items, [this](uint32_t flags) { return m_OpaquePipelines.Get(flags); }, m_MaterialBindings);
+
+    const uint32_t itemCount = static_cast<uint32_t>(items.size());
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, m_CommandRecorder.GetSubpassContents(itemCount));
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(view.viewportSize.x);
+    viewport.height = static_cast<float>(view.viewportSize.y);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = {view.viewportSize.x, view.viewportSize.y};
+
+    const std::array<VkDescriptorSet, 3> descriptorSets{
+        m_FrameData[currentFrame].cameraData.at(camera).globalDescriptorSet,
+        m_MaterialTable.GetDescriptorSet(currentFrame), m_FrameData[currentFrame].objectDescriptorSet};
+    const uint32_t instanceRegion = getViewInstanceRegion(camera);
+    const InstanceSlots instanceSlots = getInstanceSlots(instanceRegion);
+    const IndirectCommands indirectCommands = getIndirectCommands(instanceRegion);
+    const GeometryPool& geometryPool = *m_Context->getGeometryPool();
+
+    MeshletCullView meshletView;
+    meshletView.frustum = Frustum::FromMatrix(view.projection * view.view);
+    meshletView.eye = glm::vec3(glm::inverse(view.view)[3]);
+    std::atomic<uint32_t> meshletsCulled = 0;
+
+    // Runs once per chunk, possibly on a worker, so every chunk starts from unbound state.
+    auto recordDraws = [&](VkCommandBuffer recordBuffer, uint32_t begin, uint32_t end) {
+        vkCmdSetViewport(recordBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(recordBuffer, 0, 1, &scissor);
+
+        // The material table is bound once, draws find their material through the index in their object data
+        vkCmdBindDescriptorSets(recordBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_OpaquePipelineLayout, 0,
+                                static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 1,
+                                &instanceSlots.dynamicOffset);
+
+        // The queue is sorted by permutation, material, then mesh, so state only gets rebound when the key changes.
+        // Everything drawn between two pipeline, cull mode or geometry block changes goes out as one indirect draw.
+        IndirectDrawBatch batch(indirectCommands, m_RenderQueue.GetCommandIndex(items[begin]),
+                                m_Context->supportsMultiDrawIndirect());
+        VkPipeline boundPipeline = VK_NULL_HANDLE;
+        VkCullModeFlags boundCullMode = VK_CULL_MODE_FLAG_BITS_MAX_ENUM;
+        uint32_t boundMaterialSlot = UINT32_MAX;
+        uint32_t boundMeshSlot = UINT32_MAX;
+        uint32_t boundBlock = UINT32_MAX;
+        const MaterialBinding* binding = nullptr;
+        std::shared_ptr<Mesh> boundMesh;
+        GeometryAllocation geometry;
+        uint32_t drawCount = 0;
+        std::vector<DrawRange> meshletRanges;
+        uint32_t chunkMeshletsCulled = 0;
+
+        for (uint32_t i = begin; i < end;)
         {
-            auto mat = material.second.front().material.Lock();
-            if (!(mat->blendingMode == Mask || mat->renderingMode == Opaque))
+            const RenderQueueItem& item = items[i];
+            if (!m_RenderQueue.IsVisible(item, CULL_VIEW_CAMERA))
             {
+                i++;
                 continue;
             }
-            auto pipeline = getPipelineFromFlags(mat->materialFlags);
-            if (pipeline == VK_NULL_HANDLE)
+
+            const DrawCommand& cmd = m_RenderQueue.GetCommand(item);
+            // Visible copies of this draw that only differ in their object data become its instances
+            const uint32_t instanceCount =
+                m_RenderQueue.GatherInstances(items, i, end, CULL_VIEW_CAMERA, instanceSlots, i);
+
+            const uint32_t materialSlot = DrawKey::GetMaterialSlot(item.key);
+            if (materialSlot != boundMaterialSlot)
             {
-                // REON_CORE_WARN("Cant render because pipeline is not found");
-                continue;
-            }
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                boundMaterialSlot = materialSlot;
+                binding = &m_MaterialBindings[materialSlot];
+                if (!binding->material)
+                    continue;
 
-            VkViewport viewport{};
-            viewport.x = 0.0f;
-            viewport.y = 0.0f;
-            viewport.width = static_cast<float>(camera->viewportSize.x);
-            viewport.height = static_cast<float>(camera->viewportSize.y);
-            viewport.minDepth = 0.0f;
-            viewport.maxDepth = 1.0f;
-            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+                const VkCullModeFlags cullMode =
+                    binding->material->getDoubleSided() ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+                if (binding->pipeline != boundPipeline || cullMode != boundCullMode)
+                    drawCount += batch.Flush(recordBuffer);
+
+                if (binding->pipeline != boundPipeline)
+                {
+                    vkCmdBindPipeline(recordBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, binding->pipeline);
+                    boundPipeline = binding->pipeline;
+                }
+                if (cullMode != boundCullMode)
+                {
+                    vkCmdSetCullMode(recordBuffer, cullMode);
+                    boundCullMode = cullMode;
+                }
+            }
 
-            VkRect2D scissor{};
-            scissor.offset = {0, 0};
-            scissor.extent = {camera->viewportSize.x, camera->viewportSize.y};
-            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+            if (!binding->material)
+                continue;
 
-            mat->flatDataBuffers[currentFrame]->Write(&mat->flatData, sizeof(mat->flatData));
+            const uint32_t meshSlot = DrawKey::GetMeshSlot(item.key);
+            if (meshSlot != boundMeshSlot)
+            {
+                boundMeshSlot = meshSlot;
+                // Freed geometry stays untouched until this frame finished, the mesh does not have to outlive the draw
+                boundMesh = cmd.mesh.Lock();
+                geometry = boundMesh ? boundMesh->geometry : GeometryAllocation{};
+                if (geometry.IsValid() && geometry.block != boundBlock)
+                {
+                    drawCount += batch.Flush(recordBuffer);
+                    geometryPool.Bind(recordBuffer, geometry.block);
+                    boundBlock = geometry.block;
+                }
+            }
 
-            vkCmdSetCullMode(commandBuffer, mat->getDoubleSided() ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT);
+            if (!geometry.IsValid())
+                continue;
 
-            for (const auto& cmd : material.second)
+            // A single copy at full detail draws only the meshlets that survive, instances share one range
+            if (instanceCount == 1 && m_RenderQueue.GetMeshletCount(item) > 0 &&
+                cmd.subMeshIndex < boundMesh->subMeshes.size())
             {
-                auto mesh = cmd.mesh.Lock();
-                if (!mesh)
-                    continue;
+                meshletRanges.clear();
+                chunkMeshletsCulled += MeshletCuller::Cull(
+                    *boundMesh, boundMesh->subMeshes[cmd.subMeshIndex], m_RenderQueue.GetObjectData(item).model,
+                    meshletView, boundCullMode == VK_CULL_MODE_BACK_BIT, meshletRanges);
+                for (const DrawRange& range : meshletRanges)
+                    batch.Add({range.indexCount, 1, geometry.firstIndex + range.startIndex,
+                               static_cast<int32_t>(geometry.vertexOffset), m_RenderQueue.GetObjectIndex(item)});
+                continue;
+            }
 
-                std::vector<VkDescriptorSet> descriptorSets = {
-                    m_FrameData[currentFrame].cameraData.at(camera).globalDescriptorSet, mat->descriptorSets[currentFrame],
-                    cmd.owner->objectDescriptorSets[m_Context->getCurrentFrame()]};
+            const DrawRange& range = m_RenderQueue.GetDrawRange(item);
+            batch.Add({range.indexCount, instanceCount, geometry.firstIndex + range.startIndex,
+                       static_cast<int32_t>(geometry.vertexOffset), m_RenderQueue.GetObjectIndex(item)});
+        }
+        drawCount += batch.Flush(recordBuffer);
+        m_CommandRecorder.CountDraws(drawCount);
+        meshletsCulled += chunkMeshletsCulled;
+    };
 
-                ObjectRenderData data{};
-                data.model = cmd.owner->getModelMatrix();
-                data.transposeInverseModel = cmd.owner->getTransposeInverseModelMatrix();
-                data.jointCount = cmd.jointCount;
-                data.paletteOffset = cmd.joinOffset;
-                cmd.owner->objectDataBuffers[m_Context->getCurrentFrame()]->Write(&data, sizeof(data));
+    m_CommandRecorder.Record(m_Context, commandBuffer, m_OpaqueRenderPass, 0, renderPassInfo.framebuffer, itemCount,
+                             recordDraws);
+    if (camera == m_Camera)
+        m_CullStats.meshletsCulled = meshletsCulled;
 
-                VkBuffer vertexBuffers[] = {mesh->m_VertexBuffer->GetVkBuffer()};
-                VkDeviceSize offsets[] = {0};
-                vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    vkCmdEndRenderPass(commandBuffer);
 
-                vkCmdBindIndexBuffer(commandBuffer, mesh->m_IndexBuffer->GetVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    // The resolve targets are transitioned by whichever pass reads them next
+    m_FrameGraph.RecordBarriersAfter(commandBuffer, graphPass);
 
-                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_OpaquePipelineLayout, 0,
-                                        descriptorSets.size(), descriptorSets.data(), 0, nullptr);
-                vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(cmd.indexCount), 1, cmd.startIndex, 0, 0);
-            }
-        }
+    res = vkEndCommandBuffer(commandBuffer);
+    REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to record command buffer");
 
-        vkCmdEndRenderPass(commandBuffer);
-
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image = m_SwapChainResourcesByCamera[camera][currentImageIndex].colorResolveImage->getVkImage();
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-        barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-        barrier.image = m_SwapChainResourcesByCamera[camera][currentImageIndex].depthResolveImage->getVkImage();
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-        barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-        res = vkEndCommandBuffer(commandBuffer);
-        REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to record command buffer");
-
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-        VkSemaphore waitSemaphores[] = {m_Context->getCurrentImageAvailableSemaphore(),
-                                        m_DirectionalShadowsGenerated[currentFrame]};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                                             VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT};
-        submitInfo.waitSemaphoreCount = 2;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
-
-        VkSemaphore signalSemaphores[] = {m_OpaquePassDone[currentFrame]};
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
-
-        res = vkQueueSubmit(m_Context->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-        REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to submit draw command buffer");
-    }
+    // Samples the main light shadow map
+    m_FrameSubmitter.AddPass(commandBuffer, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
 }
 
-void RenderManager::RenderTransparents(std::shared_ptr<Camera> camera)
+void RenderManager::RenderTransparents(const RenderView& view)
 {
+    const std::shared_ptr<Camera>& camera = view.camera;
     int currentFrame = m_Context->getCurrentFrame();
-    m_TransparentPass.render(m_Context, camera, m_DrawCommandsByShaderMaterial, m_OpaquePassDone[currentFrame],
-                             m_Context->getCurrentRenderFinishedSemaphore(),
-                             m_FrameData[currentFrame].cameraData.at(camera).globalDescriptorSet);
+    m_TransparentPass.render(m_Context, view, m_RenderQueue, m_FrameGraph, m_CommandRecorder, m_FrameSubmitter,
+                             m_FrameData[currentFrame].cameraData.at(camera).globalDescriptorSet,
+                             m_MaterialTable.GetDescriptorSet(currentFrame),
+                             m_FrameData[currentFrame].objectDescriptorSet,
+                             getInstanceSlots(getViewInstanceRegion(camera)),
+                             getIndirectCommands(getViewInstanceRegion(camera)));
 }
 
 void RenderManager::RenderPostProcessing() {}
 
-void RenderManager::GenerateShadows()
+void RenderManager::updateShadowCascades()
 {
     auto light = m_LightManager->mainLight;
-    glm::mat4 lightSpaceMatrix;
-    float near_plane = -50.0f, far_plane = 100;
-    m_MainLightProj = glm::ortho(-20.0f, 20.0f, -20.0f, 20.0f, near_plane, far_plane);
-    // m_MainLightProj[1][1] *= -1.0f;
-    m_MainLightView = glm::lookAtRH(glm::vec3(0.0f, 0.0f, 0.0f),
-                                  (light->get_owner()->GetTransform()->localRotation * glm::vec3(0.0f, 0.0f, -1.0f)),
-                                  (light->get_owner()->GetTransform()->localRotation * glm::vec3(0.0f, 1.0f, 0.0f)));
-    lightSpaceMatrix = m_MainLightProj * m_MainLightView;
-    m_DirectionalShadowPass.render(m_Context, m_Renderers, lightSpaceMatrix,
-                                   m_DirectionalShadowsGenerated[m_Context->getCurrentFrame()]);
+    m_Snapshot.mainLightView = glm::lookAtRH(glm::vec3(0.0f, 0.0f, 0.0f),
+                                  (light->get_owner()->GetTransform()->GetLocalRotation() * glm::vec3(0.0f, 0.0f, -1.0f)),
+                                  (light->get_owner()->GetTransform()->GetLocalRotation() * glm::vec3(0.0f, 1.0f, 0.0f)));
+
+    // One shadow map per frame, fitted to the editor camera. Other views sample the same cascades.
+    const RenderView* view = m_Snapshot.FindView(m_Camera);
+    m_Snapshot.shadowCascadeCount =
+        view ? ShadowCascades::Fit(view->view, view->projection, view->nearPlane, view->farPlane,
+                                   m_Snapshot.mainLightView, m_DirectionalShadowPass.getCascadeResolution(),
+                                   m_ShadowCascadeSettings, m_Snapshot.shadowCascades)
+             : 0;
+    m_DirectionalShadowPass.placeCascades(std::span(m_Snapshot.shadowCascades.data(), m_Snapshot.shadowCascadeCount),
+                                          m_Snapshot.mainLightView, m_RenderQueue.GetStaticVersion());
+}
+
+void RenderManager::GenerateShadows()
+{
+    // Nothing samples the shadow map when no camera renders lit
+    if (m_FrameGraph.IsCulled(m_DirectionalShadowPass.getGraphPass()))
+        return;
+
+    const uint32_t cascadeCount = m_Snapshot.shadowCascadeCount;
+    std::array<DirectionalShadowPass::ShadowCascadeRegions, ShadowCascades::MaxCascades> regions;
+    for (uint32_t cascade = 0; cascade < cascadeCount; cascade++)
+    {
+        const uint32_t staticRegion = FIRST_SHADOW_INSTANCE_REGION + 2 * cascade;
+        regions[cascade].staticSlots = getInstanceSlots(staticRegion);
+        regions[cascade].staticCommands = getIndirectCommands(staticRegion);
+        regions[cascade].dynamicSlots = getInstanceSlots(staticRegion + 1);
+        regions[cascade].dynamicCommands = getIndirectCommands(staticRegion + 1);
+    }
+
+    m_DirectionalShadowPass.render(m_Context, m_RenderQueue, m_FrameGraph, m_CommandRecorder, m_FrameSubmitter,
+                                   std::span(m_Snapshot.shadowCascades.data(), cascadeCount),
+                                   std::span(regions.data(), cascadeCount));
     return;
     GenerateMainLightShadows();
     GenerateAdditionalShadows();
@@ -332,32 +514,44 @@ RenderManager::RenderManager(std::shared_ptr<LightManager> lightManager, std::sh
     // Initialize main light shadow maps
     this->m_Camera = std::move(camera);
 
-    m_DirectionalShadowPass.Init(m_Context);
+    // Before any pipeline is created, a warm cache turns their compiles into lookups
+    createPipelineCache();
+    loadShaderPack();
+    const auto pipelineStart = std::chrono::high_resolution_clock::now();
+
+    m_DirectionalShadowPass.Init(m_Context, m_PipelineCache);
+    m_CommandRecorder.Init(m_Context, &Application::Get().GetJobSystem());
 
     m_FrameData.resize(m_Context->MAX_FRAMES_IN_FLIGHT);
     m_SwapChainResourcesByCamera[m_Camera].resize(m_Context->getAmountOfSwapChainImages());
-    // m_DrawCommandsByShaderMaterial.resize(m_Context->MAX_FRAMES_IN_FLIGHT);
 
     m_NumImages = m_Context->getAmountOfSwapChainImages();
 
-    createPipelineCache();
     createDummyResources();
+    m_MaterialTable.Init(m_Context, m_DummyImage->getVkImageView(), m_DummySampler);
     createOpaqueCommandPool();
     createOpaqueRenderPass();
     createOpaqueDescriptorSetLayout();
+    createObjectDataDescriptorSets();
 
     createCommandBuffers();
 
     std::vector<VkDescriptorSetLayout> layouts;
     layouts.push_back(m_OpaqueGlobalDescriptorSetLayout);
-    layouts.push_back(m_OpaqueMaterialDescriptorSetLayout);
+    layouts.push_back(m_MaterialTable.GetLayout());
     layouts.push_back(m_OpaqueObjectDescriptorSetLayout);
     m_TransparentPass.init(m_Context, layouts, m_PipelineCache);
 
     createCameraResources(m_Camera);
+    m_OpaquePipelines.Init(
+        [this](uint32_t flags) { return createGraphicsPipeline(m_OpaqueGraphicsPipeline, flags); });
     createOpaqueGraphicsPipelines();
     createSyncObjects();
 
+    REON_CORE_INFO("Render passes and prebaked pipelines created in {0:.1f} ms",
+                   std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - pipelineStart)
+                       .count());
+
     // m_UnlitPass.init(m_Context, m_Width, m_Height, m_EndImageViews, m_PipelineCache, layouts);
 }
 
@@ -397,62 +591,83 @@ void RenderManager::Initialize()
 
 void RenderManager::InitializeSkyBox() {}
 
-std::vector<LightData> RenderManager::GetLightingBuffer()
+void RenderManager::captureLights()
 {
+    // Refilled in place, the snapshot keeps its capacity from the frames before
+    std::vector<LightData>& lights = m_Snapshot.lights;
+    lights.clear();
+
     const auto& scene = SceneManager::Get()->GetCurrentScene();
-    size_t amountOfLights = scene->lightManager->lights.size();
-    int pointIndex = 0;
-    std::vector<LightData> lights;
-
-    glm::mat4 lightSpaceMatrix;
-    float near_plane = -50.0f, far_plane = 100;
-    glm::mat4 mainLightProj = glm::ortho(-20.0f, 20.0f, -20.0f, 20.0f, near_plane, far_plane);
-    // mainLightProj[1][1] *= -1.0f;
-    glm::mat4 mainLightView = glm::lookAtRH(
-        glm::vec3(0.0f, 0.0f, 0.0f),
-        (scene->lightManager->lights[0]->get_owner()->GetTransform()->localRotation * glm::vec3(0.0f, 0.0f, -1.0f)),
-        (scene->lightManager->lights[0]->get_owner()->GetTransform()->localRotation * glm::vec3(0.0f, 1.0f, 0.0f)));
-    lightSpaceMatrix = mainLightProj * mainLightView;
-
-    for (int i = 0; i < amountOfLights; ++i)
+    if (!scene)
     {
-        unsigned int depthCube = -1;
-        Light* light = scene->lightManager->lights[i].get();
+        m_Snapshot.globalLightCount = 0;
+        return;
+    }
 
-        LightData data(light->intensity, light->color, light->get_owner()->GetTransform()->localPosition,
-                       light->get_owner()->GetTransform()->GetForwardVector(), light->innerCutOff, light->outerCutOff,
-                       (int)light->type, lightSpaceMatrix, light->range);
-        lights.emplace_back(data);
+    // The cascades were just refitted by updateShadowCascades, lights carry the closest one
+    const glm::mat4 lightSpaceMatrix =
+        m_Snapshot.shadowCascadeCount > 0 ? m_Snapshot.shadowCascades[0].viewProj : glm::mat4(1.0f);
+    const auto& sceneLights = scene->lightManager->lights;
+    lights.reserve(sceneLights.size());
+    for (const auto& light : sceneLights)
+    {
+        const auto& transform = light->get_owner()->GetTransform();
+        lights.emplace_back(light->intensity, light->color, transform->GetLocalPosition(),
+                            transform->GetForwardVector(), light->innerCutOff, light->outerCutOff, (int)light->type,
+                            lightSpaceMatrix, light->range);
     }
-    return lights;
+
+    // Lights that reach everywhere go first, in their original order so the main light stays at index 0
+    auto isGlobal = [](const LightData& light) {
+        return light.type == int(LightType::Directional) || light.range <= 0.0f;
+    };
+    const auto clustered = std::stable_partition(lights.begin(), lights.end(), isGlobal);
+    m_Snapshot.globalLightCount = static_cast<uint32_t>(clustered - lights.begin());
 }
 
-void RenderManager::setGlobalData(std::shared_ptr<Camera> camera)
+void RenderManager::writeLightData()
 {
-    const auto& viewMat = camera->GetViewMatrix();
-    const auto& projMat = camera->GetProjectionMatrix();
+    // One light list per frame, every camera bins it into its own clusters
+    const int currentFrame = m_Context->getCurrentFrame();
+    const std::vector<LightData>& lights = m_Snapshot.lights;
+    if (lights.size() * sizeof(LightData) > m_FrameData[currentFrame].lightDataBuffer->GetSize())
+        resizeLightBuffer(currentFrame, lights.size());
+
+    if (!lights.empty())
+        m_FrameData[currentFrame].lightDataBuffer->Write(lights.data(), lights.size() * sizeof(LightData));
+}
 
-    GlobalRenderData data{};
-    auto lightData = GetLightingBuffer();
+void RenderManager::setGlobalData(std::shared_ptr<Camera> camera, const RenderView& view)
+{
+    const int currentFrame = m_Context->getCurrentFrame();
+    CameraData& cameraData = m_FrameData[currentFrame].cameraData.at(camera);
 
-    std::vector<LightData> lights;
+    LightClusterer& clusterer = m_LightClusterers[camera];
+    clusterer.Build(view, m_Snapshot.lights, m_Snapshot.globalLightCount);
 
-    data.viewProj = projMat * viewMat;
-    data.inverseView = glm::inverse(viewMat);
-    for (int i = 0; i < lightData.size(); i++)
-    {
-        if (i >= REON_MAX_LIGHTS)
-        {
-            REON_CORE_WARN("More lights in scene than allowed ({}), ignoring further lights", lightData.size());
-            break;
-        }
-        lights.push_back(lightData[i]);
-    }
-    data.lightCount = glm::min(static_cast<int>(lightData.size()), REON_MAX_LIGHTS);
+    const std::span<const LightCluster> clusters = clusterer.GetClusters();
+    const std::span<const uint32_t> lightIndices = clusterer.GetLightIndices();
+    if (lightIndices.size() * sizeof(uint32_t) > cameraData.lightIndexBuffer->GetSize())
+        resizeLightIndexBuffer(currentFrame, camera, lightIndices.size());
 
-    m_FrameData[m_Context->getCurrentFrame()].cameraData.at(camera).globalBuffer->Write(&data, sizeof(data));
+    cameraData.lightClusterBuffer->Write(clusters.data(), clusters.size_bytes());
+    if (!lightIndices.empty())
+        cameraData.lightIndexBuffer->Write(lightIndices.data(), lightIndices.size_bytes());
 
-    m_FrameData[m_Context->getCurrentFrame()].lightDataBuffer->Write(lights.data(), lights.size() * sizeof(LightData));
+    GlobalRenderData data{};
+    data.viewProj = view.projection * view.view;
+    data.inverseView = glm::inverse(view.view);
+    data.lightCount = static_cast<int>(m_Snapshot.lights.size());
+    data.globalLightCount = static_cast<int>(m_Snapshot.globalLightCount);
+    data.view = view.view;
+    data.clusterGrid = glm::uvec4(LightClusterer::ClusterCountX, LightClusterer::ClusterCountY,
+                                  LightClusterer::ClusterCountZ, 0);
+    data.clusterScale = clusterer.GetClusterScale(view);
+    for (uint32_t cascade = 0; cascade < m_Snapshot.shadowCascadeCount; cascade++)
+        data.shadowCascades[cascade] = m_Snapshot.shadowCascades[cascade].viewProj;
+    data.shadowCascadeCount = static_cast<int>(m_Snapshot.shadowCascadeCount);
+
+    cameraData.globalBuffer->Write(&data, sizeof(data));
 
     //std::vector<glm::mat4> mats;
 
@@ -465,50 +680,218 @@ void RenderManager::setGlobalData(std::shared_ptr<Camera> camera)
     //       mats.size() * sizeof(glm::mat4));
 }
 
-void RenderManager::prepareDrawCommands(int currentFrame)
+void RenderManager::prepareDrawCommands()
 {
-    m_DrawCommandsByShaderMaterial.clear();
+    // Only renderers whose draw commands changed touch the queue, everything else stays where it was sorted.
     for (auto& renderer : m_Renderers)
     {
-        if (renderer->drawCommandsDirty)
-            renderer->RebuildDrawCommands();
+        if (!renderer->drawCommandsDirty)
+            continue;
 
-        for (DrawCommand& cmd : renderer->drawCommands)
+        renderer->RebuildDrawCommands();
+        m_RenderQueue.UpdateRenderer(renderer.get());
+    }
+}
+
+void RenderManager::writeObjectData()
+{
+    int currentFrame = m_Context->getCurrentFrame();
+    auto items = m_RenderQueue.GetItems();
+
+    if (items.size() * sizeof(ObjectRenderData) > m_FrameData[currentFrame].objectDataBuffer->GetSize())
+        resizeObjectDataBuffer(currentFrame, items.size());
+    // Items drawn per meshlet own a record per meshlet, so the indirect buffer grows apart from the object data
+    const size_t commandCount = m_RenderQueue.GetCommandCount();
+    if (commandCount * sizeof(VkDrawIndexedIndirectCommand) * INSTANCE_REGION_COUNT >
+        m_FrameData[currentFrame].indirectBuffer->GetSize())
+        resizeIndirectBuffer(currentFrame, commandCount);
+
+    // One contiguous pass over the sorted queue instead of a scattered write per draw, from the captured copy so the
+    // renderers may already be simulating the next frame.
+    auto* objects = static_cast<ObjectRenderData*>(m_FrameData[currentFrame].objectDataBuffer->GetMappedData());
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        objects[i] = m_RenderQueue.GetObjectData(items[i]);
+        objects[i].materialIndex = DrawKey::GetMaterialSlot(items[i].key);
+    }
+}
+
+static RenderGraphImageDesc toGraphImageDesc(const VkMemoryRequirements& requirements)
+{
+    return {requirements.size, requirements.alignment, requirements.memoryTypeBits};
+}
+
+void RenderManager::buildFrameGraph()
+{
+    const int imageIndex = m_Context->getCurrentImageIndex();
+
+    m_FrameGraph.Reset();
+    for (auto& [camera, transients] : m_TransientImagesByCamera)
+        transients.declared = false;
+
+    RenderGraph::Resource shadowMap = m_DirectionalShadowPass.declare(m_FrameGraph, imageIndex);
+
+    // Only the lit path is recorded through the graph, without it the shadow pass has no reader and gets culled
+    if (renderMode == LIT)
+    {
+        for (const RenderView& view : m_Snapshot.views)
+            declareCameraPasses(view.camera, imageIndex, shadowMap);
+    }
+
+    m_FrameGraph.Compile();
+
+    if (renderMode == LIT)
+        updateTransientImages();
+}
+
+void RenderManager::declareCameraPasses(const std::shared_ptr<Camera>& camera, int imageIndex,
+                                        RenderGraph::Resource shadowMap)
+{
+    const CameraSwapChainResources& resources = m_SwapChainResourcesByCamera[camera][imageIndex];
+    CameraTransientImages& transients = m_TransientImagesByCamera[camera];
+
+    transients.declared = true;
+    transients.msaaColor = m_FrameGraph.CreateImage("OpaqueMsaaColor", VK_IMAGE_ASPECT_COLOR_BIT, transients.msaaColorDesc);
+    transients.msaaDepth = m_FrameGraph.CreateImage("OpaqueMsaaDepth", VK_IMAGE_ASPECT_DEPTH_BIT, transients.msaaDepthDesc);
+
+    RenderGraph::Resource colorResolve = m_FrameGraph.ImportImage(
+        "OpaqueColorResolve", resources.colorResolveImage->getVkImage(), VK_IMAGE_ASPECT_COLOR_BIT);
+    RenderGraph::Resource depthResolve = m_FrameGraph.ImportImage(
+        "OpaqueDepthResolve", resources.depthResolveImage->getVkImage(), VK_IMAGE_ASPECT_DEPTH_BIT);
+    RenderGraph::Resource endImage =
+        m_FrameGraph.ImportImage("CameraResult", resources.endImage->getVkImage(), VK_IMAGE_ASPECT_COLOR_BIT);
+    m_FrameGraph.MarkOutput(endImage);
+
+    // Mirrors the attachment descriptions of m_OpaqueRenderPass
+    transients.opaquePass = m_FrameGraph.AddPass("Opaque");
+    m_FrameGraph.Attachment(transients.opaquePass, transients.msaaColor, RenderGraphAccess::ColorAttachment,
+                            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    m_FrameGraph.Attachment(transients.opaquePass, transients.msaaDepth, RenderGraphAccess::DepthAttachment,
+                            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    m_FrameGraph.Attachment(transients.opaquePass, colorResolve, RenderGraphAccess::ColorAttachment,
+                            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    m_FrameGraph.Attachment(transients.opaquePass, depthResolve, RenderGraphAccess::DepthAttachment,
+                            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    m_FrameGraph.Read(transients.opaquePass, shadowMap, RenderGraphAccess::Sampled);
+
+    m_TransparentPass.declare(m_FrameGraph, camera, imageIndex, colorResolve, depthResolve, shadowMap, endImage);
+}
+
+void RenderManager::updateTransientImages()
+{
+    const std::vector<RenderGraphHeap>& heaps = m_FrameGraph.GetHeaps();
+
+    // Heaps only grow, a graph that fits in the current ones keeps them
+    bool reallocate = m_TransientHeaps.size() != heaps.size();
+    for (size_t i = 0; !reallocate && i < heaps.size(); i++)
+    {
+        const RenderGraphHeap& current = m_TransientHeaps[i].layout;
+        reallocate = current.memoryTypeBits != heaps[i].memoryTypeBits || current.size < heaps[i].size ||
+                     current.alignment < heaps[i].alignment;
+    }
+
+    bool replace = reallocate;
+    for (const auto& [camera, transients] : m_TransientImagesByCamera)
+    {
+        if (!transients.declared)
+            continue;
+        replace |= !transients.msaaColorImage || !transients.msaaDepthImage ||
+                   transients.msaaColorHeap != m_FrameGraph.GetHeapIndex(transients.msaaColor) ||
+                   transients.msaaColorOffset != m_FrameGraph.GetHeapOffset(transients.msaaColor) ||
+                   transients.msaaDepthHeap != m_FrameGraph.GetHeapIndex(transients.msaaDepth) ||
+                   transients.msaaDepthOffset != m_FrameGraph.GetHeapOffset(transients.msaaDepth);
+    }
+
+    if (replace)
+    {
+        // Only happens when cameras are added or resized, the old images may still be in use by frames in flight
+        vkDeviceWaitIdle(m_Context->getDevice());
+
+        releaseTransientImages();
+
+        if (reallocate)
         {
-            auto shaderID = cmd.shader.Key().id;
-            auto materialID = cmd.material.Key().id;
+            freeTransientHeaps();
 
-            if (materials.find(materialID) == materials.end())
+            uint64_t heapSize = 0;
+            for (const RenderGraphHeap& layout : heaps)
             {
-                materials.insert(materialID);
-                createOpaqueMaterialDescriptorSets(cmd.material.Lock());
+                VkMemoryRequirements requirements{};
+                requirements.size = layout.size;
+                requirements.alignment = layout.alignment;
+                requirements.memoryTypeBits = layout.memoryTypeBits;
+
+                VmaAllocationCreateInfo allocInfo{};
+                allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+                TransientHeap& heap = m_TransientHeaps.emplace_back();
+                heap.layout = layout;
+                VkResult res =
+                    vmaAllocateMemory(m_Context->getAllocator(), &requirements, &allocInfo, &heap.allocation, nullptr);
+                REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to allocate transient image heap");
+                heapSize += layout.size;
             }
 
-            if (cmd.material.Lock()->descriptorSets.empty())
-            {
-                createOpaqueMaterialDescriptorSets(cmd.material.Lock());
-            }
+            REON_CORE_INFO("Transient attachments aliased into {} heap(s), {:.1f} MB instead of {:.1f} MB",
+                           heaps.size(), heapSize / (1024.0 * 1024.0),
+                           m_FrameGraph.GetUnaliasedSize() / (1024.0 * 1024.0));
+        }
 
-            m_DrawCommandsByShaderMaterial[shaderID][materialID].push_back(cmd);
+        for (auto& [camera, transients] : m_TransientImagesByCamera)
+        {
+            if (!transients.declared)
+                continue;
+
+            transients.msaaColorHeap = m_FrameGraph.GetHeapIndex(transients.msaaColor);
+            transients.msaaColorOffset = m_FrameGraph.GetHeapOffset(transients.msaaColor);
+            transients.msaaDepthHeap = m_FrameGraph.GetHeapIndex(transients.msaaDepth);
+            transients.msaaDepthOffset = m_FrameGraph.GetHeapOffset(transients.msaaDepth);
+
+            transients.msaaColorImage =
+                m_Context->createAliasedImage(transients.msaaColorInfo,
+                                              m_TransientHeaps[transients.msaaColorHeap].allocation,
+                                              transients.msaaColorOffset);
+            transients.msaaDepthImage =
+                m_Context->createAliasedImage(transients.msaaDepthInfo,
+                                              m_TransientHeaps[transients.msaaDepthHeap].allocation,
+                                              transients.msaaDepthOffset);
+
+            createOpaqueFrameBuffers(camera);
         }
     }
+
+    for (const auto& [camera, transients] : m_TransientImagesByCamera)
+    {
+        if (!transients.declared)
+            continue;
+        m_FrameGraph.BindImage(transients.msaaColor, transients.msaaColorImage->getVkImage());
+        m_FrameGraph.BindImage(transients.msaaDepth, transients.msaaDepthImage->getVkImage());
+    }
 }
 
-void RenderManager::createSyncObjects()
+void RenderManager::releaseTransientImages()
 {
-    m_DirectionalShadowsGenerated.resize(m_Context->MAX_FRAMES_IN_FLIGHT);
-    m_OpaquePassDone.resize(m_Context->MAX_FRAMES_IN_FLIGHT);
-
-    VkSemaphoreCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-    for (int i = 0; i < m_Context->MAX_FRAMES_IN_FLIGHT; i++)
+    // The opaque framebuffers reference the multisampled images
+    for (auto& [camera, transients] : m_TransientImagesByCamera)
     {
-        vkCreateSemaphore(m_Context->getDevice(), &createInfo, nullptr, &m_DirectionalShadowsGenerated[i]);
-        vkCreateSemaphore(m_Context->getDevice(), &createInfo, nullptr, &m_OpaquePassDone[i]);
+        deleteForResize(camera);
+        transients.msaaColorImage.reset();
+        transients.msaaDepthImage.reset();
     }
 }
 
+void RenderManager::freeTransientHeaps()
+{
+    for (TransientHeap& heap : m_TransientHeaps)
+        vmaFreeMemory(m_Context->getAllocator(), heap.allocation);
+    m_TransientHeaps.clear();
+}
+
+void RenderManager::createSyncObjects()
+{
+    m_FrameSubmitter.Init(m_Context);
+}
+
 void RenderManager::createDummyResources()
 {
     int texWidth, texHeight, texChannels;
@@ -638,9 +1021,9 @@ void RenderManager::createCameraResources(std::shared_ptr<Camera> camera)
 {
     createGlobalBuffers(camera);
     createOpaqueCommandBuffers(camera);
+    // The opaque framebuffers follow once the frame graph has placed the multisampled images
     createOpaqueImages(camera);
     createEndImages(camera);
-    createOpaqueFrameBuffers(camera);
     createEndBufferSet(camera);
     createOpaqueGlobalDescriptorSets(camera);
 
@@ -649,7 +1032,7 @@ void RenderManager::createCameraResources(std::shared_ptr<Camera> camera)
     std::vector<VkImageView> opaqueImageViews;
     for (int i = 0; i < m_Context->getAmountOfSwapChainImages(); ++i)
     {
-        endImageViews.push_back(m_SwapChainResourcesByCamera[camera][i].colorResolveImage->getVkImageView());
+        endImageViews.push_back(m_SwapChainResourcesByCamera[camera][i].endImage->getVkImageView());
         depthImageViews.push_back(m_SwapChainResourcesByCamera[camera][i].depthResolveImage->getVkImageView());
         opaqueImageViews.push_back(m_SwapChainResourcesByCamera[camera][i].colorResolveImage->getVkImageView());
     }
@@ -695,6 +1078,23 @@ void RenderManager::createOpaqueImages(std::shared_ptr<Camera> camera)
 
     m_SwapChainResourcesByCamera[camera].resize(swapChainImageCount);
 
+    // Only described here, updateTransientImages creates them once the frame graph has placed them
+    CameraTransientImages& transients = m_TransientImagesByCamera[camera];
+    transients.msaaColorImage.reset();
+    transients.msaaDepthImage.reset();
+
+    transients.msaaColorInfo.width = camera->viewportSize.x;
+    transients.msaaColorInfo.height = camera->viewportSize.y;
+    transients.msaaColorInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+    transients.msaaColorInfo.samples = m_Context->getSampleCount();
+    transients.msaaColorInfo.usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    transients.msaaColorDesc = toGraphImageDesc(m_Context->getImageMemoryRequirements(transients.msaaColorInfo));
+
+    transients.msaaDepthInfo = transients.msaaColorInfo;
+    transients.msaaDepthInfo.format = m_Context->findDepthFormat();
+    transients.msaaDepthInfo.usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    transients.msaaDepthDesc = toGraphImageDesc(m_Context->getImageMemoryRequirements(transients.msaaDepthInfo));
+
     for (int i = 0; i < swapChainImageCount; i++)
     {
         auto& camResources = m_SwapChainResourcesByCamera[camera][i];
@@ -702,17 +1102,6 @@ void RenderManager::createOpaqueImages(std::shared_ptr<Camera> camera)
         ImageCreateInfo createInfo;
         createInfo.width = camera->viewportSize.x;
         createInfo.height = camera->viewportSize.y;
-        createInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-        createInfo.samples = m_Context->getSampleCount();
-        createInfo.usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-
-        camResources.msaaColorImage = m_Context->createImage(createInfo);
-
-        createInfo.format = m_Context->findDepthFormat();
-        createInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-
-        camResources.msaaDepthImage = m_Context->createImage(createInfo);
-
         createInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
         createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         createInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
@@ -854,11 +1243,13 @@ void RenderManager::createOpaqueFrameBuffers(std::shared_ptr<Camera> camera)
 {
     m_SwapChainResourcesByCamera[camera].resize(m_Context->getAmountOfSwapChainImages());
 
+    const CameraTransientImages& transients = m_TransientImagesByCamera.at(camera);
+
     for (size_t i = 0; i < m_Context->getSwapChainImageViews().size(); i++)
     {
         std::array<VkImageView, 4> attachments = {
-            m_SwapChainResourcesByCamera[camera][i].msaaColorImage->getVkImageView(),
-            m_SwapChainResourcesByCamera[camera][i].msaaDepthImage->getVkImageView(),
+            transients.msaaColorImage->getVkImageView(),
+            transients.msaaDepthImage->getVkImageView(),
             m_SwapChainResourcesByCamera[camera][i].colorResolveImage->getVkImageView(),
             m_SwapChainResourcesByCamera[camera][i].depthResolveImage->getVkImageView()};
 
@@ -900,6 +1291,17 @@ void RenderManager::createOpaqueDescriptorSetLayout()
     globalDirectionalShadowBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     globalDirectionalShadowBinding.pImmutableSamplers = nullptr;
 
+    // Cluster ranges and the light indices they point into, see LightClusterer
+    VkDescriptorSetLayoutBinding globalLightClusterBinding{};
+    globalLightClusterBinding.binding = 5;
+    globalLightClusterBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    globalLightClusterBinding.descriptorCount = 1;
+    globalLightClusterBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    globalLightClusterBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding globalLightIndexBinding = globalLightClusterBinding;
+    globalLightIndexBinding.binding = 6;
+
     //VkDescriptorSetLayoutBinding globalSkinMatBinding{};
     //globalLightBinding.binding = 3;
     //globalLightBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
@@ -907,8 +1309,9 @@ void RenderManager::createOpaqueDescriptorSetLayout()
     //globalLightBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     //globalLightBinding.pImmutableSamplers = nullptr;
 
-    std::array<VkDescriptorSetLayoutBinding, 3> globalBindings{globalLayoutBinding, globalLightBinding,
-                                                               globalDirectionalShadowBinding};
+    std::array<VkDescriptorSetLayoutBinding, 5> globalBindings{globalLayoutBinding, globalLightBinding,
+                                                               globalDirectionalShadowBinding,
+                                                               globalLightClusterBinding, globalLightIndexBinding};
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutInfo.bindingCount = globalBindings.size();
@@ -918,79 +1321,25 @@ void RenderManager::createOpaqueDescriptorSetLayout()
         vkCreateDescriptorSetLayout(m_Context->getDevice(), &layoutInfo, nullptr, &m_OpaqueGlobalDescriptorSetLayout);
     REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create descriptor set layout");
 
-    VkDescriptorSetLayoutBinding flatDataBinding{};
-    flatDataBinding.binding = 1;
-    flatDataBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    flatDataBinding.descriptorCount = 1;
-    flatDataBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    flatDataBinding.pImmutableSamplers = nullptr;
-
-    VkDescriptorSetLayoutBinding albedoLayoutBinding{};
-    albedoLayoutBinding.binding = 3;
-    albedoLayoutBinding.descriptorCount = 1;
-    albedoLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    albedoLayoutBinding.pImmutableSamplers = nullptr;
-    albedoLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    VkDescriptorSetLayoutBinding normalLayoutBinding{};
-    normalLayoutBinding.binding = 4;
-    normalLayoutBinding.descriptorCount = 1;
-    normalLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    normalLayoutBinding.pImmutableSamplers = nullptr;
-    normalLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    VkDescriptorSetLayoutBinding roughnessMetallicLayoutBinding{};
-    roughnessMetallicLayoutBinding.binding = 5;
-    roughnessMetallicLayoutBinding.descriptorCount = 1;
-    roughnessMetallicLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    roughnessMetallicLayoutBinding.pImmutableSamplers = nullptr;
-    roughnessMetallicLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    VkDescriptorSetLayoutBinding emissiveLayoutBinding{};
-    emissiveLayoutBinding.binding = 6;
-    emissiveLayoutBinding.descriptorCount = 1;
-    emissiveLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    emissiveLayoutBinding.pImmutableSamplers = nullptr;
-    emissiveLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    VkDescriptorSetLayoutBinding specularLayoutBinding{};
-    specularLayoutBinding.binding = 7;
-    specularLayoutBinding.descriptorCount = 1;
-    specularLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    specularLayoutBinding.pImmutableSamplers = nullptr;
-    specularLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    VkDescriptorSetLayoutBinding specularColorLayoutBinding{};
-    specularColorLayoutBinding.binding = 8;
-    specularColorLayoutBinding.descriptorCount = 1;
-    specularColorLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    specularColorLayoutBinding.pImmutableSamplers = nullptr;
-    specularColorLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    std::array<VkDescriptorSetLayoutBinding, 7> bindings = {
-        flatDataBinding,       albedoLayoutBinding,   normalLayoutBinding,       roughnessMetallicLayoutBinding,
-        emissiveLayoutBinding, specularLayoutBinding, specularColorLayoutBinding};
-    VkDescriptorSetLayoutCreateInfo materialLayoutInfo{};
-    materialLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    materialLayoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    materialLayoutInfo.pBindings = bindings.data();
-    // layoutInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PER_STAGE_BIT_NV;
-
-    res = vkCreateDescriptorSetLayout(m_Context->getDevice(), &materialLayoutInfo, nullptr,
-                                      &m_OpaqueMaterialDescriptorSetLayout);
-    REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create descriptor set layout");
-
     VkDescriptorSetLayoutBinding objectDataBinding{};
     objectDataBinding.binding = 2;
-    objectDataBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    objectDataBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     objectDataBinding.descriptorCount = 1;
     objectDataBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     objectDataBinding.pImmutableSamplers = nullptr;
 
+    VkDescriptorSetLayoutBinding instanceBinding{};
+    instanceBinding.binding = 3;
+    instanceBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    instanceBinding.descriptorCount = 1;
+    instanceBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    instanceBinding.pImmutableSamplers = nullptr;
+
+    std::array<VkDescriptorSetLayoutBinding, 2> objectBindings = {objectDataBinding, instanceBinding};
     VkDescriptorSetLayoutCreateInfo objectLayoutInfo{};
     objectLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    objectLayoutInfo.bindingCount = 1;
-    objectLayoutInfo.pBindings = &objectDataBinding;
+    objectLayoutInfo.bindingCount = static_cast<uint32_t>(objectBindings.size());
+    objectLayoutInfo.pBindings = objectBindings.data();
 
     res = vkCreateDescriptorSetLayout(m_Context->getDevice(), &objectLayoutInfo, nullptr,
                                       &m_OpaqueObjectDescriptorSetLayout);
@@ -1021,11 +1370,6 @@ void RenderManager::createOpaqueGlobalDescriptorSets(std::shared_ptr<Camera> cam
         globalBufferInfo.offset = 0;
         globalBufferInfo.range = sizeof(GlobalRenderData);
 
-        VkDescriptorBufferInfo lightBufferInfo{};
-        lightBufferInfo.buffer = m_FrameData[i].lightDataBuffer->GetVkBuffer();
-        lightBufferInfo.offset = 0;
-        lightBufferInfo.range = sizeof(LightData) * REON_MAX_LIGHTS;
-
         //VkDescriptorBufferInfo skinMatInfo{};
         //skinMatInfo.buffer = m_FrameData[i].skinMatDataBuffer;
         //skinMatInfo.offset = 0;
@@ -1036,7 +1380,7 @@ void RenderManager::createOpaqueGlobalDescriptorSets(std::shared_ptr<Camera> cam
         directionalShadowBufferInfo.imageView = m_DirectionalShadowPass.getShadowViews()[i];
         directionalShadowBufferInfo.sampler = m_DirectionalShadowPass.getShadowSampler();
 
-        std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
         descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrites[0].dstSet = m_FrameData[i].cameraData.at(camera).globalDescriptorSet;
         descriptorWrites[0].dstBinding = 0;
@@ -1047,19 +1391,11 @@ void RenderManager::createOpaqueGlobalDescriptorSets(std::shared_ptr<Camera> cam
 
         descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrites[1].dstSet = m_FrameData[i].cameraData.at(camera).globalDescriptorSet;
-        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].dstBinding = 2;
         descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pBufferInfo = &lightBufferInfo;
-
-        descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[2].dstSet = m_FrameData[i].cameraData.at(camera).globalDescriptorSet;
-        descriptorWrites[2].dstBinding = 2;
-        descriptorWrites[2].dstArrayElement = 0;
-        descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[2].descriptorCount = 1;
-        descriptorWrites[2].pImageInfo = &directionalShadowBufferInfo;
+        descriptorWrites[1].pImageInfo = &directionalShadowBufferInfo;
 
         //descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         //descriptorWrites[3].dstSet = m_FrameData[i].cameraData[camera].globalDescriptorSet;
@@ -1071,9 +1407,73 @@ void RenderManager::createOpaqueGlobalDescriptorSets(std::shared_ptr<Camera> cam
 
         vkUpdateDescriptorSets(m_Context->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
                                descriptorWrites.data(), 0, nullptr);
+        writeLightDescriptors(static_cast<int>(i), camera);
     }
 }
 
+void RenderManager::writeLightDescriptors(int frame, const std::shared_ptr<Camera>& camera)
+{
+    const CameraData& cameraData = m_FrameData[frame].cameraData.at(camera);
+
+    // Bound whole, the buffers grow with the scene's lights and the shaders index them by the counts they are given
+    const std::array<VkDescriptorBufferInfo, 3> bufferInfos{
+        VkDescriptorBufferInfo{m_FrameData[frame].lightDataBuffer->GetVkBuffer(), 0, VK_WHOLE_SIZE},
+        VkDescriptorBufferInfo{cameraData.lightClusterBuffer->GetVkBuffer(), 0, VK_WHOLE_SIZE},
+        VkDescriptorBufferInfo{cameraData.lightIndexBuffer->GetVkBuffer(), 0, VK_WHOLE_SIZE}};
+    const std::array<uint32_t, 3> bindings{1, 5, 6};
+
+    std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+    for (size_t i = 0; i < descriptorWrites.size(); i++)
+    {
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = cameraData.globalDescriptorSet;
+        descriptorWrites[i].dstBinding = bindings[i];
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+    }
+
+    vkUpdateDescriptorSets(m_Context->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
+                           descriptorWrites.data(), 0, nullptr);
+}
+
+void RenderManager::resizeLightBuffer(int frame, size_t lightCount)
+{
+    // Only called for the frame being recorded, before any of its cameras recorded a draw
+    size_t capacity = INITIAL_LIGHT_CAPACITY;
+    while (capacity < lightCount)
+        capacity *= 2;
+
+    BufferCreateInfo bufCreateInfo;
+    bufCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufCreateInfo.cpuAccess = CpuAccessPattern::SequentialWrite;
+    bufCreateInfo.memoryHint = BufferMemoryHint::CpuToGpu;
+    bufCreateInfo.persistentlyMapped = true;
+    bufCreateInfo.size = sizeof(LightData) * capacity;
+    m_FrameData[frame].lightDataBuffer = m_Context->createBuffer(bufCreateInfo);
+
+    for (const auto& [camera, cameraData] : m_FrameData[frame].cameraData)
+        writeLightDescriptors(frame, camera);
+}
+
+void RenderManager::resizeLightIndexBuffer(int frame, const std::shared_ptr<Camera>& camera, size_t indexCount)
+{
+    size_t capacity = INITIAL_LIGHT_INDEX_CAPACITY;
+    while (capacity < indexCount)
+        capacity *= 2;
+
+    BufferCreateInfo bufCreateInfo;
+    bufCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufCreateInfo.cpuAccess = CpuAccessPattern::SequentialWrite;
+    bufCreateInfo.memoryHint = BufferMemoryHint::CpuToGpu;
+    bufCreateInfo.persistentlyMapped = true;
+    bufCreateInfo.size = sizeof(uint32_t) * capacity;
+    m_FrameData[frame].cameraData.at(camera).lightIndexBuffer = m_Context->createBuffer(bufCreateInfo);
+
+    writeLightDescriptors(frame, camera);
+}
+
 void RenderManager::createGlobalBuffers(std::shared_ptr<Camera> camera)
 {
     VkDeviceSize bufferSize = sizeof(GlobalRenderData);
@@ -1091,15 +1491,20 @@ void RenderManager::createGlobalBuffers(std::shared_ptr<Camera> camera)
 
         CameraData data{std::move(globalBuffer)};
 
-        m_FrameData[i].cameraData.emplace(camera, std::move(data));
-
         bufCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-        bufCreateInfo.cpuAccess = CpuAccessPattern::SequentialWrite;
-        bufCreateInfo.memoryHint = BufferMemoryHint::CpuToGpu;
-        bufCreateInfo.persistentlyMapped = true;
-        bufCreateInfo.size = sizeof(LightData) * REON_MAX_LIGHTS;
+        bufCreateInfo.size = sizeof(LightCluster) * LightClusterer::ClusterCount;
+        data.lightClusterBuffer = m_Context->createBuffer(bufCreateInfo);
+        bufCreateInfo.size = sizeof(uint32_t) * INITIAL_LIGHT_INDEX_CAPACITY;
+        data.lightIndexBuffer = m_Context->createBuffer(bufCreateInfo);
 
-         m_FrameData[i].lightDataBuffer = m_Context->createBuffer(bufCreateInfo);
+        m_FrameData[i].cameraData.emplace(camera, std::move(data));
+
+        // Shared by every camera, only the first one creates it
+        if (!m_FrameData[i].lightDataBuffer)
+        {
+            bufCreateInfo.size = sizeof(LightData) * INITIAL_LIGHT_CAPACITY;
+            m_FrameData[i].lightDataBuffer = m_Context->createBuffer(bufCreateInfo);
+        }
 
         //m_Context->createBuffer(sizeof(glm::mat4) * 1000, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
         //                        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT, m_FrameData[i].skinMatDataBuffer,
@@ -1109,136 +1514,8 @@ void RenderManager::createGlobalBuffers(std::shared_ptr<Camera> camera)
     }
 }
 
-void RenderManager::createOpaqueMaterialDescriptorSets(std::shared_ptr<Material> material)
+void RenderManager::createObjectDataDescriptorSets()
 {
-    material->descriptorSets.resize(m_Context->MAX_FRAMES_IN_FLIGHT);
-
-    std::vector<VkDescriptorSetLayout> materialLayouts(m_Context->MAX_FRAMES_IN_FLIGHT,
-                                                       m_OpaqueMaterialDescriptorSetLayout);
-    VkDescriptorSetAllocateInfo materialAllocInfo{};
-    materialAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    materialAllocInfo.descriptorPool = m_Context->getDescriptorPool();
-    materialAllocInfo.descriptorSetCount = static_cast<uint32_t>(m_Context->MAX_FRAMES_IN_FLIGHT);
-    materialAllocInfo.pSetLayouts = materialLayouts.data();
-
-    VkResult res =
-        vkAllocateDescriptorSets(m_Context->getDevice(), &materialAllocInfo, material->descriptorSets.data());
-    REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to allocate descriptor sets");
-
-    for (size_t i = 0; i < m_Context->MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        VkDescriptorBufferInfo materialBufferInfo{};
-        materialBufferInfo.buffer = material->flatDataBuffers[i]->GetVkBuffer();
-        materialBufferInfo.offset = 0;
-        materialBufferInfo.range = sizeof(FlatData);
-
-        VkDescriptorImageInfo albedoImageInfo{};
-        const auto& albedoTexture = material->albedoTexture.Lock();
-        albedoImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        albedoImageInfo.imageView = albedoTexture ? albedoTexture->getTextureView() : m_DummyImage->getVkImageView();
-        albedoImageInfo.sampler = albedoTexture ? albedoTexture->getSampler() : m_DummySampler;
-
-        VkDescriptorImageInfo normalImageInfo{};
-        const auto& normalTexture = material->normalTexture.Lock();
-        normalImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        normalImageInfo.imageView = normalTexture ? normalTexture->getTextureView() : m_DummyImage->getVkImageView();
-        normalImageInfo.sampler = normalTexture ? normalTexture->getSampler() : m_DummySampler;
-
-        VkDescriptorImageInfo roughnessMetallicImageInfo{};
-        const auto& roughnessMetallicTexture = material->metallicRoughnessTexture.Lock();
-        roughnessMetallicImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        roughnessMetallicImageInfo.imageView =
-            roughnessMetallicTexture ? roughnessMetallicTexture->getTextureView() : m_DummyImage->getVkImageView();
-        roughnessMetallicImageInfo.sampler =
-            roughnessMetallicTexture ? roughnessMetallicTexture->getSampler() : m_DummySampler;
-
-        VkDescriptorImageInfo emissiveImageInfo{};
-        const auto& emissiveTexture = material->emissiveTexture.Lock();
-        emissiveImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        emissiveImageInfo.imageView =
-            emissiveTexture ? emissiveTexture->getTextureView() : m_DummyImage->getVkImageView();
-        emissiveImageInfo.sampler = emissiveTexture ? emissiveTexture->getSampler() : m_DummySampler;
-
-        VkDescriptorImageInfo specularImageInfo{};
-        const auto& specularTexture = material->specularTexture.Lock();
-        specularImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        specularImageInfo.imageView =
-            specularTexture ? specularTexture->getTextureView() : m_DummyImage->getVkImageView();
-        specularImageInfo.sampler = specularTexture ? specularTexture->getSampler() : m_DummySampler;
-
-        VkDescriptorImageInfo specularColorImageInfo{};
-        const auto& specularColorTexture = material->specularColorTexture.Lock();
-        specularColorImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        specularColorImageInfo.imageView =
-            specularColorTexture ? specularColorTexture->getTextureView() : m_DummyImage->getVkImageView();
-        specularColorImageInfo.sampler = specularColorTexture ? specularColorTexture->getSampler() : m_DummySampler;
-
-        std::array<VkWriteDescriptorSet, 7> descriptorWrites{};
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = material->descriptorSets[i];
-        descriptorWrites[0].dstBinding = 1;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &materialBufferInfo;
-
-        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = material->descriptorSets[i];
-        descriptorWrites[1].dstBinding = 3;
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pImageInfo = &albedoImageInfo;
-
-        descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[2].dstSet = material->descriptorSets[i];
-        descriptorWrites[2].dstBinding = 4; // MIGHT BE WRONG
-        descriptorWrites[2].dstArrayElement = 0;
-        descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[2].descriptorCount = 1;
-        descriptorWrites[2].pImageInfo = &normalImageInfo;
-
-        descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[3].dstSet = material->descriptorSets[i];
-        descriptorWrites[3].dstBinding = 5; // MIGHT BE WRONG
-        descriptorWrites[3].dstArrayElement = 0;
-        descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[3].descriptorCount = 1;
-        descriptorWrites[3].pImageInfo = &roughnessMetallicImageInfo;
-
-        descriptorWrites[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[4].dstSet = material->descriptorSets[i];
-        descriptorWrites[4].dstBinding = 6; // MIGHT BE WRONG
-        descriptorWrites[4].dstArrayElement = 0;
-        descriptorWrites[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[4].descriptorCount = 1;
-        descriptorWrites[4].pImageInfo = &emissiveImageInfo;
-
-        descriptorWrites[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[5].dstSet = material->descriptorSets[i];
-        descriptorWrites[5].dstBinding = 7; // MIGHT BE WRONG
-        descriptorWrites[5].dstArrayElement = 0;
-        descriptorWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[5].descriptorCount = 1;
-        descriptorWrites[5].pImageInfo = &specularImageInfo;
-
-        descriptorWrites[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[6].dstSet = material->descriptorSets[i];
-        descriptorWrites[6].dstBinding = 8; // MIGHT BE WRONG
-        descriptorWrites[6].dstArrayElement = 0;
-        descriptorWrites[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[6].descriptorCount = 1;
-        descriptorWrites[6].pImageInfo = &specularColorImageInfo;
-
-        vkUpdateDescriptorSets(m_Context->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
-                               descriptorWrites.data(), 0, nullptr);
-    }
-}
-
-void RenderManager::createOpaqueObjectDescriptorSets(const std::shared_ptr<Renderer>& renderer)
-{
-    renderer->objectDescriptorSets.resize(m_Context->MAX_FRAMES_IN_FLIGHT);
-
     std::vector<VkDescriptorSetLayout> objectLayouts(m_Context->MAX_FRAMES_IN_FLIGHT,
                                                      m_OpaqueObjectDescriptorSetLayout);
     VkDescriptorSetAllocateInfo objectAllocInfo{};
@@ -1247,48 +1524,132 @@ void RenderManager::createOpaqueObjectDescriptorSets(const std::shared_ptr<Rende
     objectAllocInfo.descriptorSetCount = static_cast<uint32_t>(m_Context->MAX_FRAMES_IN_FLIGHT);
     objectAllocInfo.pSetLayouts = objectLayouts.data();
 
-    VkResult res =
-        vkAllocateDescriptorSets(m_Context->getDevice(), &objectAllocInfo, renderer->objectDescriptorSets.data());
+    std::vector<VkDescriptorSet> objectSets(m_Context->MAX_FRAMES_IN_FLIGHT);
+    VkResult res = vkAllocateDescriptorSets(m_Context->getDevice(), &objectAllocInfo, objectSets.data());
     REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to allocate descriptor sets");
 
     for (size_t i = 0; i < m_Context->MAX_FRAMES_IN_FLIGHT; i++)
     {
-        VkDescriptorBufferInfo objectBufferInfo{};
-        objectBufferInfo.buffer = renderer->objectDataBuffers[i]->GetVkBuffer();
-        objectBufferInfo.offset = 0;
-        objectBufferInfo.range = sizeof(ObjectRenderData);
+        m_FrameData[i].objectDescriptorSet = objectSets[i];
+        resizeObjectDataBuffer(static_cast<int>(i), INITIAL_OBJECT_CAPACITY);
+        resizeIndirectBuffer(static_cast<int>(i), INITIAL_OBJECT_CAPACITY);
+    }
+}
 
-        std::array<VkWriteDescriptorSet, 1> descriptorWrites{};
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = renderer->objectDescriptorSets[i];
-        descriptorWrites[0].dstBinding = 2;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &objectBufferInfo;
+void RenderManager::resizeObjectDataBuffer(int frame, size_t objectCount)
+{
+    // Only called for the frame being recorded (or at startup), its previous submission already passed the fence.
+    size_t capacity = INITIAL_OBJECT_CAPACITY;
+    while (capacity < objectCount)
+        capacity *= 2;
 
-        vkUpdateDescriptorSets(m_Context->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
-                               descriptorWrites.data(), 0, nullptr);
-    }
+    BufferCreateInfo bufCreateInfo;
+    bufCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufCreateInfo.cpuAccess = CpuAccessPattern::SequentialWrite;
+    bufCreateInfo.memoryHint = BufferMemoryHint::CpuToGpu;
+    bufCreateInfo.persistentlyMapped = true;
+    bufCreateInfo.size = sizeof(ObjectRenderData) * capacity;
 
-    m_DirectionalShadowPass.createPerObjectDescriptorSets(m_Context, renderer);
+    m_FrameData[frame].objectDataBuffer = m_Context->createBuffer(bufCreateInfo);
+
+    // Every region is bound through a dynamic offset, so it starts at the storage buffer offset alignment
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_Context->getPhysicalDevice(), &properties);
+    const VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+    const VkDeviceSize regionSize = (sizeof(uint32_t) * capacity + alignment - 1) / alignment * alignment;
+
+    bufCreateInfo.size = regionSize * INSTANCE_REGION_COUNT;
+    m_FrameData[frame].instanceBuffer = m_Context->createBuffer(bufCreateInfo);
+    m_FrameData[frame].instanceRegionSize = regionSize;
+
+    VkDescriptorBufferInfo objectBufferInfo{};
+    objectBufferInfo.buffer = m_FrameData[frame].objectDataBuffer->GetVkBuffer();
+    objectBufferInfo.offset = 0;
+    objectBufferInfo.range = VK_WHOLE_SIZE;
+
+    VkDescriptorBufferInfo instanceBufferInfo{};
+    instanceBufferInfo.buffer = m_FrameData[frame].instanceBuffer->GetVkBuffer();
+    instanceBufferInfo.offset = 0;
+    instanceBufferInfo.range = regionSize;
+
+    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet = m_FrameData[frame].objectDescriptorSet;
+    descriptorWrites[0].dstBinding = 2;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &objectBufferInfo;
+
+    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstSet = m_FrameData[frame].objectDescriptorSet;
+    descriptorWrites[1].dstBinding = 3;
+    descriptorWrites[1].dstArrayElement = 0;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pBufferInfo = &instanceBufferInfo;
+
+    vkUpdateDescriptorSets(m_Context->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
+                           descriptorWrites.data(), 0, nullptr);
+
+    m_DirectionalShadowPass.setObjectDataBuffer(m_Context, frame, m_FrameData[frame].objectDataBuffer,
+                                                m_FrameData[frame].instanceBuffer, regionSize);
 }
 
-void RenderManager::createOpaqueGraphicsPipelines()
+void RenderManager::resizeIndirectBuffer(int frame, size_t commandCount)
 {
-    uint32_t mostUsedFlags = AlbedoTexture | NormalTexture | MetallicRoughnessTexture;
+    size_t capacity = INITIAL_OBJECT_CAPACITY;
+    while (capacity < commandCount)
+        capacity *= 2;
+
+    BufferCreateInfo bufCreateInfo;
+    bufCreateInfo.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    bufCreateInfo.cpuAccess = CpuAccessPattern::SequentialWrite;
+    bufCreateInfo.memoryHint = BufferMemoryHint::CpuToGpu;
+    bufCreateInfo.persistentlyMapped = true;
+    bufCreateInfo.size = sizeof(VkDrawIndexedIndirectCommand) * capacity * INSTANCE_REGION_COUNT;
+    m_FrameData[frame].indirectBuffer = m_Context->createBuffer(bufCreateInfo);
+}
 
-    std::vector<uint32_t> prebakePermutations{
-        0,
-        AlbedoTexture | NormalTexture | MetallicRoughnessTexture | OcclusionTexture,
-        AlbedoTexture | NormalTexture | MetallicRoughnessTexture | OcclusionTexture | EmissiveTexture,
-        NormalTexture | MetallicRoughnessTexture,
-        MetallicRoughnessTexture,
-        AlbedoTexture | NormalTexture,
-    };
+InstanceSlots RenderManager::getInstanceSlots(uint32_t region) const
+{
+    const FrameData& frameData = m_FrameData[m_Context->getCurrentFrame()];
+    const VkDeviceSize offset = frameData.instanceRegionSize * region;
 
-    auto vertShaderCode = Shader::CompileHLSLToSPIRV("Assets/Shaders/vert.vert", mostUsedFlags);
-    auto fragShaderCode = Shader::CompileHLSLToSPIRV("Assets/Shaders/frag.frag", mostUsedFlags);
+    InstanceSlots slots;
+    slots.data = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(frameData.instanceBuffer->GetMappedData()) + offset);
+    slots.dynamicOffset = static_cast<uint32_t>(offset);
+    return slots;
+}
+
+IndirectCommands RenderManager::getIndirectCommands(uint32_t region) const
+{
+    const FrameData& frameData = m_FrameData[m_Context->getCurrentFrame()];
+    const size_t regionCommands = frameData.indirectBuffer->GetSize() / INSTANCE_REGION_COUNT /
+                                  sizeof(VkDrawIndexedIndirectCommand);
+
+    IndirectCommands commands;
+    commands.data =
+        static_cast<VkDrawIndexedIndirectCommand*>(frameData.indirectBuffer->GetMappedData()) + regionCommands * region;
+    commands.buffer = frameData.indirectBuffer->GetVkBuffer();
+    commands.offset = sizeof(VkDrawIndexedIndirectCommand) * regionCommands * region;
+    return commands;
+}
+
+uint32_t RenderManager::getViewInstanceRegion(const std::shared_ptr<Camera>& camera) const
+{
+    const RenderView* view = m_Snapshot.FindView(camera);
+    const uint32_t viewIndex = static_cast<uint32_t>(view - m_Snapshot.views.data());
+    REON_CORE_ASSERT(viewIndex < MAX_CAMERA_COUNT, "More views than instance regions");
+    return SHADOW_INSTANCE_REGION_COUNT + viewIndex;
+}
+
+void RenderManager::createOpaqueGraphicsPipelines()
+{
+    uint32_t mostUsedFlags = BaseMaterialPermutation;
+
+    auto vertShaderCode = Shader::CompileHLSLToSPIRV(OpaqueProgram.vertex, mostUsedFlags);
+    auto fragShaderCode = Shader::CompileHLSLToSPIRV(OpaqueProgram.fragment, mostUsedFlags);
 
     if (vertShaderCode.empty() || fragShaderCode.empty())
     {
@@ -1313,13 +1674,13 @@ void RenderManager::createOpaqueGraphicsPipelines()
 
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    auto bindingDescriptions = VertexLayout::getBindingDescriptions();
+    auto attributeDescriptions = VertexLayout::getAttributeDescriptions();
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -1389,6 +1750,8 @@ void RenderManager::createOpaqueGraphicsPipelines()
         VK_DYNAMIC_STATE_VIEWPORT,
         VK_DYNAMIC_STATE_SCISSOR,
         VK_DYNAMIC_STATE_CULL_MODE,
+        // Formats without color or skin streams bind those as one element with a stride of zero
+        VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE,
     };
 
     VkPipelineDynamicStateCreateInfo dynamicState{};
@@ -1397,7 +1760,7 @@ void RenderManager::createOpaqueGraphicsPipelines()
     dynamicState.pDynamicStates = dynamicStates.data();
 
     std::array<VkDescriptorSetLayout, 3> setLayouts{
-        m_OpaqueGlobalDescriptorSetLayout, m_OpaqueMaterialDescriptorSetLayout, m_OpaqueObjectDescriptorSetLayout};
+        m_OpaqueGlobalDescriptorSetLayout, m_MaterialTable.GetLayout(), m_OpaqueObjectDescriptorSetLayout};
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = setLayouts.size();
@@ -1435,43 +1798,156 @@ void RenderManager::createOpaqueGraphicsPipelines()
     vkDestroyShaderModule(m_Context->getDevice(), fragShaderModule, nullptr);
     vkDestroyShaderModule(m_Context->getDevice(), vertShaderModule, nullptr);
 
-    m_PipelineByMaterialPermutation.insert({mostUsedFlags, m_OpaqueGraphicsPipeline});
+    m_OpaquePipelines.Add(mostUsedFlags, m_OpaqueGraphicsPipeline);
 
-    for (auto permutation : prebakePermutations)
-    {
-        m_PipelineByMaterialPermutation.insert(
-            {permutation, createGraphicsPipeline(m_OpaqueGraphicsPipeline, permutation)});
-    }
+    m_OpaquePipelines.Prebake(OpaquePrebakedPermutations, Application::Get().GetJobSystem());
+}
+
+// Written in front of the VkPipelineCache data. Drivers validate their own header too, but not all of them reliably,
+// and checking here turns a cache from another GPU or driver into a log line instead of undefined behaviour.
+struct PipelineCacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+};
+
+static constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x43504552; // "REPC"
+static constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+
+static PipelineCacheFileHeader makePipelineCacheHeader(const VulkanContext* context)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(context->getPhysicalDevice(), &properties);
+
+    PipelineCacheFileHeader header{};
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.version = PIPELINE_CACHE_VERSION;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    return header;
+}
+
+static std::filesystem::path getPipelineCachePath()
+{
+    const std::filesystem::path& cookedRoot = Application::Get().GetEngineServices().cookedRoot;
+    if (cookedRoot.empty())
+        return {};
+    return cookedRoot / "PipelineCache.bin";
 }
 
 void RenderManager::createPipelineCache()
 {
+    std::vector<char> initialData;
+
+    const std::filesystem::path path = getPipelineCachePath();
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!path.empty() && file)
+    {
+        const std::streamsize fileSize = file.tellg();
+        file.seekg(0);
+
+        const PipelineCacheFileHeader expected = makePipelineCacheHeader(m_Context);
+        PipelineCacheFileHeader header{};
+        if (fileSize >= std::streamsize(sizeof(header)) && file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        {
+            const bool matches = header.magic == expected.magic && header.version == expected.version &&
+                                 header.vendorID == expected.vendorID && header.deviceID == expected.deviceID &&
+                                 header.driverVersion == expected.driverVersion &&
+                                 memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+                                 header.dataSize == uint64_t(fileSize) - sizeof(header);
+            if (matches)
+            {
+                initialData.resize(header.dataSize);
+                if (!file.read(initialData.data(), initialData.size()))
+                    initialData.clear();
+            }
+            else
+            {
+                REON_CORE_WARN("Pipeline cache {0} was written for another device or driver, starting empty",
+                               path.string());
+            }
+        }
+    }
+
     VkPipelineCacheCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = initialData.size();
+    createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
     VkResult res = vkCreatePipelineCache(m_Context->getDevice(), &createInfo, nullptr, &m_PipelineCache);
     REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create pipeline cache");
+
+    if (!initialData.empty())
+        REON_CORE_INFO("Loaded pipeline cache {0} ({1} KB)", path.string(), initialData.size() / 1024);
 }
 
-VkPipeline RenderManager::getPipelineFromFlags(uint32_t flags)
+void RenderManager::loadShaderPack()
 {
-    if (m_PipelineByMaterialPermutation.contains(flags))
-    {
-        return m_PipelineByMaterialPermutation[flags];
-    }
-    else
+    // Cooked projects ship every permutation they use precompiled, so startup never reaches DXC. Without a pack
+    // everything still compiles from source.
+    auto pack =
+        Application::Get().GetEngineServices().resources.GetOrLoad<ShaderPack>(SHADER_PACK_ASSET_ID).Lock();
+    if (pack)
+        REON_CORE_INFO("Loaded shader pack with {0} shader sources", pack->shaders.size());
+    Shader::SetShaderPack(std::move(pack));
+}
+
+void RenderManager::savePipelineCache()
+{
+    const std::filesystem::path path = getPipelineCachePath();
+    if (path.empty())
+        return;
+
+    size_t dataSize = 0;
+    VkResult res = vkGetPipelineCacheData(m_Context->getDevice(), m_PipelineCache, &dataSize, nullptr);
+    if (res != VK_SUCCESS || dataSize == 0)
+        return;
+
+    std::vector<char> data(dataSize);
+    res = vkGetPipelineCacheData(m_Context->getDevice(), m_PipelineCache, &dataSize, data.data());
+    if (res != VK_SUCCESS)
+        return;
+
+    PipelineCacheFileHeader header = makePipelineCacheHeader(m_Context);
+    header.dataSize = dataSize;
+
+    // Written next to the old cache and swapped in, so a crash while saving never leaves a torn file behind
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
     {
-        VkPipeline newPipeline = createGraphicsPipeline(m_OpaqueGraphicsPipeline, flags);
-        m_PipelineByMaterialPermutation[flags] = newPipeline;
-        return newPipeline;
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            REON_CORE_WARN("Could not write pipeline cache {0}", tempPath.string());
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), dataSize);
+        if (!file)
+        {
+            REON_CORE_WARN("Could not write pipeline cache {0}", tempPath.string());
+            return;
+        }
     }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+        REON_CORE_WARN("Could not replace pipeline cache {0}: {1}", path.string(), ec.message());
 }
 
 VkPipeline RenderManager::createGraphicsPipeline(VkPipeline basePipeline, uint32_t flags)
 {
     REON_CORE_INFO("Creating pipeline with flags: {}", flags);
 
-    auto vertShaderCode = Shader::CompileHLSLToSPIRV("Assets/Shaders/vert.vert", flags);
-    auto fragShaderCode = Shader::CompileHLSLToSPIRV("Assets/Shaders/frag.frag", flags);
+    auto vertShaderCode = Shader::CompileHLSLToSPIRV(OpaqueProgram.vertex, flags);
+    auto fragShaderCode = Shader::CompileHLSLToSPIRV(OpaqueProgram.fragment, flags);
 
     if (vertShaderCode.empty() || fragShaderCode.empty())
     {
@@ -1496,13 +1972,13 @@ VkPipeline RenderManager::createGraphicsPipeline(VkPipeline basePipeline, uint32
 
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    auto bindingDescriptions = VertexLayout::getBindingDescriptions();
+    auto attributeDescriptions = VertexLayout::getAttributeDescriptions();
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -1572,6 +2048,7 @@ VkPipeline RenderManager::createGraphicsPipeline(VkPipeline basePipeline, uint32
         VK_DYNAMIC_STATE_VIEWPORT,
         VK_DYNAMIC_STATE_SCISSOR,
         VK_DYNAMIC_STATE_CULL_MODE,
+        VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE,
     };
 
     VkPipelineDynamicStateCreateInfo dynamicState{};
@@ -1598,11 +2075,16 @@ VkPipeline RenderManager::createGraphicsPipeline(VkPipeline basePipeline, uint32
     pipelineInfo.basePipelineIndex = -1;
     pipelineInfo.basePipelineHandle = m_OpaqueGraphicsPipeline;
 
-    VkPipeline pipeline;
+    VkPipeline pipeline = VK_NULL_HANDLE;
 
     VkResult res = vkCreateGraphicsPipelines(
         m_Context->getDevice(), m_PipelineCache, 1, &pipelineInfo, nullptr,
         &pipeline); // TODO: optimise this to only do 1 call to createpipelines instead of one for every permutation
+    if (res != VK_SUCCESS)
+    {
+        REON_CORE_ERROR("Failed to create pipeline with flags: {}", flags);
+        pipeline = VK_NULL_HANDLE;
+    }
 
     vkDestroyShaderModule(m_Context->getDevice(), fragShaderModule, nullptr);
     vkDestroyShaderModule(m_Context->getDevice(), vertShaderModule, nullptr);
@@ -1614,13 +2096,12 @@ void RenderManager::HotReloadShaders()
 {
     vkDeviceWaitIdle(m_Context->getDevice());
 
-    vkDestroyPipelineLayout(m_Context->getDevice(), m_OpaquePipelineLayout, nullptr);
-    for (auto [permutation, pipeline] : m_PipelineByMaterialPermutation)
-    {
-        vkDestroyPipeline(m_Context->getDevice(), pipeline, nullptr);
-    }
+    // The sources changed since the cook, from here on everything compiles from them
+    Shader::SetShaderPack(nullptr);
 
-    m_PipelineByMaterialPermutation.clear();
+    // Background compiles use the layout and the base pipeline, they have to be finished before either goes away
+    m_OpaquePipelines.Clear(m_Context->getDevice());
+    vkDestroyPipelineLayout(m_Context->getDevice(), m_OpaquePipelineLayout, nullptr);
 
     createOpaqueGraphicsPipelines();
 
@@ -1629,7 +2110,7 @@ void RenderManager::HotReloadShaders()
 
 VkDescriptorSet RenderManager::GetEndBuffer(std::shared_ptr<Camera> camera)
 {
-    if (resized || m_DrawCommandsByShaderMaterial.empty())
+    if (resized || m_RenderQueue.Empty())
     {
         return nullptr;
     }
@@ -1644,6 +2125,8 @@ void RenderManager::cleanup()
     {
         deleteForResize(key);
     }
+    releaseTransientImages();
+    freeTransientHeaps();
 
     for (auto& renderer : m_Renderers)
     {
@@ -1651,6 +2134,10 @@ void RenderManager::cleanup()
     }
 
     m_DirectionalShadowPass.cleanup(m_Context);
+    m_TransparentPass.cleanup(m_Context);
+    m_MaterialTable.Cleanup();
+    m_CommandRecorder.Cleanup(m_Context);
+    m_FrameSubmitter.Cleanup(m_Context);
 
     // vkFreeDescriptorSets(m_Context->getDevice(), m_Context->getDescriptorPool(), m_EndDescriptorSets.size(),
     // m_EndDescriptorSets.data());
@@ -1664,15 +2151,20 @@ void RenderManager::cleanup()
 
     vkDestroyDescriptorSetLayout(m_Context->getDevice(), m_EndDescriptorSetLayout, nullptr);
     vkDestroyDescriptorSetLayout(m_Context->getDevice(), m_OpaqueGlobalDescriptorSetLayout, nullptr);
-    vkDestroyDescriptorSetLayout(m_Context->getDevice(), m_OpaqueMaterialDescriptorSetLayout, nullptr);
     vkDestroyDescriptorSetLayout(m_Context->getDevice(), m_OpaqueObjectDescriptorSetLayout, nullptr);
 
-    vkDestroyPipeline(m_Context->getDevice(), m_OpaqueGraphicsPipeline, nullptr);
+    // Includes the base pipeline
+    m_OpaquePipelines.Cleanup(m_Context->getDevice());
     vkDestroyPipelineLayout(m_Context->getDevice(), m_OpaquePipelineLayout, nullptr);
 
     vkDestroyRenderPass(m_Context->getDevice(), m_OpaqueRenderPass, nullptr);
 
     vkDestroyCommandPool(m_Context->getDevice(), m_OpaqueCommandPool, nullptr);
+
+    // Holds every permutation created this session, including the lazily created ones
+    savePipelineCache();
+    vkDestroyPipelineCache(m_Context->getDevice(), m_PipelineCache, nullptr);
+    Shader::SetShaderPack(nullptr);
 }
 
 void RenderManager::setMainLight(std::shared_ptr<Light> light)
@@ -1685,6 +2177,7 @@ void RenderManager::deleteForResize(std::shared_ptr<Camera> camera)
     for (size_t i = 0; i < m_Context->getAmountOfSwapChainImages(); i++)
     {
         vkDestroyFramebuffer(m_Context->getDevice(), m_SwapChainResourcesByCamera[camera][i].framebuffer, nullptr);
+        m_SwapChainResourcesByCamera[camera][i].framebuffer = VK_NULL_HANDLE;
     }
 }
 
@@ -1701,7 +2194,6 @@ void RenderManager::SetRenderDimensions(std::shared_ptr<Camera> camera, int widt
     deleteForResize(camera);
 
     createOpaqueImages(camera);
-    createOpaqueFrameBuffers(camera);
     createEndImages(camera);
 
     std::vector<VkImageView> endImageViewsByCamera;
@@ -7,12 +7,21 @@
 #include "REON/Platform/Vulkan/VulkanContext.h"
 #include "REON/Rendering/LightManager.h"
 #include "REON/ResourceManagement/ResourceManager.h"
+#include "FrameSubmitter.h"
+#include "LightClusterer.h"
+#include "MaterialTable.h"
+#include "ParallelCommandRecorder.h"
+#include "PipelinePermutations.h"
+#include "RenderGraph.h"
+#include "RenderQueue.h"
+#include "RenderSnapshot.h"
 #include "RenderPasses/DirectionalShadowPass.h"
 #include "RenderPasses/TransparentPass.h"
 #include "RenderPasses/UnlitPass.h"
 #include "vulkan/vulkan.h"
 
-#include <set>
+#include <array>
+#include <mutex>
 
 #define MAX_CAMERA_COUNT 10
 
@@ -32,20 +41,49 @@ struct CameraSwapChainResources
 {
     VkDescriptorSet endDescriptorSet;
     ImageHandle endImage = nullptr;
-    VkFramebuffer framebuffer;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
 
     ImageHandle colorResolveImage = nullptr;
 
     ImageHandle depthResolveImage = nullptr;
+};
 
-    ImageHandle msaaColorImage = nullptr;
+// Multisampled targets of a camera. They only live during its opaque pass, so instead of one per swap chain image
+// there is one per camera, placed by the frame graph in memory shared with the other cameras.
+struct CameraTransientImages
+{
+    ImageCreateInfo msaaColorInfo;
+    ImageCreateInfo msaaDepthInfo;
+    RenderGraphImageDesc msaaColorDesc;
+    RenderGraphImageDesc msaaDepthDesc;
 
+    ImageHandle msaaColorImage = nullptr;
     ImageHandle msaaDepthImage = nullptr;
+    // Where the images above were placed, compared against every compiled graph
+    uint32_t msaaColorHeap = RenderGraph::Invalid;
+    uint64_t msaaColorOffset = 0;
+    uint32_t msaaDepthHeap = RenderGraph::Invalid;
+    uint64_t msaaDepthOffset = 0;
+
+    // Handles into this frame's graph
+    bool declared = false;
+    RenderGraph::Resource msaaColor = RenderGraph::Invalid;
+    RenderGraph::Resource msaaDepth = RenderGraph::Invalid;
+    RenderGraph::Pass opaquePass = RenderGraph::Invalid;
+};
+
+struct TransientHeap
+{
+    VmaAllocation allocation = nullptr;
+    RenderGraphHeap layout;
 };
 
 struct CameraData
 {
     BufferHandle globalBuffer = nullptr;
+    // LightCluster ranges of the camera's froxel grid and the light index list they point into
+    BufferHandle lightClusterBuffer = nullptr;
+    BufferHandle lightIndexBuffer = nullptr;
     VkDescriptorSet globalDescriptorSet{VK_NULL_HANDLE};
     VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
 };
@@ -60,6 +98,16 @@ struct FrameData
     VkDescriptorSet lightDescriptorSet{VK_NULL_HANDLE};
     BufferHandle lightDataBuffer = nullptr;
 
+    // ObjectRenderData for every queued draw this frame, in queue order
+    BufferHandle objectDataBuffer = nullptr;
+    // Object indices of the instances of each draw, one region per view so every view keeps its own runs. Region 0
+    // belongs to the shadow pass, region 1 + i to snapshot view i.
+    BufferHandle instanceBuffer = nullptr;
+    VkDeviceSize instanceRegionSize = 0;
+    // VkDrawIndexedIndirectCommand records, with the same per view regions as the instance buffer
+    BufferHandle indirectBuffer = nullptr;
+    VkDescriptorSet objectDescriptorSet{VK_NULL_HANDLE};
+
     FrameData() = default;
     FrameData(const FrameData&) = delete;
     FrameData& operator=(const FrameData&) = delete;
@@ -72,13 +120,36 @@ struct FrameData
     // void* skinMatDataBufferMapped;
 };
 
-using DrawCommandByShaderMaterial = std::unordered_map<AssetId, std::unordered_map<AssetId, std::vector<DrawCommand>>>;
+// Draws rejected by frustum culling in the last frame, out of drawCount queued draws.
+struct CullStats
+{
+    uint32_t drawCount = 0;
+    uint32_t cameraCulled = 0; // editor camera
+    uint32_t shadowCulled = 0; // summed over the shadow cascades
+    uint32_t meshletsCulled = 0; // editor camera, of the draws that survived
+};
+
+// CPU time spent recording the shadow, opaque and transparent passes in the last frame.
+struct RecordStats
+{
+    uint32_t threadCount = 1;
+    float recordMs = 0.0f;
+    // Instanced draws recorded over all passes, at most the number of visible queued draws
+    uint32_t drawCalls = 0;
+    // Share of shadow cascades drawn from their static caster cache, smoothed over the last frames
+    float shadowCacheHitRate = 0.0f;
+};
 
 class RenderManager
 {
   public:
+    // Sync point between simulation and rendering. Applies queued renderer changes and copies everything preRender
+    // and Render read out of the scene, after this the scene may change again while the frame is recorded.
+    void CaptureSnapshot();
     void Render(std::shared_ptr<Camera> camera);
     void preRender();
+    // Hands every pass recorded since preRender to the queue, once per frame after the last camera was rendered.
+    void SubmitFrame();
     void AddRenderer(const std::shared_ptr<Renderer>& renderer);
     void RemoveRenderer(std::shared_ptr<Renderer> renderer);
     void AddAnimator(const std::shared_ptr<Animator>& animator);
@@ -98,22 +169,70 @@ class RenderManager
 
     void setMainLight(std::shared_ptr<Light> light);
 
+    const CullStats& GetCullStats() const
+    {
+        return m_CullStats;
+    }
+    const RecordStats& GetRecordStats() const
+    {
+        return m_RecordStats;
+    }
+    // Number of jobs each pass splits its draws over, 1 records everything inline on the calling thread.
+    void SetRecordingThreadCount(uint32_t threadCount)
+    {
+        m_CommandRecorder.SetThreadCount(threadCount);
+    }
+    uint32_t GetRecordingThreadCount() const
+    {
+        return m_CommandRecorder.GetThreadCount();
+    }
+    // Records the current scene with 1, 2, 4 and 8 threads in turn, framesPerStep frames each, and logs the average
+    // record time of every thread count. The thread count in use before is restored afterwards.
+    void StartRecordBenchmark(uint32_t framesPerStep = 300);
+    bool IsRecordBenchmarkRunning() const
+    {
+        return m_RecordBenchmark.step < RecordBenchmark::ThreadCounts.size();
+    }
+    // Thread count being measured, only meaningful while the benchmark runs
+    uint32_t GetRecordBenchmarkThreadCount() const
+    {
+        return RecordBenchmark::ThreadCounts[std::min(m_RecordBenchmark.step, RecordBenchmark::ThreadCounts.size() - 1)];
+    }
+    const RenderSnapshot& GetSnapshot() const
+    {
+        return m_Snapshot;
+    }
+    bool HasSnapshot() const
+    {
+        return m_HasSnapshot;
+    }
+
     RenderMode renderMode = LIT;
 
   private:
     void createCommandBuffers();
 
-    void RenderOpaques(std::shared_ptr<Camera> camera);
-    void RenderTransparents(std::shared_ptr<Camera> camera);
+    void RenderOpaques(const RenderView& view);
+    void RenderTransparents(const RenderView& view);
     void RenderPostProcessing();
     void GenerateShadows();
+    void updateShadowCascades();
     void GenerateMainLightShadows();
     void GenerateAdditionalShadows();
     void RenderSkyBox();
     void InitializeSkyBox();
-    std::vector<LightData> GetLightingBuffer();
-    void setGlobalData(std::shared_ptr<Camera> camera);
-    void prepareDrawCommands(int currentFrame);
+    void captureLights();
+    void writeLightData();
+    void setGlobalData(std::shared_ptr<Camera> camera, const RenderView& view);
+    void captureView(const std::shared_ptr<Camera>& camera);
+    void applyPendingChanges();
+    void prepareDrawCommands();
+    void writeObjectData();
+    void buildFrameGraph();
+    void declareCameraPasses(const std::shared_ptr<Camera>& camera, int imageIndex, RenderGraph::Resource shadowMap);
+    void updateTransientImages();
+    void releaseTransientImages();
+    void freeTransientHeaps();
 
     void deleteForResize(std::shared_ptr<Camera> camera);
 
@@ -130,24 +249,76 @@ class RenderManager
     void createOpaqueDescriptorSetLayout();
     void createOpaqueGlobalDescriptorSets(std::shared_ptr<Camera> camera);
     void createGlobalBuffers(std::shared_ptr<Camera> camera);
-    void createOpaqueMaterialDescriptorSets(std::shared_ptr<Material> material);
-    void createOpaqueObjectDescriptorSets(const std::shared_ptr<Renderer>& renderer);
+    void createObjectDataDescriptorSets();
+    void resizeObjectDataBuffer(int frame, size_t objectCount);
+    void resizeIndirectBuffer(int frame, size_t commandCount);
+    void resizeLightBuffer(int frame, size_t lightCount);
+    void resizeLightIndexBuffer(int frame, const std::shared_ptr<Camera>& camera, size_t indexCount);
+    void writeLightDescriptors(int frame, const std::shared_ptr<Camera>& camera);
+    InstanceSlots getInstanceSlots(uint32_t region) const;
+    IndirectCommands getIndirectCommands(uint32_t region) const;
+    uint32_t getViewInstanceRegion(const std::shared_ptr<Camera>& camera) const;
     void createOpaqueGraphicsPipelines();
     void createPipelineCache();
+    void savePipelineCache();
+    void loadShaderPack();
     void createEndImages(std::shared_ptr<Camera> camera);
-    VkPipeline getPipelineFromFlags(uint32_t flags);
     VkPipeline createGraphicsPipeline(VkPipeline basePipeline, uint32_t flags);
 
   private:
     const VulkanContext* m_Context;
 
-    VkPipelineCache m_PipelineCache; // TODO: STORE THIS ON DISK
+    // Shared by every pass, loaded from and written back to the cooked directory
+    VkPipelineCache m_PipelineCache = VK_NULL_HANDLE;
 
     PFN_vkCmdSetPolygonModeEXT vkCmdSetPolygonModeEXT;
 
-    std::unordered_map<uint32_t, VkPipeline> m_PipelineByMaterialPermutation;
-    DrawCommandByShaderMaterial m_DrawCommandsByShaderMaterial;
-    std::set<AssetId> materials;
+    // Unknown permutations compile in the background, materials draw with a fallback until they are ready
+    PipelinePermutations m_OpaquePipelines;
+    RenderQueue m_RenderQueue;
+    // Set 1 of the opaque and transparent passes, its records are indexed by the queue's material slots
+    MaterialTable m_MaterialTable;
+    CullStats m_CullStats;
+
+    ParallelCommandRecorder m_CommandRecorder;
+    std::vector<MaterialBinding> m_MaterialBindings;
+    RecordStats m_RecordStats;
+
+    struct RecordBenchmark
+    {
+        static constexpr std::array<uint32_t, 4> ThreadCounts{1, 2, 4, 8};
+        // Skipped after every switch, the recorder allocates secondary buffers for the new chunks first
+        static constexpr uint32_t WarmupFrames = 30;
+
+        size_t step = ThreadCounts.size();
+        uint32_t framesPerStep = 0;
+        uint32_t frame = 0;
+        double totalMs = 0.0;
+        uint32_t restoreThreadCount = 1;
+        std::array<float, ThreadCounts.size()> averageMs{};
+    };
+    RecordBenchmark m_RecordBenchmark;
+    void stepRecordBenchmark();
+
+    // Rebuilt every frame in preRender, decides the barriers between the passes and where transient images live
+    RenderGraph m_FrameGraph;
+    std::unordered_map<std::shared_ptr<Camera>, CameraTransientImages> m_TransientImagesByCamera;
+    std::unordered_map<std::shared_ptr<Camera>, LightClusterer> m_LightClusterers;
+    ShadowCascadeSettings m_ShadowCascadeSettings;
+    std::vector<TransientHeap> m_TransientHeaps;
+
+    RenderSnapshot m_Snapshot;
+    bool m_HasSnapshot = false;
+
+    // Renderers and animators are attached from the simulation, which may be running while a frame is recorded. The
+    // changes are queued here and applied at the next CaptureSnapshot.
+    struct PendingRendererChange
+    {
+        std::shared_ptr<Renderer> renderer;
+        bool add;
+    };
+    std::mutex m_PendingMutex;
+    std::vector<PendingRendererChange> m_PendingRenderers;
 
     std::vector<FrameData> m_FrameData;
     std::unordered_map<std::shared_ptr<Camera>, std::vector<CameraSwapChainResources>> m_SwapChainResourcesByCamera;
@@ -156,20 +327,20 @@ class RenderManager
     VkSampler m_EndSampler;
 
     // OPAQUE PIPELINE
-    VkCommandPool m_OpaqueCommandPool;                         //
-    VkRenderPass m_OpaqueRenderPass;                           //
-    VkDescriptorSetLayout m_OpaqueGlobalDescriptorSetLayout;   //
-    VkDescriptorSetLayout m_OpaqueMaterialDescriptorSetLayout; //
-    VkDescriptorSetLayout m_OpaqueObjectDescriptorSetLayout;   //
-    VkPipelineLayout m_OpaquePipelineLayout;                   //
-    VkPipeline m_OpaqueGraphicsPipeline;                       //
+    VkCommandPool m_OpaqueCommandPool;                       //
+    VkRenderPass m_OpaqueRenderPass;                         //
+    VkDescriptorSetLayout m_OpaqueGlobalDescriptorSetLayout; //
+    VkDescriptorSetLayout m_OpaqueObjectDescriptorSetLayout; //
+    VkPipelineLayout m_OpaquePipelineLayout;                 //
+    VkPipeline m_OpaqueGraphicsPipeline;                     //
 
     // Directional Shadows
     DirectionalShadowPass m_DirectionalShadowPass;
-    std::vector<VkSemaphore> m_DirectionalShadowsGenerated;
 
     TransparentPass m_TransparentPass;
-    std::vector<VkSemaphore> m_OpaquePassDone;
+
+    // Every pass of the frame goes out in one submission, ordered on a timeline semaphore
+    FrameSubmitter m_FrameSubmitter;
 
     UnlitPass m_UnlitPass;
 
@@ -179,6 +350,13 @@ class RenderManager
     VkSampler m_DummySampler;
 
     int m_NumImages = 0;
+    const size_t INITIAL_OBJECT_CAPACITY = 1024;
+    const size_t INITIAL_LIGHT_CAPACITY = 64;
+    const size_t INITIAL_LIGHT_INDEX_CAPACITY = 4096;
+    // Two instance regions per shadow cascade, for its static and its dynamic casters, the views follow
+    static constexpr uint32_t FIRST_SHADOW_INSTANCE_REGION = 0;
+    static constexpr uint32_t SHADOW_INSTANCE_REGION_COUNT = 2 * ShadowCascades::MaxCascades;
+    static constexpr uint32_t INSTANCE_REGION_COUNT = SHADOW_INSTANCE_REGION_COUNT + MAX_CAMERA_COUNT;
     std::vector<VkCommandBuffer> m_CmdBufs;
 
     // OLD (some still used, but new things (vulkan) are above this, will filter out whats not used anymore once i get
@@ -192,8 +370,6 @@ class RenderManager
 
     // Lighting
     std::shared_ptr<LightManager> m_LightManager;
-    glm::mat4 m_MainLightView;
-    glm::mat4 m_MainLightProj;
     std::vector<std::shared_ptr<Light>> m_PointLights;
 
     // Shadows
@@ -1,10 +1,13 @@
 #include "reonpch.h"
 #include "DirectionalShadowPass.h"
+#include "REON/Rendering/FrameSubmitter.h"
+#include "REON/Rendering/ParallelCommandRecorder.h"
 #include "REON/Rendering/Shader.h"
+#include "REON/Rendering/ShaderPrograms.h"
 #include "REON/Rendering/Structs/Vertex.h"
 
 namespace REON {
-	void DirectionalShadowPass::Init(const VulkanContext* context)
+	void DirectionalShadowPass::Init(const VulkanContext* context, VkPipelineCache pipelineCache)
 	{
 		context->createCommandPool(m_CommandPool, context->findQueueFamilies(context->getPhysicalDevice()).graphicsFamily.value());
 		createCommandBuffers(context);
@@ -12,23 +15,137 @@ namespace REON {
 		createRenderPass(context);
 		createFrameBuffers(context);
 		createDescriptorSetLayout(context);
-		createGraphicsPipeline(context);
+		createGraphicsPipeline(context, pipelineCache);
 		createPerLightBuffers(context);
+		createPerObjectDescriptorSets(context);
 	}
 
-	void DirectionalShadowPass::render(const VulkanContext* context, std::vector<std::shared_ptr<Renderer>> renderers, glm::mat4 mainLightViewProj, VkSemaphore signalSemaphore)
+	RenderGraph::Resource DirectionalShadowPass::declare(RenderGraph& graph, int imageIndex)
 	{
+		RenderGraph::Resource shadowMap = graph.ImportImage("MainLightShadowMap", m_DepthImages[imageIndex]->getVkImage(),
+			VK_IMAGE_ASPECT_DEPTH_BIT);
+
+		// The cached static casters are copied in first, the dynamic ones are drawn on top of them
+		m_CopyPass = graph.AddPass("ShadowCacheCopy");
+		graph.Write(m_CopyPass, shadowMap, RenderGraphAccess::TransferDestination);
+
+		m_GraphPass = graph.AddPass("DirectionalShadow");
+		graph.Attachment(m_GraphPass, shadowMap, RenderGraphAccess::DepthAttachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+		return shadowMap;
+	}
+
+	void DirectionalShadowPass::placeCascades(std::span<ShadowCascade> cascades, const glm::mat4& lightView,
+		uint64_t staticVersion)
+	{
+		REON_CORE_ASSERT(cascades.size() <= ShadowCascades::MaxCascades, "Too many shadow cascades");
+
+		uint32_t hits = 0;
+		for (uint32_t cascade = 0; cascade < cascades.size(); cascade++) {
+			CachedCascade& cached = m_CachedCascades[cascade];
+			if (cached.valid && cached.staticVersion == staticVersion && cached.lightView == lightView &&
+				ShadowCascades::PlaceInCacheRegion(cascades[cascade], cached.region, lightView, cached.texelOffset)) {
+				hits++;
+				continue;
+			}
+
+			// Centered on the cascade again, so it can move the full margin in any direction
+			cached.region = ShadowCascades::FitCacheRegion(cascades[cascade], lightView, CACHE_MARGIN_TEXELS);
+			cached.lightView = lightView;
+			cached.staticVersion = staticVersion;
+			cached.valid = true;
+			cached.redraw = true;
+			const bool placed = ShadowCascades::PlaceInCacheRegion(cascades[cascade], cached.region, lightView,
+				cached.texelOffset);
+			REON_CORE_ASSERT(placed, "A cascade has to fit the cache region fitted around it");
+		}
+
+		if (!cascades.empty())
+			m_CacheHitRate += (float(hits) / float(cascades.size()) - m_CacheHitRate) * 0.05f;
+	}
+
+	void DirectionalShadowPass::render(const VulkanContext* context, const RenderQueue& queue, const RenderGraph& graph,
+		ParallelCommandRecorder& recorder, FrameSubmitter& submitter, std::span<const ShadowCascade> cascades,
+		std::span<const ShadowCascadeRegions> regions)
+	{
+		REON_CORE_ASSERT(cascades.size() <= ShadowCascades::MaxCascades && regions.size() >= cascades.size(),
+			"Every shadow cascade needs its own instance regions");
+
 		int currentFrame = context->getCurrentFrame();
 		int currentImageIndex = context->getCurrentImageIndex();
+		VkCommandBuffer commandBuffer = m_CommandBuffers[currentFrame];
 
 		VkCommandBufferBeginInfo beginInfo{};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 		beginInfo.flags = 0;
 		beginInfo.pInheritanceInfo = nullptr;
 
-		VkResult res = vkBeginCommandBuffer(m_CommandBuffers[currentFrame], &beginInfo);
+		VkResult res = vkBeginCommandBuffer(commandBuffer, &beginInfo);
 		REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to begin recording command buffer");
 
+		// Cascade i's matrix sits at i * m_CascadeStride and its cache region's MaxCascades slots later, picked through
+		// the dynamic offset of the per light set
+		uint8_t* cascadeMatrices = static_cast<uint8_t*>(m_PerLightBuffers[currentFrame]->GetMappedData());
+		for (size_t cascade = 0; cascade < cascades.size(); cascade++) {
+			memcpy(cascadeMatrices + cascade * m_CascadeStride, &cascades[cascade].viewProj, sizeof(glm::mat4));
+			memcpy(cascadeMatrices + (ShadowCascades::MaxCascades + cascade) * m_CascadeStride,
+				&m_CachedCascades[cascade].region.viewProj, sizeof(glm::mat4));
+		}
+
+		const std::span<const RenderQueueItem> items = queue.GetBucket(RenderBucket::Opaque);
+		const uint32_t itemCount = static_cast<uint32_t>(items.size());
+		const uint cascadeResolution = getCascadeResolution();
+		const uint cacheResolution = getCacheResolution();
+
+		// Static casters are only redrawn into a cache once placeCascades moved its region
+		for (uint32_t cascade = 0; cascade < cascades.size(); cascade++) {
+			CachedCascade& cached = m_CachedCascades[cascade];
+			if (!cached.redraw)
+				continue;
+			cached.redraw = false;
+
+			VkRenderPassBeginInfo cacheInfo{};
+			cacheInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			cacheInfo.renderPass = m_CacheRenderPass;
+			cacheInfo.framebuffer = m_CacheFramebuffers[cascade];
+			cacheInfo.renderArea.offset = { 0,0 };
+			cacheInfo.renderArea.extent = { cacheResolution, cacheResolution };
+
+			VkClearValue clearValue{};
+			clearValue.depthStencil = { 1.0f, 0 };
+			cacheInfo.clearValueCount = 1;
+			cacheInfo.pClearValues = &clearValue;
+
+			const VkRect2D tile{ { 0,0 }, { cacheResolution, cacheResolution } };
+			const ShadowCascadeRegions& cascadeRegions = regions[cascade];
+			vkCmdBeginRenderPass(commandBuffer, &cacheInfo, recorder.GetSubpassContents(itemCount));
+			recorder.Record(context, commandBuffer, m_CacheRenderPass, 0, cacheInfo.framebuffer, itemCount,
+				[&](VkCommandBuffer recordBuffer, uint32_t begin, uint32_t end) {
+					vkCmdBindPipeline(recordBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+					recorder.CountDraws(recordCascade(context, recordBuffer, queue, items, begin, end, cascade,
+						ShadowCascades::MaxCascades + cascade, CasterFilter::Static, tile, cascadeRegions.staticSlots,
+						cascadeRegions.staticCommands));
+				});
+			vkCmdEndRenderPass(commandBuffer);
+		}
+
+		// Every frame starts from the cached static depth of each cascade, copied from where the cascade sits in its
+		// cache region into its tile
+		graph.RecordBarriersBefore(commandBuffer, m_CopyPass);
+		for (uint32_t cascade = 0; cascade < cascades.size(); cascade++) {
+			const glm::uvec2 texelOffset = m_CachedCascades[cascade].texelOffset;
+			VkImageCopy copy{};
+			copy.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 };
+			copy.srcOffset = { static_cast<int32_t>(texelOffset.x), static_cast<int32_t>(texelOffset.y), 0 };
+			copy.dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 };
+			copy.dstOffset = { static_cast<int32_t>((cascade % CASCADES_PER_ROW) * cascadeResolution),
+				static_cast<int32_t>((cascade / CASCADES_PER_ROW) * cascadeResolution), 0 };
+			copy.extent = { cascadeResolution, cascadeResolution, 1 };
+			vkCmdCopyImage(commandBuffer, m_CacheImages[cascade]->getVkImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				m_DepthImages[currentImageIndex]->getVkImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+		}
+		graph.RecordBarriersAfter(commandBuffer, m_CopyPass);
+
 		VkRenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 		renderPassInfo.renderPass = m_RenderPass;
@@ -36,128 +153,99 @@ namespace REON {
 		renderPassInfo.renderArea.offset = { 0,0 };
 		renderPassInfo.renderArea.extent = { MAIN_SHADOW_WIDTH, MAIN_SHADOW_HEIGHT };
 
-		std::array<VkClearValue, 1> clearValues{};
-		clearValues[0].depthStencil = { 1.0f, 0 };
-		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		renderPassInfo.pClearValues = clearValues.data();
-
-		VkImageMemoryBarrier barrier{};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = m_DepthImages[currentImageIndex]->getVkImage();
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-		vkCmdPipelineBarrier(m_CommandBuffers[currentFrame],
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-			0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier);
-
-		vkCmdBeginRenderPass(m_CommandBuffers[currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		vkCmdBindPipeline(m_CommandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
-
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(MAIN_SHADOW_WIDTH);
-		viewport.height = static_cast<float>(MAIN_SHADOW_HEIGHT);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(m_CommandBuffers[currentFrame], 0, 1, &viewport);
-
-		VkRect2D scissor{};
-		scissor.offset = { 0,0 };
-		scissor.extent = { MAIN_SHADOW_WIDTH, MAIN_SHADOW_HEIGHT };
-		vkCmdSetScissor(m_CommandBuffers[currentFrame], 0, 1, &scissor);
-
-		m_PerLightBuffers[currentFrame]->Write(&mainLightViewProj, sizeof(mainLightViewProj));
+		// The shadow map is read by the opaque passes, the transition to shader read happens in front of them
+		graph.RecordBarriersBefore(commandBuffer, m_GraphPass);
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, recorder.GetSubpassContents(itemCount));
+
+		// Only the dynamic casters are drawn over the copied cache, every cascade into its own tile
+		auto recordDraws = [&](VkCommandBuffer recordBuffer, uint32_t begin, uint32_t end) {
+			vkCmdBindPipeline(recordBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+			uint32_t drawCount = 0;
+			for (uint32_t cascade = 0; cascade < cascades.size(); cascade++) {
+				const VkRect2D tile{ { static_cast<int32_t>((cascade % CASCADES_PER_ROW) * cascadeResolution),
+					static_cast<int32_t>((cascade / CASCADES_PER_ROW) * cascadeResolution) },
+					{ cascadeResolution, cascadeResolution } };
+				drawCount += recordCascade(context, recordBuffer, queue, items, begin, end, cascade, cascade,
+					CasterFilter::Dynamic, tile, regions[cascade].dynamicSlots, regions[cascade].dynamicCommands);
+			}
+			recorder.CountDraws(drawCount);
+		};
 
-		for (const auto& renderer : renderers) {
+		recorder.Record(context, commandBuffer, m_RenderPass, 0, renderPassInfo.framebuffer, itemCount, recordDraws);
 
-			for (const auto& cmd : renderer->drawCommands) {
-                auto mesh = cmd.mesh.Lock();
-                if (!mesh)
-                    continue;
+		vkCmdEndRenderPass(commandBuffer);
 
-				auto mat = cmd.material.Lock();
-                if (!mat)
-                    continue;
+		graph.RecordBarriersAfter(commandBuffer, m_GraphPass);
 
-				if (!(mat->blendingMode == Mask || mat->renderingMode == Opaque))
-					continue;
+		res = vkEndCommandBuffer(commandBuffer);
+		REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to record command buffer");
 
-				std::array<VkDescriptorSet, 2> descriptorSets{ m_PerLightDescriptorSets[currentFrame], cmd.owner->shadowObjectDescriptorSets[context->getCurrentFrame()] };
-				auto modelMatrix = cmd.owner->getModelMatrix();
-				cmd.owner->shadowObjectDataBuffers[context->getCurrentFrame()]->Write(&modelMatrix, sizeof(glm::mat4));
+		submitter.AddPass(commandBuffer, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT);
+	}
 
-				VkBuffer vertexBuffers[] = {mesh->m_VertexBuffer->GetVkBuffer()};
-				VkDeviceSize offsets[] = { 0 };
-				vkCmdBindVertexBuffers(m_CommandBuffers[currentFrame], 0, 1, vertexBuffers, offsets);
+	uint32_t DirectionalShadowPass::recordCascade(const VulkanContext* context, VkCommandBuffer commandBuffer,
+		const RenderQueue& queue, std::span<const RenderQueueItem> items, uint32_t begin, uint32_t end, uint32_t cascade,
+		uint32_t matrix, CasterFilter filter, const VkRect2D& tile, const InstanceSlots& slots,
+		const IndirectCommands& commands) const
+	{
+		const int currentFrame = context->getCurrentFrame();
+		const CullView cullView = GetShadowCascadeView(cascade);
 
-				vkCmdBindIndexBuffer(m_CommandBuffers[currentFrame], mesh->m_IndexBuffer->GetVkBuffer(), 0,
-                                     VK_INDEX_TYPE_UINT32);
+		VkViewport viewport{};
+		viewport.x = static_cast<float>(tile.offset.x);
+		viewport.y = static_cast<float>(tile.offset.y);
+		viewport.width = static_cast<float>(tile.extent.width);
+		viewport.height = static_cast<float>(tile.extent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
 
-				vkCmdBindDescriptorSets(m_CommandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, descriptorSets.size(), descriptorSets.data(), 0, nullptr);
-				vkCmdDrawIndexed(m_CommandBuffers[currentFrame], static_cast<uint32_t>(cmd.indexCount), 1, cmd.startIndex, 0, 0);
+		const std::array<VkDescriptorSet, 2> descriptorSets{ m_PerLightDescriptorSets[currentFrame], m_PerObjectDescriptorSets[currentFrame] };
+		const std::array<uint32_t, 2> dynamicOffsets{ static_cast<uint32_t>(matrix * m_CascadeStride), slots.dynamicOffset };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &tile);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, descriptorSets.size(), descriptorSets.data(),
+			dynamicOffsets.size(), dynamicOffsets.data());
+
+		// One pipeline and no material state, so the chunk only splits its indirect draw when the geometry block changes
+		IndirectDrawBatch batch(commands, queue.GetCommandIndex(items[begin]), context->supportsMultiDrawIndirect());
+		uint32_t boundMeshSlot = UINT32_MAX;
+		uint32_t boundBlock = UINT32_MAX;
+		GeometryAllocation geometry;
+		uint32_t drawCount = 0;
+
+		for (uint32_t i = begin; i < end;) {
+			const RenderQueueItem& item = items[i];
+			if (!queue.IsVisible(item, cullView, filter)) {
+				i++;
+				continue;
 			}
 
+			const DrawCommand& cmd = queue.GetCommand(item);
+			// Copies of this draw that only differ in their object data become instances of it
+			const uint32_t instanceCount = queue.GatherInstances(items, i, end, cullView, slots, i, filter);
+
+			const uint32_t meshSlot = DrawKey::GetMeshSlot(item.key);
+			if (meshSlot != boundMeshSlot) {
+				boundMeshSlot = meshSlot;
+				const std::shared_ptr<Mesh> mesh = cmd.mesh.Lock();
+				geometry = mesh ? mesh->geometry : GeometryAllocation{};
+				if (geometry.IsValid() && geometry.block != boundBlock) {
+					drawCount += batch.Flush(commandBuffer);
+					context->getGeometryPool()->BindPositions(commandBuffer, geometry.block);
+					boundBlock = geometry.block;
+				}
+			}
 
+			if (!geometry.IsValid())
+				continue;
 
-			//set object buffers (model matrix)
+			// The level of detail the camera sees, so objects do not shadow themselves with a different surface
+			const DrawRange& range = queue.GetDrawRange(item);
+			batch.Add({ range.indexCount, instanceCount, geometry.firstIndex + range.startIndex,
+				static_cast<int32_t>(geometry.vertexOffset), queue.GetObjectIndex(item) });
 		}
-
-		vkCmdEndRenderPass(m_CommandBuffers[currentFrame]);
-
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = m_DepthImages[currentImageIndex]->getVkImage();
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-		barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		vkCmdPipelineBarrier(m_CommandBuffers[currentFrame],
-			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier);
-
-		res = vkEndCommandBuffer(m_CommandBuffers[currentFrame]);
-		REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to record command buffer");
-
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_CommandBuffers[currentFrame];
-
-		VkSemaphore signalSemaphores[] = { signalSemaphore };
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = signalSemaphores;
-
-		res = vkQueueSubmit(context->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-		REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to submit draw command buffer");
-
+		return drawCount + batch.Flush(commandBuffer);
 	}
 
 	void DirectionalShadowPass::cleanup(const VulkanContext* context)
@@ -165,6 +253,9 @@ namespace REON {
 		for (int i = 0; i < context->getAmountOfSwapChainImages(); i++) {
 			vkDestroyFramebuffer(context->getDevice(), m_Framebuffers[i], nullptr);
 		}
+		for (VkFramebuffer framebuffer : m_CacheFramebuffers) {
+			vkDestroyFramebuffer(context->getDevice(), framebuffer, nullptr);
+		}
 
 		vkDestroySampler(context->getDevice(), m_DepthImageSampler, nullptr);
 
@@ -175,6 +266,7 @@ namespace REON {
 		vkDestroyPipelineLayout(context->getDevice(), m_PipelineLayout, nullptr);
 
 		vkDestroyRenderPass(context->getDevice(), m_RenderPass, nullptr);
+		vkDestroyRenderPass(context->getDevice(), m_CacheRenderPass, nullptr);
 		
 		vkDestroyCommandPool(context->getDevice(), m_CommandPool, nullptr);
 	}
@@ -203,12 +295,22 @@ namespace REON {
         createInfo.width = MAIN_SHADOW_WIDTH;
         createInfo.height = MAIN_SHADOW_HEIGHT;
         createInfo.format = context->findDepthFormat();
-        createInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        createInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
 		for (int i = 0; i < swapChainImageCount; i++) {
             m_DepthImages[i] = context->createImage(createInfo);
 		}
 
+		// One cache per cascade, shared by all frames since it only changes when it is redrawn
+		ImageCreateInfo cacheInfo = createInfo;
+		cacheInfo.width = getCacheResolution();
+		cacheInfo.height = getCacheResolution();
+		cacheInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+		for (ImageHandle& cacheImage : m_CacheImages) {
+			cacheImage = context->createImage(cacheInfo);
+		}
+
 		VkSamplerCreateInfo samplerInfo{};
 		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
 		samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -242,11 +344,12 @@ namespace REON {
 		VkAttachmentDescription depthAttachment{};
 		depthAttachment.format = context->findDepthFormat();
 		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		// Loads the static depth the copy pass put in, the graph has moved it to the attachment layout by then
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
 		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 		depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 		VkAttachmentReference depthAttachmentRef{};
@@ -278,6 +381,34 @@ namespace REON {
 
 		VkResult res = vkCreateRenderPass(context->getDevice(), &renderPassInfo, nullptr, &m_RenderPass);
 		REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create render pass")
+
+		// The caches live outside the render graph, so their pass handles its own synchronization: the previous copy
+		// out of a cache has to finish before it is cleared, and the new depth has to land before the next copy.
+		VkAttachmentDescription cacheAttachment = depthAttachment;
+		cacheAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		cacheAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		cacheAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+		std::array<VkSubpassDependency, 2> cacheDependencies{};
+		cacheDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		cacheDependencies[0].dstSubpass = 0;
+		cacheDependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		cacheDependencies[0].srcAccessMask = 0;
+		cacheDependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		cacheDependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		cacheDependencies[1].srcSubpass = 0;
+		cacheDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		cacheDependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		cacheDependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		cacheDependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		cacheDependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		renderPassInfo.pAttachments = &cacheAttachment;
+		renderPassInfo.dependencyCount = static_cast<uint32_t>(cacheDependencies.size());
+		renderPassInfo.pDependencies = cacheDependencies.data();
+
+		res = vkCreateRenderPass(context->getDevice(), &renderPassInfo, nullptr, &m_CacheRenderPass);
+		REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create render pass")
 	}
 
 	void DirectionalShadowPass::createFrameBuffers(const VulkanContext* context)
@@ -301,13 +432,29 @@ namespace REON {
 			VkResult res = vkCreateFramebuffer(context->getDevice(), &framebufferInfo, nullptr, &m_Framebuffers[i]);
 			REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create framebuffer");
 		}
+
+		for (size_t i = 0; i < m_CacheImages.size(); i++) {
+			VkImageView attachment = m_CacheImages[i]->getVkImageView();
+
+			VkFramebufferCreateInfo framebufferInfo{};
+			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferInfo.renderPass = m_CacheRenderPass;
+			framebufferInfo.attachmentCount = 1;
+			framebufferInfo.pAttachments = &attachment;
+			framebufferInfo.width = getCacheResolution();
+			framebufferInfo.height = getCacheResolution();
+			framebufferInfo.layers = 1;
+
+			VkResult res = vkCreateFramebuffer(context->getDevice(), &framebufferInfo, nullptr, &m_CacheFramebuffers[i]);
+			REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create framebuffer");
+		}
 	}
 
 	void DirectionalShadowPass::createDescriptorSetLayout(const VulkanContext* context)
 	{
 		VkDescriptorSetLayoutBinding perLightLayoutBinding{};
 		perLightLayoutBinding.binding = 0;
-		perLightLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		perLightLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		perLightLayoutBinding.descriptorCount = 1;
 		perLightLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 		perLightLayoutBinding.pImmutableSamplers = nullptr;
@@ -322,24 +469,32 @@ namespace REON {
 
 		VkDescriptorSetLayoutBinding perObjectLayoutBinding{};
 		perObjectLayoutBinding.binding = 1;
-		perObjectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		perObjectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 		perObjectLayoutBinding.descriptorCount = 1;
 		perObjectLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 		perObjectLayoutBinding.pImmutableSamplers = nullptr;
 
+		VkDescriptorSetLayoutBinding instanceLayoutBinding{};
+		instanceLayoutBinding.binding = 2;
+		instanceLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		instanceLayoutBinding.descriptorCount = 1;
+		instanceLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		instanceLayoutBinding.pImmutableSamplers = nullptr;
+
+		std::array<VkDescriptorSetLayoutBinding, 2> perObjectBindings{ perObjectLayoutBinding, instanceLayoutBinding };
 		VkDescriptorSetLayoutCreateInfo shadowLayoutInfo{};
 		shadowLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		shadowLayoutInfo.bindingCount = 1;
-		shadowLayoutInfo.pBindings = &perObjectLayoutBinding;
+		shadowLayoutInfo.bindingCount = static_cast<uint32_t>(perObjectBindings.size());
+		shadowLayoutInfo.pBindings = perObjectBindings.data();
 
 		res = vkCreateDescriptorSetLayout(context->getDevice(), &shadowLayoutInfo, nullptr, &m_PerObjectDescriptorSetLayout);
 		REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create descriptor set layout");
 	}
 
-	void DirectionalShadowPass::createGraphicsPipeline(const VulkanContext* context)
+	void DirectionalShadowPass::createGraphicsPipeline(const VulkanContext* context, VkPipelineCache pipelineCache)
 	{
-		auto vertShaderCode = Shader::CompileHLSLToSPIRV("Assets/Shaders/DirectionalShadow.vert");
-		auto fragShaderCode = Shader::CompileHLSLToSPIRV("Assets/Shaders/DirectionalShadow.frag");
+		auto vertShaderCode = Shader::CompileHLSLToSPIRV(DirectionalShadowProgram.vertex);
+		auto fragShaderCode = Shader::CompileHLSLToSPIRV(DirectionalShadowProgram.fragment);
 
 		VkShaderModule vertShaderModule = context->createShaderModule(vertShaderCode);
 		VkShaderModule fragShaderModule = context->createShaderModule(fragShaderCode);
@@ -358,15 +513,16 @@ namespace REON {
 
 		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-		auto bindingDescription = Vertex::getBindingDescription();
-		auto attributeDescriptions = Vertex::getAttributeDescriptions();
+		// Depth only, the position stream is all it fetches
+		auto bindingDescription = VertexLayout::getPositionBindingDescription();
+		auto attributeDescription = VertexLayout::getPositionAttributeDescription();
 
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		vertexInputInfo.vertexBindingDescriptionCount = 1;
 		vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+		vertexInputInfo.vertexAttributeDescriptionCount = 1;
+		vertexInputInfo.pVertexAttributeDescriptions = &attributeDescription;
 
 		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -468,7 +624,7 @@ namespace REON {
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 		pipelineInfo.basePipelineIndex = -1;
 
-		res = vkCreateGraphicsPipelines(context->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_GraphicsPipeline);
+		res = vkCreateGraphicsPipelines(context->getDevice(), pipelineCache, 1, &pipelineInfo, nullptr, &m_GraphicsPipeline);
 		REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to create graphics pipeline");
 
 		vkDestroyShaderModule(context->getDevice(), fragShaderModule, nullptr);
@@ -477,7 +633,12 @@ namespace REON {
 
 	void DirectionalShadowPass::createPerLightBuffers(const VulkanContext* context)
 	{
-		VkDeviceSize bufferSize = sizeof(glm::mat4);
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(context->getPhysicalDevice(), &properties);
+		const VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+		m_CascadeStride = (sizeof(glm::mat4) + alignment - 1) / alignment * alignment;
+
+		VkDeviceSize bufferSize = m_CascadeStride * ShadowCascades::MaxCascades * 2;
 
 		m_PerLightBuffers.resize(context->MAX_FRAMES_IN_FLIGHT);
 
@@ -520,7 +681,7 @@ namespace REON {
 			descriptorWrites[0].dstSet = m_PerLightDescriptorSets[i];
 			descriptorWrites[0].dstBinding = 0;
 			descriptorWrites[0].dstArrayElement = 0;
-			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 			descriptorWrites[0].descriptorCount = 1;
 			descriptorWrites[0].pBufferInfo = &globalBufferInfo;
 
@@ -528,9 +689,9 @@ namespace REON {
 		}
 	}
 
-	void DirectionalShadowPass::createPerObjectDescriptorSets(const VulkanContext* context, std::shared_ptr<Renderer> renderer)
+	void DirectionalShadowPass::createPerObjectDescriptorSets(const VulkanContext* context)
 	{
-		renderer->shadowObjectDescriptorSets.resize(context->MAX_FRAMES_IN_FLIGHT);
+		m_PerObjectDescriptorSets.resize(context->MAX_FRAMES_IN_FLIGHT);
 
 		std::vector<VkDescriptorSetLayout> objectLayouts(context->MAX_FRAMES_IN_FLIGHT, m_PerObjectDescriptorSetLayout);
 		VkDescriptorSetAllocateInfo objectAllocInfo{};
@@ -539,26 +700,41 @@ namespace REON {
 		objectAllocInfo.descriptorSetCount = static_cast<uint32_t>(context->MAX_FRAMES_IN_FLIGHT);
 		objectAllocInfo.pSetLayouts = objectLayouts.data();
 
-		VkResult res = vkAllocateDescriptorSets(context->getDevice(), &objectAllocInfo, renderer->shadowObjectDescriptorSets.data());
+		VkResult res = vkAllocateDescriptorSets(context->getDevice(), &objectAllocInfo, m_PerObjectDescriptorSets.data());
 		REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to allocate descriptor sets");
+	}
 
-		for (size_t i = 0; i < context->MAX_FRAMES_IN_FLIGHT; i++) {
-			VkDescriptorBufferInfo objectBufferInfo{};
-			objectBufferInfo.buffer = renderer->shadowObjectDataBuffers[i]->GetVkBuffer();
-			objectBufferInfo.offset = 0;
-			objectBufferInfo.range = sizeof(glm::mat4);
-
-			std::array<VkWriteDescriptorSet, 1> descriptorWrites{};
-			descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[0].dstSet = renderer->shadowObjectDescriptorSets[i];
-			descriptorWrites[0].dstBinding = 1;
-			descriptorWrites[0].dstArrayElement = 0;
-			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptorWrites[0].descriptorCount = 1;
-			descriptorWrites[0].pBufferInfo = &objectBufferInfo;
-
-			vkUpdateDescriptorSets(context->getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-		}
+	void DirectionalShadowPass::setObjectDataBuffer(const VulkanContext* context, int frame, const BufferHandle& objectBuffer,
+		const BufferHandle& instanceBuffer, VkDeviceSize regionSize)
+	{
+		VkDescriptorBufferInfo objectBufferInfo{};
+		objectBufferInfo.buffer = objectBuffer->GetVkBuffer();
+		objectBufferInfo.offset = 0;
+		objectBufferInfo.range = VK_WHOLE_SIZE;
+
+		VkDescriptorBufferInfo instanceBufferInfo{};
+		instanceBufferInfo.buffer = instanceBuffer->GetVkBuffer();
+		instanceBufferInfo.offset = 0;
+		instanceBufferInfo.range = regionSize;
+
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = m_PerObjectDescriptorSets[frame];
+		descriptorWrites[0].dstBinding = 1;
+		descriptorWrites[0].dstArrayElement = 0;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pBufferInfo = &objectBufferInfo;
+
+		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet = m_PerObjectDescriptorSets[frame];
+		descriptorWrites[1].dstBinding = 2;
+		descriptorWrites[1].dstArrayElement = 0;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pBufferInfo = &instanceBufferInfo;
+
+		vkUpdateDescriptorSets(context->getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 	}
 
 }
\ No newline at end of file
@@ -1,8 +1,13 @@
 #pragma once
 #include <REON/Platform/Vulkan/VulkanContext.h>
 #include <REON/GameHierarchy/Components/Renderer.h>
+#include <REON/Rendering/ParallelCommandRecorder.h>
+#include <REON/Rendering/RenderGraph.h>
+#include <REON/Rendering/RenderQueue.h>
+#include <REON/Rendering/ShadowCascades.h>
 
 namespace REON {
+	class FrameSubmitter;
 
 	class DirectionalShadowPass
 	{
@@ -10,12 +15,41 @@ namespace REON {
 		DirectionalShadowPass() {}
 		~DirectionalShadowPass() {}
 
-		void Init(const VulkanContext* context);
+		void Init(const VulkanContext* context, VkPipelineCache pipelineCache);
 
-		void render(const VulkanContext* context, std::vector<std::shared_ptr<Renderer>> renderers, glm::mat4 mainLightViewProj, VkSemaphore signalSemaphore);
+		// Adds the shadow pass to the frame graph and returns the shadow map it writes
+		RenderGraph::Resource declare(RenderGraph& graph, int imageIndex);
+
+		// Instance regions of one cascade, static and dynamic casters are gathered apart since they are drawn apart
+		struct ShadowCascadeRegions
+		{
+			InstanceSlots staticSlots;
+			IndirectCommands staticCommands;
+			InstanceSlots dynamicSlots;
+			IndirectCommands dynamicCommands;
+		};
+
+		// Moves every cascade into the region its static casters are cached for. The region is moved and its cache marked
+		// for a redraw once the cascade leaves it, the light turns or the static casters change. Rewrites the cascades'
+		// depth ranges to their region's, so it has to run before the cascades are used anywhere else.
+		void placeCascades(std::span<ShadowCascade> cascades, const glm::mat4& lightView, uint64_t staticVersion);
+		// Light space region of a cascade's cache, contains the cascade. Casters are culled against it.
+		const glm::mat4& getCacheRegion(uint32_t cascade) const { return m_CachedCascades[cascade].region.viewProj; }
+		// Share of cascades drawn from their cache instead of redrawn, smoothed over the last frames
+		float getCacheHitRate() const { return m_CacheHitRate; }
+
+		// Renders every cascade into its own tile of the shadow map, with the casters culled against that cascade.
+		// Static casters are drawn into their cascade's cache only when placeCascades asked for it, every frame copies
+		// the cascades' part of the caches into the tiles and draws the dynamic casters over them.
+		void render(const VulkanContext* context, const RenderQueue& queue, const RenderGraph& graph,
+			ParallelCommandRecorder& recorder, FrameSubmitter& submitter, std::span<const ShadowCascade> cascades,
+			std::span<const ShadowCascadeRegions> regions);
 
 		void createPerLightDescriptorSets(const VulkanContext* context);
-		void createPerObjectDescriptorSets(const VulkanContext* context, std::shared_ptr<Renderer> renderer);
+		// Points the per object set of a frame at the shared object data and instance buffers, called again whenever
+		// they grow. The instance buffer is bound one region of regionSize bytes at a time through a dynamic offset.
+		void setObjectDataBuffer(const VulkanContext* context, int frame, const BufferHandle& objectBuffer,
+			const BufferHandle& instanceBuffer, VkDeviceSize regionSize);
 
 		std::vector<VkImageView> getShadowViews() const 
 		{
@@ -27,17 +61,30 @@ namespace REON {
 			return views;
 		}
 		VkSampler getShadowSampler() const { return m_DepthImageSampler; }
+		// Texels along one side of a cascade's tile, the tiles are laid out two by two like in shadow_cascades.hlsl
+		uint getCascadeResolution() const { return MAIN_SHADOW_WIDTH / CASCADES_PER_ROW; }
+		RenderGraph::Pass getGraphPass() const { return m_GraphPass; }
+		RenderGraph::Pass getCopyPass() const { return m_CopyPass; }
 
 		void cleanup(const VulkanContext* context);
 
 	private:
+		uint getCacheResolution() const { return getCascadeResolution() + 2 * CACHE_MARGIN_TEXELS; }
+
 		void createCommandBuffers(const VulkanContext* context);
 		void createImages(const VulkanContext* context);
 		void createRenderPass(const VulkanContext* context);
 		void createFrameBuffers(const VulkanContext* context);
 		void createDescriptorSetLayout(const VulkanContext* context);
-		void createGraphicsPipeline(const VulkanContext* context);
+		void createGraphicsPipeline(const VulkanContext* context, VkPipelineCache pipelineCache);
 		void createPerLightBuffers(const VulkanContext* context);
+		void createPerObjectDescriptorSets(const VulkanContext* context);
+
+		// Records the casters of items[begin, end) that pass filter for one cascade into tile, returns the draw count.
+		// matrix is the slot of the per light buffer they are transformed with.
+		uint32_t recordCascade(const VulkanContext* context, VkCommandBuffer commandBuffer, const RenderQueue& queue,
+			std::span<const RenderQueueItem> items, uint32_t begin, uint32_t end, uint32_t cascade, uint32_t matrix,
+			CasterFilter filter, const VkRect2D& tile, const InstanceSlots& slots, const IndirectCommands& commands) const;
 
 		std::vector<VkCommandBuffer> m_CommandBuffers;
 		VkCommandPool m_CommandPool;
@@ -45,14 +92,38 @@ namespace REON {
 		VkDescriptorSetLayout m_PerLightDescriptorSetLayout;
 		VkDescriptorSetLayout m_PerObjectDescriptorSetLayout;
 		std::vector<VkDescriptorSet> m_PerLightDescriptorSets;
+		std::vector<VkDescriptorSet> m_PerObjectDescriptorSets;
         std::vector<BufferHandle> m_PerLightBuffers;
+		VkDeviceSize m_CascadeStride = 0; // between two matrices in a per light buffer, the cascades' then the regions'
 		VkPipelineLayout m_PipelineLayout;
 		VkPipeline m_GraphicsPipeline;
 		std::vector<ImageHandle> m_DepthImages;
 		std::vector<VkFramebuffer> m_Framebuffers;
 		VkSampler m_DepthImageSampler;
 
+		// Depth of the static casters in the region around each cascade, with what it was rendered for
+		struct CachedCascade
+		{
+			ShadowCacheRegion region;
+			glm::mat4 lightView{ 1.0f };
+			uint64_t staticVersion = 0;
+			glm::uvec2 texelOffset{ 0 }; // of the cascade's tile within the cache
+			bool valid = false;
+			bool redraw = false; // stays set until a render drew it
+		};
+		VkRenderPass m_CacheRenderPass;
+		std::array<ImageHandle, ShadowCascades::MaxCascades> m_CacheImages;
+		std::array<VkFramebuffer, ShadowCascades::MaxCascades> m_CacheFramebuffers{};
+		std::array<CachedCascade, ShadowCascades::MaxCascades> m_CachedCascades;
+		float m_CacheHitRate = 0.0f;
+
+		RenderGraph::Pass m_CopyPass = RenderGraph::Invalid;
+		RenderGraph::Pass m_GraphPass = RenderGraph::Invalid;
+
 		const uint MAIN_SHADOW_WIDTH = 4096, MAIN_SHADOW_HEIGHT = 4096;
+		const uint CASCADES_PER_ROW = 2;
+		// Texels a cache reaches past its cascade on every side, the cascade can move this far before it is redrawn
+		const uint CACHE_MARGIN_TEXELS = 256;
 	};
 
 }
\ No newline at end of file
@@ -3,7 +3,9 @@
 #include "TransparentPass.h"
 
 #include "OpaquePass.h"
+#include "REON/Application.h"
 #include "REON/Rendering/Material.h"
+#include "REON/Rendering/ShaderPrograms.h"
 #include "REON/Rendering/Structs/Vertex.h"
 #include "REON/ResourceManagement/ResourceManager.h"
 
@@ -19,8 +21,9 @@ void TransparentPass::init(const VulkanContext* context, std::vector<VkDescripto
                                context->findQueueFamilies(context->getPhysicalDevice()).graphicsFamily.value());
     createDescriptorSetLayouts(context);
     createRenderPasses(context);
+    m_Pipelines.Init([this, context](uint32_t flags)
+                     { return createPermutationGraphicsPipeline(context, m_GraphicsPipeline, flags); });
     createGraphicsPipelines(context);
-    createSyncObjects(context);
 }
 
 void TransparentPass::init(const VulkanContext* context, std::shared_ptr<Camera> camera,
@@ -42,18 +45,50 @@ void TransparentPass::init(const VulkanContext* context, std::shared_ptr<Camera>
     createDescriptorSets(context, camera, opaqueViews);
 }
 
-void TransparentPass::render(
-    const VulkanContext* context, std::shared_ptr<Camera> camera,
-    std::unordered_map<AssetId, std::unordered_map<AssetId, std::vector<DrawCommand>>> rendererMap,
-    VkSemaphore waitSemaphore, VkSemaphore signalSemaphore, VkDescriptorSet globalDescriptorSet)
+void TransparentPass::declare(RenderGraph& graph, std::shared_ptr<Camera> camera, int imageIndex,
+                              RenderGraph::Resource opaqueColor, RenderGraph::Resource opaqueDepth,
+                              RenderGraph::Resource shadowMap, RenderGraph::Resource result)
+{
+    auto& swapChainResources = m_SwapChainResourcesByCamera[camera][imageIndex];
+    GraphPasses& passes = m_GraphPasses[camera];
+
+    RenderGraph::Resource colorAccum = graph.ImportImage(
+        "TransparentColorAccum", swapChainResources.colorAccumTarget->getVkImage(), VK_IMAGE_ASPECT_COLOR_BIT);
+    RenderGraph::Resource alphaAccum = graph.ImportImage(
+        "TransparentAlphaAccum", swapChainResources.alphaAccumTarget->getVkImage(), VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // Mirrors the attachment descriptions of m_RenderPass
+    passes.accumulate = graph.AddPass("TransparentAccumulate");
+    graph.Attachment(passes.accumulate, colorAccum, RenderGraphAccess::ColorAttachment, VK_IMAGE_LAYOUT_UNDEFINED,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    graph.Attachment(passes.accumulate, alphaAccum, RenderGraphAccess::ColorAttachment, VK_IMAGE_LAYOUT_UNDEFINED,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    graph.Attachment(passes.accumulate, opaqueDepth, RenderGraphAccess::DepthAttachment,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    if (shadowMap != RenderGraph::Invalid)
+        graph.Read(passes.accumulate, shadowMap, RenderGraphAccess::Sampled);
+
+    passes.composite = graph.AddPass("TransparentComposite");
+    graph.Read(passes.composite, opaqueColor, RenderGraphAccess::Sampled);
+    graph.Read(passes.composite, colorAccum, RenderGraphAccess::Sampled);
+    graph.Read(passes.composite, alphaAccum, RenderGraphAccess::Sampled);
+    graph.Attachment(passes.composite, result, RenderGraphAccess::ColorAttachment, VK_IMAGE_LAYOUT_UNDEFINED,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void TransparentPass::render(const VulkanContext* context, const RenderView& view, const RenderQueue& queue,
+                             const RenderGraph& graph, ParallelCommandRecorder& recorder, FrameSubmitter& submitter,
+                             VkDescriptorSet globalDescriptorSet, VkDescriptorSet materialDescriptorSet,
+                             VkDescriptorSet objectDescriptorSet, const InstanceSlots& instanceSlots,
+                             const IndirectCommands& indirectCommands)
 {
     int currentFrame = context->getCurrentFrame();
     int currentImageIndex = context->getCurrentImageIndex();
 
-    auto& swapChainResources = m_SwapChainResourcesByCamera[camera][currentImageIndex];
-    auto& cameraData = m_FrameData[currentFrame].cameraData[camera];
+    auto& swapChainResources = m_SwapChainResourcesByCamera[view.camera][currentImageIndex];
+    auto& cameraData = m_FrameData[currentFrame].cameraData[view.camera];
+    const GraphPasses& passes = m_GraphPasses.at(view.camera);
 
-    for (const auto& pair : rendererMap)
     {
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -68,7 +103,7 @@ void TransparentPass::render(
         renderPassInfo.renderPass = m_RenderPass;
         renderPassInfo.framebuffer = swapChainResources.framebuffer;
         renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = {camera->viewportSize.x, camera->viewportSize.y};
+        renderPassInfo.renderArea.extent = {view.viewportSize.x, view.viewportSize.y};
 
         std::array<VkClearValue, 3> clearValues{};
         clearValues[0].color = {0.0f, 0.0f, 0.0f, 0.0f};
@@ -78,97 +113,136 @@ void TransparentPass::render(
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(cameraData.commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        const auto& materialFromShader = pair.second;
-        for (const auto& material : materialFromShader)
-        {
-
-            // set material wide buffers/textures
-            auto mat = material.second.front().material.Lock();
-            if (!(mat->blendingMode == Blend && mat->renderingMode == Transparent))
-            {
-                continue;
-            }
-            auto pipeline = getPipelineFromFlags(context, mat->materialFlags);
-            if (pipeline == VK_NULL_HANDLE)
-            {
-                REON_CORE_WARN("Cant render because pipeline is not found");
-                continue;
-            }
-            vkCmdBindPipeline(cameraData.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
-            VkViewport viewport{};
-            viewport.x = 0.0f;
-            viewport.y = 0.0f;
-            viewport.width = static_cast<float>(camera->viewportSize.x);
-            viewport.height = static_cast<float>(camera->viewportSize.y);
-            viewport.minDepth = 0.0f;
-            viewport.maxDepth = 1.0f;
-            vkCmdSetViewport(cameraData.commandBuffer, 0, 1, &viewport);
-
-            VkRect2D scissor{};
-            scissor.offset = {0, 0};
-            scissor.extent = {camera->viewportSize.x, camera->viewportSize.y};
-            vkCmdSetScissor(cameraData.commandBuffer, 0, 1, &scissor);
-
-            mat->flatDataBuffers[currentFrame]->Write(&mat->flatData, sizeof(mat->flatData));
-
-            vkCmdSetCullMode(cameraData.commandBuffer,
-                             mat->getDoubleSided() ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT);
-
-            for (const auto& cmd : material.second)
+        const std::span<const RenderQueueItem> items = queue.GetBucket(RenderBucket::Transparent);
+        ParallelCommandRecorder::ResolveMaterialBindings(
+            queue, items,
+            [this](uint32_t flags) {
+                VkPipeline pipeline = m_Pipelines.Get(flags);
+                if (pipeline == VK_NULL_HANDLE)
+                    REON_CORE_WARN("Cant render because pipeline is not found");
+                return pipeline;
+            },
+            m_MaterialBindings);
+
+        const uint32_t itemCount = static_cast<uint32_t>(items.size());
+        graph.RecordBarriersBefore(cameraData.commandBuffer, passes.accumulate);
+        vkCmdBeginRenderPass(cameraData.commandBuffer, &renderPassInfo, recorder.GetSubpassContents(itemCount));
+
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(view.viewportSize.x);
+        viewport.height = static_cast<float>(view.viewportSize.y);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+
+        VkRect2D scissor{};
+        scissor.offset = {0, 0};
+        scissor.extent = {view.viewportSize.x, view.viewportSize.y};
+
+        const std::array<VkDescriptorSet, 3> descriptorSets{globalDescriptorSet, materialDescriptorSet,
+                                                            objectDescriptorSet};
+
+        auto recordDraws = [&](VkCommandBuffer recordBuffer, uint32_t begin, uint32_t end) {
+            vkCmdSetViewport(recordBuffer, 0, 1, &viewport);
+            vkCmdSetScissor(recordBuffer, 0, 1, &scissor);
+
+            vkCmdBindDescriptorSets(recordBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipelineLayout, 0,
+                                    static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 1,
+                                    &instanceSlots.dynamicOffset);
+
+            // WBOIT composites order independently, so transparent draws are state sorted and batched just like the
+            // opaque ones.
+            IndirectDrawBatch batch(indirectCommands, queue.GetCommandIndex(items[begin]),
+                                    context->supportsMultiDrawIndirect());
+            VkPipeline boundPipeline = VK_NULL_HANDLE;
+            VkCullModeFlags boundCullMode = VK_CULL_MODE_FLAG_BITS_MAX_ENUM;
+            uint32_t boundMaterialSlot = UINT32_MAX;
+            uint32_t boundMeshSlot = UINT32_MAX;
+            uint32_t boundBlock = UINT32_MAX;
+            const MaterialBinding* binding = nullptr;
+            GeometryAllocation geometry;
+            uint32_t drawCount = 0;
+
+            for (uint32_t i = begin; i < end;)
             {
-                auto mesh = cmd.mesh.Lock();
-                if (!mesh)
+                const RenderQueueItem& item = items[i];
+                if (!queue.IsVisible(item, CULL_VIEW_CAMERA))
+                {
+                    i++;
+                    continue;
+                }
+
+                const DrawCommand& cmd = queue.GetCommand(item);
+                const uint32_t instanceCount = queue.GatherInstances(items, i, end, CULL_VIEW_CAMERA, instanceSlots, i);
+
+                const uint32_t materialSlot = DrawKey::GetMaterialSlot(item.key);
+                if (materialSlot != boundMaterialSlot)
+                {
+                    // Material data comes from the material table, only pipeline and cull mode changes break a batch
+                    boundMaterialSlot = materialSlot;
+                    binding = &m_MaterialBindings[materialSlot];
+                    if (!binding->material)
+                        continue;
+
+                    const VkCullModeFlags cullMode =
+                        binding->material->getDoubleSided() ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+                    if (binding->pipeline != boundPipeline || cullMode != boundCullMode)
+                        drawCount += batch.Flush(recordBuffer);
+
+                    if (binding->pipeline != boundPipeline)
+                    {
+                        vkCmdBindPipeline(recordBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, binding->pipeline);
+                        boundPipeline = binding->pipeline;
+                    }
+                    if (cullMode != boundCullMode)
+                    {
+                        vkCmdSetCullMode(recordBuffer, cullMode);
+                        boundCullMode = cullMode;
+                    }
+                }
+
+                if (!binding->material)
                     continue;
 
-                std::vector<VkDescriptorSet> descriptorSets = {
-                    globalDescriptorSet, mat->descriptorSets[currentFrame],
-                    cmd.owner->objectDescriptorSets[context->getCurrentFrame()]};
-
-                ObjectRenderData data{};
-                data.model = cmd.owner->getModelMatrix();
-                data.transposeInverseModel = glm::transpose(glm::inverse(data.model));
-                cmd.owner->objectDataBuffers[context->getCurrentFrame()]->Write(&data, sizeof(data));
-
-                VkBuffer vertexBuffers[] = {mesh->m_VertexBuffer->GetVkBuffer()};
-                VkDeviceSize offsets[] = {0};
-                vkCmdBindVertexBuffers(cameraData.commandBuffer, 0, 1, vertexBuffers, offsets);
-
-                vkCmdBindIndexBuffer(cameraData.commandBuffer, mesh->m_IndexBuffer->GetVkBuffer(), 0,
-                                     VK_INDEX_TYPE_UINT32);
+                const uint32_t meshSlot = DrawKey::GetMeshSlot(item.key);
+                if (meshSlot != boundMeshSlot)
+                {
+                    boundMeshSlot = meshSlot;
+                    const std::shared_ptr<Mesh> mesh = cmd.mesh.Lock();
+                    geometry = mesh ? mesh->geometry : GeometryAllocation{};
+                    if (geometry.IsValid() && geometry.block != boundBlock)
+                    {
+                        drawCount += batch.Flush(recordBuffer);
+                        context->getGeometryPool()->Bind(recordBuffer, geometry.block);
+                        boundBlock = geometry.block;
+                    }
+                }
+
+                if (!geometry.IsValid())
+                    continue;
 
-                vkCmdBindDescriptorSets(cameraData.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                        m_GraphicsPipelineLayout, 0, descriptorSets.size(), descriptorSets.data(), 0,
-                                        nullptr);
-                vkCmdDrawIndexed(cameraData.commandBuffer, static_cast<uint32_t>(cmd.indexCount), 1, cmd.startIndex, 0,
-                                 0);
+                const DrawRange& range = queue.GetDrawRange(item);
+                batch.Add({range.indexCount, instanceCount, geometry.firstIndex + range.startIndex,
+                           static_cast<int32_t>(geometry.vertexOffset), queue.GetObjectIndex(item)});
             }
-        }
+            drawCount += batch.Flush(recordBuffer);
+            recorder.CountDraws(drawCount);
+        };
+
+        recorder.Record(context, cameraData.commandBuffer, m_RenderPass, 0, swapChainResources.framebuffer, itemCount,
+                        recordDraws);
 
         vkCmdEndRenderPass(cameraData.commandBuffer);
+        graph.RecordBarriersAfter(cameraData.commandBuffer, passes.accumulate);
 
         res = vkEndCommandBuffer(cameraData.commandBuffer);
         REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to record command buffer");
 
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-        VkSemaphore waitSemaphores[] = {waitSemaphore};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &cameraData.commandBuffer;
-
-        VkSemaphore signalSemaphores[] = {m_TransparentRenderDone[currentFrame]};
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
-
-        res = vkQueueSubmit(context->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-        REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to submit draw command buffer");
+        // Depth tests against and samples the opaque results
+        submitter.AddPass(cameraData.commandBuffer, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                                                        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+                                                        VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
     }
 
     VkCommandBufferBeginInfo beginInfo{};
@@ -184,13 +258,14 @@ void TransparentPass::render(
     renderPassInfo.renderPass = m_CompositeRenderPass;
     renderPassInfo.framebuffer = swapChainResources.compositeFramebuffer;
     renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = {camera->viewportSize.x, camera->viewportSize.y};
+    renderPassInfo.renderArea.extent = {view.viewportSize.x, view.viewportSize.y};
 
     std::array<VkClearValue, 1> clearValues{};
     clearValues[0].color = {0.0f, 0.0f, 0.0f, 0.0f};
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
+    graph.RecordBarriersBefore(cameraData.compositeCommandBuffer, passes.composite);
     vkCmdBeginRenderPass(cameraData.compositeCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
     vkCmdBindPipeline(cameraData.compositeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_CompositePipeline);
@@ -198,18 +273,18 @@ void TransparentPass::render(
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(camera->viewportSize.x);
-    viewport.height = static_cast<float>(camera->viewportSize.y);
+    viewport.width = static_cast<float>(view.viewportSize.x);
+    viewport.height = static_cast<float>(view.viewportSize.y);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
     vkCmdSetViewport(cameraData.compositeCommandBuffer, 0, 1, &viewport);
 
     VkRect2D scissor{};
     scissor.offset = {0, 0};
-    scissor.extent = {camera->viewportSize.x, camera->viewportSize.y};
+    scissor.extent = {view.viewportSize.x, view.viewportSize.y};
     vkCmdSetScissor(cameraData.compositeCommandBuffer, 0, 1, &scissor);
 
-    glm::vec2 frameBufferSize(camera->viewportSize.x, camera->viewportSize.y);
+    glm::vec2 frameBufferSize(view.viewportSize.x, view.viewportSize.y);
     swapChainResources.frameInfoBuffer->Write(&frameBufferSize, sizeof(glm::vec2));
 
     vkCmdBindDescriptorSets(cameraData.compositeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -217,27 +292,13 @@ void TransparentPass::render(
     vkCmdDraw(cameraData.compositeCommandBuffer, 3, 1, 0, 0);
 
     vkCmdEndRenderPass(cameraData.compositeCommandBuffer);
+    graph.RecordBarriersAfter(cameraData.compositeCommandBuffer, passes.composite);
 
     res = vkEndCommandBuffer(cameraData.compositeCommandBuffer);
     REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to record command buffer");
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-    VkSemaphore waitSemaphores[] = {m_TransparentRenderDone[currentFrame]};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &cameraData.compositeCommandBuffer;
-
-    VkSemaphore signalSemaphores[] = {signalSemaphore};
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
-
-    res = vkQueueSubmit(context->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-    REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to submit draw command buffer");
+    submitter.AddPass(cameraData.compositeCommandBuffer,
+                      VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
 }
 
 void TransparentPass::resize(const VulkanContext* context, std::shared_ptr<Camera> camera,
@@ -308,20 +369,25 @@ void TransparentPass::resize(const VulkanContext* context, std::shared_ptr<Camer
 
 void TransparentPass::hotReloadShaders(const VulkanContext* context)
 {
+    // Finishes the background compiles before the layout and base pipeline they use are destroyed
+    m_Pipelines.Clear(context->getDevice());
     vkDestroyPipelineLayout(context->getDevice(), m_GraphicsPipelineLayout, nullptr);
-    for (auto [permutation, pipeline] : m_PipelineByMaterialPermutation)
-    {
-        vkDestroyPipeline(context->getDevice(), pipeline, nullptr);
-    }
 
     vkDestroyPipelineLayout(context->getDevice(), m_CompositePipelineLayout, nullptr);
     vkDestroyPipeline(context->getDevice(), m_CompositePipeline, nullptr);
 
-    m_PipelineByMaterialPermutation.clear();
-
     createGraphicsPipelines(context);
 }
 
+void TransparentPass::cleanup(const VulkanContext* context)
+{
+    m_Pipelines.Cleanup(context->getDevice());
+    vkDestroyPipelineLayout(context->getDevice(), m_GraphicsPipelineLayout, nullptr);
+
+    vkDestroyPipelineLayout(context->getDevice(), m_CompositePipelineLayout, nullptr);
+    vkDestroyPipeline(context->getDevice(), m_CompositePipeline, nullptr);
+}
+
 void TransparentPass::createImages(const VulkanContext* context, std::shared_ptr<Camera> camera)
 {
     size_t swapChainImageCount = context->getAmountOfSwapChainImages();
@@ -516,17 +582,10 @@ void TransparentPass::createFrameBuffers(const VulkanContext* context, std::shar
 
 void TransparentPass::createGraphicsPipelines(const VulkanContext* context)
 {
-    uint32_t mostUsedFlags = AlbedoTexture | NormalTexture | MetallicRoughnessTexture;
-
-    std::vector<uint32_t> prebakePermutations{
-        0,
-        NormalTexture | MetallicRoughnessTexture,
-        MetallicRoughnessTexture,
-        AlbedoTexture | NormalTexture,
-    };
+    uint32_t mostUsedFlags = BaseMaterialPermutation;
 
-    auto vertShaderCode = Shader::CompileHLSLToSPIRV("Assets/Shaders/Transparent.vert", mostUsedFlags);
-    auto fragShaderCode = Shader::CompileHLSLToSPIRV("Assets/Shaders/Transparent.frag", mostUsedFlags);
+    auto vertShaderCode = Shader::CompileHLSLToSPIRV(TransparentProgram.vertex, mostUsedFlags);
+    auto fragShaderCode = Shader::CompileHLSLToSPIRV(TransparentProgram.fragment, mostUsedFlags);
 
     if (vertShaderCode.empty() || fragShaderCode.empty())
     {
@@ -551,13 +610,13 @@ void TransparentPass::createGraphicsPipelines(const VulkanContext* context)
 
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    auto bindingDescriptions = VertexLayout::getBindingDescriptions();
+    auto attributeDescriptions = VertexLayout::getAttributeDescriptions();
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -635,7 +694,8 @@ void TransparentPass::createGraphicsPipelines(const VulkanContext* context)
     depthStencil.stencilTestEnable = VK_FALSE;
 
     std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR,
-                                                 VK_DYNAMIC_STATE_CULL_MODE};
+                                                 VK_DYNAMIC_STATE_CULL_MODE,
+                                                 VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE};
 
     VkPipelineDynamicStateCreateInfo dynamicState{};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -679,16 +739,12 @@ void TransparentPass::createGraphicsPipelines(const VulkanContext* context)
     vkDestroyShaderModule(context->getDevice(), fragShaderModule, nullptr);
     vkDestroyShaderModule(context->getDevice(), vertShaderModule, nullptr);
 
-    m_PipelineByMaterialPermutation.insert({mostUsedFlags, m_GraphicsPipeline});
+    m_Pipelines.Add(mostUsedFlags, m_GraphicsPipeline);
 
-    for (auto permutation : prebakePermutations)
-    {
-        m_PipelineByMaterialPermutation.insert(
-            {permutation, createPermutationGraphicsPipeline(context, m_GraphicsPipeline, permutation)});
-    }
+    m_Pipelines.Prebake(TransparentPrebakedPermutations, Application::Get().GetJobSystem());
 
-    vertShaderCode = Shader::CompileHLSLToSPIRV("Assets/Shaders/fullScreen.vert", 0);
-    fragShaderCode = Shader::CompileHLSLToSPIRV("Assets/Shaders/WBOITComposite.frag", 0);
+    vertShaderCode = Shader::CompileHLSLToSPIRV(TransparentCompositeProgram.vertex, 0);
+    fragShaderCode = Shader::CompileHLSLToSPIRV(TransparentCompositeProgram.fragment, 0);
 
     if (vertShaderCode.empty() || fragShaderCode.empty())
     {
@@ -932,20 +988,6 @@ void TransparentPass::createDescriptorSets(const VulkanContext* context, std::sh
     }
 }
 
-VkPipeline TransparentPass::getPipelineFromFlags(const VulkanContext* context, uint32_t flags)
-{
-    if (m_PipelineByMaterialPermutation.contains(flags))
-    {
-        return m_PipelineByMaterialPermutation[flags];
-    }
-    else
-    {
-        VkPipeline newPipeline = createPermutationGraphicsPipeline(context, m_GraphicsPipeline, flags);
-        m_PipelineByMaterialPermutation[flags] = newPipeline;
-        return newPipeline;
-    }
-}
-
 void TransparentPass::cleanForResize(const VulkanContext* context, std::shared_ptr<Camera> camera)
 {
     for (int i = 0; i < context->getAmountOfSwapChainImages(); i++)
@@ -956,24 +998,11 @@ void TransparentPass::cleanForResize(const VulkanContext* context, std::shared_p
     }
 }
 
-void TransparentPass::createSyncObjects(const VulkanContext* context)
-{
-    m_TransparentRenderDone.resize(context->MAX_FRAMES_IN_FLIGHT);
-
-    VkSemaphoreCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-    for (int i = 0; i < context->MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        vkCreateSemaphore(context->getDevice(), &createInfo, nullptr, &m_TransparentRenderDone[i]);
-    }
-}
-
 VkPipeline TransparentPass::createPermutationGraphicsPipeline(const VulkanContext* context, VkPipeline basePipeline,
                                                               uint32_t flags)
 {
-    auto vertShaderCode = Shader::CompileHLSLToSPIRV("Assets/Shaders/Transparent.vert", flags);
-    auto fragShaderCode = Shader::CompileHLSLToSPIRV("Assets/Shaders/Transparent.frag", flags);
+    auto vertShaderCode = Shader::CompileHLSLToSPIRV(TransparentProgram.vertex, flags);
+    auto fragShaderCode = Shader::CompileHLSLToSPIRV(TransparentProgram.fragment, flags);
 
     if (vertShaderCode.empty() || fragShaderCode.empty())
     {
@@ -998,13 +1027,13 @@ VkPipeline TransparentPass::createPermutationGraphicsPipeline(const VulkanContex
 
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    auto bindingDescriptions = VertexLayout::getBindingDescriptions();
+    auto attributeDescriptions = VertexLayout::getAttributeDescriptions();
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -1082,7 +1111,8 @@ VkPipeline TransparentPass::createPermutationGraphicsPipeline(const VulkanContex
     depthStencil.stencilTestEnable = VK_FALSE;
 
     std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR,
-                                                 VK_DYNAMIC_STATE_CULL_MODE};
+                                                 VK_DYNAMIC_STATE_CULL_MODE,
+                                                 VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE};
 
     VkPipelineDynamicStateCreateInfo dynamicState{};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -2,6 +2,11 @@
 #include <REON/Platform/Vulkan/VulkanContext.h>
 #include "REON/GameHierarchy/Components/Renderer.h"
 #include "REON/GameHierarchy/Components/Camera.h"
+#include "REON/Rendering/FrameSubmitter.h"
+#include "REON/Rendering/ParallelCommandRecorder.h"
+#include "REON/Rendering/PipelinePermutations.h"
+#include "REON/Rendering/RenderGraph.h"
+#include "REON/Rendering/RenderQueue.h"
 
 namespace REON {
 	struct CameraSwapchainRecources;
@@ -38,9 +43,17 @@ namespace REON {
 		void init(const VulkanContext* context, std::shared_ptr<Camera> camera, std::vector<VkImageView>& resultViews,
 			std::vector<VkImageView>& depthViews, std::vector<VkImageView>& opaqueViews);
 
-		void render(const VulkanContext* context, std::shared_ptr<Camera> camera,
-                    std::unordered_map<AssetId, std::unordered_map<AssetId, std::vector<DrawCommand>>> rendererMap, 
-			VkSemaphore waitSemaphore, VkSemaphore signalSemaphore, VkDescriptorSet globalDescriptorSet);
+		// Adds the accumulation and composite passes of a camera to the frame graph. They depth test against
+		// opaqueDepth, blend opaqueColor under the transparent surfaces and write the result.
+		void declare(RenderGraph& graph, std::shared_ptr<Camera> camera, int imageIndex, RenderGraph::Resource opaqueColor,
+			RenderGraph::Resource opaqueDepth, RenderGraph::Resource shadowMap, RenderGraph::Resource result);
+
+		// Records the view's accumulation and composite passes. Everything about the camera is read from the
+		// snapshot view, the live camera may already be a frame ahead.
+		void render(const VulkanContext* context, const RenderView& view, const RenderQueue& queue,
+			const RenderGraph& graph, ParallelCommandRecorder& recorder, FrameSubmitter& submitter,
+			VkDescriptorSet globalDescriptorSet, VkDescriptorSet materialDescriptorSet, VkDescriptorSet objectDescriptorSet,
+			const InstanceSlots& instanceSlots, const IndirectCommands& indirectCommands);
 
 		void resize(const VulkanContext* context, std::shared_ptr<Camera> camera, std::vector<VkImageView>& endViews,
 			std::vector<VkImageView> opaqueImageViews, std::vector<VkImageView> depthImageViews);
@@ -58,9 +71,7 @@ namespace REON {
 		void createDescriptorSetLayouts(const VulkanContext* context);
 		void createDescriptorSets(const VulkanContext* context, std::shared_ptr<Camera> camera, std::vector<VkImageView> opaqueImageViews);
 		VkPipeline createPermutationGraphicsPipeline(const VulkanContext* context, VkPipeline BasePipeline, uint32_t flags);
-		VkPipeline getPipelineFromFlags(const VulkanContext* context, uint32_t flags);
 		void cleanForResize(const VulkanContext* context, std::shared_ptr<Camera> camera);
-		void createSyncObjects(const VulkanContext* context);
 
 		//std::vector<VkCommandBuffer> m_CommandBuffers;
 		VkCommandPool m_CommandPool;
@@ -69,17 +80,23 @@ namespace REON {
 		std::unordered_map<std::shared_ptr<Camera>, std::vector<CameraSwapchainRecourcesTransparent>> m_SwapChainResourcesByCamera;
 		std::vector<FrameInfo> m_FrameData;
 
+		struct GraphPasses {
+			RenderGraph::Pass accumulate = RenderGraph::Invalid;
+			RenderGraph::Pass composite = RenderGraph::Invalid;
+		};
+		std::unordered_map<std::shared_ptr<Camera>, GraphPasses> m_GraphPasses;
+
 		VkPipelineLayout m_GraphicsPipelineLayout;
 		VkPipeline m_GraphicsPipeline;
-		std::unordered_map<uint32_t, VkPipeline> m_PipelineByMaterialPermutation;
+		// Unknown permutations compile in the background, materials draw with a fallback until they are ready
+		PipelinePermutations m_Pipelines;
+		std::vector<MaterialBinding> m_MaterialBindings;
 
 		//std::vector<VkCommandBuffer> m_CompositeCommandBuffers;
 		VkRenderPass m_CompositeRenderPass;
 		VkPipelineLayout m_CompositePipelineLayout;
 		VkPipeline m_CompositePipeline;
 
-		std::vector<VkSemaphore> m_TransparentRenderDone;
-
 		std::vector<VkDescriptorSetLayout> m_Layouts;
 
 		VkPipelineCache m_PipelineCache;
@@ -38,130 +38,138 @@ namespace REON {
 		}
 	}
 
-	void UnlitPass::render(const VulkanContext* context, 
-		std::unordered_map<std::string, std::unordered_map<std::string, std::vector<DrawCommand>>> rendererMap,
-		VkDescriptorSet globalDescriptorSet, VkSemaphore signalSemaphore, RenderMode renderMode)
+	void UnlitPass::render(const VulkanContext* context, const RenderQueue& queue,
+		VkDescriptorSet globalDescriptorSet, VkDescriptorSet materialDescriptorSet, VkDescriptorSet objectDescriptorSet,
+		const InstanceSlots& instanceSlots, VkSemaphore signalSemaphore, RenderMode renderMode)
 	{
 		int currentFrame = context->getCurrentFrame();
 		int currentImageIndex = context->getCurrentImageIndex();
 
-		for (const auto& pair : rendererMap) {
-			VkCommandBufferBeginInfo beginInfo{};
-			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			beginInfo.flags = 0;
-			beginInfo.pInheritanceInfo = nullptr;
-
-			VkResult res = vkBeginCommandBuffer(m_CommandBuffers[currentFrame], &beginInfo);
-			REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to begin recording command buffer");
-
-			VkRenderPassBeginInfo renderPassInfo{};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassInfo.renderPass = m_RenderPass;
-			renderPassInfo.framebuffer = m_Framebuffers[context->getCurrentImageIndex()];
-			renderPassInfo.renderArea.offset = { 0,0 };
-			renderPassInfo.renderArea.extent = { m_Width, m_Height };
-
-			std::array<VkClearValue, 4> clearValues{};
-			clearValues[0].color = { 0.1f, 0.1f, 0.1f, 1.0f };
-			clearValues[1].depthStencil = { 1.0f, 0 };
-			clearValues[2].color = { 0.1f, 0.1f, 0.1f, 1.0f };
-			clearValues[3].depthStencil = { 1.0f, 0 };
-			renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-			renderPassInfo.pClearValues = clearValues.data();
-
-			vkCmdBeginRenderPass(m_CommandBuffers[currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			const auto& materialFromShader = pair.second;
-			for (const auto& material : materialFromShader) {
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = 0;
+		beginInfo.pInheritanceInfo = nullptr;
+
+		VkResult res = vkBeginCommandBuffer(m_CommandBuffers[currentFrame], &beginInfo);
+		REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to begin recording command buffer");
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = m_RenderPass;
+		renderPassInfo.framebuffer = m_Framebuffers[context->getCurrentImageIndex()];
+		renderPassInfo.renderArea.offset = { 0,0 };
+		renderPassInfo.renderArea.extent = { m_Width, m_Height };
+
+		std::array<VkClearValue, 4> clearValues{};
+		clearValues[0].color = { 0.1f, 0.1f, 0.1f, 1.0f };
+		clearValues[1].depthStencil = { 1.0f, 0 };
+		clearValues[2].color = { 0.1f, 0.1f, 0.1f, 1.0f };
+		clearValues[3].depthStencil = { 1.0f, 0 };
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
+
+		vkCmdBeginRenderPass(m_CommandBuffers[currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(m_Width);
+		viewport.height = static_cast<float>(m_Height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(m_CommandBuffers[currentFrame], 0, 1, &viewport);
+
+		VkRect2D scissor{};
+		scissor.offset = { 0,0 };
+		scissor.extent = { m_Width, m_Height };
+		vkCmdSetScissor(m_CommandBuffers[currentFrame], 0, 1, &scissor);
+
+		std::array<VkDescriptorSet, 3> descriptorSets{ globalDescriptorSet, materialDescriptorSet, objectDescriptorSet };
+		vkCmdBindDescriptorSets(m_CommandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, descriptorSets.size(), descriptorSets.data(), 1, &instanceSlots.dynamicOffset);
+
+		uint32_t boundMaterialSlot = UINT32_MAX;
+		uint32_t boundMeshSlot = UINT32_MAX;
+		std::shared_ptr<Material> mat;
+		std::shared_ptr<Mesh> mesh;
+
+		const std::span<const RenderQueueItem> items = queue.GetBucket(RenderBucket::Opaque);
+		const uint32_t itemCount = static_cast<uint32_t>(items.size());
+		for (uint32_t i = 0; i < itemCount;) {
+			const RenderQueueItem& item = items[i];
+			if (!queue.IsVisible(item, CULL_VIEW_CAMERA)) {
+				i++;
+				continue;
+			}
+
+			const DrawCommand& cmd = queue.GetCommand(item);
+			const uint32_t instanceCount = queue.GatherInstances(items, i, itemCount, CULL_VIEW_CAMERA, instanceSlots, i);
+
+			const uint32_t materialSlot = DrawKey::GetMaterialSlot(item.key);
+			if (materialSlot != boundMaterialSlot) {
 				//set material wide buffers/textures
-                auto mat = material.second.front().material.Lock();
-				if (!(mat->blendingMode == Mask || mat->renderingMode == Opaque)) {
+				boundMaterialSlot = materialSlot;
+				mat = cmd.material.Lock();
+				if (!mat)
 					continue;
-				}
+
 				uint32_t mask = AlbedoTexture | EmissiveTexture;
 				auto pipeline = getPipelineFromFlags(context, mat->materialFlags & mask);
 				if (pipeline == VK_NULL_HANDLE) {
 					REON_CORE_WARN("Cant render because pipeline is not found");
+					mat = nullptr;
 					continue;
 				}
 				vkCmdBindPipeline(m_CommandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
-				VkViewport viewport{};
-				viewport.x = 0.0f;
-				viewport.y = 0.0f;
-				viewport.width = static_cast<float>(m_Width);
-				viewport.height = static_cast<float>(m_Height);
-				viewport.minDepth = 0.0f;
-				viewport.maxDepth = 1.0f;
-				vkCmdSetViewport(m_CommandBuffers[currentFrame], 0, 1, &viewport);
-
-				VkRect2D scissor{};
-				scissor.offset = { 0,0 };
-				scissor.extent = { m_Width, m_Height };
-				vkCmdSetScissor(m_CommandBuffers[currentFrame], 0, 1, &scissor);
-
+				// Wireframe draws in the material's colours, its record is shared with the lit passes
 				vkCmdSetPolygonModeEXT(m_CommandBuffers[currentFrame], renderMode == WIREFRAME ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL);
 
-				FlatData data = mat->flatData;
-
-				if (renderMode == WIREFRAME) 
-				{ 
-					data.albedo = glm::vec4(0.0, 0.0, 0.0, 1.0);
-					data.emissiveFactor = glm::vec4(0.0, 0.0, 0.0, 1.0);
-				}
-
-				mat->flatDataBuffers[currentFrame]->Write(&data, sizeof(mat->flatData));
-
 				vkCmdSetCullMode(m_CommandBuffers[currentFrame], mat->getDoubleSided() ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT);
+			}
 
+			if (!mat)
+				continue;
 
-				for (const auto& cmd : material.second) {
-                    auto mesh = cmd.mesh.Lock();
-                    if (!mesh)
-                        continue;
-
-					std::vector<VkDescriptorSet> descriptorSets = { globalDescriptorSet, mat->descriptorSets[currentFrame], cmd.owner->objectDescriptorSets[currentFrame] };
-
-					ObjectRenderData data{};
-					data.model = cmd.owner->getModelMatrix();
-					data.transposeInverseModel = cmd.owner->getTransposeInverseModelMatrix();
-                    cmd.owner->objectDataBuffers[context->getCurrentFrame()]->Write(&data, sizeof(data));
+			const uint32_t meshSlot = DrawKey::GetMeshSlot(item.key);
+			if (meshSlot != boundMeshSlot) {
+				boundMeshSlot = meshSlot;
+				mesh = cmd.mesh.Lock();
+				if (!mesh || !mesh->geometry.IsValid())
+					continue;
 
-					VkBuffer vertexBuffers[] = {mesh->m_VertexBuffer->GetVkBuffer()};
-					VkDeviceSize offsets[] = { 0 };
-					vkCmdBindVertexBuffers(m_CommandBuffers[currentFrame], 0, 1, vertexBuffers, offsets);
+				context->getGeometryPool()->Bind(m_CommandBuffers[currentFrame], mesh->geometry.block);
+			}
 
-					vkCmdBindIndexBuffer(m_CommandBuffers[currentFrame], mesh->m_IndexBuffer->GetVkBuffer(), 0,
-                                         VK_INDEX_TYPE_UINT32);
+			if (!mesh || !mesh->geometry.IsValid())
+				continue;
 
-					vkCmdBindDescriptorSets(m_CommandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, descriptorSets.size(), descriptorSets.data(), 0, nullptr);
-					vkCmdDrawIndexed(m_CommandBuffers[currentFrame], static_cast<uint32_t>(cmd.indexCount), 1, cmd.startIndex, 0, 0);
-				}
-			}
+			const DrawRange& range = queue.GetDrawRange(item);
+			vkCmdDrawIndexed(m_CommandBuffers[currentFrame], range.indexCount, instanceCount,
+				mesh->geometry.firstIndex + range.startIndex, static_cast<int32_t>(mesh->geometry.vertexOffset), queue.GetObjectIndex(item));
+		}
 
-			vkCmdEndRenderPass(m_CommandBuffers[currentFrame]);
+		vkCmdEndRenderPass(m_CommandBuffers[currentFrame]);
 
-			res = vkEndCommandBuffer(m_CommandBuffers[currentFrame]);
-			REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to record command buffer");
+		res = vkEndCommandBuffer(m_CommandBuffers[currentFrame]);
+		REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to record command buffer");
 
-			VkSubmitInfo submitInfo{};
-			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-			VkSemaphore waitSemaphores[] = { context->getCurrentImageAvailableSemaphore() };
-			VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-			submitInfo.waitSemaphoreCount = 1;
-			submitInfo.pWaitSemaphores = waitSemaphores;
-			submitInfo.pWaitDstStageMask = waitStages;
-			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &m_CommandBuffers[currentFrame];
+		VkSemaphore waitSemaphores[] = { context->getCurrentImageAvailableSemaphore() };
+		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = waitSemaphores;
+		submitInfo.pWaitDstStageMask = waitStages;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &m_CommandBuffers[currentFrame];
 
-			VkSemaphore signalSemaphores[] = {signalSemaphore };
-			submitInfo.signalSemaphoreCount = 1;
-			submitInfo.pSignalSemaphores = signalSemaphores;
+		VkSemaphore signalSemaphores[] = {signalSemaphore };
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = signalSemaphores;
 
-			res = vkQueueSubmit(context->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-			REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to submit draw command buffer");
-		}
+		res = vkQueueSubmit(context->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
+		REON_CORE_ASSERT(res == VK_SUCCESS, "Failed to submit draw command buffer");
 	}
 
 	void UnlitPass::resize(const VulkanContext* context, uint width, uint height, std::vector<VkImageView> endImageViews)
@@ -321,13 +329,13 @@ namespace REON {
 
 		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-		auto bindingDescription = Vertex::getBindingDescription();
-		auto attributeDescriptions = Vertex::getAttributeDescriptions();
+		auto bindingDescriptions = VertexLayout::getBindingDescriptions();
+		auto attributeDescriptions = VertexLayout::getAttributeDescriptions();
 
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+		vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+		vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
 		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -396,7 +404,8 @@ namespace REON {
 			VK_DYNAMIC_STATE_VIEWPORT,
 			VK_DYNAMIC_STATE_SCISSOR,
 			VK_DYNAMIC_STATE_CULL_MODE,
-			VK_DYNAMIC_STATE_POLYGON_MODE_EXT
+			VK_DYNAMIC_STATE_POLYGON_MODE_EXT,
+			VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE
 		};
 
 		VkPipelineDynamicStateCreateInfo dynamicState{};
@@ -2,6 +2,7 @@
 #include <REON/Platform/Vulkan/VulkanContext.h>
 #include <REON/Rendering/Material.h>
 #include <REON/GameHierarchy/Components/Renderer.h>
+#include <REON/Rendering/RenderQueue.h>
 #include <REON/ResourceManagement/ResourceManager.h>
 
 namespace REON {
@@ -16,9 +17,9 @@ namespace REON {
 		void init(const VulkanContext* context, uint width, uint height, std::vector<VkImageView> endImageViews, 
 			VkPipelineCache pipelineCache, std::vector<VkDescriptorSetLayout> layouts);
 
-		void render(const VulkanContext* context, 
-			std::unordered_map<std::string, std::unordered_map<std::string, std::vector<DrawCommand>>> rendererMap,
-			VkDescriptorSet globalDescriptorSet, VkSemaphore signalSemaphore, RenderMode renderMode);
+		void render(const VulkanContext* context, const RenderQueue& queue,
+			VkDescriptorSet globalDescriptorSet, VkDescriptorSet materialDescriptorSet, VkDescriptorSet objectDescriptorSet,
+			const InstanceSlots& instanceSlots, VkSemaphore signalSemaphore, RenderMode renderMode);
 
 		void resize(const VulkanContext* context, uint width, uint height, std::vector<VkImageView> endImageViews);
 
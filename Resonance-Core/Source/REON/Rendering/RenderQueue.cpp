@@ -0,0 +1,351 @@
+#include "reonpch.h"
+
+#include "RenderQueue.h"
+
+namespace REON
+{
+
+void RenderQueue::UpdateRenderer(Renderer* renderer)
+{
+    RemoveRenderer(renderer);
+
+    auto& entries = m_EntriesByRenderer[renderer];
+    entries.reserve(renderer->drawCommands.size());
+
+    for (const DrawCommand& cmd : renderer->drawCommands)
+    {
+        uint32_t index = allocateEntry();
+        Entry& entry = m_Entries[index];
+        entry.command = cmd;
+        entry.materialSlot = getMaterialSlot(cmd.material);
+        entry.alive = true;
+
+        const AssetId& meshId = cmd.mesh.Key().id;
+        entry.lods[0].range = {cmd.startIndex, cmd.indexCount};
+        entry.lods[0].meshSlot = getMeshSlot(meshId, cmd.startIndex, cmd.indexCount);
+
+        // Every level is its own mesh slot, so only copies drawn at the same level are instanced together
+        const std::shared_ptr<Mesh> mesh = cmd.mesh.Lock();
+        if (mesh && cmd.subMeshIndex < mesh->subMeshes.size())
+        {
+            const SubMesh& subMesh = mesh->subMeshes[cmd.subMeshIndex];
+            entry.meshletCount = subMesh.meshletCount;
+            for (size_t i = 0; i < subMesh.lods.size() && i < mesh->lodErrors.size() && entry.lodCount < MaxLodCount;
+                 i++)
+            {
+                const SubMeshLod& lod = subMesh.lods[i];
+                LodLevel& level = entry.lods[entry.lodCount++];
+                level.range = {lod.indexOffset, lod.indexCount};
+                level.meshSlot = getMeshSlot(meshId, lod.indexOffset, lod.indexCount);
+                level.error = mesh->lodErrors[i];
+            }
+        }
+
+        entries.push_back(index);
+        ++m_LiveEntries;
+    }
+
+    m_MembershipDirty = true;
+}
+
+void RenderQueue::RemoveRenderer(Renderer* renderer)
+{
+    auto it = m_EntriesByRenderer.find(renderer);
+    if (it == m_EntriesByRenderer.end())
+        return;
+
+    for (uint32_t index : it->second)
+    {
+        if (m_Entries[index].stillFrames >= StaticFrameCount)
+            m_StaticVersion++;
+        m_Entries[index] = Entry{};
+        m_FreeEntries.push_back(index);
+        --m_LiveEntries;
+    }
+
+    m_EntriesByRenderer.erase(it);
+    m_MembershipDirty = true;
+}
+
+void RenderQueue::Sort(const RenderView& view)
+{
+    // Material state can be edited without the renderer rebuilding its commands, so resolve it once per slot.
+    for (size_t i = 0; i < m_Materials.size(); i++)
+    {
+        MaterialState& state = m_MaterialStates[i];
+        const RenderBucket previousBucket = state.bucket;
+        auto mat = m_Materials[i].Lock();
+        if (!mat)
+        {
+            state.bucket = RenderBucket::Skipped;
+        }
+        else
+        {
+            state.bucket = (mat->blendingMode == Mask || mat->renderingMode == Opaque) ? RenderBucket::Opaque
+                                                                                       : RenderBucket::Transparent;
+            state.permutation = mat->materialFlags;
+        }
+
+        // Entries moving in or out of the opaque bucket start or stop casting shadows, static ones included
+        if (state.bucket != previousBucket)
+            m_StaticVersion++;
+    }
+
+    if (m_MembershipDirty)
+    {
+        m_Items.clear();
+        m_Items.reserve(m_LiveEntries);
+        for (uint32_t i = 0; i < m_Entries.size(); i++)
+        {
+            if (m_Entries[i].alive)
+                m_Items.push_back({0, i});
+        }
+        m_MembershipDirty = false;
+    }
+
+    const glm::mat4& viewMatrix = view.view;
+    const float nearPlane = view.nearPlane;
+    const float depthScale = float(DrawKey::DepthMask) / glm::max(view.farPlane - nearPlane, 1e-3f);
+
+    // Pixels a unit long line covers at distance one, the projected size of anything is this over its distance
+    const glm::vec3 eye = glm::vec3(glm::inverse(viewMatrix)[3]);
+    const float pixelsPerUnit = glm::abs(view.projection[1][1]) * 0.5f * float(view.viewportSize.y);
+
+    for (RenderQueueItem& item : m_Items)
+    {
+        Entry& entry = m_Entries[item.entry];
+        const MaterialState& state = m_MaterialStates[entry.materialSlot];
+
+        if (entry.lodCount > 1)
+        {
+            // Shadows draw the level the camera sees, a static entry switching levels changes its cached shadow
+            const uint8_t lod = selectLod(entry, m_LodBounds[item.entry], eye, pixelsPerUnit);
+            if (lod != entry.lod && entry.stillFrames >= StaticFrameCount)
+                m_StaticVersion++;
+            entry.lod = lod;
+        }
+
+        // View space looks down -Z, so negate to get a distance that grows away from the camera.
+        const glm::vec3 position = glm::vec3(m_ObjectData[item.entry].model[3]);
+        const float viewDepth = -(viewMatrix[0][2] * position.x + viewMatrix[1][2] * position.y +
+                                  viewMatrix[2][2] * position.z + viewMatrix[3][2]);
+        const float scaled = glm::clamp((viewDepth - nearPlane) * depthScale, 0.0f, float(DrawKey::DepthMask));
+
+        item.key = DrawKey::Make(state.bucket, state.permutation, entry.materialSlot, entry.lods[entry.lod].meshSlot,
+                                 uint32_t(scaled));
+    }
+
+    if (!std::is_sorted(m_Items.begin(), m_Items.end(),
+                        [](const RenderQueueItem& a, const RenderQueueItem& b) { return a.key < b.key; }))
+        radixSort();
+
+    for (uint32_t bucket = 0; bucket < 4; bucket++)
+    {
+        const uint64_t firstKey = uint64_t(bucket) << DrawKey::BucketShift;
+        m_BucketOffsets[bucket] = std::lower_bound(m_Items.begin(), m_Items.end(), firstKey,
+                                                   [](const RenderQueueItem& item, uint64_t key) {
+                                                       return item.key < key;
+                                                   }) -
+                                  m_Items.begin();
+    }
+    m_BucketOffsets[4] = m_Items.size();
+
+    m_CommandOffsets.resize(m_Items.size() + 1);
+    uint32_t commandCount = 0;
+    for (size_t i = 0; i < m_Items.size(); i++)
+    {
+        m_CommandOffsets[i] = commandCount;
+        commandCount += glm::max(GetMeshletCount(m_Items[i]), 1u);
+    }
+    m_CommandOffsets[m_Items.size()] = commandCount;
+}
+
+void RenderQueue::Capture()
+{
+    m_Culler.Resize(m_Entries.size());
+    m_ObjectData.resize(m_Entries.size());
+    m_LodBounds.resize(m_Entries.size());
+    for (size_t i = 0; i < m_Entries.size(); i++)
+    {
+        Entry& entry = m_Entries[i];
+        if (!entry.alive)
+        {
+            // Dead entries get invalid bounds, which always pass and never count as culled.
+            m_Culler.SetBounds(i, AABB{});
+            continue;
+        }
+
+        Renderer* owner = entry.command.owner;
+        const AABB& worldBounds = owner->GetWorldBounds(entry.command.subMeshIndex);
+        m_Culler.SetBounds(i, worldBounds);
+
+        ObjectRenderData& data = m_ObjectData[i];
+        const glm::mat4 model = owner->getModelMatrix();
+        updateStillFrames(entry, model == data.model && entry.command.jointCount == 0);
+        data.model = model;
+        data.transposeInverseModel = owner->getTransposeInverseModelMatrix();
+        data.paletteOffset = entry.command.joinOffset;
+        data.jointCount = entry.command.jointCount;
+
+        if (entry.lodCount > 1)
+        {
+            // Without bounds the camera always counts as inside the sphere, which keeps the full mesh
+            LodBounds& bounds = m_LodBounds[i];
+            bounds.center = worldBounds.GetCenter();
+            bounds.radius = worldBounds.IsValid() ? glm::length(worldBounds.GetExtents())
+                                                  : std::numeric_limits<float>::max();
+            bounds.scale = glm::max(glm::length(glm::vec3(data.model[0])), glm::length(glm::vec3(data.model[1])));
+            bounds.scale = glm::max(bounds.scale, glm::length(glm::vec3(data.model[2])));
+        }
+    }
+
+    m_Visibility.resize(m_Entries.size(), 0);
+}
+
+uint32_t RenderQueue::Cull(const Frustum& frustum, CullView view)
+{
+    REON_CORE_ASSERT(m_Culler.Size() == m_Entries.size(), "Render queue bounds are stale, call Capture first");
+    return m_Culler.Cull(frustum, view, m_Visibility);
+}
+
+std::span<const RenderQueueItem> RenderQueue::GetBucket(RenderBucket bucket) const
+{
+    const uint32_t index = uint32_t(bucket);
+    return std::span<const RenderQueueItem>(m_Items.data() + m_BucketOffsets[index],
+                                            m_BucketOffsets[index + 1] - m_BucketOffsets[index]);
+}
+
+void RenderQueue::updateStillFrames(Entry& entry, bool still)
+{
+    if (!still)
+    {
+        if (entry.stillFrames >= StaticFrameCount)
+            m_StaticVersion++;
+        entry.stillFrames = 0;
+    }
+    else if (entry.stillFrames < StaticFrameCount && ++entry.stillFrames == StaticFrameCount)
+        m_StaticVersion++;
+}
+
+uint32_t RenderQueue::allocateEntry()
+{
+    if (!m_FreeEntries.empty())
+    {
+        uint32_t index = m_FreeEntries.back();
+        m_FreeEntries.pop_back();
+        return index;
+    }
+
+    m_Entries.emplace_back();
+    return static_cast<uint32_t>(m_Entries.size() - 1);
+}
+
+uint16_t RenderQueue::getMaterialSlot(const ResourceHandle<Material>& material)
+{
+    const AssetId& id = material.Key().id;
+    auto it = m_MaterialSlots.find(id);
+    if (it != m_MaterialSlots.end())
+    {
+        // Keep the newest handle, the old one may point at an unloaded slot.
+        m_Materials[it->second] = material;
+        return it->second;
+    }
+
+    REON_CORE_ASSERT(m_Materials.size() <= DrawKey::SlotMask, "Render queue ran out of material slots");
+    uint16_t slot = static_cast<uint16_t>(m_Materials.size());
+    m_MaterialSlots.emplace(id, slot);
+    m_Materials.push_back(material);
+    m_MaterialStates.emplace_back();
+    return slot;
+}
+
+uint16_t RenderQueue::getMeshSlot(const AssetId& mesh, uint32_t startIndex, uint32_t indexCount)
+{
+    const MeshRange range{mesh, startIndex, indexCount};
+    auto it = m_MeshSlots.find(range);
+    if (it != m_MeshSlots.end())
+        return it->second;
+
+    REON_CORE_ASSERT(m_MeshSlots.size() <= DrawKey::SlotMask, "Render queue ran out of mesh slots");
+    uint16_t slot = static_cast<uint16_t>(m_MeshSlots.size());
+    m_MeshSlots.emplace(range, slot);
+    return slot;
+}
+
+uint8_t RenderQueue::selectLod(const Entry& entry, const LodBounds& bounds, const glm::vec3& eye,
+                               float pixelsPerUnit) const
+{
+    // Measured from the nearest point of the bounding sphere, from inside it the full mesh is drawn
+    const float distance = glm::length(bounds.center - eye) - bounds.radius;
+    if (distance <= 0.0f)
+        return 0;
+
+    const float pixelsPerError = bounds.scale * pixelsPerUnit / distance;
+    for (uint8_t lod = entry.lodCount - 1; lod > 0; lod--)
+    {
+        if (entry.lods[lod].error * pixelsPerError <= m_LodPixelError)
+            return lod;
+    }
+    return 0;
+}
+
+uint32_t RenderQueue::GatherInstances(std::span<const RenderQueueItem> items, uint32_t first, uint32_t end,
+                                      CullView view, const InstanceSlots& slots, uint32_t& next,
+                                      CasterFilter filter) const
+{
+    const uint64_t instanceKey = DrawKey::GetInstanceKey(items[first].key);
+    uint32_t* runSlots = slots.data + GetObjectIndex(items[first]);
+
+    uint32_t count = 0;
+    next = first;
+    for (; next < end && DrawKey::GetInstanceKey(items[next].key) == instanceKey; next++)
+    {
+        // Culled items leave their slot unused, the run keeps going past them
+        if (IsVisible(items[next], view, filter))
+            runSlots[count++] = GetObjectIndex(items[next]);
+    }
+    return count;
+}
+
+void RenderQueue::radixSort()
+{
+    // LSD radix sort, 8 bits per pass. All histograms are built in one sweep and passes where every key shares the
+    // same byte are skipped, which drops most of them since bucket/permutation/material rarely vary much.
+    const size_t count = m_Items.size();
+    m_Scratch.resize(count);
+
+    std::array<std::array<uint32_t, 256>, 8> histograms{};
+    for (const RenderQueueItem& item : m_Items)
+    {
+        for (uint32_t pass = 0; pass < 8; pass++)
+            histograms[pass][(item.key >> (pass * 8)) & 0xFF]++;
+    }
+
+    RenderQueueItem* src = m_Items.data();
+    RenderQueueItem* dst = m_Scratch.data();
+
+    for (uint32_t pass = 0; pass < 8; pass++)
+    {
+        auto& histogram = histograms[pass];
+        if (histogram[(src[0].key >> (pass * 8)) & 0xFF] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for (uint32_t& bin : histogram)
+        {
+            uint32_t binCount = bin;
+            bin = offset;
+            offset += binCount;
+        }
+
+        for (size_t i = 0; i < count; i++)
+            dst[histogram[(src[i].key >> (pass * 8)) & 0xFF]++] = src[i];
+
+        std::swap(src, dst);
+    }
+
+    if (src != m_Items.data())
+        std::copy(src, src + count, m_Items.data());
+}
+
+} // namespace REON
@@ -0,0 +1,311 @@
+#pragma once
+
+#include "REON/GameHierarchy/Components/Renderer.h"
+#include "FrustumCuller.h"
+#include "RenderSnapshot.h"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace REON
+{
+
+enum class RenderBucket : uint8_t
+{
+    Opaque = 0,
+    Transparent = 1,
+    Skipped = 3 // material not resident, sorts behind every drawable bucket
+};
+
+// 64-bit sort key, most significant field first:
+// [63..62] bucket | [61..54] pipeline permutation | [53..40] material slot | [39..26] mesh slot | [25..0] depth
+// The mesh slot stands for a mesh and index range, so copies of the same submesh with the same material sort next to
+// each other and can be drawn instanced.
+namespace DrawKey
+{
+constexpr uint32_t BucketShift = 62;
+constexpr uint32_t PermutationShift = 54;
+constexpr uint32_t MaterialShift = 40;
+constexpr uint32_t MeshShift = 26;
+
+constexpr uint64_t PermutationMask = (1ull << 8) - 1;
+constexpr uint64_t SlotMask = (1ull << 14) - 1;
+constexpr uint64_t DepthMask = (1ull << 26) - 1;
+
+constexpr uint64_t Make(RenderBucket bucket, uint32_t permutation, uint32_t materialSlot, uint32_t meshSlot,
+                        uint32_t depth)
+{
+    return (uint64_t(bucket) << BucketShift) | ((permutation & PermutationMask) << PermutationShift) |
+           ((materialSlot & SlotMask) << MaterialShift) | ((meshSlot & SlotMask) << MeshShift) | (depth & DepthMask);
+}
+
+constexpr RenderBucket GetBucket(uint64_t key)
+{
+    return RenderBucket(key >> BucketShift);
+}
+
+constexpr uint32_t GetPermutation(uint64_t key)
+{
+    return uint32_t((key >> PermutationShift) & PermutationMask);
+}
+
+constexpr uint32_t GetMaterialSlot(uint64_t key)
+{
+    return uint32_t((key >> MaterialShift) & SlotMask);
+}
+
+constexpr uint32_t GetMeshSlot(uint64_t key)
+{
+    return uint32_t((key >> MeshShift) & SlotMask);
+}
+
+// Items with equal instance keys only differ in their object data
+constexpr uint64_t GetInstanceKey(uint64_t key)
+{
+    return key & ~DepthMask;
+}
+} // namespace DrawKey
+
+// Views an entry can be culled against, each owns one bit of the visibility mask.
+enum CullView : uint8_t
+{
+    CULL_VIEW_CAMERA = 1 << 0,
+    // Shadow cascades of the main light, cascade i owns bit 1 + i
+    CULL_VIEW_SHADOW_CASCADE_0 = 1 << 1,
+    CULL_VIEW_SHADOW_CASCADE_1 = 1 << 2,
+    CULL_VIEW_SHADOW_CASCADE_2 = 1 << 3,
+    CULL_VIEW_SHADOW_CASCADE_3 = 1 << 4,
+};
+
+constexpr CullView GetShadowCascadeView(uint32_t cascade)
+{
+    return static_cast<CullView>(CULL_VIEW_SHADOW_CASCADE_0 << cascade);
+}
+
+// Which visible entries a draw takes, shadow passes cache the static ones between frames
+enum class CasterFilter : uint8_t
+{
+    All,
+    Static,
+    Dynamic,
+};
+
+struct RenderQueueItem
+{
+    uint64_t key;
+    uint32_t entry;
+};
+
+// Index range an item draws, of the level of detail Sort picked for it
+struct DrawRange
+{
+    uint32_t startIndex;
+    uint32_t indexCount;
+};
+
+// Instance indirection of one view. Shaders read objects[instances[SV_InstanceID]], an instanced draw starting at
+// firstInstance uses the slots from there on. Every item owns the slot at its object index, so a run of items only
+// writes slots it owns and chunks recorded on different threads never overlap.
+struct InstanceSlots
+{
+    uint32_t* data = nullptr;
+    uint32_t dynamicOffset = 0; // of the view's range in the instance buffer
+};
+
+// Persistent list of draw commands, kept sorted by DrawKey. Renderers are only re-inserted when their draw commands
+// were rebuilt; every frame the keys are refreshed (material state, view depth, level of detail) and re-sorted only if
+// one changed. Only UpdateRenderer, RemoveRenderer and Capture read the renderers, everything after works on the
+// captured copy.
+class RenderQueue
+{
+  public:
+    // Levels of detail an entry can switch between, the full mesh included
+    static constexpr uint32_t MaxLodCount = 4;
+    // Captures in a row an entry's model matrix has to stay the same before it counts as static
+    static constexpr uint16_t StaticFrameCount = 30;
+
+    void UpdateRenderer(Renderer* renderer);
+    void RemoveRenderer(Renderer* renderer);
+
+    // Also picks every entry's level of detail for the view, the coarsest one whose simplification error projects to
+    // at most the LOD pixel error. Every view draws the level picked here.
+    void Sort(const RenderView& view);
+    void SetLodPixelError(float pixels)
+    {
+        m_LodPixelError = pixels;
+    }
+
+    // Copies the renderers' world bounds into the culler and their matrices into the per entry object data, once per
+    // frame at the sync point after transforms are final.
+    void Capture();
+    // Records which entries touch the frustum under the given view bit and returns how many were rejected. Runs on
+    // entries rather than sorted items, so it may be called before or after Sort.
+    uint32_t Cull(const Frustum& frustum, CullView view);
+    bool IsVisible(const RenderQueueItem& item, CullView view) const
+    {
+        return (m_Visibility[item.entry] & view) != 0;
+    }
+    bool IsVisible(const RenderQueueItem& item, CullView view, CasterFilter filter) const
+    {
+        return IsVisible(item, view) &&
+               (filter == CasterFilter::All || IsStatic(item) == (filter == CasterFilter::Static));
+    }
+    // Entries whose model matrix stayed the same for StaticFrameCount captures. Skinned entries never count, their
+    // surface moves without the model matrix changing.
+    bool IsStatic(const RenderQueueItem& item) const
+    {
+        return m_Entries[item.entry].stillFrames >= StaticFrameCount;
+    }
+    // Changes whenever an entry becomes or stops being static, or a static entry draws differently. Anything cached
+    // from the static entries is stale once it does.
+    uint64_t GetStaticVersion() const
+    {
+        return m_StaticVersion;
+    }
+
+    std::span<const RenderQueueItem> GetBucket(RenderBucket bucket) const;
+    std::span<const RenderQueueItem> GetItems() const
+    {
+        return m_Items;
+    }
+    // Per object data is streamed in sorted order, so an item's object slot is its position in the queue.
+    uint32_t GetObjectIndex(const RenderQueueItem& item) const
+    {
+        return static_cast<uint32_t>(&item - m_Items.data());
+    }
+    // First indirect command record an item owns. Items drawn per meshlet own one record per meshlet, so their culled
+    // ranges fit, every other item owns one.
+    uint32_t GetCommandIndex(const RenderQueueItem& item) const
+    {
+        return m_CommandOffsets[GetObjectIndex(item)];
+    }
+    uint32_t GetCommandCount() const
+    {
+        return m_CommandOffsets.empty() ? 0 : m_CommandOffsets.back();
+    }
+    // Meshlets of the item's submesh, 0 unless it is drawn at full detail
+    uint32_t GetMeshletCount(const RenderQueueItem& item) const
+    {
+        const Entry& entry = m_Entries[item.entry];
+        return entry.lod == 0 ? entry.meshletCount : 0;
+    }
+    const DrawCommand& GetCommand(const RenderQueueItem& item) const
+    {
+        return m_Entries[item.entry].command;
+    }
+    const DrawRange& GetDrawRange(const RenderQueueItem& item) const
+    {
+        const Entry& entry = m_Entries[item.entry];
+        return entry.lods[entry.lod].range;
+    }
+    const ObjectRenderData& GetObjectData(const RenderQueueItem& item) const
+    {
+        return m_ObjectData[item.entry];
+    }
+
+    // Collects items[first] and the visible items after it, up to end, that share its instance key into slots, so
+    // they can be drawn with one instanced draw starting at GetObjectIndex(items[first]). Returns the instance count
+    // and sets next to the first item after the run.
+    uint32_t GatherInstances(std::span<const RenderQueueItem> items, uint32_t first, uint32_t end, CullView view,
+                             const InstanceSlots& slots, uint32_t& next,
+                             CasterFilter filter = CasterFilter::All) const;
+
+    const std::vector<ResourceHandle<Material>>& GetMaterials() const
+    {
+        return m_Materials;
+    }
+
+    bool Empty() const
+    {
+        return m_LiveEntries == 0;
+    }
+
+  private:
+    struct LodLevel
+    {
+        DrawRange range{};
+        uint16_t meshSlot = 0;
+        float error = 0.0f; // in mesh units
+    };
+
+    struct Entry
+    {
+        DrawCommand command;
+        uint16_t materialSlot = 0;
+        uint8_t lodCount = 1;
+        uint8_t lod = 0;
+        std::array<LodLevel, MaxLodCount> lods{};
+        uint32_t meshletCount = 0;
+        uint16_t stillFrames = 0; // captures the model matrix stayed the same, up to StaticFrameCount
+        bool alive = false;
+    };
+
+    // World space bounding sphere of an entry and the largest scale of its model matrix, which errors in mesh units
+    // are multiplied with
+    struct LodBounds
+    {
+        glm::vec3 center{0.0f};
+        float radius = 0.0f;
+        float scale = 1.0f;
+    };
+
+    struct MaterialState
+    {
+        RenderBucket bucket = RenderBucket::Skipped;
+        uint32_t permutation = 0;
+    };
+
+    uint32_t allocateEntry();
+    void updateStillFrames(Entry& entry, bool still);
+    uint16_t getMaterialSlot(const ResourceHandle<Material>& material);
+    uint16_t getMeshSlot(const AssetId& mesh, uint32_t startIndex, uint32_t indexCount);
+    uint8_t selectLod(const Entry& entry, const LodBounds& bounds, const glm::vec3& eye, float pixelsPerUnit) const;
+    void radixSort();
+
+  private:
+    std::vector<Entry> m_Entries;
+    std::vector<uint32_t> m_FreeEntries;
+    std::unordered_map<Renderer*, std::vector<uint32_t>> m_EntriesByRenderer;
+    size_t m_LiveEntries = 0;
+    bool m_MembershipDirty = false;
+
+    std::unordered_map<AssetId, uint16_t> m_MaterialSlots;
+    std::vector<ResourceHandle<Material>> m_Materials;
+    std::vector<MaterialState> m_MaterialStates;
+    struct MeshRange
+    {
+        AssetId mesh;
+        uint32_t startIndex;
+        uint32_t indexCount;
+
+        bool operator==(const MeshRange&) const = default;
+    };
+    struct MeshRangeHash
+    {
+        size_t operator()(const MeshRange& range) const
+        {
+            size_t hash = std::hash<AssetId>()(range.mesh);
+            hash ^= std::hash<uint64_t>()((uint64_t(range.startIndex) << 32) | range.indexCount) + 0x9e3779b9 +
+                    (hash << 6) + (hash >> 2);
+            return hash;
+        }
+    };
+    std::unordered_map<MeshRange, uint16_t, MeshRangeHash> m_MeshSlots;
+
+    std::vector<RenderQueueItem> m_Items;
+    std::vector<RenderQueueItem> m_Scratch;
+    std::array<size_t, 5> m_BucketOffsets{};
+    std::vector<uint32_t> m_CommandOffsets; // per item and one past the last, prefix sum of the records they own
+
+    FrustumCuller m_Culler;
+    std::vector<uint8_t> m_Visibility;         // per entry, CullView bits
+    std::vector<ObjectRenderData> m_ObjectData; // per entry, as of the last Capture
+    std::vector<LodBounds> m_LodBounds;         // per entry, as of the last Capture
+    float m_LodPixelError = 1.0f;
+    uint64_t m_StaticVersion = 0;
+};
+
+} // namespace REON
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "REON/Rendering/ShadowCascades.h"
+#include "REON/Rendering/Structs/LightData.h"
+#include "glm/glm.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace REON
+{
+class Camera;
+
+// Camera state as it was at the sync point. The camera pointer only identifies the per camera GPU resources, its
+// matrices are never read while recording.
+struct RenderView
+{
+    std::shared_ptr<Camera> camera;
+    glm::mat4 view{1.0f};
+    glm::mat4 projection{1.0f};
+    float nearPlane = 0.1f;
+    float farPlane = 100.0f;
+    glm::uvec2 viewportSize{800, 600};
+};
+
+// Everything the render stage needs from the scene besides the per object data kept in the RenderQueue, captured once
+// per frame between simulation and rendering. Nothing in here points back into game objects, so the next simulation
+// step can run while this frame is recorded.
+struct RenderSnapshot
+{
+    uint64_t frameNumber = 0;
+
+    std::vector<RenderView> views;
+    // Directional and unlimited range lights first, they are not clustered
+    std::vector<LightData> lights;
+    uint32_t globalLightCount = 0;
+
+    // Rotation into the main light's space, its shadow cascades are fitted to the editor camera
+    glm::mat4 mainLightView{1.0f};
+    std::array<ShadowCascade, ShadowCascades::MaxCascades> shadowCascades;
+    uint32_t shadowCascadeCount = 0;
+
+    const RenderView* FindView(const std::shared_ptr<Camera>& camera) const
+    {
+        for (const RenderView& view : views)
+        {
+            if (view.camera == camera)
+                return &view;
+        }
+        return nullptr;
+    }
+};
+
+} // namespace REON
@@ -3,6 +3,8 @@
 #include "Shader.h"
 
 #include "Material.h"
+#include "ShaderPack.h"
+#include "REON/Application.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -23,9 +25,195 @@ Shader::Shader(const std::string& name, std::any metadata)
     }
 }
 
+namespace
+{
+
+constexpr uint32_t SHADER_CACHE_MAGIC = 0x43534552; // "RESC"
+constexpr uint32_t SHADER_CACHE_VERSION = 1;
+
+struct ShaderCacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t codeSize;
+};
+
+// DXC instances are expensive to create but not thread safe, so every thread that compiles keeps its own.
+struct DxcInstances
+{
+    ComPtr<IDxcUtils> utils;
+    ComPtr<IDxcCompiler3> compiler;
+    ComPtr<IDxcIncludeHandler> includeHandler;
+    // Part of every cache key, SPIR-V from another compiler build is not reused
+    uint64_t compilerVersion = 0;
+};
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    // FNV-1a 64-bit
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+DxcInstances& getDxcInstances()
+{
+    thread_local DxcInstances instances;
+    if (instances.compiler)
+        return instances;
+
+    HRESULT hres = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&instances.compiler));
+    REON_CORE_ASSERT(SUCCEEDED(hres), "Could not init DXC Compiler");
+
+    hres = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&instances.utils));
+    REON_CORE_ASSERT(SUCCEEDED(hres), "Could not init DXC Utility");
+
+    instances.utils->CreateDefaultIncludeHandler(&instances.includeHandler);
+
+    uint32_t version[2] = {0, 0};
+    ComPtr<IDxcVersionInfo> versionInfo;
+    if (SUCCEEDED(instances.compiler.As(&versionInfo)))
+        versionInfo->GetVersion(&version[0], &version[1]);
+    instances.compilerVersion = hashBytes(1469598103934665603ull, version, sizeof(version));
+
+    ComPtr<IDxcVersionInfo2> commitInfo;
+    char* commitHash = nullptr;
+    uint32_t commitCount = 0;
+    if (SUCCEEDED(instances.compiler.As(&commitInfo)) && SUCCEEDED(commitInfo->GetCommitInfo(&commitCount, &commitHash)))
+    {
+        instances.compilerVersion = hashBytes(instances.compilerVersion, &commitCount, sizeof(commitCount));
+        if (commitHash)
+        {
+            instances.compilerVersion = hashBytes(instances.compilerVersion, commitHash, strlen(commitHash));
+            CoTaskMemFree(commitHash);
+        }
+    }
+
+    return instances;
+}
+
+std::mutex s_ShaderPackMutex;
+std::shared_ptr<const ShaderPack> s_ShaderPack;
+
+// Compiled SPIR-V of this session by key, permutations and hot reloads of unchanged shaders never reach DXC twice
+std::mutex s_CacheMutex;
+std::unordered_map<uint64_t, std::vector<char>> s_MemoryCache;
+
+std::filesystem::path getCacheFilePath(uint64_t key)
+{
+    const std::filesystem::path& cookedRoot = Application::Get().GetEngineServices().cookedRoot;
+    if (cookedRoot.empty())
+        return {};
+    return cookedRoot / "ShaderCache" / fmt::format("{:016x}.spv", key);
+}
+
+std::vector<char> readCacheFile(uint64_t key)
+{
+    const std::filesystem::path path = getCacheFilePath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (path.empty() || !file)
+        return {};
+
+    ShaderCacheFileHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != SHADER_CACHE_MAGIC ||
+        header.version != SHADER_CACHE_VERSION || header.key != key || header.codeSize == 0)
+        return {};
+
+    std::vector<char> code(header.codeSize);
+    if (!file.read(code.data(), code.size()))
+        return {};
+    return code;
+}
+
+void writeCacheFile(uint64_t key, const std::vector<char>& code)
+{
+    const std::filesystem::path path = getCacheFilePath(key);
+    if (path.empty())
+        return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // Threads compiling the same permutation each write their own file, the rename makes whichever finishes last win
+    std::filesystem::path tempPath = path;
+    tempPath += fmt::format(".{}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        const ShaderCacheFileHeader header{SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, key, code.size()};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(code.data(), code.size());
+        if (!file)
+        {
+            REON_CORE_WARN("Could not write shader cache {0}", tempPath.string());
+            return;
+        }
+    }
+
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+    {
+        REON_CORE_WARN("Could not write shader cache {0}: {1}", path.string(), ec.message());
+        std::filesystem::remove(tempPath, ec);
+    }
+}
+
+// Runs only the preprocessor, the result covers the source, every include and the define set at a fraction of the
+// cost of a compile. Returns false when DXC could not preprocess, the shader is then compiled without the cache.
+bool hashPreprocessedSource(DxcInstances& dxc, const DxcBuffer& buffer, std::vector<LPCWSTR> arguments,
+                            uint64_t& key)
+{
+    arguments.push_back(L"-P");
+
+    ComPtr<IDxcResult> result;
+    HRESULT hres = dxc.compiler->Compile(&buffer, arguments.data(), static_cast<uint32_t>(arguments.size()),
+                                         dxc.includeHandler.Get(), IID_PPV_ARGS(&result));
+    if (SUCCEEDED(hres))
+        result->GetStatus(&hres);
+    if (FAILED(hres))
+        return false;
+
+    ComPtr<IDxcBlobUtf8> preprocessed;
+    if (FAILED(result->GetOutput(DXC_OUT_HLSL, IID_PPV_ARGS(&preprocessed), nullptr)) || !preprocessed)
+        return false;
+
+    key = hashBytes(dxc.compilerVersion, preprocessed->GetStringPointer(), preprocessed->GetStringLength());
+    // Target profile, entry point and debug info change the SPIR-V without showing up in the preprocessed source
+    for (LPCWSTR argument : arguments)
+        key = hashBytes(key, argument, wcslen(argument) * sizeof(wchar_t));
+    return true;
+}
+
+} // namespace
+
+void Shader::SetShaderPack(std::shared_ptr<const ShaderPack> pack)
+{
+    std::lock_guard<std::mutex> lock(s_ShaderPackMutex);
+    s_ShaderPack = std::move(pack);
+}
+
 std::vector<char> Shader::CompileHLSLToSPIRV(const std::string& source, uint32_t flags)
 {
+    std::shared_ptr<const ShaderPack> pack;
+    {
+        std::lock_guard<std::mutex> lock(s_ShaderPackMutex);
+        pack = s_ShaderPack;
+    }
+    if (pack)
+    {
+        if (const std::vector<char>* code = pack->Find(source, flags))
+            return *code;
+    }
 
+    return CompileHLSLSource(source, flags);
+}
+
+std::vector<char> Shader::CompileHLSLSource(const std::string& source, uint32_t flags)
+{
     std::filesystem::path shaderPath = std::filesystem::absolute(std::filesystem::path(source));
     std::filesystem::path parentPath = shaderPath.parent_path();
 
@@ -35,24 +223,11 @@ std::vector<char> Shader::CompileHLSLToSPIRV(const std::string& source, uint32_t
 
     HRESULT hres;
 
-    ComPtr<IDxcLibrary> library;
-    hres = DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&library));
-    REON_CORE_ASSERT(SUCCEEDED(hres), "Could not init DXC Library");
-
-    ComPtr<IDxcCompiler3> compiler;
-    hres = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
-    REON_CORE_ASSERT(SUCCEEDED(hres), "Could not init DXC Compiler");
-
-    ComPtr<IDxcUtils> utils;
-    hres = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils));
-    REON_CORE_ASSERT(SUCCEEDED(hres), "Could not init DXC Utility");
-
-    ComPtr<IDxcIncludeHandler> includeHandler;
-    utils->CreateDefaultIncludeHandler(&includeHandler);
+    DxcInstances& dxc = getDxcInstances();
 
     uint32_t codePage = DXC_CP_ACP;
     ComPtr<IDxcBlobEncoding> sourceBlob;
-    hres = utils->LoadFile(filename.c_str(), &codePage, &sourceBlob);
+    hres = dxc.utils->LoadFile(filename.c_str(), &codePage, &sourceBlob);
     REON_CORE_ASSERT(SUCCEEDED(hres), "Could not load shader file");
 
     LPCWSTR targetProfile{};
@@ -128,24 +303,44 @@ std::vector<char> Shader::CompileHLSLToSPIRV(const std::string& source, uint32_t
     buffer.Ptr = sourceBlob->GetBufferPointer();
     buffer.Size = sourceBlob->GetBufferSize();
 
+    uint64_t key = 0;
+    const bool cacheable = hashPreprocessedSource(dxc, buffer, arguments, key);
+    if (cacheable)
+    {
+        {
+            std::lock_guard<std::mutex> lock(s_CacheMutex);
+            auto it = s_MemoryCache.find(key);
+            if (it != s_MemoryCache.end())
+                return it->second;
+        }
+
+        std::vector<char> cachedCode = readCacheFile(key);
+        if (!cachedCode.empty())
+        {
+            std::lock_guard<std::mutex> lock(s_CacheMutex);
+            s_MemoryCache.insert({key, cachedCode});
+            return cachedCode;
+        }
+    }
+
     ComPtr<IDxcResult> result{nullptr};
-    hres = compiler->Compile(&buffer, arguments.data(), static_cast<uint32_t>(arguments.size()), includeHandler.Get(),
-                             IID_PPV_ARGS(&result));
+    hres = dxc.compiler->Compile(&buffer, arguments.data(), static_cast<uint32_t>(arguments.size()),
+                                 dxc.includeHandler.Get(), IID_PPV_ARGS(&result));
 
     if (SUCCEEDED(hres))
     {
         result->GetStatus(&hres);
     }
 
-    if (FAILED(hres) && (result))
+    if (FAILED(hres))
     {
         ComPtr<IDxcBlobEncoding> errorBlob;
-        hres = result->GetErrorBuffer(&errorBlob);
-        if (SUCCEEDED(hres) && errorBlob)
+        if (result && SUCCEEDED(result->GetErrorBuffer(&errorBlob)) && errorBlob)
         {
             REON_CORE_ERROR("Shader compilation failed: \n\n{}", (const char*)errorBlob->GetBufferPointer());
             // throw std::runtime_error("Compilation failed");
         }
+        return {};
     }
 
     ComPtr<IDxcBlob> code;
@@ -154,6 +349,13 @@ std::vector<char> Shader::CompileHLSLToSPIRV(const std::string& source, uint32_t
     const char* byteCodePtr = reinterpret_cast<const char*>(code->GetBufferPointer());
     std::vector<char> shaderCode(byteCodePtr, byteCodePtr + code->GetBufferSize());
 
+    if (cacheable && !shaderCode.empty())
+    {
+        writeCacheFile(key, shaderCode);
+        std::lock_guard<std::mutex> lock(s_CacheMutex);
+        s_MemoryCache.insert({key, shaderCode});
+    }
+
     return shaderCode;
 }
 
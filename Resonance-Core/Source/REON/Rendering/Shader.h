@@ -20,6 +20,8 @@
 namespace REON
 {
 
+struct ShaderPack;
+
 class [[clang::annotate("serialize")]] Shader : public ResourceBase
 {
   public:
@@ -31,7 +33,14 @@ class [[clang::annotate("serialize")]] Shader : public ResourceBase
 
     void use() {}
 
+    // Bytecode from the shader pack when it holds the permutation, CompileHLSLSource otherwise.
     static std::vector<char> CompileHLSLToSPIRV(const std::string& source, uint32_t flags = 0);
+    // Thread safe, every thread keeps its own DXC instances. The SPIR-V is cached in memory and in the cooked
+    // directory, keyed by the preprocessed source (includes and defines resolved), the arguments and the DXC version.
+    // Returns an empty vector when compilation failed.
+    static std::vector<char> CompileHLSLSource(const std::string& source, uint32_t flags = 0);
+    // Precompiled bytecode to prefer over the sources, null compiles everything from source again.
+    static void SetShaderPack(std::shared_ptr<const ShaderPack> pack);
     std::vector<char> getVertexSPIRV()
     {
         if (m_VertexSPIRV.empty())
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "REON/AssetManagement/Asset.h"
+#include "REON/ResourceManagement/Resource.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace REON
+{
+// Precompiled SPIR-V of every shader permutation the cooked project uses, written by the editor's shader cook.
+struct ShaderPack : public ResourceBase
+{
+    static constexpr AssetTypeId kType = ASSET_SHADER_PACK;
+
+    // Null when the pack holds no bytecode for this source and permutation
+    const std::vector<char>* Find(std::string_view source, uint32_t flags) const
+    {
+        auto it = shaders.find(source);
+        if (it == shaders.end())
+            return nullptr;
+
+        auto permutation = it->second.find(flags);
+        return permutation != it->second.end() ? &permutation->second : nullptr;
+    }
+
+    struct SourceHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view source) const noexcept
+        {
+            return std::hash<std::string_view>()(source);
+        }
+    };
+
+    // SPIR-V by the path the shader is requested with, then by MaterialShaderFlags
+    std::unordered_map<std::string, std::unordered_map<uint32_t, std::vector<char>>, SourceHash, std::equal_to<>>
+        shaders;
+};
+} // namespace REON
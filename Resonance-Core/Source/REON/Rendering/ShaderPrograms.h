@@ -0,0 +1,44 @@
+#pragma once
+
+#include "REON/Rendering/Material.h"
+
+#include <cstdint>
+
+namespace REON
+{
+
+struct ShaderProgram
+{
+    const char* vertex;
+    const char* fragment;
+};
+
+// Every program the renderer creates pipelines from. The shader cook compiles these into the shader pack, so the paths
+// have to match the ones the passes request at runtime.
+inline constexpr ShaderProgram OpaqueProgram{"Assets/Shaders/vert.vert", "Assets/Shaders/frag.frag"};
+inline constexpr ShaderProgram TransparentProgram{"Assets/Shaders/Transparent.vert", "Assets/Shaders/Transparent.frag"};
+inline constexpr ShaderProgram DirectionalShadowProgram{"Assets/Shaders/DirectionalShadow.vert",
+                                                        "Assets/Shaders/DirectionalShadow.frag"};
+inline constexpr ShaderProgram TransparentCompositeProgram{"Assets/Shaders/fullScreen.vert",
+                                                           "Assets/Shaders/WBOITComposite.frag"};
+
+// The permutation the material passes create their base pipeline with, every other permutation derives from it.
+inline constexpr uint32_t BaseMaterialPermutation = AlbedoTexture | NormalTexture | MetallicRoughnessTexture;
+
+// Created at startup whether or not a material uses them, anything else compiles the first time it is drawn.
+inline constexpr uint32_t OpaquePrebakedPermutations[] = {
+    0,
+    AlbedoTexture | NormalTexture | MetallicRoughnessTexture | OcclusionTexture,
+    AlbedoTexture | NormalTexture | MetallicRoughnessTexture | OcclusionTexture | EmissiveTexture,
+    NormalTexture | MetallicRoughnessTexture,
+    MetallicRoughnessTexture,
+    AlbedoTexture | NormalTexture,
+};
+inline constexpr uint32_t TransparentPrebakedPermutations[] = {
+    0,
+    NormalTexture | MetallicRoughnessTexture,
+    MetallicRoughnessTexture,
+    AlbedoTexture | NormalTexture,
+};
+
+} // namespace REON
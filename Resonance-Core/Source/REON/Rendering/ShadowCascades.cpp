@@ -0,0 +1,167 @@
+#include "reonpch.h"
+
+#include "ShadowCascades.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <array>
+
+namespace REON
+{
+
+void ShadowCascades::ComputeSplits(float nearPlane, float farPlane, float lambda, std::span<float> splits)
+{
+    if (splits.empty())
+        return;
+
+    const size_t last = splits.size() - 1;
+    for (size_t i = 0; i <= last; i++)
+    {
+        const float fraction = last > 0 ? float(i) / float(last) : 0.0f;
+        const float logarithmic = nearPlane * glm::pow(farPlane / nearPlane, fraction);
+        const float uniform = nearPlane + (farPlane - nearPlane) * fraction;
+        splits[i] = glm::mix(uniform, logarithmic, lambda);
+    }
+    splits[0] = nearPlane;
+    splits[last] = farPlane;
+}
+
+uint32_t ShadowCascades::Fit(const glm::mat4& cameraView, const glm::mat4& cameraProjection, float nearPlane,
+                             float farPlane, const glm::mat4& lightView, uint32_t resolution,
+                             const ShadowCascadeSettings& settings, std::span<ShadowCascade> cascades)
+{
+    const uint32_t count = std::min({settings.cascadeCount, static_cast<uint32_t>(cascades.size()), MaxCascades});
+    if (count == 0 || resolution <= 2 * BorderTexels)
+        return 0;
+
+    const float nearDepth = glm::max(nearPlane, 1e-4f);
+    const float farDepth = glm::max(glm::min(farPlane, settings.shadowDistance), nearDepth * 1.001f);
+    std::array<float, MaxCascades + 1> splits;
+    ComputeSplits(nearDepth, farDepth, glm::clamp(settings.splitLambda, 0.0f, 1.0f),
+                  std::span<float>(splits.data(), count + 1));
+
+    // Corner edges of the frustum as lines through view space, found from two depths so orthographic cameras work too
+    const glm::mat4 inverseProjection = glm::inverse(cameraProjection);
+    std::array<glm::vec3, 4> nearCorners, farCorners;
+    for (uint32_t corner = 0; corner < 4; corner++)
+    {
+        const glm::vec2 ndc((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f);
+        const glm::vec4 a = inverseProjection * glm::vec4(ndc, 0.0f, 1.0f);
+        const glm::vec4 b = inverseProjection * glm::vec4(ndc, 1.0f, 1.0f);
+        nearCorners[corner] = glm::vec3(a) / a.w;
+        farCorners[corner] = glm::vec3(b) / b.w;
+    }
+    auto cornerAt = [&](uint32_t corner, float depth) {
+        const glm::vec3& a = nearCorners[corner];
+        const glm::vec3& b = farCorners[corner];
+        // View space looks down -Z, so the far point has the smaller z
+        const float t = (-depth - a.z) / glm::min(b.z - a.z, -1e-6f);
+        return a + (b - a) * t;
+    };
+
+    const glm::mat4 inverseView = glm::inverse(cameraView);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ShadowCascade& cascade = cascades[i];
+        cascade.nearDepth = splits[i];
+        cascade.farDepth = splits[i + 1];
+
+        std::array<glm::vec3, 8> corners;
+        glm::vec3 nearCenter(0.0f), farCenter(0.0f);
+        for (uint32_t corner = 0; corner < 4; corner++)
+        {
+            corners[corner] = cornerAt(corner, cascade.nearDepth);
+            corners[corner + 4] = cornerAt(corner, cascade.farDepth);
+            nearCenter += corners[corner] * 0.25f;
+            farCenter += corners[corner + 4] * 0.25f;
+        }
+
+        // The sphere's center sits on the slice's axis where the near and far corners are equally far away, its radius
+        // only depends on the slice's shape so it stays the same however the camera is oriented.
+        float nearSpread = 0.0f, farSpread = 0.0f;
+        for (uint32_t corner = 0; corner < 4; corner++)
+        {
+            nearSpread = glm::max(nearSpread, glm::dot(corners[corner] - nearCenter, corners[corner] - nearCenter));
+            farSpread = glm::max(farSpread, glm::dot(corners[corner + 4] - farCenter, corners[corner + 4] - farCenter));
+        }
+        const glm::vec3 axis = farCenter - nearCenter;
+        const float axisLengthSq = glm::dot(axis, axis);
+        const float t = axisLengthSq > 0.0f
+                            ? glm::clamp((axisLengthSq + farSpread - nearSpread) / (2.0f * axisLengthSq), 0.0f, 1.0f)
+                            : 0.0f;
+        const glm::vec3 center = nearCenter + axis * t;
+
+        float radius = 0.0f;
+        for (const glm::vec3& corner : corners)
+            radius = glm::max(radius, glm::length(corner - center));
+        // Rounded up so float noise in the corners cannot change the cascade's size from one frame to the next
+        radius = glm::ceil(radius * 16.0f) / 16.0f;
+
+        const float halfExtent = radius * float(resolution) / float(resolution - 2 * BorderTexels);
+        cascade.texelSize = 2.0f * halfExtent / float(resolution);
+
+        const glm::vec3 worldCenter = glm::vec3(inverseView * glm::vec4(center, 1.0f));
+        cascade.sphere = glm::vec4(worldCenter, radius);
+
+        // Snapped to the texel grid of the light's view, the shadow map then moves in whole texels
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(worldCenter, 1.0f));
+        lightCenter.x = glm::floor(lightCenter.x / cascade.texelSize) * cascade.texelSize;
+        lightCenter.y = glm::floor(lightCenter.y / cascade.texelSize) * cascade.texelSize;
+
+        cascade.lightMin = glm::vec2(lightCenter) - halfExtent;
+        cascade.lightMax = glm::vec2(lightCenter) + halfExtent;
+        cascade.lightNear = -lightCenter.z - radius - settings.casterDistance;
+        cascade.lightFar = -lightCenter.z + radius;
+        const glm::mat4 projection = glm::ortho(cascade.lightMin.x, cascade.lightMax.x, cascade.lightMin.y,
+                                                cascade.lightMax.y, cascade.lightNear, cascade.lightFar);
+        cascade.viewProj = projection * lightView;
+    }
+    return count;
+}
+
+ShadowCacheRegion ShadowCascades::FitCacheRegion(const ShadowCascade& cascade, const glm::mat4& lightView,
+                                                 uint32_t marginTexels)
+{
+    const float margin = float(marginTexels) * cascade.texelSize;
+
+    ShadowCacheRegion region;
+    region.texelSize = cascade.texelSize;
+    region.lightMin = cascade.lightMin - margin;
+    region.lightMax = cascade.lightMax + margin;
+    region.lightNear = cascade.lightNear - margin;
+    region.lightFar = cascade.lightFar + margin;
+    region.viewProj = glm::ortho(region.lightMin.x, region.lightMax.x, region.lightMin.y, region.lightMax.y,
+                                 region.lightNear, region.lightFar) *
+                      lightView;
+    return region;
+}
+
+bool ShadowCascades::PlaceInCacheRegion(ShadowCascade& cascade, const ShadowCacheRegion& region,
+                                        const glm::mat4& lightView, glm::uvec2& texelOffset)
+{
+    // A resized cascade no longer shares the region's texel grid
+    if (cascade.texelSize != region.texelSize || cascade.lightNear < region.lightNear ||
+        cascade.lightFar > region.lightFar)
+        return false;
+
+    // Both corners sit on the same grid, so the distances are whole texels up to float noise
+    const glm::vec2 offset = glm::round((cascade.lightMin - region.lightMin) / region.texelSize);
+    const glm::vec2 extent = glm::round((cascade.lightMax - cascade.lightMin) / region.texelSize);
+    const glm::vec2 regionExtent = glm::round((region.lightMax - region.lightMin) / region.texelSize);
+    if (offset.x < 0.0f || offset.y < 0.0f || offset.x + extent.x > regionExtent.x ||
+        offset.y + extent.y > regionExtent.y)
+        return false;
+
+    // Rebuilt from the region's corner, so the cascade's texels line up with the region's exactly
+    texelOffset = glm::uvec2(offset);
+    cascade.lightMin = region.lightMin + offset * region.texelSize;
+    cascade.lightMax = cascade.lightMin + extent * region.texelSize;
+    cascade.lightNear = region.lightNear;
+    cascade.lightFar = region.lightFar;
+    cascade.viewProj = glm::ortho(cascade.lightMin.x, cascade.lightMax.x, cascade.lightMin.y, cascade.lightMax.y,
+                                  cascade.lightNear, cascade.lightFar) *
+                       lightView;
+    return true;
+}
+
+} // namespace REON
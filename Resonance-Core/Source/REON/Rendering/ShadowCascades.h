@@ -0,0 +1,80 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <span>
+
+namespace REON
+{
+
+struct ShadowCascadeSettings
+{
+    uint32_t cascadeCount = 4;
+    // Blend between uniform (0) and logarithmic (1) splits, the practical split scheme
+    float splitLambda = 0.75f;
+    // View depth past which nothing receives a shadow, capped at the camera's far plane
+    float shadowDistance = 50.0f;
+    // How far towards the light from a cascade's slice casters are still rendered into it
+    float casterDistance = 100.0f;
+};
+
+// One cascade of the main light's shadow, covering the camera frustum between two view depths.
+struct ShadowCascade
+{
+    glm::mat4 viewProj{1.0f};
+    glm::vec4 sphere{0.0f}; // world space bounding sphere of the frustum slice, xyz center and w radius
+    float nearDepth = 0.0f;
+    float farDepth = 0.0f;
+    float texelSize = 0.0f; // world units per shadow map texel
+    // Orthographic box in the light's view, xy corners and the distances of the near and far plane
+    glm::vec2 lightMin{0.0f};
+    glm::vec2 lightMax{0.0f};
+    float lightNear = 0.0f;
+    float lightFar = 0.0f;
+};
+
+// Light space region the static casters of a cascade are cached for. It lies on the cascade's texel grid and reaches
+// past the cascade on every side, so while the camera moves the cascade finds its texels in the region at a whole
+// texel offset until it leaves it.
+struct ShadowCacheRegion
+{
+    glm::mat4 viewProj{1.0f};
+    glm::vec2 lightMin{0.0f};
+    glm::vec2 lightMax{0.0f};
+    float lightNear = 0.0f;
+    float lightFar = 0.0f;
+    float texelSize = 0.0f;
+};
+
+// Fits shadow cascades to a camera's frustum. Every cascade bounds its frustum slice with a sphere, so its size does
+// not change as the camera turns, and moves in whole texels of the light's view, so edges do not shimmer as the camera
+// moves.
+class ShadowCascades
+{
+  public:
+    static constexpr uint32_t MaxCascades = 4;
+
+    // Writes splits.size() view depths from nearPlane to farPlane, blending logarithmic and uniform spacing by lambda.
+    static void ComputeSplits(float nearPlane, float farPlane, float lambda, std::span<float> splits);
+
+    // Fits min(settings.cascadeCount, cascades.size(), MaxCascades) cascades and returns how many. lightView only
+    // rotates into the light's space, resolution is the texel count along one side of a cascade's shadow map.
+    static uint32_t Fit(const glm::mat4& cameraView, const glm::mat4& cameraProjection, float nearPlane, float farPlane,
+                        const glm::mat4& lightView, uint32_t resolution, const ShadowCascadeSettings& settings,
+                        std::span<ShadowCascade> cascades);
+
+    // Region around a fitted cascade reaching marginTexels texels past it on every side, and as far again towards and
+    // away from the light.
+    static ShadowCacheRegion FitCacheRegion(const ShadowCascade& cascade, const glm::mat4& lightView,
+                                            uint32_t marginTexels);
+    // When the cascade lies inside the region, moves it onto the region's depth range so both store the same depth
+    // and writes where the cascade's first texel sits in the region. Returns false when the cascade left the region.
+    static bool PlaceInCacheRegion(ShadowCascade& cascade, const ShadowCacheRegion& region, const glm::mat4& lightView,
+                                   glm::uvec2& texelOffset);
+
+    // Texels a cascade keeps free along its edges: one lost to snapping, two for the filter taps of shaded pixels.
+    static constexpr uint32_t BorderTexels = 3;
+};
+
+} // namespace REON
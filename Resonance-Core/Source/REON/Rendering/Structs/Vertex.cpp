@@ -0,0 +1,52 @@
+#include "reonpch.h"
+
+#include "Vertex.h"
+
+namespace REON
+{
+
+VertexStreams PackVertexStreams(std::span<const glm::vec3> positions, std::span<const glm::vec3> normals,
+                                std::span<const glm::vec4> tangents, std::span<const glm::vec2> uvs,
+                                std::span<const glm::vec4> colors, std::span<const glm::u16vec4> joints0,
+                                std::span<const glm::u16vec4> joints1, std::span<const glm::vec4> weights0,
+                                std::span<const glm::vec4> weights1)
+{
+    const size_t count = positions.size();
+    auto at = [](auto span, size_t i, auto fallback) { return i < span.size() ? span[i] : fallback; };
+
+    VertexStreams streams;
+    streams.positions.assign(positions.begin(), positions.end());
+
+    streams.attributes.resize(count);
+    for (size_t i = 0; i < count; i++)
+        streams.attributes[i] = PackVertexAttributes(at(normals, i, glm::vec3(0.0f)), at(tangents, i, glm::vec4(0.0f)),
+                                                     at(uvs, i, glm::vec2(0.0f)));
+
+    const uint32_t white = PackVertexColor(glm::vec4(1.0f));
+    std::vector<uint32_t> packedColors(std::min(colors.size(), count));
+    bool anyColor = false;
+    for (size_t i = 0; i < packedColors.size(); i++)
+    {
+        packedColors[i] = PackVertexColor(colors[i]);
+        anyColor |= packedColors[i] != white;
+    }
+    if (anyColor)
+    {
+        packedColors.resize(count, white);
+        streams.colors = std::move(packedColors);
+        streams.format |= VERTEX_FORMAT_COLOR;
+    }
+
+    if (!joints0.empty() && !weights0.empty())
+    {
+        streams.skin.resize(count);
+        for (size_t i = 0; i < count; i++)
+            streams.skin[i] = PackVertexSkin(at(joints0, i, glm::u16vec4(0)), at(joints1, i, glm::u16vec4(0)),
+                                             at(weights0, i, glm::vec4(0.0f)), at(weights1, i, glm::vec4(0.0f)));
+        streams.format |= VERTEX_FORMAT_SKIN;
+    }
+
+    return streams;
+}
+
+} // namespace REON
@@ -1,81 +1,216 @@
 #pragma once
 
 #include "glm/glm.hpp"
+#include "glm/gtc/constants.hpp"
+#include "glm/gtc/packing.hpp"
 #include <vulkan/vulkan.h>
-#include <array>
 
-namespace REON{
-
-    struct Vertex {
-        glm::vec3 Position;
-		glm::vec4 Color;
-        glm::vec3 Normal;
-        glm::vec2 TexCoords;
-        glm::vec4 Tangent;
-        glm::u16vec4 Joints_0;
-        glm::u16vec4 Joints_1;
-        glm::vec4 Weights_0;
-        glm::vec4 Weights_1;
-
-		static VkVertexInputBindingDescription getBindingDescription() {
-			VkVertexInputBindingDescription bindingDescription{};
-			bindingDescription.binding = 0;
-			bindingDescription.stride = sizeof(Vertex);
-			bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-			return bindingDescription;
-		}
-
-		static std::array<VkVertexInputAttributeDescription, 9> getAttributeDescriptions() {
-			std::array<VkVertexInputAttributeDescription, 9> attributeDescriptions{};
-
-			attributeDescriptions[0].binding = 0;
-			attributeDescriptions[0].location = 0;
-			attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-			attributeDescriptions[0].offset = offsetof(Vertex, Position);
-
-			attributeDescriptions[1].binding = 0;
-			attributeDescriptions[1].location = 1;
-			attributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-			attributeDescriptions[1].offset = offsetof(Vertex, Color);
-
-			attributeDescriptions[2].binding = 0;
-			attributeDescriptions[2].location = 2;
-			attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-			attributeDescriptions[2].offset = offsetof(Vertex, Normal);
-
-			attributeDescriptions[3].binding = 0;
-			attributeDescriptions[3].location = 3;
-			attributeDescriptions[3].format = VK_FORMAT_R32G32_SFLOAT;
-			attributeDescriptions[3].offset = offsetof(Vertex, TexCoords);
-
-			attributeDescriptions[4].binding = 0;
-			attributeDescriptions[4].location = 4;
-			attributeDescriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-			attributeDescriptions[4].offset = offsetof(Vertex, Tangent);
-
-			attributeDescriptions[5].binding = 0;
-            attributeDescriptions[5].location = 5;
-            attributeDescriptions[5].format = VK_FORMAT_R16G16B16A16_UINT;
-            attributeDescriptions[5].offset = offsetof(Vertex, Joints_0);
-
-			attributeDescriptions[6].binding = 0;
-            attributeDescriptions[6].location = 6;
-            attributeDescriptions[6].format = VK_FORMAT_R16G16B16A16_UINT;
-            attributeDescriptions[6].offset = offsetof(Vertex, Joints_1);
-
-			attributeDescriptions[7].binding = 0;
-            attributeDescriptions[7].location = 7;
-            attributeDescriptions[7].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-            attributeDescriptions[7].offset = offsetof(Vertex, Weights_0);
-
-            attributeDescriptions[8].binding = 0;
-            attributeDescriptions[8].location = 8;
-            attributeDescriptions[8].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-            attributeDescriptions[8].offset = offsetof(Vertex, Weights_1);
-
-			return attributeDescriptions;
-		}
-    };
-
-}
\ No newline at end of file
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace REON
+{
+
+// Vertex buffer bindings of the geometry pool, one buffer per stream. Position and attributes exist for every mesh,
+// color and skin only for meshes that carry them.
+enum class VertexStream : uint32_t
+{
+    Position = 0,
+    Attributes,
+    Color,
+    Skin,
+    Count
+};
+
+// Which optional streams a mesh has, stored in MeshHeader::flags of cooked meshes.
+enum VertexFormatFlags : uint32_t
+{
+    VERTEX_FORMAT_COLOR = 1 << 0,
+    VERTEX_FORMAT_SKIN = 1 << 1,
+};
+
+// Normal, tangent and uv in 12 bytes. xy is the octahedral normal, z the tangent's angle around the normal over pi,
+// measured in the basis OrthonormalBasis builds from the decoded normal, w the bitangent sign. Decoded by
+// vertex_packing.hlsl, which has to stay in sync with the functions below.
+struct PackedVertexAttributes
+{
+    int16_t normalTangent[4]; // R16G16B16A16_SNORM
+    uint16_t uv[2];           // R16G16_SFLOAT
+};
+static_assert(sizeof(PackedVertexAttributes) == 12, "PackedVertexAttributes no longer matches the vertex layout");
+
+struct PackedVertexSkin
+{
+    uint16_t joints[8];  // 2x R16G16B16A16_UINT
+    uint16_t weights[8]; // 2x R16G16B16A16_UNORM, normalized to sum up to one
+};
+static_assert(sizeof(PackedVertexSkin) == 32, "PackedVertexSkin no longer matches the vertex layout");
+
+// The streams of one mesh as the cook writes them and the geometry pool uploads them. colors and skin are empty unless
+// format has their flag.
+struct VertexStreams
+{
+    uint32_t format = 0;
+    std::vector<glm::vec3> positions;
+    std::vector<PackedVertexAttributes> attributes;
+    std::vector<uint32_t> colors; // R8G8B8A8_UNORM
+    std::vector<PackedVertexSkin> skin;
+
+    uint32_t GetVertexCount() const
+    {
+        return static_cast<uint32_t>(positions.size());
+    }
+};
+
+// Packs unpacked attributes into streams. Every span but positions may be empty, missing normals, tangents and uvs are
+// packed as zero, missing colors and skinning leave out their stream. So do colors that are all white, which is what
+// absent colors read as.
+VertexStreams PackVertexStreams(std::span<const glm::vec3> positions, std::span<const glm::vec3> normals,
+                                std::span<const glm::vec4> tangents, std::span<const glm::vec2> uvs,
+                                std::span<const glm::vec4> colors, std::span<const glm::u16vec4> joints0,
+                                std::span<const glm::u16vec4> joints1, std::span<const glm::vec4> weights0,
+                                std::span<const glm::vec4> weights1);
+
+inline glm::vec2 OctahedralEncode(glm::vec3 n)
+{
+    n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (n.z >= 0.0f)
+        return glm::vec2(n.x, n.y);
+    return glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                     (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+inline glm::vec3 OctahedralDecode(glm::vec2 e)
+{
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    const float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+// Branchless orthonormal basis around a unit vector, Duff et al. 2017
+inline void OrthonormalBasis(const glm::vec3& n, glm::vec3& b1, glm::vec3& b2)
+{
+    const float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+    const float a = -1.0f / (sign + n.z);
+    const float b = n.x * n.y * a;
+    b1 = glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+    b2 = glm::vec3(b, sign + n.y * n.y * a, -n.y);
+}
+
+inline PackedVertexAttributes PackVertexAttributes(const glm::vec3& normal, const glm::vec4& tangent,
+                                                   const glm::vec2& uv)
+{
+    PackedVertexAttributes packed{};
+
+    const float length = glm::length(normal);
+    const glm::vec2 oct = OctahedralEncode(length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f));
+    packed.normalTangent[0] = static_cast<int16_t>(glm::packSnorm1x16(oct.x));
+    packed.normalTangent[1] = static_cast<int16_t>(glm::packSnorm1x16(oct.y));
+
+    // The shader only sees the quantized normal, the tangent angle has to be measured around that one
+    const glm::vec3 n = OctahedralDecode(glm::vec2(glm::unpackSnorm1x16(uint16_t(packed.normalTangent[0])),
+                                                   glm::unpackSnorm1x16(uint16_t(packed.normalTangent[1]))));
+    glm::vec3 b1, b2;
+    OrthonormalBasis(n, b1, b2);
+    const glm::vec3 t(tangent);
+    const float angle = std::atan2(glm::dot(t, b2), glm::dot(t, b1));
+    packed.normalTangent[2] = static_cast<int16_t>(glm::packSnorm1x16(angle / glm::pi<float>()));
+    packed.normalTangent[3] = static_cast<int16_t>(glm::packSnorm1x16(tangent.w < 0.0f ? -1.0f : 1.0f));
+
+    packed.uv[0] = glm::packHalf1x16(uv.x);
+    packed.uv[1] = glm::packHalf1x16(uv.y);
+    return packed;
+}
+
+inline uint32_t PackVertexColor(const glm::vec4& color)
+{
+    return glm::packUnorm4x8(color);
+}
+
+inline PackedVertexSkin PackVertexSkin(const glm::u16vec4& joints0, const glm::u16vec4& joints1,
+                                       const glm::vec4& weights0, const glm::vec4& weights1)
+{
+    PackedVertexSkin packed{};
+    const float sum = weights0.x + weights0.y + weights0.z + weights0.w + weights1.x + weights1.y + weights1.z +
+                      weights1.w;
+    const float scale = sum > 0.0f ? 1.0f / sum : 0.0f;
+    for (int i = 0; i < 4; i++)
+    {
+        packed.joints[i] = joints0[i];
+        packed.joints[i + 4] = joints1[i];
+        packed.weights[i] = glm::packUnorm1x16(weights0[i] * scale);
+        packed.weights[i + 4] = glm::packUnorm1x16(weights1[i] * scale);
+    }
+    return packed;
+}
+
+// Vertex input of the mesh pipelines. Binding i reads VertexStream i, pipelines that bind through GeometryPool::Bind
+// set their strides dynamically so missing optional streams can be read as a constant. Shader inputs are numbered by
+// declaration order, vertex shaders declare them in the order of the locations here.
+struct VertexLayout
+{
+    static constexpr uint32_t GetStride(VertexStream stream)
+    {
+        switch (stream)
+        {
+        case VertexStream::Position:
+            return sizeof(glm::vec3);
+        case VertexStream::Attributes:
+            return sizeof(PackedVertexAttributes);
+        case VertexStream::Color:
+            return sizeof(uint32_t);
+        case VertexStream::Skin:
+            return sizeof(PackedVertexSkin);
+        default:
+            return 0;
+        }
+    }
+
+    static std::array<VkVertexInputBindingDescription, size_t(VertexStream::Count)> getBindingDescriptions()
+    {
+        std::array<VkVertexInputBindingDescription, size_t(VertexStream::Count)> bindingDescriptions{};
+        for (uint32_t i = 0; i < uint32_t(VertexStream::Count); i++)
+        {
+            bindingDescriptions[i].binding = i;
+            bindingDescriptions[i].stride = GetStride(VertexStream(i));
+            bindingDescriptions[i].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        }
+        return bindingDescriptions;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 8> getAttributeDescriptions()
+    {
+        constexpr uint32_t attributes = uint32_t(VertexStream::Attributes);
+        constexpr uint32_t skin = uint32_t(VertexStream::Skin);
+        return {{
+            {0, uint32_t(VertexStream::Position), VK_FORMAT_R32G32B32_SFLOAT, 0},
+            {1, attributes, VK_FORMAT_R16G16B16A16_SNORM, offsetof(PackedVertexAttributes, normalTangent)},
+            {2, attributes, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertexAttributes, uv)},
+            {3, uint32_t(VertexStream::Color), VK_FORMAT_R8G8B8A8_UNORM, 0},
+            {4, skin, VK_FORMAT_R16G16B16A16_UINT, offsetof(PackedVertexSkin, joints)},
+            {5, skin, VK_FORMAT_R16G16B16A16_UINT, offsetof(PackedVertexSkin, joints) + 8},
+            {6, skin, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertexSkin, weights)},
+            {7, skin, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertexSkin, weights) + 8},
+        }};
+    }
+
+    // Depth only passes read the position stream alone, see GeometryPool::BindPositions
+    static VkVertexInputBindingDescription getPositionBindingDescription()
+    {
+        return {0, GetStride(VertexStream::Position), VK_VERTEX_INPUT_RATE_VERTEX};
+    }
+
+    static VkVertexInputAttributeDescription getPositionAttributeDescription()
+    {
+        return {0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0};
+    }
+};
+
+} // namespace REON
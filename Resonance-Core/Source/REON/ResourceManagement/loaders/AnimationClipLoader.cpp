@@ -0,0 +1,78 @@
+#include "reonpch.h"
+#include "AnimationClipLoader.h"
+
+#include "REON/AssetManagement/ModelBinFormat.h"
+#include "REON/Rendering/Animation/AnimationClip.h"
+
+namespace REON
+{
+std::shared_ptr<ResourceBase> AnimationClipLoader::Load(const AssetKey& key, const ArtifactRef& ref,
+                                                        IBlobReader& reader)
+{
+    std::vector<std::byte> bytes;
+    if (!reader.ReadRange(ref.uri, ref.offset, ref.size, bytes))
+        return {};
+
+    if (bytes.size() < sizeof(AnimationClipHeader))
+        return {};
+
+    AnimationClipHeader h{};
+    std::memcpy(&h, bytes.data(), sizeof(h));
+
+    if (h.magic != CLIP_MAGIC || h.version != CLIP_VERSION)
+        return {};
+
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(bytes.data());
+    const size_t size = bytes.size();
+
+    const size_t trackCount = size_t(h.jointCount) * AnimationClip::ChannelCount;
+    const size_t trackBytes = trackCount * sizeof(AnimationTrackEntry);
+    const size_t timeBytes = size_t(h.keyCount) * sizeof(float);
+    const size_t valueBytes = size_t(h.keyCount) * 4 * sizeof(float);
+
+    if (size_t(h.trackOffset) + trackBytes > size || size_t(h.timeOffset) + timeBytes > size ||
+        size_t(h.valueOffset) + valueBytes > size)
+        return {};
+
+    auto clip = std::make_shared<AnimationClip>();
+    clip->name = std::string(h.name, strnlen(h.name, sizeof(h.name)));
+    std::memcpy(clip->rigId.bytes.data(), h.rigId, 16);
+    clip->duration = h.duration;
+    clip->jointCount = h.jointCount;
+
+    std::vector<AnimationTrackEntry> tracks(trackCount);
+    if (!tracks.empty())
+        std::memcpy(tracks.data(), base + h.trackOffset, trackBytes);
+
+    clip->tracks.reserve(trackCount);
+    for (const AnimationTrackEntry& track : tracks)
+    {
+        if (uint64_t(track.firstKey) + track.keyCount > h.keyCount)
+            return {};
+        clip->tracks.push_back({track.firstKey, track.keyCount});
+    }
+
+    clip->times.resize(h.keyCount);
+    clip->values.resize(h.keyCount);
+    if (h.keyCount > 0)
+    {
+        std::memcpy(clip->times.data(), base + h.timeOffset, timeBytes);
+        std::memcpy(clip->values.data(), base + h.valueOffset, valueBytes);
+    }
+
+    // The sampler walks keys forward, so times have to ascend within each track
+    for (const AnimationClip::Track& track : clip->tracks)
+    {
+        for (uint32_t i = 1; i < track.keyCount; ++i)
+        {
+            if (clip->times[track.firstKey + i] < clip->times[track.firstKey + i - 1])
+            {
+                REON_CORE_WARN("Animation clip {} has keys out of order", key.id.to_string());
+                return {};
+            }
+        }
+    }
+
+    return clip;
+}
+} // namespace REON
@@ -18,6 +18,20 @@ static AssetId AssetIdFromBytes16(const uint8_t b[16])
     return id;
 }
 
+uint32_t GetMaterialShaderFlags(const MatBinHeader& header)
+{
+    uint32_t flags = 0;
+    if (AssetIdFromBytes16(header.baseColorTex) != NullAssetId)
+        flags |= AlbedoTexture;
+    if (AssetIdFromBytes16(header.mrTex) != NullAssetId)
+        flags |= MetallicRoughnessTexture;
+    if (AssetIdFromBytes16(header.normalTex) != NullAssetId)
+        flags |= NormalTexture;
+    if (AssetIdFromBytes16(header.emissiveTex) != NullAssetId)
+        flags |= EmissiveTexture;
+    return flags;
+}
+
 std::shared_ptr<ResourceBase> MaterialLoader::Load(const AssetKey& key, const ArtifactRef& ref, IBlobReader& reader)
 {
     std::vector<std::byte> bytes;
@@ -43,31 +57,25 @@ std::shared_ptr<ResourceBase> MaterialLoader::Load(const AssetKey& key, const Ar
     mat->renderingMode = th->flags & MAT_TRANSPARENT ? Transparent : Opaque;
     mat->blendingMode = th->flags & MAT_MODE_BLEND ? Blend : Mask;
 
-    uint32_t flags = 0;
-
     AssetId TexId = AssetIdFromBytes16(th->baseColorTex);
     if (TexId != NullAssetId)
     {
-        flags |= AlbedoTexture;
         mat->albedoTexture = Application::Get().GetEngineServices().resources.GetOrLoad<Texture>(TexId);
         
     }
     TexId = AssetIdFromBytes16(th->mrTex);
     if (TexId != NullAssetId)
     {
-        flags |= MetallicRoughnessTexture;
         mat->metallicRoughnessTexture = Application::Get().GetEngineServices().resources.GetOrLoad<Texture>(TexId);
     }
     TexId = AssetIdFromBytes16(th->normalTex);
     if (TexId != NullAssetId)
     {
-        flags |= NormalTexture;
         mat->normalTexture = Application::Get().GetEngineServices().resources.GetOrLoad<Texture>(TexId);
     }
     TexId = AssetIdFromBytes16(th->emissiveTex);
     if (TexId != NullAssetId)
     {
-        flags |= EmissiveTexture;
         mat->emissiveTexture = Application::Get().GetEngineServices().resources.GetOrLoad<Texture>(TexId);
     }
     TexId = AssetIdFromBytes16(th->specularTex);
@@ -86,7 +94,7 @@ std::shared_ptr<ResourceBase> MaterialLoader::Load(const AssetKey& key, const Ar
     mat->flatData.preCompF0 = th->precompF0;
     mat->flatData.roughness = th->roughness;
 
-    mat->materialFlags = flags;
+    mat->materialFlags = GetMaterialShaderFlags(*th);
 
     return mat;
 }
@@ -2,23 +2,97 @@
 
 #include "MeshLoader.h"
 
+#include "ModelBinContainerReader.h"
 #include "REON/AssetManagement/ModelBinFormat.h"
 
 namespace REON
 {
 
-std::shared_ptr<ResourceBase> MeshLoader::Load(const AssetKey& key, const ArtifactRef& ref, IBlobReader& reader)
+static_assert(sizeof(Meshlet) == sizeof(MeshletEntry), "Meshlet no longer matches MeshletEntry");
+static_assert(offsetof(Meshlet, indexOffset) == offsetof(MeshletEntry, indexOffset));
+static_assert(offsetof(Meshlet, subMesh) == offsetof(MeshletEntry, subMesh));
+
+// Meshlets live in their own chunk of the model file, looked up by mesh id. They are optional, a file without them or
+// with a malformed chunk leaves the mesh drawn without cluster culling.
+static void LoadMeshlets(const AssetKey& key, const ArtifactRef& ref, IBlobReader& reader, Mesh& mesh)
 {
+    ArtifactRef fileRef = ref;
+    fileRef.offset = 0;
+    fileRef.size = 0;
+
+    ModelBinContainerReader container;
+    uint64_t chunkOffset = 0, chunkSize = 0;
+    if (!container.Open(fileRef, reader) || !container.GetChunkSlice(ChunkType::MESHLETS, chunkOffset, chunkSize))
+        return;
+
     std::vector<std::byte> bytes;
-    if (!reader.ReadRange(ref.uri, ref.offset, ref.size, bytes))
-        return {};
+    if (!reader.ReadRange(ref.uri, chunkOffset, sizeof(MeshletChunkHeader), bytes) ||
+        bytes.size() != sizeof(MeshletChunkHeader))
+        return;
 
-    if (bytes.size() < sizeof(MeshHeader))
-        return {};
+    MeshletChunkHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    const uint64_t tableSize = uint64_t(header.meshCount) * sizeof(MeshletMeshEntry);
+    if (header.version != MESHLET_CHUNK_VERSION || header.meshTableOffset + tableSize > chunkSize)
+        return;
 
-    const MeshHeader* mh = reinterpret_cast<const MeshHeader*>(bytes.data());
-    if (mh->magic != MESH_MAGIC || mh->version != 1)
-        return {};
+    if (!reader.ReadRange(ref.uri, chunkOffset + header.meshTableOffset, tableSize, bytes) || bytes.size() != tableSize)
+        return;
+
+    const MeshletMeshEntry* entries = reinterpret_cast<const MeshletMeshEntry*>(bytes.data());
+    const MeshletMeshEntry* entry = nullptr;
+    for (uint32_t i = 0; i < header.meshCount && !entry; ++i)
+    {
+        if (std::equal(key.id.begin(), key.id.end(), entries[i].meshId))
+            entry = &entries[i];
+    }
+    if (!entry)
+        return;
+
+    const uint32_t meshletCount = entry->meshletCount;
+    const uint64_t meshletBytes = uint64_t(meshletCount) * sizeof(MeshletEntry);
+    if (entry->meshletOffset + meshletBytes > chunkSize)
+        return;
+
+    const uint64_t meshletOffset = chunkOffset + entry->meshletOffset;
+    if (!reader.ReadRange(ref.uri, meshletOffset, meshletBytes, bytes) || bytes.size() != meshletBytes)
+        return;
+
+    std::vector<Meshlet> meshlets(meshletCount);
+    std::memcpy(meshlets.data(), bytes.data(), meshletBytes);
+
+    // Meshlets of a submesh have to follow each other and stay inside its index range
+    for (uint32_t i = 0; i < meshletCount; ++i)
+    {
+        const Meshlet& meshlet = meshlets[i];
+        bool valid = meshlet.subMesh < mesh.subMeshes.size() && (i == 0 || meshlet.subMesh >= meshlets[i - 1].subMesh);
+        if (valid)
+        {
+            const SubMesh& subMesh = mesh.subMeshes[meshlet.subMesh];
+            const uint64_t end = uint64_t(meshlet.indexOffset) + uint64_t(meshlet.triangleCount) * 3;
+            valid = meshlet.indexOffset >= uint32_t(subMesh.indexOffset) &&
+                    end <= uint64_t(subMesh.indexOffset) + uint32_t(subMesh.indexCount);
+        }
+        if (!valid)
+        {
+            REON_CORE_WARN("Meshlets of mesh {} are malformed, drawing it without them", key.id.to_string());
+            return;
+        }
+    }
+
+    for (uint32_t i = 0; i < meshletCount; ++i)
+    {
+        SubMesh& subMesh = mesh.subMeshes[meshlets[i].subMesh];
+        if (subMesh.meshletCount == 0)
+            subMesh.firstMeshlet = i;
+        subMesh.meshletCount++;
+    }
+    mesh.meshlets = std::move(meshlets);
+}
+
+// Version 1 and 2 meshes store every attribute as floats, they are packed at load
+static std::shared_ptr<Mesh> DecodeUnpackedMesh(const MeshHeader* mh, const std::vector<std::byte>& bytes)
+{
     const uint32_t vtx = mh->vertexCount;
     const uint32_t idx = mh->indexCount;
 
@@ -129,7 +203,75 @@ std::shared_ptr<ResourceBase> MeshLoader::Load(const AssetKey& key, const Artifa
             meshData.weights_1[i] = glm::vec4(c[i * 4 + 0], c[i * 4 + 1], c[i * 4 + 2], c[i * 4 + 3]);
     }
 
-    auto mesh = std::make_shared<Mesh>(meshData);
+    return std::make_shared<Mesh>(meshData);
+}
+
+static std::shared_ptr<Mesh> DecodePackedMesh(const MeshHeader* mh, const std::vector<std::byte>& bytes)
+{
+    const uint32_t vtx = mh->vertexCount;
+    const uint32_t idx = mh->indexCount;
+
+    auto inRange = [&](uint32_t off, uint64_t len) -> bool { return uint64_t(off) + len <= bytes.size(); };
+
+    if (!inRange(mh->posOffset, uint64_t(vtx) * sizeof(glm::vec3)) ||
+        !inRange(mh->idxOffset, uint64_t(idx) * sizeof(uint32_t)) ||
+        !inRange(mh->attributeOffset, uint64_t(vtx) * sizeof(PackedVertexAttributes)))
+        return {};
+
+    const std::byte* base = bytes.data();
+    auto copyStream = [&](auto& stream, uint32_t offset) {
+        stream.resize(vtx);
+        std::memcpy(stream.data(), base + offset, stream.size() * sizeof(stream[0]));
+    };
+
+    VertexStreams streams;
+    streams.format = mh->flags & (VERTEX_FORMAT_COLOR | VERTEX_FORMAT_SKIN);
+    copyStream(streams.positions, mh->posOffset);
+    copyStream(streams.attributes, mh->attributeOffset);
+
+    if (streams.format & VERTEX_FORMAT_COLOR)
+    {
+        if (!inRange(mh->packedColorOffset, uint64_t(vtx) * sizeof(uint32_t)))
+            return {};
+        copyStream(streams.colors, mh->packedColorOffset);
+    }
+
+    if (streams.format & VERTEX_FORMAT_SKIN)
+    {
+        if (!inRange(mh->skinOffset, uint64_t(vtx) * sizeof(PackedVertexSkin)))
+            return {};
+        copyStream(streams.skin, mh->skinOffset);
+    }
+
+    const uint32_t* ix = reinterpret_cast<const uint32_t*>(base + mh->idxOffset);
+    return std::make_shared<Mesh>(streams, std::vector<uint>(ix, ix + idx));
+}
+
+std::shared_ptr<ResourceBase> MeshLoader::Load(const AssetKey& key, const ArtifactRef& ref, IBlobReader& reader)
+{
+    std::vector<std::byte> bytes;
+    if (!reader.ReadRange(ref.uri, ref.offset, ref.size, bytes))
+        return {};
+
+    if (bytes.size() < MESH_HEADER_V1_SIZE)
+        return {};
+
+    const MeshHeader* mh = reinterpret_cast<const MeshHeader*>(bytes.data());
+    if (mh->magic != MESH_MAGIC || mh->version < 1 || mh->version > MESH_VERSION)
+        return {};
+    if (mh->version >= 2 && bytes.size() < MESH_HEADER_V2_SIZE)
+        return {};
+    if (mh->version >= 3 && bytes.size() < MESH_HEADER_V3_SIZE)
+        return {};
+    if (mh->version >= 4 && bytes.size() < sizeof(MeshHeader))
+        return {};
+
+    std::shared_ptr<Mesh> mesh = mh->version >= 3 ? DecodePackedMesh(mh, bytes) : DecodeUnpackedMesh(mh, bytes);
+    if (!mesh)
+        return {};
+
+    auto inRange = [&](uint32_t off, uint64_t len) -> bool { return uint64_t(off) + len <= bytes.size(); };
+    const std::byte* base = bytes.data();
 
     for (int i = 0; i < mh->subMeshCount; ++i)
     {
@@ -149,6 +291,49 @@ std::shared_ptr<ResourceBase> MeshLoader::Load(const AssetKey& key, const Artifa
         mesh->subMeshes.push_back(subm);
     }
 
+    if (mh->version >= 2)
+    {
+        if (!inRange(mh->subMeshBoundsOffset, uint64_t(mh->subMeshCount) * sizeof(MeshBounds)))
+            return {};
+
+        auto toAABB = [](const MeshBounds& b) {
+            return AABB{glm::vec3(b.min[0], b.min[1], b.min[2]), glm::vec3(b.max[0], b.max[1], b.max[2])};
+        };
+
+        mesh->bounds = toAABB(mh->bounds);
+        const MeshBounds* subBounds = reinterpret_cast<const MeshBounds*>(base + mh->subMeshBoundsOffset);
+        for (uint32_t i = 0; i < mh->subMeshCount; ++i)
+            mesh->subMeshes[i].bounds = toAABB(subBounds[i]);
+    }
+    else
+    {
+        mesh->ComputeBounds();
+    }
+
+    if (mh->version >= 4 && mh->lodCount > 0)
+    {
+        const uint64_t rangeCount = uint64_t(mh->lodCount) * mh->subMeshCount;
+        if (!inRange(mh->lodOffset, uint64_t(mh->lodCount) * sizeof(MeshLodEntry)) ||
+            !inRange(mh->lodRangeOffset, rangeCount * sizeof(SubMeshLodEntry)))
+            return {};
+
+        const MeshLodEntry* lods = reinterpret_cast<const MeshLodEntry*>(base + mh->lodOffset);
+        const SubMeshLodEntry* ranges = reinterpret_cast<const SubMeshLodEntry*>(base + mh->lodRangeOffset);
+        for (uint32_t lod = 0; lod < mh->lodCount; ++lod)
+        {
+            mesh->lodErrors.push_back(lods[lod].error);
+            for (uint32_t i = 0; i < mh->subMeshCount; ++i)
+            {
+                const SubMeshLodEntry& range = ranges[lod * mh->subMeshCount + i];
+                if (uint64_t(range.indexOffset) + range.indexCount > mh->indexCount)
+                    return {};
+                mesh->subMeshes[i].lods.push_back({range.indexCount, range.indexOffset});
+            }
+        }
+    }
+
+    LoadMeshlets(key, ref, reader, *mesh);
+
     return mesh;
 }
 } // namespace REON
\ No newline at end of file
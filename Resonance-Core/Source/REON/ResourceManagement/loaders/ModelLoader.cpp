@@ -22,9 +22,9 @@ static std::string MakeNodeName(size_t i)
 static void SetTransformFromTRS(std::shared_ptr<GameObject>& go, const SceneNode& n)
 {
     // Replace with your Transform API
-    go->GetTransform()->localPosition = {n.t[0], n.t[1], n.t[2]};
-    go->GetTransform()->localRotation = {n.r[0], n.r[1], n.r[2], n.r[3]}; // quat
-    go->GetTransform()->localScale = {n.s[0], n.s[1], n.s[2]};
+    go->GetTransform()->SetLocalPosition({n.t[0], n.t[1], n.t[2]});
+    go->GetTransform()->SetLocalRotation({n.r[0], n.r[1], n.r[2], n.r[3]}); // quat
+    go->GetTransform()->SetLocalScale({n.s[0], n.s[1], n.s[2]});
 }
 
 // Converts 16-byte array in SceneNode to your AssetId type.
@@ -105,6 +105,35 @@ static std::shared_ptr<GameObject> BuildNodeRecursive(uint32_t nodeIndex, const
     return obj;
 }
 
+// Ids of the clips cooked into the model, empty when it has none
+static std::vector<AssetId> LoadClipIds(const ModelBinContainerReader& container, IBlobReader& reader)
+{
+    uint64_t chunkOffset = 0, chunkSize = 0;
+    if (!container.GetChunkSlice(ChunkType::ANIMATIONS, chunkOffset, chunkSize))
+        return {};
+
+    const std::string& uri = container.ModelRef().uri;
+    std::vector<std::byte> bytes;
+    if (!reader.ReadRange(uri, chunkOffset, sizeof(AnimationChunkHeader), bytes) ||
+        bytes.size() != sizeof(AnimationChunkHeader))
+        return {};
+
+    AnimationChunkHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    const uint64_t tableSize = uint64_t(header.clipCount) * sizeof(AnimationClipEntry);
+    if (header.version != ANIMATION_CHUNK_VERSION || header.clipTableOffset + tableSize > chunkSize)
+        return {};
+
+    if (!reader.ReadRange(uri, chunkOffset + header.clipTableOffset, tableSize, bytes) || bytes.size() != tableSize)
+        return {};
+
+    std::vector<AssetId> ids(header.clipCount);
+    const AnimationClipEntry* entries = reinterpret_cast<const AnimationClipEntry*>(bytes.data());
+    for (uint32_t i = 0; i < header.clipCount; ++i)
+        ids[i] = AssetIdFromBytes16(entries[i].clipId);
+    return ids;
+}
+
 static std::vector<uint32_t> CollectRoots(const std::vector<SceneNode>& nodes)
 {
     std::vector<uint32_t> roots;
@@ -157,6 +186,15 @@ bool ModelLoader::LoadModelFromFile(AssetId id, std::shared_ptr<Scene> scene)
             std::memcpy(rigId.bytes.data(), container.Header().rigId, 16);
             auto rig = Application::Get().GetEngineServices().resources.GetOrLoad<Rig>(rigId);
             animator = std::make_shared<Animator>(rig);
+
+            // The first clip plays looped, like a model previewed in a viewer
+            std::vector<ResourceHandle<AnimationClip>> clips;
+            for (const AssetId& clipId : LoadClipIds(container, *services.blobReader))
+                clips.push_back(services.resources.GetOrLoad<AnimationClip>(clipId));
+            if (!clips.empty())
+                animator->Play(clips.front());
+            animator->SetClips(std::move(clips));
+
             scene->renderManager->AddAnimator(animator);
         }
         const auto& root = BuildNodeRecursive(roots[0], nodes, scene, nullptr, animator);
@@ -12,15 +12,33 @@ std::shared_ptr<ResourceBase> RigLoader::Load(const AssetKey& key, const Artifac
     if (!reader.ReadRange(ref.uri, ref.offset, ref.size, bytes))
         return {};
 
-    if (bytes.size() < sizeof(RigChunkHeader))
+    if (bytes.size() < RIG_CHUNK_HEADER_V1_SIZE)
         return {};
 
-    RigChunkHeader h{};
-    std::memcpy(&h, bytes.data(), sizeof(h));
+    RigChunkHeaderV1 v1;
+    std::memcpy(&v1, bytes.data(), sizeof(v1));
 
-    if (h.version != 1)
+    if (v1.version < 1 || v1.version > RIG_CHUNK_VERSION)
         return {};
 
+    RigChunkHeader h{};
+    if (v1.version >= 2)
+    {
+        if (bytes.size() < sizeof(RigChunkHeader))
+            return {};
+        std::memcpy(&h, bytes.data(), sizeof(h));
+    }
+    else
+    {
+        h.version = v1.version;
+        std::memcpy(h.rigId, v1.rigId, sizeof(h.rigId));
+        h.jointCount = v1.jointCount;
+        h.skinCount = v1.skinCount;
+        h.jointNodeIdsOffset = v1.jointNodeIdsOffset;
+        h.skinOffset = v1.skinOffset;
+        h.jointRecordOffset = 0;
+    }
+
     const uint8_t* base = reinterpret_cast<const uint8_t*>(bytes.data());
     const size_t size = bytes.size();
 
@@ -73,6 +91,33 @@ std::shared_ptr<ResourceBase> RigLoader::Load(const AssetKey& key, const Artifac
         rig->joints.push_back(j);
     }
 
+    if (h.jointRecordOffset != 0 && h.jointCount > 0)
+    {
+        const size_t recordBytes = size_t(h.jointCount) * sizeof(RigJointRecord);
+        if (size_t(h.jointRecordOffset) + recordBytes > size)
+            return {};
+
+        std::vector<RigJointRecord> records(h.jointCount);
+        std::memcpy(records.data(), base + h.jointRecordOffset, recordBytes);
+
+        for (uint32_t i = 0; i < h.jointCount; ++i)
+        {
+            const RigJointRecord& r = records[i];
+            // Parents have to come first, the pose is composed in joint order
+            if (r.parent >= int32_t(i))
+                return {};
+
+            Rig::Joint& j = rig->joints[i];
+            j.parentIndex = r.parent;
+            j.restTranslation = glm::vec3(r.t[0], r.t[1], r.t[2]);
+            j.restRotation = glm::quat(r.r[3], r.r[0], r.r[1], r.r[2]);
+            j.restScale = glm::vec3(r.s[0], r.s[1], r.s[2]);
+            std::memcpy(&j.parentOffset, r.parentOffset, sizeof(r.parentOffset));
+            j.hasParentOffset = j.parentOffset != glm::mat4(1.0f);
+        }
+        rig->hasHierarchy = true;
+    }
+
     for (uint32_t i = 0; i < h.skinCount; ++i)
     {
         const SkinRecord& sr = recs[i];
@@ -0,0 +1,49 @@
+#include "reonpch.h"
+#include "ShaderPackLoader.h"
+
+#include "REON/AssetManagement/ShaderPackFormat.h"
+#include "REON/Rendering/ShaderPack.h"
+
+namespace REON
+{
+std::shared_ptr<ResourceBase> ShaderPackLoader::Load(const AssetKey& key, const ArtifactRef& ref, IBlobReader& reader)
+{
+    std::vector<std::byte> bytes;
+    if (!reader.ReadRange(ref.uri, ref.offset, ref.size, bytes))
+        return {};
+
+    if (bytes.size() < sizeof(ShaderPackHeader))
+        return {};
+
+    ShaderPackHeader h{};
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    if (h.magic != SHADER_PACK_MAGIC || h.version != SHADER_PACK_VERSION)
+        return {};
+
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(bytes.data());
+    const size_t size = bytes.size();
+
+    const size_t entriesBytes = size_t(h.entryCount) * sizeof(ShaderPackEntry);
+    if (size_t(h.entriesOffset) + entriesBytes > size || h.stringsOffset > size)
+        return {};
+
+    std::vector<ShaderPackEntry> entries(h.entryCount);
+    if (h.entryCount > 0)
+        std::memcpy(entries.data(), base + h.entriesOffset, entriesBytes);
+
+    auto pack = std::make_shared<ShaderPack>();
+    for (const ShaderPackEntry& entry : entries)
+    {
+        if (size_t(h.stringsOffset) + entry.sourceOffset + entry.sourceLength > size ||
+            size_t(entry.codeOffset) + entry.codeSize > size)
+            return {};
+
+        std::string source(reinterpret_cast<const char*>(base + h.stringsOffset + entry.sourceOffset),
+                           entry.sourceLength);
+        const char* code = reinterpret_cast<const char*>(base + entry.codeOffset);
+        pack->shaders[std::move(source)][entry.flags] = std::vector<char>(code, code + entry.codeSize);
+    }
+
+    return pack;
+}
+} // namespace REON
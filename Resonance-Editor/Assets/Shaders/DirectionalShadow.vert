@@ -1,6 +1,7 @@
 struct VS_Input
 {
     float3 Position : POSITION;
+    uint InstanceId : SV_InstanceID;
 };
 
 struct VS_Output
@@ -8,11 +9,22 @@ struct VS_Output
     float4 Position : SV_Position;
 };
 
-cbuffer ModelMatrix : register(b1, space1)
+struct ObjectData
 {
-    matrix model;
+    float4x4 model;
+    float4x4 transposeInverseModel;
+    int paletteOffset;
+    int jointCount;
+    uint materialIndex;
+    float _padding;
 };
 
+// Shared with the main passes
+StructuredBuffer<ObjectData> objects : register(t1, space1);
+// Object index of each instance of a draw, starting at its firstInstance
+StructuredBuffer<uint> instances : register(t2, space1);
+
+// Of the cascade being rendered, the pass selects it with a dynamic offset
 cbuffer LightSpaceMatrix : register(b0)
 {
     matrix lightSpaceMatrix;
@@ -21,6 +33,7 @@ cbuffer LightSpaceMatrix : register(b0)
 VS_Output main(VS_Input input)
 {
     VS_Output output;
+    float4x4 model = objects[instances[input.InstanceId]].model;
     output.Position = mul(lightSpaceMatrix, float4(mul(model, float4(input.Position, 1.0)).xyz, 1.0));
     return output;
 }
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include "material_table.hlsl"
+
 #define M_PI 3.141592653589793f
 #define c_MinRoughness 0.04
 
@@ -11,6 +13,7 @@ struct PS_Input
     float3 fragPosition : FRAG_POSITION;
     float3 fragViewPos : FRAG_VIEW_POS;
     float4 fragLightSpacePos : FRAG_LIGHT_SPACE_POS;
+    nointerpolation uint materialIndex : MATERIAL_INDEX;
 };
 
 struct Light
@@ -19,6 +22,10 @@ struct Light
     float4 direction;
     float4 color;
     float4x4 mainViewProj;
+    float range;
+    float outerCutoff;
+    int type;
+    float _padding;
 };
 
 cbuffer GlobalBuffer : register(b0)
@@ -26,7 +33,14 @@ cbuffer GlobalBuffer : register(b0)
     column_major float4x4 viewProj;
     column_major float4x4 inverseView;
     int lightCount;
-    float3 _padding;
+    int globalLightCount;
+    float2 _padding;
+    column_major float4x4 view;
+    uint4 clusterGrid;
+    float4 clusterScale;
+    column_major float4x4 shadowCascades[4];
+    int shadowCascadeCount;
+    float3 _cascadePadding;
 };
 
 Texture2D DirectionalShadowMap : register(t2);
@@ -36,39 +50,11 @@ SamplerState PointShadowSampler : register(s3);
 
 StructuredBuffer<Light> lights : register(t1);
 
-cbuffer flatData : register(b1, space1)
-{
-    float4 u_BaseColorFactor;
-    float u_Roughness;
-    float u_Metallic;
-    float normalScalar;
-    int u_FlipNormalY; // 0 = no flip, 1 = flip Y normal
-    float4 u_EmissiveFactor; // W = alpha cutoff
-    float4 u_SpecularFactor;
-    float preCompF0;
-};
+#include "light_clusters.hlsl"
+#include "shadow_cascades.hlsl"
 
 //#define USE_NORMAL_TEXTURE
 
-#ifdef USE_ALBEDO_TEXTURE
-Texture2D texture_albedo : register(t3, space1);
-SamplerState texture_sampler_albedo : register(s3, space1);
-#endif
-#ifdef USE_NORMAL_TEXTURE
-Texture2D texture_normal : register(t4, space1);
-SamplerState texture_sampler_normal : register(s4, space1);
-#endif
-#ifdef USE_METALLICROUGHNESS_TEXTURE
-Texture2D texture_roughness : register(t5, space1);
-SamplerState texture_sampler_roughness : register(s5, space1);
-#endif
-#ifdef USE_SPECULAR_TEXTURE
-Texture2D texture_specular : register(t7, space1);
-SamplerState texture_sampler_specular : register(s7, space1);
-Texture2D texture_specular_color : register(t8, space1);
-SamplerState texture_sampler_specular_color : register(s8, space1);
-#endif
-
 struct PBRInfo
 {
     float NdotL; // cos angle between normal and light direction
@@ -85,35 +71,6 @@ struct PBRInfo
     float3 specularColor; // color contribution from specular lighting
 };
 
-float MainShadowCalculation(float4 fragPosLightSpace, float3 normal)
-{
-    float3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-    projCoords.xy = projCoords.xy * 0.5 + 0.5;
-    //projCoords.z = projCoords.z * 0.5 + 0.5;
-
-    float currentDepth = projCoords.z;
-    float bias = max(0.005 * (1.0 - abs(dot(normalize(normal), normalize(lights[0].direction.xyz)))), 0.0005);
-    
-    //return bias;
-    //PCF
-    float shadow = 0.0;
-    int sizex, sizey;
-    DirectionalShadowMap.GetDimensions(sizex, sizey);
-    float2 texelSize = 1.0 / float2(sizex, sizey);
-    for (int x = -1; x <= 1; ++x)
-    {
-        for (int y = -1; y <= 1; ++y)
-        {
-            float pcfDepth = DirectionalShadowMap.Sample(DirectionalShadowSampler, projCoords.xy + float2(x, y) * texelSize).r;
-            //return pcfDepth;
-            shadow += currentDepth > pcfDepth + bias ? 1.0 : 0.0;
-        }
-    }
-    shadow /= 9.0;
-
-    return shadow;
-}
-
 float4 SRGBtoLINEAR(float4 srgbIn)
 {
 #ifdef SRGB_FAST_APPROXIMATION
@@ -161,9 +118,9 @@ float3 getNormal(float3x3 inTbn, float2 texCoord)
     float3x3 tbn = inTbn;
     
 #ifdef USE_NORMAL_TEXTURE
-    float3 n = texture_normal.Sample(texture_sampler_normal, texCoord);
-    n.g = lerp(n.g, 1.0 - n.g, u_FlipNormalY);
-    n = normalize(mul(float3(normalScalar, normalScalar, 1.0) * (2.0 * n - 1.0), tbn));
+    float3 n = SampleMaterialTexture(material.normalTexture, texCoord).rgb;
+    n.g = lerp(n.g, 1.0 - n.g, material.flipNormalY);
+    n = normalize(mul(float3(material.normalScalar, material.normalScalar, 1.0) * (2.0 * n - 1.0), tbn));
     //return float3(1.0, 0.0, 1.0);
 #else
     float3 n = normalize(float3(tbn[0][2], tbn[1][2], tbn[2][2]));
@@ -181,12 +138,13 @@ struct PS_Output
 PS_Output main(PS_Input input, bool isFrontFacing : SV_IsFrontFace)
 {
     PS_Output output;
+    material = materials[input.materialIndex];
     
-    float perceptualRoughness = u_Roughness;
-    float metallic = u_Metallic;
+    float perceptualRoughness = material.roughness;
+    float metallic = material.metallic;
     
 #ifdef USE_METALLICROUGHNESS_TEXTURE
-        float4 sample = texture_roughness.Sample(texture_sampler_roughness, input.tex);
+        float4 sample = SampleMaterialTexture(material.metallicRoughnessTexture, input.tex);
         perceptualRoughness = sample.g * perceptualRoughness;
         metallic = sample.b * metallic;
         //return float4(1.0, 0.0, 1.0, 1.0);
@@ -198,20 +156,20 @@ PS_Output main(PS_Input input, bool isFrontFacing : SV_IsFrontFace)
     float alphaRoughness = perceptualRoughness * perceptualRoughness;
 
 #ifdef USE_ALBEDO_TEXTURE
-    float4 baseColor = SRGBtoLINEAR(texture_albedo.Sample(texture_sampler_albedo, input.tex)) * u_BaseColorFactor; // TODO: look into maybe srgb to linear color
+    float4 baseColor = SRGBtoLINEAR(SampleMaterialTexture(material.albedoTexture, input.tex)) * material.baseColorFactor; // TODO: look into maybe srgb to linear color
 #else
-    float4 baseColor = u_BaseColorFactor;
+    float4 baseColor = material.baseColorFactor;
 #endif
     
-    float3 f0 = preCompF0.xxx;
+    float3 f0 = material.preCompF0.xxx;
     
     //output.accum = float4(0.3.xxx, 0);
     float3 diffuseColor = baseColor.rgb * (1.xxx - f0);
     diffuseColor *= 1.0 - metallic;
     
 #ifdef USE_SPECULAR_TEXTURE
-    float3 specularColor = u_SpecularFactor.rgb * SRGBtoLINEAR(texture_specular_color.Sample(texture_sampler_specular_color, input.tex)).rgb;
-    float specular = u_SpecularFactor.a * texture_specular.Sample(texture_sampler_specular, input.tex).a;
+    float3 specularColor = material.specularFactor.rgb * SRGBtoLINEAR(SampleMaterialTexture(material.specularColorTexture, input.tex)).rgb;
+    float specular = material.specularFactor.a * SampleMaterialTexture(material.specularTexture, input.tex).a;
     f0 = min(f0 * specularColor, float3(1.xxx)) * specular;
     float reflectance90 = specular;
 #else
@@ -235,8 +193,11 @@ PS_Output main(PS_Input input, bool isFrontFacing : SV_IsFrontFace)
     
     float3 color = float3(0, 0, 0);
     
-    for (int i = 0; i < lightCount; i++)
+    LightCluster cluster = GetLightCluster(input.position, input.fragPosition);
+    uint clusterLightCount = uint(globalLightCount) + cluster.count;
+    for (uint c = 0; c < clusterLightCount; c++)
     {
+        uint i = GetClusterLight(cluster, c);
         float3 l;
         float3 radiance;
         float shadow = 0.0;
@@ -245,7 +206,7 @@ PS_Output main(PS_Input input, bool isFrontFacing : SV_IsFrontFace)
         {
             l = normalize(-lights[i].direction.xyz);
             radiance = lights[i].color.xyz;
-            shadow = MainShadowCalculation(input.fragLightSpacePos, n);
+            shadow = MainShadowCalculation(input.fragPosition, n);
             //return float4(shadow, 0.0, 0.0, 1.0);
         }
         else
@@ -253,6 +214,9 @@ PS_Output main(PS_Input input, bool isFrontFacing : SV_IsFrontFace)
             l = normalize(lights[i].position.xyz - input.fragPosition);
             float distance = length(lights[i].position.xyz - input.fragPosition);
             float attenuation = 1.0 / (distance * distance);
+            // Fades out at the range the light was clustered with
+            if (lights[i].range > 0.0)
+                attenuation *= saturate(1.0 - pow(distance / lights[i].range, 4.0));
             radiance = lights[i].color.xyz * attenuation;
         }
         
@@ -1,10 +1,13 @@
+#include "vertex_packing.hlsl"
+
+// Declared in the order of the locations in VertexLayout
 struct VS_Input
 {
     float3 position : POSITION;
-    float4 color : COLOR;
-    float3 normal : NORMAL;
+    float4 normalTangent : NORMAL_TANGENT;
     float2 texcoord : TEXCOORD;
-    float4 tangent : TANGENT;
+    float4 color : COLOR;
+    uint instanceId : SV_InstanceID;
 };
 
 struct PS_Input
@@ -17,6 +20,7 @@ struct PS_Input
     float3 fragPosition : FRAG_POSITION;
     float3 fragViewPos : FRAG_VIEW_POS;
     float4 fragLightSpacePos : FRAG_LIGHT_SPACE_POS;
+    nointerpolation uint materialIndex : MATERIAL_INDEX;
 };
 
 struct Light
@@ -27,12 +31,21 @@ struct Light
     float4x4 mainViewProj;
 };
 
-cbuffer ObjectBuffer : register(b2, space2)
+struct ObjectData
 {
     float4x4 model;
     float4x4 transposeInverseModel;
+    int paletteOffset;
+    int jointCount;
+    uint materialIndex;
+    float _padding;
 };
 
+// One entry per queued draw
+StructuredBuffer<ObjectData> objects : register(t2, space2);
+// Object index of each instance of a draw, starting at its firstInstance
+StructuredBuffer<uint> instances : register(t3, space2);
+
 cbuffer GlobalBuffer : register(b0)
 {
     float4x4 viewProj;
@@ -46,14 +59,23 @@ StructuredBuffer<Light> lights : register(t1);
 PS_Input main(VS_Input input)
 {
     PS_Input output;
-    
+
+    ObjectData object = objects[instances[input.instanceId]];
+    float4x4 model = object.model;
+    float4x4 transposeInverseModel = object.transposeInverseModel;
+
+    float3 normal;
+    float4 tangentSign;
+    DecodeTangentFrame(input.normalTangent, normal, tangentSign);
+
     output.position = mul(viewProj, mul(model, float4(input.position, 1.0f)));
     output.color = input.color;
     output.tex = input.texcoord;
-    output.normal = normalize(mul(transposeInverseModel, float4(input.normal, 0.0f)).xyz);
-    float3 tangent = normalize(mul(transposeInverseModel, float4(input.tangent.xyz, 0.0)).xyz);
+    output.materialIndex = object.materialIndex;
+    output.normal = normalize(mul(transposeInverseModel, float4(normal, 0.0f)).xyz);
+    float3 tangent = normalize(mul(transposeInverseModel, float4(tangentSign.xyz, 0.0)).xyz);
     tangent = normalize(tangent - dot(tangent, output.normal) * output.normal);
-    float3 bitangent = cross(output.normal, tangent) * input.tangent.w;
+    float3 bitangent = cross(output.normal, tangent) * tangentSign.w;
     output.tbn = float3x3(tangent, bitangent, output.normal);
     output.fragPosition = mul(model, float4(input.position, 1.0)).xyz;
     output.fragViewPos = float3(inverseView[0][3], inverseView[1][3], inverseView[2][3]);
@@ -1,10 +1,11 @@
+// Declared in the order of the locations in VertexLayout
 struct VS_Input
 {
     float3 position : POSITION;
-    float4 color : COLOR;
-    float3 normal : NORMAL;
+    float4 normalTangent : NORMAL_TANGENT;
     float2 texcoord : TEXCOORD;
-    float4 tangent : TANGENT;
+    float4 color : COLOR;
+    uint instanceId : SV_InstanceID;
 };
 
 struct PS_Input
@@ -12,14 +13,24 @@ struct PS_Input
     float4 position : SV_POSITION;
     float4 color : COLOR;
     float2 tex : TEXCOORD;
+    nointerpolation uint materialIndex : MATERIAL_INDEX;
 };
 
-cbuffer ObjectBuffer : register(b2, space2)
+struct ObjectData
 {
     float4x4 model;
     float4x4 transposeInverseModel;
+    int paletteOffset;
+    int jointCount;
+    uint materialIndex;
+    float _padding;
 };
 
+// One entry per queued draw
+StructuredBuffer<ObjectData> objects : register(t2, space2);
+// Object index of each instance of a draw, starting at its firstInstance
+StructuredBuffer<uint> instances : register(t3, space2);
+
 cbuffer GlobalBuffer : register(b0)
 {
     float4x4 viewProj;
@@ -31,9 +42,11 @@ cbuffer GlobalBuffer : register(b0)
 PS_Input main(VS_Input input)
 {
     PS_Input output;
-    
-    output.position = mul(viewProj, mul(model, float4(input.position, 1.0f)));
+
+    ObjectData object = objects[instances[input.instanceId]];
+    output.position = mul(viewProj, mul(object.model, float4(input.position, 1.0f)));
     output.color = input.color;
     output.tex = input.texcoord;
+    output.materialIndex = object.materialIndex;
     return output;
 }
\ No newline at end of file
@@ -1,36 +1,16 @@
 #include "textures.hlsl"
+#include "material_table.hlsl"
 
 
 
 #define M_PI 3.141592653589793f
 #define c_MinRoughness 0.04
 
-#ifdef USE_ALBEDO_TEXTURE
-Texture2D texture_albedo : register(t3, space1);
-SamplerState texture_sampler_albedo : register(s3, space1);
-#endif
-#ifdef USE_NORMAL_TEXTURE
-Texture2D texture_normal : register(t4, space1);
-SamplerState texture_sampler_normal : register(s4, space1);
-#endif
-#ifdef USE_METALLICROUGHNESS_TEXTURE
-Texture2D texture_roughness : register(t5, space1);
-SamplerState texture_sampler_roughness : register(s5, space1);
-#endif
-#ifdef USE_EMISSIVE_TEXTURE
-Texture2D texture_emissive : register(t6, space1);
-SamplerState texture_sampler_emissive : register(s6, space1);
-#endif
-#ifdef USE_SPECULAR_TEXTURE
-Texture2D texture_specular : register(t7, space1);
-SamplerState texture_sampler_specular : register(s7, space1);
-Texture2D texture_specular_color : register(t8, space1);
-SamplerState texture_sampler_specular_color : register(s8, space1);
-#endif
 
-static const int LightType_Point = 0;
+// Mirrors LightType in Light.h
+static const int LightType_Spot = 0;
 static const int LightType_Directional = 1;
-static const int LightType_Spot = 3;
+static const int LightType_Point = 3;
 
 float clampedDot(float3 x, float3 y)
 {
@@ -125,6 +105,7 @@ struct PS_Input
     float3 fragPosition : FRAG_POSITION;
     float3 fragViewPos : FRAG_VIEW_POS;
     float4 fragLightSpacePos : FRAG_LIGHT_SPACE_POS;
+    nointerpolation uint materialIndex : MATERIAL_INDEX;
 };
 
 struct Light
@@ -144,7 +125,14 @@ cbuffer GlobalBuffer : register(b0)
     column_major float4x4 viewProj;
     column_major float4x4 inverseView;
     int lightCount;
-    float3 _padding;
+    int globalLightCount;
+    float2 _padding;
+    column_major float4x4 view;
+    uint4 clusterGrid;
+    float4 clusterScale;
+    column_major float4x4 shadowCascades[4];
+    int shadowCascadeCount;
+    float3 _cascadePadding;
 };
 
 Texture2D DirectionalShadowMap : register(t2);
@@ -154,17 +142,8 @@ SamplerState PointShadowSampler : register(s4);
 
 StructuredBuffer<Light> lights : register(t1);
 
-cbuffer flatData : register(b1, space1)
-{
-    float4 u_BaseColorFactor;
-    float u_Roughness;
-    float u_Metallic;
-    float normalScalar;
-    int u_FlipNormalY; // 0 = no flip, 1 = flip Y normal
-    float4 u_EmissiveFactor; // W = alpha cutoff
-    float4 u_SpecularFactor;
-    float preCompF0;
-};
+#include "light_clusters.hlsl"
+#include "shadow_cascades.hlsl"
 
 //#define USE_NORMAL_TEXTURE
 
@@ -202,9 +181,11 @@ float3 getLighIntensity(Light light, float3 pointToLight)
     {
         rangeAttenuation = getRangeAttenuation(light.range, length(pointToLight));
     }
-    if (light.type == LightType_Spot)
+    // Only spot lights with a cone are culled by it, see LightClusterer
+    if (light.type == LightType_Spot && light.outerCutoff > 0.0)
     {
-        //spotAttenuation = //getSpotAttenuation(pointToLight, light.direction, light.outerConeCos, light.innerConeCos);
+        spotAttenuation = getSpotAttenuation(pointToLight, light.direction.xyz, cos(radians(light.outerCutoff)),
+                                             cos(light.direction.w));
     }
 
     return rangeAttenuation * spotAttenuation * light.color.a * light.color.rgb;
@@ -322,12 +303,12 @@ NormalInfo getNormalInfo(PS_Input input)
     NormalInfo info;
     info.ng = ng;
 #ifdef USE_NORMAL_TEXTURE
-    info.ntex = texture_normal.Sample(texture_sampler_normal, input.tex).rgb * 2.0 - 1.0;
-    if (u_FlipNormalY != 0)
+    info.ntex = SampleMaterialTexture(material.normalTexture, input.tex).rgb * 2.0 - 1.0;
+    if (material.flipNormalY != 0)
     {
         info.ntex.y = -info.ntex.y;
     }
-    info.ntex.xy *= normalScalar;
+    info.ntex.xy *= material.normalScalar;
     info.ntex = normalize(info.ntex);
 
     info.n = normalize(t * info.ntex.x + b * info.ntex.y + ng * info.ntex.z);
@@ -346,10 +327,10 @@ NormalInfo getNormalInfo(PS_Input input)
 
 float4 getBaseColor(PS_Input input)
 {
-    float4 baseColor = u_BaseColorFactor;
+    float4 baseColor = material.baseColorFactor;
 
 #if defined(USE_ALBEDO_TEXTURE)
-    baseColor *= texture_albedo.Sample(texture_sampler_albedo, input.tex);
+    baseColor *= SampleMaterialTexture(material.albedoTexture, input.tex);
 #endif
 
     return baseColor * input.color;
@@ -357,13 +338,13 @@ float4 getBaseColor(PS_Input input)
 
 MaterialInfo getMetallicRoughnessInfo(MaterialInfo info, PS_Input input)
 {
-    info.metallic = u_Metallic;
-    info.perceptualRoughness = u_Roughness;
+    info.metallic = material.metallic;
+    info.perceptualRoughness = material.roughness;
 
 #ifdef USE_METALLICROUGHNESS_TEXTURE
     // Roughness is stored in the 'g' channel, metallic is stored in the 'b' channel.
     // This layout intentionally reserves the 'r' channel for (optional) occlusion map data
-    float4 mrSample = texture_roughness.Sample(texture_sampler_roughness, input.tex);
+    float4 mrSample = SampleMaterialTexture(material.metallicRoughnessTexture, input.tex);
     info.perceptualRoughness *= mrSample.g;
     info.metallic *= mrSample.b;
 #endif
@@ -371,37 +352,10 @@ MaterialInfo getMetallicRoughnessInfo(MaterialInfo info, PS_Input input)
     return info;
 }
 
-float MainShadowCalculation(float4 fragPosLightSpace, float3 normal)
-{
-    float3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-    projCoords.xy = projCoords.xy * 0.5 + 0.5;
-    //projCoords.z = projCoords.z * 0.5 + 0.5;
-
-    float currentDepth = projCoords.z;
-    float bias = max(0.005 * (1.0 - abs(dot(normalize(normal), normalize(lights[0].direction.xyz)))), 0.0005);
-    
-    //return bias;
-    //PCF
-    float shadow = 0.0;
-    int sizex, sizey;
-    DirectionalShadowMap.GetDimensions(sizex, sizey);
-    float2 texelSize = 1.0 / float2(sizex, sizey);
-    for (int x = -1; x <= 1; ++x)
-    {
-        for (int y = -1; y <= 1; ++y)
-        {
-            float pcfDepth = DirectionalShadowMap.Sample(DirectionalShadowSampler, projCoords.xy + float2(x, y) * texelSize).r;
-            //return pcfDepth;
-            shadow += currentDepth > pcfDepth + bias ? 1.0 : 0.0;
-        }
-    }
-    shadow /= 9.0;
-
-    return shadow;
-}
-
 float4 main(PS_Input input, bool isFrontFacing : SV_IsFrontFace) : SV_TARGET
 {
+    material = materials[input.materialIndex];
+
     float4 baseColor = getBaseColor(input);
     
     float3 color = float3(0, 0, 0);
@@ -465,9 +419,11 @@ float4 main(PS_Input input, bool isFrontFacing : SV_IsFrontFace) : SV_TARGET
     float3 f_dielectric_brdf = float3(0.0.xxx);
     float3 f_metal_brdf = float3(0.0.xxx);
     
-    for (int i = 0; i < lightCount; i++)
+    LightCluster cluster = GetLightCluster(input.position, input.fragPosition);
+    uint clusterLightCount = uint(globalLightCount) + cluster.count;
+    for (uint i = 0; i < clusterLightCount; i++)
     {
-        Light light = lights[i];
+        Light light = lights[GetClusterLight(cluster, i)];
         
         float3 pointToLight;
         if (light.position.w == 1.0)
@@ -515,20 +471,25 @@ float4 main(PS_Input input, bool isFrontFacing : SV_IsFrontFace) : SV_TARGET
         float3 l_color = lerp(l_dielectric_brdf, l_metal_brdf, materialInfo.metallic);
         l_color = l_sheen + l_color * l_albedoSheenScaling;
         l_color = lerp(l_color, l_clearcoat_brdf, clearcoatFactor * clearcoatFresnel);
-        color += l_color;
+
+        // The main light stays first in the light list, the shadow cascades are rendered for it
+        float shadow = 0.0;
+        if (i == 0 && light.position.w == 1.0)
+            shadow = MainShadowCalculation(input.fragPosition, n);
+        color += l_color * (1.0 - shadow);
     }
     
-    f_emissive = u_EmissiveFactor;
+    f_emissive = material.emissiveFactor.rgb;
     
 #ifdef USE_EMISSIVE_TEXTURE
-    f_emissive *= texture_emissive.Sample(texture_sampler_emissive, input.tex).rgb;
+    f_emissive *= SampleMaterialTexture(material.emissiveTexture, input.tex).rgb;
 #endif
     
     color = f_emissive * (1.0 - clearcoatFactor * clearcoatFresnel) + color;
     
     
 #ifdef ALPHA_CUTOFF
-    if(baseColor.a < u_EmissiveFactor.w)
+    if(baseColor.a < material.emissiveFactor.w)
         discard;
     baseColor.a = 1.0;
 #endif
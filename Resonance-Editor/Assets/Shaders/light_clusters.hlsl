@@ -0,0 +1,27 @@
+// Froxel grid the CPU bins the lights of each camera into, see LightClusterer.h. Lights before globalLightCount reach
+// every pixel, the rest are looked up through the pixel's cluster. Include after the GlobalBuffer declaration.
+
+struct LightCluster
+{
+    uint offset; // into lightIndices
+    uint count;
+};
+
+StructuredBuffer<LightCluster> lightClusters : register(t5);
+StructuredBuffer<uint> lightIndices : register(t6);
+
+LightCluster GetLightCluster(float4 fragCoord, float3 worldPosition)
+{
+    float viewDepth = max(-mul(view, float4(worldPosition, 1.0)).z, 1e-4);
+
+    uint3 cluster;
+    cluster.xy = min(uint2(fragCoord.xy * clusterScale.xy), clusterGrid.xy - 1);
+    cluster.z = uint(clamp(log(viewDepth) * clusterScale.z + clusterScale.w, 0.0, float(clusterGrid.z - 1)));
+    return lightClusters[(cluster.z * clusterGrid.y + cluster.y) * clusterGrid.x + cluster.x];
+}
+
+// Index into lights of the i-th light shading a pixel of the cluster, for i below globalLightCount + cluster.count
+uint GetClusterLight(LightCluster cluster, uint i)
+{
+    return i < uint(globalLightCount) ? i : lightIndices[cluster.offset + i - uint(globalLightCount)];
+}
@@ -0,0 +1,36 @@
+// Every material the lit passes draw with, bound once per pass. Draws find their record through the materialIndex of
+// their object data. Mirrors MaterialRecord and MaterialTable::MaxTextures in MaterialTable.h.
+#define MATERIAL_TEXTURE_CAPACITY 4096
+
+struct MaterialRecord
+{
+    float4 baseColorFactor;
+    float roughness;
+    float metallic;
+    float normalScalar;
+    int flipNormalY; // 0 = no flip, 1 = flip Y normal
+    float4 emissiveFactor; // W = alpha cutoff
+    float4 specularFactor;
+    float preCompF0;
+    uint albedoTexture;
+    uint normalTexture;
+    uint metallicRoughnessTexture;
+    uint emissiveTexture;
+    uint specularTexture;
+    uint specularColorTexture;
+    uint _padding;
+};
+
+StructuredBuffer<MaterialRecord> materials : register(t0, space1);
+// Combined image samplers, the texture and sampler of a slot share the descriptor. Slot 0 is a dummy texture.
+Texture2D materialTextures[MATERIAL_TEXTURE_CAPACITY] : register(t1, space1);
+SamplerState materialSamplers[MATERIAL_TEXTURE_CAPACITY] : register(s1, space1);
+
+// The material of the pixel being shaded, loaded at the start of main
+static MaterialRecord material;
+
+// Pixels of different draws in one indirect batch may share a wave, so the index is not uniform
+float4 SampleMaterialTexture(uint index, float2 uv)
+{
+    return materialTextures[NonUniformResourceIndex(index)].Sample(materialSamplers[NonUniformResourceIndex(index)], uv);
+}
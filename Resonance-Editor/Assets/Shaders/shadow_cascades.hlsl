@@ -0,0 +1,45 @@
+// Cascaded shadow map of the main light, see ShadowCascades.h. Cascade i renders into tile i of DirectionalShadowMap,
+// tiles laid out two by two. Include after the GlobalBuffer and DirectionalShadowMap declarations.
+
+static const float CascadeTileScale = 0.5;
+
+// Shadow of the main light at a world position, from the first cascade that holds it with room for the filter taps.
+// Returns 0 outside every cascade.
+float MainShadowCalculation(float3 worldPosition, float3 normal)
+{
+    int sizex, sizey;
+    DirectionalShadowMap.GetDimensions(sizex, sizey);
+    float2 texelSize = 1.0 / float2(sizex, sizey);
+    float2 tileTexelSize = texelSize / CascadeTileScale;
+
+    float bias = max(0.005 * (1.0 - abs(dot(normalize(normal), normalize(lights[0].direction.xyz)))), 0.0005);
+
+    for (int c = 0; c < shadowCascadeCount; c++)
+    {
+        float4 fragPosLightSpace = mul(shadowCascades[c], float4(worldPosition, 1.0));
+        float3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+        float2 tileCoords = projCoords.xy * 0.5 + 0.5;
+        if (any(tileCoords < 2.0 * tileTexelSize) || any(tileCoords > 1.0 - 2.0 * tileTexelSize) ||
+            projCoords.z < 0.0 || projCoords.z > 1.0)
+        {
+            continue;
+        }
+
+        float2 atlasCoords = (float2(c & 1, c >> 1) + tileCoords) * CascadeTileScale;
+        float currentDepth = projCoords.z;
+
+        // PCF, sampled at level 0 since which cascade a pixel reads differs between neighbours
+        float shadow = 0.0;
+        for (int x = -1; x <= 1; ++x)
+        {
+            for (int y = -1; y <= 1; ++y)
+            {
+                float pcfDepth = DirectionalShadowMap.SampleLevel(DirectionalShadowSampler,
+                                                                  atlasCoords + float2(x, y) * texelSize, 0).r;
+                shadow += currentDepth > pcfDepth + bias ? 1.0 : 0.0;
+            }
+        }
+        return shadow / 9.0;
+    }
+    return 0.0;
+}
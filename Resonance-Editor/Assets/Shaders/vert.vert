@@ -1,14 +1,17 @@
+#include "vertex_packing.hlsl"
+
+// Declared in the order of the locations in VertexLayout
 struct VS_Input
 {
     float3 position : POSITION;
-    float4 color : COLOR;
-    float3 normal : NORMAL;
+    float4 normalTangent : NORMAL_TANGENT;
     float2 texcoord : TEXCOORD;
-    float4 tangent : TANGENT;
+    float4 color : COLOR;
     uint4 joints_0 : JOINTS_0;
     uint4 joints_1 : JOINTS_1;
     float4 weights_0 : WEIGHTS_0;
     float4 weights_1 : WEIGHTS_1;
+    uint instanceId : SV_InstanceID;
 };
 
 struct PS_Input
@@ -21,6 +24,7 @@ struct PS_Input
     float3 fragPosition : FRAG_POSITION;
     float3 fragViewPos : FRAG_VIEW_POS;
     float4 fragLightSpacePos : FRAG_LIGHT_SPACE_POS;
+    nointerpolation uint materialIndex : MATERIAL_INDEX;
 };
 
 struct Light
@@ -31,14 +35,21 @@ struct Light
     float4x4 mainViewProj;
 };
 
-cbuffer ObjectBuffer : register(b2, space2)
+struct ObjectData
 {
     float4x4 model;
     float4x4 transposeInverseModel;
     int paletteOffset;
     int jointCount;
+    uint materialIndex;
+    float _padding;
 };
 
+// One entry per queued draw
+StructuredBuffer<ObjectData> objects : register(t2, space2);
+// Object index of each instance of a draw, starting at its firstInstance
+StructuredBuffer<uint> instances : register(t3, space2);
+
 cbuffer GlobalBuffer : register(b0)
 {
     float4x4 viewProj;
@@ -55,10 +66,17 @@ PS_Input main(VS_Input input)
 {
     PS_Input output;
 
+    ObjectData object = objects[instances[input.instanceId]];
+    float4x4 model = object.model;
+    float4x4 transposeInverseModel = object.transposeInverseModel;
+
+    float3 localN;
+    float4 localTangent;
+    DecodeTangentFrame(input.normalTangent, localN, localTangent);
+
     float4 localPos = float4(input.position, 1.0f);
-    float3 localN = input.normal;
-    float4 localT4 = float4(input.tangent.xyz, 0.0f); // direction
-    float tanSign = input.tangent.w;
+    float4 localT4 = float4(localTangent.xyz, 0.0f); // direction
+    float tanSign = localTangent.w;
 
 
 //    if (paletteOffset > 0)
@@ -102,6 +120,7 @@ PS_Input main(VS_Input input)
 // Attributes passthrough
     output.color = input.color;
     output.tex = input.texcoord;
+    output.materialIndex = object.materialIndex;
 
 // World-space normal/tangent
     output.normal = normalize(mul(transposeInverseModel, float4(localN, 0.0f)).xyz);
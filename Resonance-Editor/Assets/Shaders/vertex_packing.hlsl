@@ -0,0 +1,34 @@
+// Decoding of the packed vertex attributes, mirrors the packing functions in Vertex.h. The attribute stream holds the
+// octahedral normal in xy, the tangent's angle around the normal over pi in z and the bitangent sign in w.
+static const float VERTEX_PACKING_PI = 3.14159265f;
+
+float3 OctahedralDecode(float2 e)
+{
+    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+// Branchless orthonormal basis around a unit vector, Duff et al. 2017
+void OrthonormalBasis(float3 n, out float3 b1, out float3 b2)
+{
+    float s = n.z >= 0.0f ? 1.0f : -1.0f;
+    float a = -1.0f / (s + n.z);
+    float b = n.x * n.y * a;
+    b1 = float3(1.0f + s * n.x * n.x * a, s * b, -s * n.x);
+    b2 = float3(b, s + n.y * n.y * a, -n.y);
+}
+
+// Object space normal and tangent, w of the tangent is the bitangent sign
+void DecodeTangentFrame(float4 packed, out float3 normal, out float4 tangent)
+{
+    normal = OctahedralDecode(packed.xy);
+
+    float3 b1, b2;
+    OrthonormalBasis(normal, b1, b2);
+    float s, c;
+    sincos(packed.z * VERTEX_PACKING_PI, s, c);
+    tangent = float4(c * b1 + s * b2, packed.w < 0.0f ? -1.0f : 1.0f);
+}
@@ -0,0 +1,386 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace REON::EDITOR
+{
+// Scoring constants from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static constexpr float CacheDecayPower = 1.5f;
+static constexpr float LastTriangleScore = 0.75f;
+static constexpr float ValenceBoostScale = 2.0f;
+static constexpr float ValenceBoostPower = 0.5f;
+
+static float VertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The last triangle's vertices score the same, whichever order they were in
+        if (cachePosition < 3)
+            score = LastTriangleScore;
+        else
+            score = std::pow(1.0f - float(cachePosition - 3) / float(MeshOptimizer::CacheSize - 3), CacheDecayPower);
+    }
+
+    // Vertices with few triangles left are finished first, so they do not end up costing a second transform
+    score += ValenceBoostScale * std::pow(float(remainingTriangles), -ValenceBoostPower);
+    return score;
+}
+
+template <class T>
+static void RemapStream(std::vector<T>& stream, const std::vector<uint32_t>& remap, uint32_t newCount,
+                        const T& fallback)
+{
+    if (stream.empty())
+        return;
+
+    std::vector<T> result(newCount, fallback);
+    for (size_t i = 0; i < remap.size(); i++)
+    {
+        if (remap[i] != UINT32_MAX && i < stream.size())
+            result[remap[i]] = stream[i];
+    }
+    stream = std::move(result);
+}
+
+MeshOptimizeReport MeshOptimizer::Optimize(ImportedMesh& mesh, const MeshOptimizeOptions& options)
+{
+    MeshOptimizeReport report;
+    const size_t vertexCount = mesh.positions.size();
+    if (!options.enabled || vertexCount == 0 || mesh.indices.size() < 3)
+        return report;
+
+    if (std::any_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t index) { return index >= vertexCount; }))
+    {
+        REON_WARN("MeshOptimizer: mesh {} has indices out of range, keeping its imported order", mesh.debugName);
+        return report;
+    }
+
+    if (options.report)
+        report.before = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount);
+
+    auto optimizeRange = [&](size_t first, size_t count) {
+        first = std::min(first, mesh.indices.size());
+        count = std::min(count, mesh.indices.size() - first) / 3 * 3;
+        OptimizeVertexCache(mesh.indices.data() + first, count, vertexCount);
+        if (options.overdraw)
+            OptimizeOverdraw(mesh.indices.data() + first, count, mesh.positions);
+    };
+
+    if (mesh.subMeshes.empty())
+    {
+        optimizeRange(0, mesh.indices.size());
+    }
+    else
+    {
+        for (const ImportedMesh::SubMesh& subMesh : mesh.subMeshes)
+            optimizeRange(subMesh.indexOffset, subMesh.indexCount);
+    }
+
+    // Ranges a level shares with the level before it are already optimized
+    const std::vector<ImportedMesh::SubMesh>* previous = &mesh.subMeshes;
+    for (const ImportedMesh::Lod& lod : mesh.lods)
+    {
+        for (size_t i = 0; i < lod.subMeshes.size(); i++)
+        {
+            const ImportedMesh::SubMesh& range = lod.subMeshes[i];
+            if (i >= previous->size() || (*previous)[i].indexOffset != range.indexOffset)
+                optimizeRange(range.indexOffset, range.indexCount);
+        }
+        previous = &lod.subMeshes;
+    }
+
+    OptimizeVertexFetch(mesh);
+
+    if (options.report)
+    {
+        report.after = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.positions.size());
+        REON_INFO("MeshOptimizer: {} ({} triangles) ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, overfetch {:.2f} -> "
+                  "{:.2f}",
+                  mesh.debugName, report.after.triangleCount, report.before.GetACMR(), report.after.GetACMR(),
+                  report.before.GetATVR(), report.after.GetATVR(), report.before.GetOverfetch(),
+                  report.after.GetOverfetch());
+    }
+    return report;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Triangles of each vertex, those not emitted yet are kept at the front of its range
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        triangleOffsets[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        triangleOffsets[v + 1] += triangleOffsets[v];
+
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    std::vector<uint32_t> vertexTriangles(triangleCount * 3);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        for (size_t k = 0; k < 3; k++)
+        {
+            const uint32_t v = indices[t * 3 + k];
+            vertexTriangles[triangleOffsets[v] + remainingTriangles[v]++] = uint32_t(t);
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScores[v] = VertexScore(-1, remainingTriangles[v]);
+
+    auto triangleScore = [&](size_t t) {
+        return vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+    };
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+
+    std::array<uint32_t, CacheSize + 3> cache;
+    size_t cacheCount = 0;
+    size_t deadEndCursor = 0;
+
+    int64_t best = 0;
+    float bestScore = -1.0f;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const float score = triangleScore(t);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = int64_t(t);
+        }
+    }
+
+    while (result.size() < triangleCount * 3)
+    {
+        if (best < 0)
+        {
+            // None of the cached vertices has triangles left, continue with the next one in input order
+            while (emitted[deadEndCursor])
+                deadEndCursor++;
+            best = int64_t(deadEndCursor);
+        }
+
+        const size_t triangle = size_t(best);
+        emitted[triangle] = true;
+
+        std::array<uint32_t, CacheSize + 3> newCache;
+        size_t newCacheCount = 0;
+        for (size_t k = 0; k < 3; k++)
+        {
+            const uint32_t v = indices[triangle * 3 + k];
+            result.push_back(v);
+            newCache[newCacheCount++] = v;
+
+            uint32_t* triangles = vertexTriangles.data() + triangleOffsets[v];
+            uint32_t& remaining = remainingTriangles[v];
+            const auto it = std::find(triangles, triangles + remaining, uint32_t(triangle));
+            std::swap(*it, triangles[remaining - 1]);
+            remaining--;
+        }
+
+        for (size_t i = 0; i < cacheCount; i++)
+        {
+            const uint32_t v = cache[i];
+            if (v != newCache[0] && v != newCache[1] && v != newCache[2])
+                newCache[newCacheCount++] = v;
+        }
+
+        for (size_t i = 0; i < newCacheCount; i++)
+        {
+            const uint32_t v = newCache[i];
+            cachePositions[v] = i < CacheSize ? int(i) : -1;
+            vertexScores[v] = VertexScore(cachePositions[v], remainingTriangles[v]);
+        }
+
+        // Only triangles of vertices whose score changed can have become the best one
+        best = -1;
+        bestScore = -1.0f;
+        for (size_t i = 0; i < newCacheCount; i++)
+        {
+            const uint32_t v = newCache[i];
+            const uint32_t* triangles = vertexTriangles.data() + triangleOffsets[v];
+            for (uint32_t j = 0; j < remainingTriangles[v]; j++)
+            {
+                const float score = triangleScore(triangles[j]);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = triangles[j];
+                }
+            }
+        }
+
+        cacheCount = std::min<size_t>(newCacheCount, CacheSize);
+        std::copy(newCache.begin(), newCache.begin() + cacheCount, cache.begin());
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<glm::vec3>& positions)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+        return;
+
+    // Split where a triangle misses on all three vertices, the cache starts over there so moving the cluster that
+    // follows costs next to nothing
+    std::vector<size_t> clusterStarts;
+    std::vector<uint32_t> timestamps(positions.size(), 0);
+    uint32_t time = AnalyzeCacheSize + 1;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        uint32_t misses = 0;
+        for (size_t k = 0; k < 3; k++)
+        {
+            const uint32_t v = indices[t * 3 + k];
+            if (time - timestamps[v] > AnalyzeCacheSize)
+            {
+                timestamps[v] = time++;
+                misses++;
+            }
+        }
+        if (t == 0 || misses == 3)
+            clusterStarts.push_back(t);
+    }
+    if (clusterStarts.size() < 2)
+        return;
+    clusterStarts.push_back(triangleCount);
+
+    struct Cluster
+    {
+        size_t first;
+        size_t count;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters(clusterStarts.size() - 1);
+
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        Cluster& cluster = clusters[c];
+        cluster.first = clusterStarts[c];
+        cluster.count = clusterStarts[c + 1] - clusterStarts[c];
+        cluster.centroid = glm::vec3(0.0f);
+        cluster.normal = glm::vec3(0.0f);
+
+        float area = 0.0f;
+        for (size_t t = cluster.first; t < cluster.first + cluster.count; t++)
+        {
+            const glm::vec3& p0 = positions[indices[t * 3]];
+            const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+            const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float triangleArea = glm::length(normal);
+
+            cluster.centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            cluster.normal += normal;
+            area += triangleArea;
+        }
+
+        meshCentroid += cluster.centroid;
+        meshArea += area;
+        cluster.centroid = area > 0.0f ? cluster.centroid / area : positions[indices[cluster.first * 3]];
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+    // Clusters facing away from the center occlude the ones facing inwards from most directions, draw them first
+    for (Cluster& cluster : clusters)
+    {
+        const float length = glm::length(cluster.normal);
+        cluster.sortKey = length > 0.0f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / length) : 0.0f;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(),
+                     [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    for (const Cluster& cluster : clusters)
+        result.insert(result.end(), indices + cluster.first * 3, indices + (cluster.first + cluster.count) * 3);
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(ImportedMesh& mesh)
+{
+    std::vector<uint32_t> remap(mesh.positions.size(), UINT32_MAX);
+    uint32_t vertexCount = 0;
+    for (uint32_t& index : mesh.indices)
+    {
+        if (remap[index] == UINT32_MAX)
+            remap[index] = vertexCount++;
+        index = remap[index];
+    }
+
+    RemapStream(mesh.positions, remap, vertexCount, glm::vec3(0.0f));
+    RemapStream(mesh.normals, remap, vertexCount, glm::vec3(0.0f));
+    RemapStream(mesh.tangents, remap, vertexCount, glm::vec4(0.0f));
+    RemapStream(mesh.uv0, remap, vertexCount, glm::vec2(0.0f));
+    RemapStream(mesh.colors, remap, vertexCount, glm::vec4(1.0f));
+    RemapStream(mesh.joints_0, remap, vertexCount, glm::u16vec4(0));
+    RemapStream(mesh.joints_1, remap, vertexCount, glm::u16vec4(0));
+    RemapStream(mesh.weights_0, remap, vertexCount, glm::vec4(0.0f));
+    RemapStream(mesh.weights_1, remap, vertexCount, glm::vec4(0.0f));
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    constexpr uint32_t LineSize = 64;
+    constexpr uint32_t LineCount = 256;
+
+    VertexCacheStats stats;
+    stats.triangleCount = uint32_t(indexCount / 3);
+
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    std::array<uint64_t, LineCount> lines;
+    lines.fill(UINT64_MAX);
+    uint32_t time = AnalyzeCacheSize + 1;
+
+    for (size_t i = 0; i < size_t(stats.triangleCount) * 3; i++)
+    {
+        const uint32_t v = indices[i];
+        if (v >= vertexCount)
+            continue;
+
+        if (!referenced[v])
+        {
+            referenced[v] = true;
+            stats.vertexCount++;
+        }
+
+        if (time - timestamps[v] <= AnalyzeCacheSize)
+            continue;
+
+        timestamps[v] = time++;
+        stats.transformedCount++;
+
+        // A miss fetches the vertex, count the cache lines that were not resident
+        const uint64_t begin = uint64_t(v) * sizeof(glm::vec3);
+        const uint64_t end = begin + sizeof(glm::vec3);
+        for (uint64_t line = begin / LineSize; line <= (end - 1) / LineSize; line++)
+        {
+            if (lines[line % LineCount] != line)
+            {
+                lines[line % LineCount] = line;
+                stats.fetchedBytes += LineSize;
+            }
+        }
+    }
+    return stats;
+}
+} // namespace REON::EDITOR
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "AssetManagement/Assets/Model/ModelImport.h"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace REON::EDITOR
+{
+// Post-transform cache and vertex fetch behaviour of an index buffer, simulated on the CPU.
+struct VertexCacheStats
+{
+    uint32_t triangleCount = 0;
+    uint32_t vertexCount = 0;      // unique vertices referenced
+    uint32_t transformedCount = 0; // vertex shader invocations, cache misses
+    uint32_t fetchedBytes = 0;     // bytes loaded from the position stream
+
+    // Average cache miss ratio, transformed vertices per triangle. 0.5 is the ideal of a regular grid, 3 no reuse.
+    float GetACMR() const
+    {
+        return triangleCount ? float(transformedCount) / float(triangleCount) : 0.0f;
+    }
+    // Average transformed to vertex ratio, 1 is every vertex transformed once
+    float GetATVR() const
+    {
+        return vertexCount ? float(transformedCount) / float(vertexCount) : 0.0f;
+    }
+    // Bytes fetched over the bytes of the referenced vertices, 1 is every position read once
+    float GetOverfetch() const
+    {
+        return vertexCount ? float(fetchedBytes) / float(vertexCount * sizeof(glm::vec3)) : 0.0f;
+    }
+
+    VertexCacheStats& operator+=(const VertexCacheStats& other)
+    {
+        triangleCount += other.triangleCount;
+        vertexCount += other.vertexCount;
+        transformedCount += other.transformedCount;
+        fetchedBytes += other.fetchedBytes;
+        return *this;
+    }
+};
+
+struct MeshOptimizeReport
+{
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+struct MeshOptimizeOptions
+{
+    bool enabled = true;
+    // Reorders clusters of triangles so faces on the outside of the mesh come first, reducing overdraw at a small
+    // cost in cache efficiency.
+    bool overdraw = true;
+    // Logs the cache statistics of every mesh before and after optimizing
+    bool report = true;
+};
+
+// Cook time reordering of mesh data for the GPU. Triangles are reordered per submesh and level of detail range, so the
+// ranges and the draw order between them stay as imported, vertices are then renumbered in the order the triangles
+// first use them.
+class MeshOptimizer
+{
+  public:
+    // Statistics are only gathered with options.report set
+    static MeshOptimizeReport Optimize(ImportedMesh& mesh, const MeshOptimizeOptions& options);
+
+    // Forsyth's linear speed vertex cache optimization, over an LRU cache of CacheSize entries.
+    static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+    // Tipsify style overdraw ordering of cache optimized triangles, clusters split where the cache starts over are
+    // sorted by how much they face away from the mesh center. Keeps the order within each cluster.
+    static void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<glm::vec3>& positions);
+    // Renumbers vertices in order of first use and drops unreferenced ones, every vertex stream is remapped.
+    static void OptimizeVertexFetch(ImportedMesh& mesh);
+
+    // Simulated with a FIFO of AnalyzeCacheSize entries, the common model for hardware post-transform caches, and a
+    // direct mapped cache of 64 byte lines over the position stream.
+    static VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+    static constexpr uint32_t CacheSize = 32;
+    static constexpr uint32_t AnalyzeCacheSize = 16;
+};
+} // namespace REON::EDITOR
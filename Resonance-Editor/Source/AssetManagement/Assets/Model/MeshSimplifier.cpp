@@ -0,0 +1,443 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace REON::EDITOR
+{
+// Collapses that change the vertex normal or uv cost this much on top of their quadric error, scaled to squared
+// distances so both weigh in like a surface offset.
+static constexpr float NormalWeight = 1.0f;
+static constexpr float UvWeight = 0.5f;
+// Collapses may turn a triangle by at most this much, as the cosine between its normals before and after
+static constexpr float MinFlipCosine = 0.25f;
+
+// Symmetric 4x4 error quadric of a set of planes, weighted by triangle area
+struct Quadric
+{
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double weight = 0;
+
+    void AddPlane(const glm::dvec3& n, double d, double w)
+    {
+        a00 += w * n.x * n.x;
+        a01 += w * n.x * n.y;
+        a02 += w * n.x * n.z;
+        a11 += w * n.y * n.y;
+        a12 += w * n.y * n.z;
+        a22 += w * n.z * n.z;
+        b0 += w * n.x * d;
+        b1 += w * n.y * d;
+        b2 += w * n.z * d;
+        c += w * d * d;
+        weight += w;
+    }
+
+    Quadric& operator+=(const Quadric& other)
+    {
+        a00 += other.a00;
+        a01 += other.a01;
+        a02 += other.a02;
+        a11 += other.a11;
+        a12 += other.a12;
+        a22 += other.a22;
+        b0 += other.b0;
+        b1 += other.b1;
+        b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+        return *this;
+    }
+
+    // Mean squared distance of p to the planes
+    float Evaluate(const glm::vec3& point) const
+    {
+        const double x = point.x, y = point.y, z = point.z;
+        const double error = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                             2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return weight > 0.0 ? float(std::max(error, 0.0) / weight) : 0.0f;
+    }
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    float error; // quadric part of the cost, mean squared distance
+    float cost;
+};
+
+uint32_t MeshSimplifier::GenerateLods(ImportedMesh& mesh, const MeshLodOptions& options)
+{
+    mesh.lods.clear();
+    const size_t vertexCount = mesh.positions.size();
+    if (!options.enabled || options.maxLodCount == 0 || mesh.subMeshes.empty() || vertexCount == 0)
+        return 0;
+
+    if (std::any_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t index) { return index >= vertexCount; }))
+    {
+        REON_WARN("MeshSimplifier: mesh {} has indices out of range, no levels of detail generated", mesh.debugName);
+        return 0;
+    }
+
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for (uint32_t index : mesh.indices)
+    {
+        min = glm::min(min, mesh.positions[index]);
+        max = glm::max(max, mesh.positions[index]);
+    }
+    const float radius = min.x <= max.x ? glm::length(max - min) * 0.5f : 0.0f;
+    if (radius <= 0.0f)
+        return 0;
+
+    const size_t baseIndexCount = mesh.indices.size();
+    std::vector<ImportedMesh::SubMesh> previous = mesh.subMeshes;
+    size_t previousTriangles = baseIndexCount / 3;
+    float previousError = 0.0f;
+
+    for (uint32_t level = 1; level <= options.maxLodCount; level++)
+    {
+        const size_t levelStart = mesh.indices.size();
+        const float ratio = std::pow(options.reductionRatio, float(level));
+
+        ImportedMesh::Lod lod;
+        lod.error = previousError;
+        size_t triangles = 0;
+        for (size_t s = 0; s < mesh.subMeshes.size(); s++)
+        {
+            const ImportedMesh::SubMesh& base = mesh.subMeshes[s];
+            const size_t first = std::min<size_t>(base.indexOffset, baseIndexCount);
+            const size_t baseCount = std::min<size_t>(base.indexCount, baseIndexCount - first) / 3 * 3;
+            const size_t target = size_t(float(baseCount / 3) * ratio) * 3;
+
+            ImportedMesh::SubMesh range = previous[s];
+            if (baseCount / 3 >= options.minTriangleCount && target < range.indexCount)
+            {
+                float error = 0.0f;
+                std::vector<uint32_t> simplified = Simplify(mesh, mesh.indices.data() + first, baseCount,
+                                                            target, options.maxError * radius, &error);
+                if (simplified.size() < range.indexCount)
+                {
+                    range.indexOffset = uint32_t(mesh.indices.size());
+                    range.indexCount = uint32_t(simplified.size());
+                    mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+                    lod.error = std::max(lod.error, error);
+                }
+            }
+
+            lod.subMeshes.push_back(range);
+            triangles += range.indexCount / 3;
+        }
+
+        if (float(triangles) > float(previousTriangles) * (1.0f - MinLevelReduction))
+        {
+            mesh.indices.resize(levelStart);
+            break;
+        }
+
+        previous = lod.subMeshes;
+        previousTriangles = triangles;
+        previousError = lod.error;
+        mesh.lods.push_back(std::move(lod));
+    }
+
+    return uint32_t(mesh.lods.size());
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const ImportedMesh& mesh, const uint32_t* indices, size_t indexCount,
+                                               size_t targetIndexCount, float targetError, float* error)
+{
+    std::vector<uint32_t> result(indices, indices + indexCount / 3 * 3);
+    if (error)
+        *error = 0.0f;
+
+    const std::vector<glm::vec3>& positions = mesh.positions;
+    const size_t vertexCount = positions.size();
+    const size_t triangleCount = result.size() / 3;
+    if (result.size() <= targetIndexCount || triangleCount == 0)
+        return result;
+
+    const bool hasNormals = mesh.normals.size() == vertexCount;
+    const bool hasUvs = mesh.uv0.size() == vertexCount;
+
+    // Vertices sharing a position with another one sit on a seam, the attributes differ on either side
+    std::vector<uint32_t> welded(vertexCount);
+    std::vector<bool> locked(vertexCount, false);
+    {
+        struct PositionHash
+        {
+            size_t operator()(const glm::vec3& p) const
+            {
+                // Adding zero turns -0 into 0, which compare equal but differ in bits
+                const glm::vec3 q = p + glm::vec3(0.0f);
+                uint32_t bits[3];
+                std::memcpy(bits, &q, sizeof(bits));
+                return size_t(bits[0]) * 73856093u ^ size_t(bits[1]) * 19349663u ^ size_t(bits[2]) * 83492791u;
+            }
+        };
+        std::unordered_map<glm::vec3, uint32_t, PositionHash> firstAtPosition;
+        firstAtPosition.reserve(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            auto [it, inserted] = firstAtPosition.emplace(positions[v], v);
+            welded[v] = it->second;
+            if (!inserted)
+                locked[v] = locked[it->second] = true;
+        }
+    }
+
+    // Edges used by one triangle are open borders, more than two non-manifold, neither can be collapsed safely
+    {
+        std::unordered_map<uint64_t, uint32_t> edgeUses;
+        edgeUses.reserve(result.size());
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            for (size_t k = 0; k < 3; k++)
+            {
+                uint32_t a = welded[result[t * 3 + k]];
+                uint32_t b = welded[result[t * 3 + (k + 1) % 3]];
+                if (a > b)
+                    std::swap(a, b);
+                edgeUses[(uint64_t(a) << 32) | b]++;
+            }
+        }
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            for (size_t k = 0; k < 3; k++)
+            {
+                const uint32_t va = result[t * 3 + k];
+                const uint32_t vb = result[t * 3 + (k + 1) % 3];
+                uint32_t a = welded[va];
+                uint32_t b = welded[vb];
+                if (a > b)
+                    std::swap(a, b);
+                if (edgeUses[(uint64_t(a) << 32) | b] != 2)
+                    locked[va] = locked[vb] = true;
+            }
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const glm::dvec3 p0 = positions[result[t * 3 + 0]];
+        const glm::dvec3 p1 = positions[result[t * 3 + 1]];
+        const glm::dvec3 p2 = positions[result[t * 3 + 2]];
+        const glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const double length = glm::length(normal);
+        if (length <= 0.0)
+            continue;
+
+        const glm::dvec3 n = normal / length;
+        for (size_t k = 0; k < 3; k++)
+            quadrics[result[t * 3 + k]].AddPlane(n, -glm::dot(n, p0), length * 0.5);
+    }
+
+    auto collapseCost = [&](uint32_t from, uint32_t to, float& geometric) {
+        Quadric quadric = quadrics[from];
+        quadric += quadrics[to];
+        geometric = quadric.Evaluate(positions[to]);
+
+        float cost = geometric;
+        const glm::vec3 offset = positions[to] - positions[from];
+        const float distance2 = glm::dot(offset, offset);
+        if (hasNormals)
+        {
+            const float cosine = glm::dot(mesh.normals[from], mesh.normals[to]);
+            cost += NormalWeight * (1.0f - cosine) * distance2;
+        }
+        if (hasUvs)
+        {
+            // uv space is normalized to the mesh, compare it to the edge length
+            const glm::vec2 uvOffset = mesh.uv0[to] - mesh.uv0[from];
+            cost += UvWeight * glm::dot(uvOffset, uvOffset) * distance2;
+        }
+        return cost;
+    };
+
+    const float errorLimit = targetError * targetError;
+    size_t liveTriangles = triangleCount;
+    std::vector<bool> removed(triangleCount, false);
+    float maxError = 0.0f;
+
+    std::vector<uint32_t> offsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched(vertexCount);
+    std::vector<uint32_t> neighbours;
+
+    auto triangleNormal = [&](const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+        return glm::cross(b - a, c - a);
+    };
+
+    while (liveTriangles * 3 > targetIndexCount)
+    {
+        // Triangles around each vertex, rebuilt every pass. A collapse only rewrites triangles of the vertex that
+        // moves, which is marked touched together with its target, so the lists of untouched vertices stay exact.
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            if (!removed[t])
+            {
+                for (size_t k = 0; k < 3; k++)
+                    offsets[result[t * 3 + k] + 1]++;
+            }
+        }
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] += offsets[v];
+        adjacency.resize(offsets[vertexCount]);
+        {
+            std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                if (!removed[t])
+                {
+                    for (size_t k = 0; k < 3; k++)
+                        adjacency[cursor[result[t * 3 + k]]++] = uint32_t(t);
+                }
+            }
+        }
+
+        collapses.clear();
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            if (removed[t])
+                continue;
+            for (size_t k = 0; k < 3; k++)
+            {
+                const uint32_t a = result[t * 3 + k];
+                const uint32_t b = result[t * 3 + (k + 1) % 3];
+                float geometric = 0.0f;
+                if (!locked[a])
+                {
+                    const float cost = collapseCost(a, b, geometric);
+                    collapses.push_back({a, b, geometric, cost});
+                }
+                if (!locked[b])
+                {
+                    const float cost = collapseCost(b, a, geometric);
+                    collapses.push_back({b, a, geometric, cost});
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        std::fill(touched.begin(), touched.end(), false);
+        size_t collapsed = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (liveTriangles * 3 <= targetIndexCount)
+                break;
+            const uint32_t from = collapse.from;
+            const uint32_t to = collapse.to;
+            if (collapse.error > errorLimit || touched[from] || touched[to])
+                continue;
+
+            // Link condition: the two vertices may only share the neighbours opposite the edge, or the collapse
+            // pinches the surface
+            neighbours.clear();
+            for (uint32_t i = offsets[from]; i < offsets[from + 1]; i++)
+            {
+                const uint32_t t = adjacency[i];
+                if (removed[t])
+                    continue;
+                for (size_t k = 0; k < 3; k++)
+                {
+                    const uint32_t v = result[t * 3 + k];
+                    if (v != from && v != to)
+                        neighbours.push_back(v);
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+            uint32_t shared = 0;
+            for (uint32_t i = offsets[to]; i < offsets[to + 1]; i++)
+            {
+                const uint32_t t = adjacency[i];
+                if (removed[t])
+                    continue;
+                for (size_t k = 0; k < 3; k++)
+                {
+                    const uint32_t v = result[t * 3 + k];
+                    if (v != to && std::binary_search(neighbours.begin(), neighbours.end(), v))
+                    {
+                        shared++;
+                        neighbours.erase(std::lower_bound(neighbours.begin(), neighbours.end(), v));
+                    }
+                }
+            }
+            if (shared > 2)
+                continue;
+
+            bool flips = false;
+            for (uint32_t i = offsets[from]; i < offsets[from + 1] && !flips; i++)
+            {
+                const uint32_t t = adjacency[i];
+                const uint32_t* triangle = &result[t * 3];
+                if (removed[t] || triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                    continue;
+
+                const size_t k = triangle[0] == from ? 0 : triangle[1] == from ? 1 : 2;
+                const glm::vec3& b = positions[triangle[(k + 1) % 3]];
+                const glm::vec3& c = positions[triangle[(k + 2) % 3]];
+                const glm::vec3 before = triangleNormal(positions[from], b, c);
+                const glm::vec3 after = triangleNormal(positions[to], b, c);
+                const float lengths = glm::length(before) * glm::length(after);
+                flips = lengths <= 0.0f || glm::dot(before, after) < MinFlipCosine * lengths;
+            }
+            if (flips)
+                continue;
+
+            for (uint32_t i = offsets[from]; i < offsets[from + 1]; i++)
+            {
+                const uint32_t t = adjacency[i];
+                if (removed[t])
+                    continue;
+
+                uint32_t* triangle = &result[t * 3];
+                if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                {
+                    removed[t] = true;
+                    liveTriangles--;
+                    continue;
+                }
+                for (size_t k = 0; k < 3; k++)
+                {
+                    if (triangle[k] == from)
+                        triangle[k] = to;
+                }
+            }
+
+            quadrics[to] += quadrics[from];
+            maxError = std::max(maxError, collapse.error);
+            touched[from] = touched[to] = true;
+            collapsed++;
+        }
+
+        if (collapsed == 0)
+            break;
+    }
+
+    size_t write = 0;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        if (removed[t])
+            continue;
+        for (size_t k = 0; k < 3; k++)
+            result[write++] = result[t * 3 + k];
+    }
+    result.resize(write);
+
+    if (error)
+        *error = std::sqrt(maxError);
+    return result;
+}
+} // namespace REON::EDITOR
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "AssetManagement/Assets/Model/ModelImport.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace REON::EDITOR
+{
+struct MeshLodOptions
+{
+    bool enabled = true;
+    uint32_t maxLodCount = 3;
+    // Triangle count of each level relative to the one before it
+    float reductionRatio = 0.5f;
+    // Largest simplification error of any level, relative to the mesh's bounding sphere radius
+    float maxError = 0.05f;
+    // Submeshes with fewer triangles are left as they are
+    uint32_t minTriangleCount = 64;
+};
+
+// Cook time level of detail generation. Every level is simplified from the full mesh and stored as extra index
+// ranges, so the levels share one vertex buffer and switching between them only changes the range that is drawn.
+class MeshSimplifier
+{
+  public:
+    // Fills mesh.lods and appends their indices to mesh.indices. Levels that remove less than MinLevelReduction of the
+    // triangles of the level before end the chain. Returns the number of levels generated.
+    static uint32_t GenerateLods(ImportedMesh& mesh, const MeshLodOptions& options);
+
+    // Garland-Heckbert quadric error simplification of indices down to targetIndexCount, or until the next collapse
+    // would move the surface further than targetError. Edges are collapsed onto one of their vertices, so the result
+    // indexes the mesh's existing vertices. Vertices on open borders and on seams, where vertices at the same position
+    // carry different normals or uvs, never move, and collapses across normal or uv changes cost extra. error receives
+    // the largest error introduced, in mesh units.
+    static std::vector<uint32_t> Simplify(const ImportedMesh& mesh, const uint32_t* indices, size_t indexCount,
+                                          size_t targetIndexCount, float targetError, float* error = nullptr);
+
+    static constexpr float MinLevelReduction = 0.2f;
+};
+} // namespace REON::EDITOR
@@ -0,0 +1,228 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace REON::EDITOR
+{
+// Cones whose triangles spread further than this from the axis, as the cosine of the widest one, are never culled
+static constexpr float MinConeCosine = 0.1f;
+
+static void ComputeMeshletBounds(const ImportedMesh& mesh, ImportedMesh::Meshlet& meshlet)
+{
+    const uint32_t* indices = mesh.indices.data() + meshlet.indexOffset;
+    const size_t indexCount = size_t(meshlet.triangleCount) * 3;
+
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        min = glm::min(min, mesh.positions[indices[i]]);
+        max = glm::max(max, mesh.positions[indices[i]]);
+    }
+    meshlet.center = (min + max) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (size_t i = 0; i < indexCount; i++)
+        meshlet.radius = std::max(meshlet.radius, glm::length(mesh.positions[indices[i]] - meshlet.center));
+
+    // Normal cone after Zeux's meshoptimizer: the axis averages the triangle normals, the apex sits behind every
+    // triangle's plane so a camera looking at the apex from within the cone sees only back faces.
+    struct Plane
+    {
+        glm::vec3 normal;
+        glm::vec3 point;
+    };
+    std::vector<Plane> planes;
+    planes.reserve(meshlet.triangleCount);
+    glm::vec3 axis(0.0f);
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        const glm::vec3& p0 = mesh.positions[indices[i]];
+        const glm::vec3 normal =
+            glm::cross(mesh.positions[indices[i + 1]] - p0, mesh.positions[indices[i + 2]] - p0);
+        const float length = glm::length(normal);
+        if (length <= 0.0f)
+            continue;
+        planes.push_back({normal / length, p0});
+        axis += planes.back().normal;
+    }
+
+    meshlet.coneApex = meshlet.center;
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+
+    const float axisLength = glm::length(axis);
+    if (planes.empty() || axisLength <= 0.0f)
+        return;
+    axis /= axisLength;
+
+    float minCosine = 1.0f;
+    for (const Plane& plane : planes)
+        minCosine = std::min(minCosine, glm::dot(plane.normal, axis));
+    if (minCosine <= MinConeCosine)
+        return;
+
+    float apexOffset = 0.0f;
+    for (const Plane& plane : planes)
+        apexOffset = std::max(apexOffset, glm::dot(meshlet.center - plane.point, plane.normal) /
+                                              glm::dot(plane.normal, axis));
+
+    meshlet.coneApex = meshlet.center - axis * apexOffset;
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = std::sqrt(1.0f - minCosine * minCosine);
+}
+
+// Greedy clustering of indices [first, first + count): a cluster grows by the neighbouring triangle that adds the
+// fewest new vertices, closest to the cluster first, and starts over from the next triangle in the current order once
+// it is full or has no neighbours left.
+static void BuildSubMeshMeshlets(ImportedMesh& mesh, uint32_t subMesh, size_t first, size_t count)
+{
+    const uint32_t* indices = mesh.indices.data() + first;
+    const size_t triangleCount = count / 3;
+    const size_t vertexCount = mesh.positions.size();
+
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        offsets[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] += offsets[v];
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            for (size_t k = 0; k < 3; k++)
+                adjacency[cursor[indices[t * 3 + k]]++] = uint32_t(t);
+        }
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    // Cluster a vertex was last added to, so membership needs no clearing between clusters
+    std::vector<uint32_t> vertexCluster(vertexCount, UINT32_MAX);
+    std::vector<uint32_t> ordered;
+    ordered.reserve(triangleCount * 3);
+
+    std::vector<uint32_t> clusterVertices;
+    size_t seedCursor = 0;
+    uint32_t cluster = 0;
+
+    auto newVertices = [&](size_t t) {
+        uint32_t added = 0;
+        for (size_t k = 0; k < 3; k++)
+            added += vertexCluster[indices[t * 3 + k]] != cluster;
+        return added;
+    };
+    auto centroid = [&](size_t t) {
+        return (mesh.positions[indices[t * 3]] + mesh.positions[indices[t * 3 + 1]] +
+                mesh.positions[indices[t * 3 + 2]]) /
+               3.0f;
+    };
+
+    while (seedCursor < triangleCount)
+    {
+        while (seedCursor < triangleCount && emitted[seedCursor])
+            seedCursor++;
+        if (seedCursor == triangleCount)
+            break;
+
+        ImportedMesh::Meshlet meshlet{};
+        meshlet.indexOffset = uint32_t(first + ordered.size());
+        meshlet.subMesh = subMesh;
+        clusterVertices.clear();
+        glm::vec3 centroidSum(0.0f);
+
+        int64_t next = int64_t(seedCursor);
+        while (next >= 0)
+        {
+            const size_t t = size_t(next);
+            if (clusterVertices.size() + newVertices(t) > MeshletBuilder::MaxVertices ||
+                meshlet.triangleCount >= MeshletBuilder::MaxTriangles)
+                break;
+
+            emitted[t] = true;
+            for (size_t k = 0; k < 3; k++)
+            {
+                const uint32_t v = indices[t * 3 + k];
+                ordered.push_back(v);
+                if (vertexCluster[v] != cluster)
+                {
+                    vertexCluster[v] = cluster;
+                    clusterVertices.push_back(v);
+                }
+            }
+            meshlet.triangleCount++;
+            centroidSum += centroid(t);
+
+            const glm::vec3 center = centroidSum / float(meshlet.triangleCount);
+            next = -1;
+            uint32_t bestNew = 4;
+            float bestDistance = std::numeric_limits<float>::max();
+            for (uint32_t v : clusterVertices)
+            {
+                for (uint32_t i = offsets[v]; i < offsets[v + 1]; i++)
+                {
+                    const uint32_t candidate = adjacency[i];
+                    if (emitted[candidate])
+                        continue;
+
+                    const uint32_t added = newVertices(candidate);
+                    const glm::vec3 offset = centroid(candidate) - center;
+                    const float distance = glm::dot(offset, offset);
+                    if (added < bestNew || (added == bestNew && distance < bestDistance))
+                    {
+                        bestNew = added;
+                        bestDistance = distance;
+                        next = candidate;
+                    }
+                }
+            }
+
+            // Nothing connected left, continue with the next triangle in order if it still fits
+            if (next < 0)
+            {
+                while (seedCursor < triangleCount && emitted[seedCursor])
+                    seedCursor++;
+                if (seedCursor < triangleCount)
+                    next = int64_t(seedCursor);
+            }
+        }
+
+        meshlet.vertexCount = uint32_t(clusterVertices.size());
+        mesh.meshlets.push_back(meshlet);
+        cluster++;
+    }
+
+    std::copy(ordered.begin(), ordered.end(), mesh.indices.begin() + first);
+}
+
+uint32_t MeshletBuilder::Build(ImportedMesh& mesh, const MeshletOptions& options)
+{
+    mesh.meshlets.clear();
+    const size_t vertexCount = mesh.positions.size();
+    if (!options.enabled || vertexCount == 0)
+        return 0;
+
+    if (std::any_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t index) { return index >= vertexCount; }))
+    {
+        REON_WARN("MeshletBuilder: mesh {} has indices out of range, no meshlets built", mesh.debugName);
+        return 0;
+    }
+
+    for (uint32_t s = 0; s < mesh.subMeshes.size(); s++)
+    {
+        const ImportedMesh::SubMesh& subMesh = mesh.subMeshes[s];
+        const size_t first = std::min<size_t>(subMesh.indexOffset, mesh.indices.size());
+        const size_t count = std::min<size_t>(subMesh.indexCount, mesh.indices.size() - first) / 3 * 3;
+        if (count / 3 < options.minTriangleCount)
+            continue;
+
+        const size_t firstMeshlet = mesh.meshlets.size();
+        BuildSubMeshMeshlets(mesh, s, first, count);
+        for (size_t i = firstMeshlet; i < mesh.meshlets.size(); i++)
+            ComputeMeshletBounds(mesh, mesh.meshlets[i]);
+    }
+
+    return uint32_t(mesh.meshlets.size());
+}
+} // namespace REON::EDITOR
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "AssetManagement/Assets/Model/ModelImport.h"
+
+#include <cstdint>
+
+namespace REON::EDITOR
+{
+struct MeshletOptions
+{
+    bool enabled = true;
+    // Submeshes with fewer triangles are drawn whole, culling their clusters would not pay for itself
+    uint32_t minTriangleCount = 1024;
+};
+
+// Cook time partitioning of submeshes into clusters the renderer can cull on their own. Triangles of every cluster are
+// moved next to each other in the index buffer, so a cluster is a plain index range and survivors that follow each
+// other merge into one draw.
+class MeshletBuilder
+{
+  public:
+    // Fills mesh.meshlets for the base submeshes, levels of detail are not clustered. Reorders indices within each
+    // submesh, run before MeshOptimizer::OptimizeVertexFetch.
+    static uint32_t Build(ImportedMesh& mesh, const MeshletOptions& options);
+
+    // Mesh shader sized limits, so the same clusters can be fed to a mesh shader path without rebuilding them.
+    static constexpr uint32_t MaxVertices = 64;
+    static constexpr uint32_t MaxTriangles = 124;
+};
+} // namespace REON::EDITOR
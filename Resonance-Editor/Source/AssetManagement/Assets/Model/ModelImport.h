@@ -85,6 +85,30 @@ struct ImportedMesh
 
     std::vector<SubMesh> subMeshes;
 
+    // Coarser versions of the submeshes generated at cook time, see MeshSimplifier. Their index ranges point into
+    // indices past the base submeshes and reference the same vertices.
+    struct Lod
+    {
+        float error; // largest simplification error, in mesh units
+        std::vector<SubMesh> subMeshes;
+    };
+    std::vector<Lod> lods;
+
+    // Clusters of the base submeshes, see MeshletBuilder. Each one is a contiguous range of indices.
+    struct Meshlet
+    {
+        glm::vec3 center; // bounding sphere
+        float radius;
+        glm::vec3 coneApex;
+        glm::vec3 coneAxis;
+        float coneCutoff; // sine of the cone's half angle, 1 when the triangles face too many ways to be culled
+        uint32_t indexOffset;
+        uint32_t triangleCount;
+        uint32_t vertexCount;
+        uint32_t subMesh;
+    };
+    std::vector<Meshlet> meshlets;
+
     // if skinned later: joints/weights
 };
 
@@ -98,8 +122,34 @@ struct ImportedSkin
 struct ImportedRig
 {
     AssetId rigId;
-    std::vector<AssetId> joints;
+    std::vector<AssetId> joints; // parents before their children
     std::vector<uint32_t> skinIndices;
+    std::vector<NodeIndex> jointNodes; // imported node of every joint, in the same order
+};
+
+// Keyframes of one animated channel of a rig joint. Step keys are stored as pairs of keys at the same time, cubic
+// spline keys by their values with the tangents dropped, so every track is sampled linearly.
+struct ImportedAnimationTrack
+{
+    enum Channel : uint32_t
+    {
+        Translation = 0,
+        Rotation = 1,
+        Scale = 2,
+    };
+
+    uint32_t joint; // rig joint index
+    Channel channel;
+    std::vector<float> times;
+    std::vector<glm::vec4> values; // xyz for translation and scale, xyzw for rotation
+};
+
+struct ImportedAnimationClip
+{
+    AssetId id;
+    std::string debugName;
+    float duration = 0.0f; // seconds
+    std::vector<ImportedAnimationTrack> tracks;
 };
 
 struct ImportedNode
@@ -132,6 +182,7 @@ struct ImportedModel
     std::vector<ImportedNode> nodes;
     std::optional<ImportedRig> rig;
     std::vector<ImportedSkin> skins;
+    std::vector<ImportedAnimationClip> animations; // only channels of rig joints are kept
     std::vector<NodeIndex> rootNodes = {0};
 };
 
@@ -0,0 +1,87 @@
+#include "RigBuilder.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace REON::EDITOR
+{
+void RigBuilder::LinkParents(std::vector<ImportedNode>& nodes)
+{
+    for (ImportedNode& node : nodes)
+        node.parent = UINT32_MAX;
+
+    for (NodeIndex n = 0; n < (NodeIndex)nodes.size(); ++n)
+    {
+        for (NodeIndex child : nodes[n].children)
+        {
+            if (child < nodes.size())
+                nodes[child].parent = n;
+        }
+    }
+}
+
+void RigBuilder::SortJoints(const std::vector<ImportedNode>& nodes, std::vector<NodeIndex>& jointNodes)
+{
+    auto nodeDepth = [&](NodeIndex nodeIdx)
+    {
+        uint32_t depth = 0;
+        // Bounded by the node count, so a cycle in a broken file cannot hang the import
+        for (NodeIndex p = nodes[nodeIdx].parent; p < nodes.size() && depth <= nodes.size(); p = nodes[p].parent)
+            ++depth;
+        return depth;
+    };
+    std::stable_sort(jointNodes.begin(), jointNodes.end(),
+                     [&](NodeIndex a, NodeIndex b) { return nodeDepth(a) < nodeDepth(b); });
+}
+
+std::vector<RigJointRecord> RigBuilder::BuildJointRecords(const ImportedModel& model)
+{
+    const std::vector<NodeIndex>& jointNodes = model.rig->jointNodes;
+    std::unordered_map<NodeIndex, int32_t> nodeToJoint;
+    for (size_t i = 0; i < jointNodes.size(); ++i)
+        nodeToJoint[jointNodes[i]] = (int32_t)i;
+
+    std::vector<RigJointRecord> records(jointNodes.size());
+    for (size_t i = 0; i < jointNodes.size(); ++i)
+    {
+        const ImportedNode& node = model.nodes[jointNodes[i]];
+        RigJointRecord& r = records[i];
+        r.parent = -1;
+        std::memcpy(r.t, &node.t, sizeof(r.t));
+        r.r[0] = node.r.x;
+        r.r[1] = node.r.y;
+        r.r[2] = node.r.z;
+        r.r[3] = node.r.w;
+        std::memcpy(r.s, &node.s, sizeof(r.s));
+
+        // The root node's transform is the object the animator sits on, so it is left out of the offset
+        glm::mat4 offset(1.0f);
+        if (node.parent == UINT32_MAX)
+            offset = glm::inverse(NodeLocalMatrix(node));
+        for (NodeIndex p = node.parent; p < model.nodes.size(); p = model.nodes[p].parent)
+        {
+            auto joint = nodeToJoint.find(p);
+            if (joint != nodeToJoint.end())
+            {
+                r.parent = joint->second;
+                break;
+            }
+            if (model.nodes[p].parent == UINT32_MAX)
+                break;
+            offset = NodeLocalMatrix(model.nodes[p]) * offset;
+        }
+        std::memcpy(r.parentOffset, &offset, sizeof(r.parentOffset));
+    }
+    return records;
+}
+
+glm::mat4 RigBuilder::NodeLocalMatrix(const ImportedNode& node)
+{
+    return glm::translate(glm::mat4(1.0f), node.t) * glm::mat4_cast(glm::quat(node.r)) *
+           glm::scale(glm::mat4(1.0f), node.s);
+}
+} // namespace REON::EDITOR
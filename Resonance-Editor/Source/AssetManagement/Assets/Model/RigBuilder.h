@@ -0,0 +1,28 @@
+#pragma once
+
+#include "AssetManagement/Assets/Model/ModelImport.h"
+#include "REON/AssetManagement/ModelBinFormat.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace REON::EDITOR
+{
+// Joint hierarchy of an imported rig, worked out from the imported nodes. Imported nodes keep the indices of the source
+// file, so a node's children list is all that is needed to find its parent.
+class RigBuilder
+{
+  public:
+    // Sets every node's parent from its parent's children list. Nodes nothing points at stay roots.
+    static void LinkParents(std::vector<ImportedNode>& nodes);
+
+    // Orders joint nodes by depth so parents come before their children and a pose is composed in one pass. Joints at
+    // the same depth keep their order. Needs linked parents.
+    static void SortJoints(const std::vector<ImportedNode>& nodes, std::vector<NodeIndex>& jointNodes);
+
+    // Parent joint, rest pose and parent offset of every rig joint, from the nodes the joints were imported from.
+    static std::vector<RigJointRecord> BuildJointRecords(const ImportedModel& model);
+
+    static glm::mat4 NodeLocalMatrix(const ImportedNode& node);
+};
+} // namespace REON::EDITOR
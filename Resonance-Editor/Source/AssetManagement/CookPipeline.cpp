@@ -6,8 +6,14 @@
 #include "ImportedSourceStore.h"
 #include "MaterialBinWriter.h"
 #include "ModelBinWriter.h"
+#include "ShaderPackWriter.h"
 #include "TextureBinWriter.h"
 
+#include "REON/AssetManagement/MaterialBinFormat.h"
+#include "REON/Rendering/ShaderPrograms.h"
+
+#include <set>
+
 namespace REON::EDITOR
 {
 std::unordered_map<AssetTypeId, std::unique_ptr<IImporter>> CookPipeline::m_Importers;
@@ -41,6 +47,12 @@ bool CookPipeline::CookAll(BuildQueue& queue)
         manifestWriter.Upsert(cookOutput.artifacts);
     }
 
+    if (shaderPackDirty)
+    {
+        manifestWriter.Upsert(CookShaderPack().artifacts);
+        shaderPackDirty = false;
+    }
+
     manifestWriter.Save(options.projectRoot / options.cookedRoot / "manifest.bin");
 
     return true;
@@ -83,6 +95,7 @@ bool CookPipeline::cookAsset(const BuildJob& job, const AssetRecord& record, Coo
 
     case ASSET_MATERIAL:
         out = CookMaterial(record);
+        shaderPackDirty = true;
         return true;
 
     case ASSET_TEXTURE:
@@ -104,8 +117,39 @@ CookOutput CookPipeline::CookModel(const AssetRecord& record)
         return {};
     }
 
-    CookOutput output = ModelBinWriter::WriteModelBin(importedModel.value(), options.projectRoot / options.cookedRoot /
-                                                                                 (record.id.to_string() + ".modelbin"));
+    ImportedModel& model = importedModel.value();
+    MeshOptimizeReport total;
+    VertexCacheStats optimized;
+    for (ImportedMesh& mesh : model.meshes)
+    {
+        // Levels of detail first, so the optimizer reorders their index ranges along with the base ones
+        MeshSimplifier::GenerateLods(mesh, options.meshLods);
+        MeshOptimizeReport report = MeshOptimizer::Optimize(mesh, options.meshOptimization);
+        optimized += report.after;
+
+        // Clustering regroups the optimized triangles, so vertices are renumbered for the final order. The after
+        // figures are taken again from that order, it is the one the cooked mesh is drawn in.
+        if (MeshletBuilder::Build(mesh, options.meshlets) > 0)
+        {
+            MeshOptimizer::OptimizeVertexFetch(mesh);
+            if (report.after.triangleCount > 0)
+                report.after =
+                    MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.positions.size());
+        }
+        total.before += report.before;
+        total.after += report.after;
+    }
+    if (options.meshOptimization.enabled && options.meshOptimization.report && total.before.triangleCount > 0)
+    {
+        REON_INFO("CookModel: {} ({} triangles) ACMR {:.3f} -> {:.3f} (optimizer order {:.3f}), ATVR {:.3f} -> {:.3f}, "
+                  "overfetch {:.2f} -> {:.2f}",
+                  model.debugName, total.after.triangleCount, total.before.GetACMR(), total.after.GetACMR(),
+                  optimized.GetACMR(), total.before.GetATVR(), total.after.GetATVR(), total.before.GetOverfetch(),
+                  total.after.GetOverfetch());
+    }
+
+    CookOutput output = ModelBinWriter::WriteModelBin(model, options.projectRoot / options.cookedRoot /
+                                                                 (record.id.to_string() + ".modelbin"));
 
     return output;
 }
@@ -187,4 +231,52 @@ CookOutput CookPipeline::CookMaterial(const AssetRecord& record)
 
     return output;
 }
+
+// Compiles every permutation the passes prebake plus the ones the cooked materials are drawn with, so the runtime
+// starts without compiling a single shader.
+CookOutput CookPipeline::CookShaderPack()
+{
+    const std::filesystem::path cookedDir = options.projectRoot / options.cookedRoot;
+
+    std::set<uint32_t> opaque(std::begin(OpaquePrebakedPermutations), std::end(OpaquePrebakedPermutations));
+    std::set<uint32_t> transparent(std::begin(TransparentPrebakedPermutations),
+                                   std::end(TransparentPrebakedPermutations));
+    opaque.insert(BaseMaterialPermutation);
+    transparent.insert(BaseMaterialPermutation);
+
+    manifestWriter.ForEach(ASSET_MATERIAL,
+                           [&](const AssetKey& key, const ArtifactRef& ref)
+                           {
+                               std::ifstream in(cookedDir / ref.uri, std::ios::binary);
+                               in.seekg((std::streamoff)ref.offset);
+
+                               MatBinHeader header{};
+                               if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+                                   header.magic != MAT_MAGIC || header.version != MAT_VERSION)
+                               {
+                                   REON_ERROR("CookShaderPack: Failed to read cooked material {}, its permutation "
+                                              "compiles at runtime",
+                                              key.id.to_string());
+                                   return;
+                               }
+
+                               const uint32_t flags = GetMaterialShaderFlags(header);
+                               (header.flags & MAT_TRANSPARENT ? transparent : opaque).insert(flags);
+                           });
+
+    std::vector<ShaderPackSource> shaders;
+    auto addProgram = [&](const ShaderProgram& program, uint32_t flags)
+    {
+        shaders.push_back({program.vertex, flags});
+        shaders.push_back({program.fragment, flags});
+    };
+    for (uint32_t flags : opaque)
+        addProgram(OpaqueProgram, flags);
+    for (uint32_t flags : transparent)
+        addProgram(TransparentProgram, flags);
+    addProgram(DirectionalShadowProgram, 0);
+    addProgram(TransparentCompositeProgram, 0);
+
+    return ShaderPackWriter::WriteShaderPack(shaders, cookedDir / "shaders.shaderpack");
+}
 } // namespace REON::EDITOR
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "AssetImporter.h"
+#include "Assets/Model/MeshOptimizer.h"
+#include "Assets/Model/MeshSimplifier.h"
+#include "Assets/Model/MeshletBuilder.h"
 #include "BuildQueue.h"
 #include "ManifestWriter.h"
 
@@ -13,6 +16,9 @@ struct CookOptions
     std::filesystem::path projectRoot;
     std::filesystem::path cookedRoot;
     bool embedDebugChunks = true;
+    MeshOptimizeOptions meshOptimization;
+    MeshLodOptions meshLods;
+    MeshletOptions meshlets;
 };
 
 class CookPipeline
@@ -34,6 +40,7 @@ class CookPipeline
     CookOutput CookModel(const AssetRecord& record);
     CookOutput CookTexture(const AssetRecord& record);
     CookOutput CookMaterial(const AssetRecord& record);
+    CookOutput CookShaderPack();
 
     // importer map
     static std::unordered_map<AssetTypeId, std::unique_ptr<IImporter>> m_Importers;
@@ -41,5 +48,7 @@ class CookPipeline
     ImportContext importCtx;
     ManifestWriter manifestWriter;
     CookOptions options;
+    // Set when a cooked material may use a permutation the current shader pack does not hold
+    bool shaderPackDirty = true;
 };
 } // namespace REON::EDITOR
\ No newline at end of file
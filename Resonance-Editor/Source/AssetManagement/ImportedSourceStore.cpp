@@ -13,7 +13,7 @@ namespace
 {
 
 constexpr std::uint32_t kMagic = 0x494D444C; // IMDL
-constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kVersion = 2;
 
 template <typename T> bool WriteRaw(std::ostream& os, const T& v)
 {
@@ -239,6 +239,17 @@ bool ReadImportedNode(std::istream& is, ImportedNode& v)
            ReadAssetId(is, v.meshId) && ReadRaw(is, v.skinIndex) && ReadAssetIdVector(is, v.materialId);
 }
 
+bool WriteImportedAnimationTrack(std::ostream& os, const ImportedAnimationTrack& v)
+{
+    return WriteRaw(os, v.joint) && WriteRaw(os, v.channel) && WritePodVector(os, v.times) &&
+           WritePodVector(os, v.values);
+}
+
+bool ReadImportedAnimationTrack(std::istream& is, ImportedAnimationTrack& v)
+{
+    return ReadRaw(is, v.joint) && ReadRaw(is, v.channel) && ReadPodVector(is, v.times) && ReadPodVector(is, v.values);
+}
+
 } // namespace
 
 bool ImportedSourceStore::SaveModel(const AssetId& sourceId, const ImportedModel& model)
@@ -284,7 +295,7 @@ bool ImportedSourceStore::SaveModel(const AssetId& sourceId, const ImportedModel
     if (hasRig)
     {
         if (!WriteAssetId(os, model.rig->rigId) || !WriteAssetIdVector(os, model.rig->joints) ||
-            !WritePodVector(os, model.rig->skinIndices))
+            !WritePodVector(os, model.rig->skinIndices) || !WritePodVector(os, model.rig->jointNodes))
             return false;
     }
 
@@ -299,6 +310,14 @@ bool ImportedSourceStore::SaveModel(const AssetId& sourceId, const ImportedModel
     if (!WritePodVector(os, model.rootNodes))
         return false;
 
+    if (!writeArray(model.animations,
+                    [&](auto& os, const ImportedAnimationClip& c)
+                    {
+                        return WriteAssetId(os, c.id) && WriteString(os, c.debugName) && WriteRaw(os, c.duration) &&
+                               writeArray(c.tracks, WriteImportedAnimationTrack);
+                    }))
+        return false;
+
     return true;
 }
 
@@ -353,7 +372,7 @@ std::optional<ImportedModel> ImportedSourceStore::LoadModel(const AssetId& sourc
     {
         model.rig.emplace();
         if (!ReadAssetId(is, model.rig->rigId) || !ReadAssetIdVector(is, model.rig->joints) ||
-            !ReadPodVector(is, model.rig->skinIndices))
+            !ReadPodVector(is, model.rig->skinIndices) || !ReadPodVector(is, model.rig->jointNodes))
             return std::nullopt;
     }
 
@@ -368,6 +387,14 @@ std::optional<ImportedModel> ImportedSourceStore::LoadModel(const AssetId& sourc
     if (!ReadPodVector(is, model.rootNodes))
         return std::nullopt;
 
+    if (!readArray(model.animations,
+                   [&](auto& is, ImportedAnimationClip& c)
+                   {
+                       return ReadAssetId(is, c.id) && ReadString(is, c.debugName) && ReadRaw(is, c.duration) &&
+                              readArray(c.tracks, ReadImportedAnimationTrack);
+                   }))
+        return std::nullopt;
+
     return model;
 }
 } // namespace REON::EDITOR
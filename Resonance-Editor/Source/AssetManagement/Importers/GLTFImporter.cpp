@@ -1,6 +1,7 @@
 #include "GLTFImporter.h"
 
 #include "AssetManagement/CookPipeline.h"
+#include "AssetManagement/Assets/Model/RigBuilder.h"
 
 #include <AssetManagement/Assets/Model/TangentCalculator.h>
 #include <glm/gtc/type_ptr.hpp>
@@ -286,6 +287,7 @@ ImportResult GltfImporter::Import(std::filesystem::path src)
 
         importedModel.rootNodes.push_back(HandleGLTFNode(model, nodeId, importedModel, modelRecord));
     }
+    RigBuilder::LinkParents(importedModel.nodes);
 
     if (!model.skins.empty())
     {
@@ -308,6 +310,8 @@ ImportResult GltfImporter::Import(std::filesystem::path src)
             add_unique((uint32_t)skin.joints[i]);
     }
 
+    RigBuilder::SortJoints(importedModel.nodes, rigJointNodes);
+
     std::unordered_map<uint32_t, uint32_t> nodeToPalette;
     nodeToPalette.reserve(rigJointNodes.size());
     for (uint32_t i = 0; i < (uint32_t)rigJointNodes.size(); ++i)
@@ -322,6 +326,7 @@ ImportResult GltfImporter::Import(std::filesystem::path src)
 
             importedModel.rig->joints[i] = importedModel.nodes[nodeIdx].NodeId;
         }
+        importedModel.rig->jointNodes = rigJointNodes;
     }
 
     for (const auto& skin : model.skins)
@@ -367,6 +372,36 @@ ImportResult GltfImporter::Import(std::filesystem::path src)
         importedModel.skins.push_back(std::move(impSkin));
     }
 
+    // Clips only drive rig joints, so a model without skins has nothing to animate
+    if (importedModel.rig.has_value())
+    {
+        for (size_t i = 0; i < model.animations.size(); ++i)
+        {
+            auto [it, inserted] =
+                currentModelAsset.stableKeyToId.try_emplace("animation:" + std::to_string(i), AssetId{});
+            if (inserted)
+                it->second = MakeRandomAssetId();
+
+            ImportedAnimationClip clip{};
+            clip.id = it->second;
+            HandleGLTFAnimation(model, model.animations[i], nodeToPalette, clip);
+            if (clip.tracks.empty())
+                continue;
+
+            AssetRecord clipRecord{};
+            clipRecord.id = clip.id;
+            clipRecord.logicalName = clip.debugName;
+            clipRecord.sourcePath = importedModel.sourcePath;
+            clipRecord.type = ASSET_ANIMATION_CLIP;
+            clipRecord.origin = AssetOrigin::ImportedSubAsset;
+            clipRecord.parentSourceId = importedModel.modelId;
+            producedAssets.push_back(clipRecord);
+            modelRecord.assetDeps.push_back(clip.id);
+
+            importedModel.animations.push_back(std::move(clip));
+        }
+    }
+
     //TODO: persist import data on disk
     producedAssets.push_back(modelRecord);
 
@@ -390,12 +425,11 @@ ImportResult GltfImporter::Import(std::filesystem::path src)
 }
 
 NodeIndex GltfImporter::HandleGLTFNode(const tg::Model& model, int nodeId, ImportedModel& impModel,
-                                       AssetRecord& modelRecord, float scale, uint32_t parentId)
+                                       AssetRecord& modelRecord, float scale)
 {
     auto node = model.nodes[nodeId];
 
     ImportedNode data{};
-    data.parent = parentId;
 
     data.debugName = node.name;
 
@@ -432,15 +466,15 @@ NodeIndex GltfImporter::HandleGLTFNode(const tg::Model& model, int nodeId, Impor
         data.skinIndex = UINT32_MAX;
     }
 
+    // Imported nodes keep the gltf node indices, parents are linked from the children lists once all are in
     impModel.nodes[nodeId] = data;
-    auto currentId = impModel.nodes.size() - 1; // return index of this node in the imported model's node list
 
     for (auto& childId : node.children)
     {
         if (childId < 0 || childId > model.nodes.size() - 1)
             continue;
 
-        const auto importedChildId = HandleGLTFNode(model, childId, impModel, modelRecord, scale, currentId);
+        const auto importedChildId = HandleGLTFNode(model, childId, impModel, modelRecord, scale);
 
         impModel.nodes[nodeId].children.push_back(importedChildId);
     }
@@ -706,6 +740,100 @@ AssetId GltfImporter::HandleGLTFTexture(const tg::Model& model, const tg::Textur
     return importedTexture.id;
 }
 
+void GltfImporter::HandleGLTFAnimation(const tg::Model& model, const tg::Animation& animation,
+                                       const std::unordered_map<uint32_t, uint32_t>& nodeToJoint,
+                                       ImportedAnimationClip& clip)
+{
+    clip.debugName = animation.name;
+
+    for (const auto& channel : animation.channels)
+    {
+        if (channel.sampler < 0 || channel.sampler >= (int)animation.samplers.size() || channel.target_node < 0)
+            continue;
+
+        auto joint = nodeToJoint.find((uint32_t)channel.target_node);
+        if (joint == nodeToJoint.end())
+            continue;
+
+        ImportedAnimationTrack track{};
+        track.joint = joint->second;
+        if (channel.target_path == "translation")
+            track.channel = ImportedAnimationTrack::Translation;
+        else if (channel.target_path == "rotation")
+            track.channel = ImportedAnimationTrack::Rotation;
+        else if (channel.target_path == "scale")
+            track.channel = ImportedAnimationTrack::Scale;
+        else
+        {
+            REON_WARN("Animation {} targets {}, which is not supported", animation.name, channel.target_path);
+            continue;
+        }
+
+        const auto& sampler = animation.samplers[channel.sampler];
+        if (sampler.input < 0 || sampler.output < 0)
+            continue;
+
+        std::vector<float> times;
+        std::vector<glm::vec4> values;
+        const auto& output = model.accessors.at(sampler.output);
+        bool read = ReadAccessorScalar(model, model.accessors.at(sampler.input), times);
+        if (track.channel == ImportedAnimationTrack::Rotation)
+        {
+            read = read && ReadAccessorVec4(model, output, values);
+        }
+        else
+        {
+            std::vector<glm::vec3> vectors;
+            read = read && ReadAccessorVec3(model, output, vectors);
+            for (const glm::vec3& v : vectors)
+                values.emplace_back(v, 0.0f);
+        }
+
+        // Cubic spline keys are stored as in tangent, value, out tangent
+        if (sampler.interpolation == "CUBICSPLINE" && values.size() == times.size() * 3)
+        {
+            for (size_t k = 0; k < times.size(); ++k)
+                values[k] = values[k * 3 + 1];
+            values.resize(times.size());
+        }
+
+        if (!read || times.empty() || values.size() != times.size())
+        {
+            REON_WARN("Animation {} has a malformed {} channel, skipping it", animation.name, channel.target_path);
+            continue;
+        }
+
+        if (track.channel == ImportedAnimationTrack::Rotation)
+        {
+            for (glm::vec4& q : values)
+                q = glm::normalize(q);
+        }
+
+        if (sampler.interpolation == "STEP")
+        {
+            // Every value is held until the next key, where a second key at the same time switches to the next value
+            for (size_t k = 0; k < times.size(); ++k)
+            {
+                track.times.push_back(times[k]);
+                track.values.push_back(values[k]);
+                if (k + 1 < times.size())
+                {
+                    track.times.push_back(times[k + 1]);
+                    track.values.push_back(values[k]);
+                }
+            }
+        }
+        else
+        {
+            track.times = std::move(times);
+            track.values = std::move(values);
+        }
+
+        clip.duration = std::max(clip.duration, track.times.back());
+        clip.tracks.push_back(std::move(track));
+    }
+}
+
 std::tuple<glm::vec3, Quaternion, glm::vec3> GltfImporter::GetTRSFromGLTFNode(const tg::Node& node)
 {
     glm::vec3 trans{0, 0, 0};
@@ -945,6 +1073,23 @@ glm::vec4 GltfImporter::ReadWeightsVec4(const tg::Accessor& accessor, const uint
     return w;
 }
 
+bool GltfImporter::ReadAccessorScalar(const tg::Model& model, const tg::Accessor& accessor, std::vector<float>& out)
+{
+    if (accessor.type != TINYGLTF_TYPE_SCALAR)
+        return false;
+
+    const uint8_t* base = nullptr;
+    size_t stride = 0;
+    GetAccessorBaseAndStride(model, accessor, base, stride);
+
+    out.reserve(out.size() + size_t(accessor.count));
+
+    for (size_t i = 0; i < size_t(accessor.count); ++i)
+        out.push_back(ReadComponentAsFloat(base + i * stride, accessor.componentType, accessor.normalized));
+
+    return true;
+}
+
 bool GltfImporter::ReadAccessorVec2(const tg::Model& model, const tg::Accessor& accessor, std::vector<glm::vec2>& out)
 {
     if (accessor.type != TINYGLTF_TYPE_VEC2)
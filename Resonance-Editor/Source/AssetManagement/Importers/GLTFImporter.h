@@ -21,9 +21,10 @@ class GltfImporter final : public IImporter
   private:
     AssetId HandleGLTFTexture(const tg::Model& model, const tg::Texture& texture, ImportedModel& impModel,
                               bool isSRGB, AssetId texId, AssetId imgId);
-    NodeIndex HandleGLTFNode(const tg::Model& model, int nodeId, ImportedModel& impModel, AssetRecord& modelRecord, float scale = 1.0f,
-                             uint32_t parentId = UINT32_MAX);
+    NodeIndex HandleGLTFNode(const tg::Model& model, int nodeId, ImportedModel& impModel, AssetRecord& modelRecord, float scale = 1.0f);
     AssetId HandleGLTFMesh(const tg::Model& model, const tg::Mesh& mesh, ImportedModel& impModel, ImportedNode& impNode, AssetId id);
+    void HandleGLTFAnimation(const tg::Model& model, const tg::Animation& animation,
+                             const std::unordered_map<uint32_t, uint32_t>& nodeToJoint, ImportedAnimationClip& clip);
 
     std::tuple<glm::vec3, Quaternion, glm::vec3> GetTRSFromGLTFNode(const tg::Node& node);
 
@@ -42,6 +43,7 @@ class GltfImporter final : public IImporter
     glm::u16vec4 ReadJointsU16x4(const tg::Accessor& accessor, const uint8_t* p);
     glm::vec4 ReadWeightsVec4(const tg::Accessor& accessor, const uint8_t* p);
 
+    bool ReadAccessorScalar(const tg::Model& model, const tg::Accessor& accessor, std::vector<float>& out);
     bool ReadAccessorVec2(const tg::Model& model, const tg::Accessor& accessor, std::vector<glm::vec2>& out);
     bool ReadAccessorVec3(const tg::Model& model, const tg::Accessor& accessor, std::vector<glm::vec3>& out);
     bool ReadAccessorVec4(const tg::Model& model, const tg::Accessor& accessor, std::vector<glm::vec4>& out);
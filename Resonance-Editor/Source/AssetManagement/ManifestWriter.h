@@ -41,6 +41,15 @@ class ManifestWriter
         entries_.erase(k);
     }
 
+    template <class F> void ForEach(AssetTypeId type, F&& fn) const
+    {
+        for (const auto& [k, ref] : entries_)
+        {
+            if (k.type == type)
+                fn(k, ref);
+        }
+    }
+
     void Save(const std::filesystem::path& manifestPath)
     {
         std::filesystem::create_directories(manifestPath.parent_path());
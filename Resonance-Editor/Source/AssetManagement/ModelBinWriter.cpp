@@ -1,7 +1,12 @@
 #include "ModelBinWriter.h"
 
+#include "AssetManagement/Assets/Model/RigBuilder.h"
+
 #include "REON/AssetManagement/ModelBinFormat.h"
+#include "REON/Rendering/Structs/Vertex.h"
 
+#include <cstring>
+#include <limits>
 #include <type_traits>
 
 namespace REON::EDITOR
@@ -33,6 +38,75 @@ template <class T> static void WriteSpan(std::ofstream& out, const T* data, size
     out.write(reinterpret_cast<const char*>(data), (std::streamsize)(sizeof(T) * count));
 }
 
+// Bounds of the vertices referenced by indices [first, first + count), zero sized if nothing is referenced.
+static MeshBounds ComputeBounds(const ImportedMesh& mesh, size_t first, size_t count)
+{
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+
+    const size_t end = std::min(first + count, mesh.indices.size());
+    for (size_t i = first; i < end; i++)
+    {
+        const uint32_t index = mesh.indices[i];
+        if (index >= mesh.positions.size())
+            continue;
+        min = glm::min(min, mesh.positions[index]);
+        max = glm::max(max, mesh.positions[index]);
+    }
+
+    if (min.x > max.x)
+        min = max = glm::vec3(0.0f);
+
+    return MeshBounds{{min.x, min.y, min.z}, {max.x, max.y, max.z}};
+}
+
+// Clip blob: header, then the track table, key times and key values, each 16 byte aligned.
+static void WriteAnimationClip(std::ofstream& out, const ImportedModel& model, const ImportedAnimationClip& clip)
+{
+    const uint32_t jointCount = (uint32_t)model.rig->joints.size();
+
+    std::vector<AnimationTrackEntry> tracks(size_t(jointCount) * 3, AnimationTrackEntry{0, 0});
+    std::vector<float> times;
+    std::vector<glm::vec4> values;
+    for (const auto& track : clip.tracks)
+    {
+        if (track.joint >= jointCount || track.times.size() != track.values.size())
+            continue;
+
+        AnimationTrackEntry& entry = tracks[size_t(track.joint) * 3 + track.channel];
+        if (entry.keyCount != 0)
+        {
+            REON_WARN("Clip {} animates the same channel of joint {} twice, keeping the first", clip.debugName,
+                      track.joint);
+            continue;
+        }
+
+        entry.firstKey = (uint32_t)times.size();
+        entry.keyCount = (uint32_t)track.times.size();
+        times.insert(times.end(), track.times.begin(), track.times.end());
+        values.insert(values.end(), track.values.begin(), track.values.end());
+    }
+
+    AnimationClipHeader ch{};
+    std::memcpy(ch.rigId, model.rig->rigId.bytes.data(), 16);
+    std::strncpy(ch.name, clip.debugName.c_str(), sizeof(ch.name) - 1);
+    ch.duration = clip.duration;
+    ch.jointCount = jointCount;
+    ch.keyCount = (uint32_t)times.size();
+    ch.trackOffset = (uint32_t)AlignUp(sizeof(AnimationClipHeader), 16);
+    ch.timeOffset = (uint32_t)AlignUp(ch.trackOffset + sizeof(AnimationTrackEntry) * tracks.size(), 16);
+    ch.valueOffset = (uint32_t)AlignUp(ch.timeOffset + sizeof(float) * times.size(), 16);
+
+    const uint64_t clipStart = (uint64_t)out.tellp();
+    WritePOD(out, ch);
+    WriteZeros(out, clipStart + ch.trackOffset - (uint64_t)out.tellp());
+    WriteSpan(out, tracks.data(), tracks.size());
+    WriteZeros(out, clipStart + ch.timeOffset - (uint64_t)out.tellp());
+    WriteSpan(out, times.data(), times.size());
+    WriteZeros(out, clipStart + ch.valueOffset - (uint64_t)out.tellp());
+    WriteSpan(out, values.data(), values.size());
+}
+
 CookOutput ModelBinWriter::WriteModelBin(const ImportedModel& model, const std::filesystem::path& outFile)
 {
     std::filesystem::create_directories(outFile.parent_path());
@@ -45,7 +119,7 @@ CookOutput ModelBinWriter::WriteModelBin(const ImportedModel& model, const std::
     std::vector<ChunkEntry> chunks;
     chunks.reserve(3);
 
-    const uint32_t chunkCount = 4;
+    const uint32_t chunkCount = 6;
     header.chunkCount = chunkCount;
 
     if (model.rig.has_value())
@@ -176,86 +250,61 @@ CookOutput ModelBinWriter::WriteModelBin(const ImportedModel& model, const std::
     {
         const uint64_t meshPayloadOffset = (uint64_t)out.tellp();
 
+        const VertexStreams streams = PackVertexStreams(m.positions, m.normals, m.tangents, m.uv0, m.colors,
+                                                        m.joints_0, m.joints_1, m.weights_0, m.weights_1);
+
         MeshHeader mh{};
         mh.vertexCount = (uint32_t)m.positions.size();
         mh.indexCount = (uint32_t)m.indices.size();
-        mh.flags = 0;
+        mh.flags = streams.format;
 
         uint32_t off = (uint32_t)sizeof(MeshHeader);
 
         mh.posOffset = off;
-        off += uint32_t(sizeof(glm::vec3) * m.positions.size());
+        off += uint32_t(sizeof(glm::vec3) * streams.positions.size());
 
-        mh.nrmOffset = off;
-        off += uint32_t(sizeof(glm::vec3) * m.normals.size());
-
-        mh.tanOffset = off;
-        off += uint32_t(sizeof(glm::vec4) * m.tangents.size());
-
-        mh.uv0Offset = off;
-        off += uint32_t(sizeof(glm::vec2) * m.uv0.size());
+        mh.attributeOffset = off;
+        off += uint32_t(sizeof(PackedVertexAttributes) * streams.attributes.size());
 
         mh.idxOffset = off;
         off += uint32_t(sizeof(uint32_t) * m.indices.size());
 
-        mh.colorOffset = off;
-        off += uint32_t(sizeof(glm::vec4) * m.colors.size());
-
-        if (!m.joints_0.empty())
-        {
-            mh.joint0offset = off;
-            off += uint32_t(sizeof(glm::u16vec4) * m.joints_0.size());
-        }
-
-        if (!m.joints_1.empty())
+        if (!streams.colors.empty())
         {
-            mh.joint1offset = off;
-            off += uint32_t(sizeof(glm::u16vec4) * m.joints_1.size());
+            mh.packedColorOffset = off;
+            off += uint32_t(sizeof(uint32_t) * streams.colors.size());
         }
 
-        if (!m.weights_0.empty())
+        if (!streams.skin.empty())
         {
-            mh.weight0offset = off;
-            off += uint32_t(sizeof(glm::vec4) * m.weights_0.size());
-        }
-
-        if (!m.weights_1.empty())
-        {
-            mh.weight1offset = off;
-            off += uint32_t(sizeof(glm::vec4) * m.weights_1.size());
+            mh.skinOffset = off;
+            off += uint32_t(sizeof(PackedVertexSkin) * streams.skin.size());
         }
 
         mh.subMeshOffset = off;
         mh.subMeshCount = (uint32_t)m.subMeshes.size();
         off += uint32_t(sizeof(SubMeshEntry) * m.subMeshes.size());
 
-        WritePOD(out, mh);
-        WriteSpan(out, m.positions.data(), m.positions.size());
-        WriteSpan(out, m.normals.data(), m.normals.size());
-        WriteSpan(out, m.tangents.data(), m.tangents.size());
-        WriteSpan(out, m.uv0.data(), m.uv0.size());
-        WriteSpan(out, m.indices.data(), m.indices.size());
-        WriteSpan(out, m.colors.data(), m.colors.size());
+        mh.bounds = ComputeBounds(m, 0, m.indices.size());
+        mh.subMeshBoundsOffset = off;
+        off += uint32_t(sizeof(MeshBounds) * m.subMeshes.size());
 
-        if (!m.joints_0.empty())
+        if (!m.lods.empty())
         {
-            WriteSpan(out, m.joints_0.data(), m.joints_0.size());
-        }
+            mh.lodCount = (uint32_t)m.lods.size();
+            mh.lodOffset = off;
+            off += uint32_t(sizeof(MeshLodEntry) * m.lods.size());
 
-        if (!m.joints_1.empty())
-        {
-            WriteSpan(out, m.joints_1.data(), m.joints_1.size());
+            mh.lodRangeOffset = off;
+            off += uint32_t(sizeof(SubMeshLodEntry) * m.lods.size() * m.subMeshes.size());
         }
 
-        if (!m.weights_0.empty())
-        {
-            WriteSpan(out, m.weights_0.data(), m.weights_0.size());
-        }
-
-        if (!m.weights_1.empty())
-        {
-            WriteSpan(out, m.weights_1.data(), m.weights_1.size());
-        }
+        WritePOD(out, mh);
+        WriteSpan(out, streams.positions.data(), streams.positions.size());
+        WriteSpan(out, streams.attributes.data(), streams.attributes.size());
+        WriteSpan(out, m.indices.data(), m.indices.size());
+        WriteSpan(out, streams.colors.data(), streams.colors.size());
+        WriteSpan(out, streams.skin.data(), streams.skin.size());
 
         for (const auto& sm : m.subMeshes)
         {
@@ -267,6 +316,30 @@ CookOutput ModelBinWriter::WriteModelBin(const ImportedModel& model, const std::
             WritePOD(out, e);
         }
 
+        for (const auto& sm : m.subMeshes)
+        {
+            WritePOD(out, ComputeBounds(m, sm.indexOffset, sm.indexCount));
+        }
+
+        for (const auto& lod : m.lods)
+        {
+            MeshLodEntry e{};
+            e.error = lod.error;
+            WritePOD(out, e);
+        }
+
+        for (const auto& lod : m.lods)
+        {
+            for (size_t i = 0; i < m.subMeshes.size(); ++i)
+            {
+                // Every level covers every submesh, a submesh that could not be simplified keeps its finer range
+                SubMeshLodEntry e{};
+                e.indexOffset = i < lod.subMeshes.size() ? lod.subMeshes[i].indexOffset : m.subMeshes[i].indexOffset;
+                e.indexCount = i < lod.subMeshes.size() ? lod.subMeshes[i].indexCount : m.subMeshes[i].indexCount;
+                WritePOD(out, e);
+            }
+        }
+
         const uint64_t meshPayloadEnd = (uint64_t)out.tellp();
         const uint64_t meshPayloadSize = meshPayloadEnd - meshPayloadOffset;
 
@@ -316,8 +389,10 @@ CookOutput ModelBinWriter::WriteModelBin(const ImportedModel& model, const std::
         const uint32_t skinCount = (uint32_t)model.skins.size();          // embed all skins
         const uint32_t jointIdCount = (uint32_t)model.rig->joints.size(); // optional metadata list
 
+        const bool hasJointRecords = !model.rig->jointNodes.empty() && model.rig->jointNodes.size() == jointIdCount;
+
         RigChunkHeader rh{};
-        rh.version = 1;
+        rh.version = RIG_CHUNK_VERSION;
         rh.skinCount = skinCount;
         rh.jointCount = jointIdCount;
         std::memcpy(rh.rigId, model.rig->rigId.bytes.data(), 16);
@@ -351,6 +426,16 @@ CookOutput ModelBinWriter::WriteModelBin(const ImportedModel& model, const std::
             rh.jointNodeIdsOffset = 0;
         }
 
+        if (hasJointRecords)
+        {
+            const std::vector<RigJointRecord> jointRecords = RigBuilder::BuildJointRecords(model);
+            rh.jointRecordOffset = (uint32_t)((uint64_t)out.tellp() - chunkStart);
+            WriteSpan(out, jointRecords.data(), jointRecords.size());
+
+            cur = AlignUp((uint64_t)out.tellp(), 16);
+            WriteZeros(out, cur - (uint64_t)out.tellp());
+        }
+
         // Write embedded skins payload blocks, fill records
         for (uint32_t i = 0; i < skinCount; ++i)
         {
@@ -411,6 +496,104 @@ CookOutput ModelBinWriter::WriteModelBin(const ImportedModel& model, const std::
         chunks.push_back(rigChunk);
     }
 
+    // After the rig, which the asset map expects at chunks[3]
+    uint32_t clusteredMeshCount = 0;
+    for (const auto& m : model.meshes)
+        clusteredMeshCount += m.meshlets.empty() ? 0 : 1;
+
+    if (clusteredMeshCount > 0)
+    {
+        ChunkEntry meshletChunk{};
+        meshletChunk.type = ChunkType::MESHLETS;
+        meshletChunk.flags = 0;
+        meshletChunk.offset = cursor;
+
+        MeshletChunkHeader mch{};
+        mch.meshCount = clusteredMeshCount;
+        mch.meshTableOffset = sizeof(MeshletChunkHeader);
+        WritePOD(out, mch);
+
+        uint32_t meshletOffset = uint32_t(sizeof(MeshletChunkHeader) + sizeof(MeshletMeshEntry) * clusteredMeshCount);
+        for (const auto& m : model.meshes)
+        {
+            if (m.meshlets.empty())
+                continue;
+
+            MeshletMeshEntry e{};
+            std::copy(m.id.begin(), m.id.end(), e.meshId);
+            e.meshletOffset = meshletOffset;
+            e.meshletCount = (uint32_t)m.meshlets.size();
+            WritePOD(out, e);
+            meshletOffset += uint32_t(sizeof(MeshletEntry) * m.meshlets.size());
+        }
+
+        for (const auto& m : model.meshes)
+        {
+            for (const auto& ml : m.meshlets)
+            {
+                MeshletEntry e{};
+                std::memcpy(e.center, &ml.center, sizeof(e.center));
+                e.radius = ml.radius;
+                std::memcpy(e.coneApex, &ml.coneApex, sizeof(e.coneApex));
+                e.coneCutoff = ml.coneCutoff;
+                std::memcpy(e.coneAxis, &ml.coneAxis, sizeof(e.coneAxis));
+                e.indexOffset = ml.indexOffset;
+                e.triangleCount = ml.triangleCount;
+                e.vertexCount = ml.vertexCount;
+                e.subMesh = ml.subMesh;
+                WritePOD(out, e);
+            }
+        }
+
+        const uint64_t endPos = (uint64_t)out.tellp();
+        meshletChunk.size = endPos - meshletChunk.offset;
+        cursor = AlignUp(endPos, 16);
+        WriteZeros(out, cursor - endPos);
+
+        chunks.push_back(meshletChunk);
+    }
+
+    // Clips are blobs of their own like meshes, the chunk only lists them for the model loader
+    std::vector<AnimationClipEntry> clipEntries;
+    if (model.rig.has_value())
+    {
+        for (const auto& clip : model.animations)
+        {
+            AnimationClipEntry entry{};
+            std::copy(clip.id.begin(), clip.id.end(), entry.clipId);
+            entry.dataOffset = cursor;
+            WriteAnimationClip(out, model, clip);
+
+            const uint64_t endPos = (uint64_t)out.tellp();
+            entry.dataSize = endPos - entry.dataOffset;
+            cursor = AlignUp(endPos, 16);
+            WriteZeros(out, cursor - endPos);
+
+            clipEntries.push_back(entry);
+        }
+    }
+
+    if (!clipEntries.empty())
+    {
+        ChunkEntry animationChunk{};
+        animationChunk.type = ChunkType::ANIMATIONS;
+        animationChunk.flags = 0;
+        animationChunk.offset = cursor;
+
+        AnimationChunkHeader ach{};
+        ach.clipCount = (uint32_t)clipEntries.size();
+        ach.clipTableOffset = sizeof(AnimationChunkHeader);
+        WritePOD(out, ach);
+        WriteSpan(out, clipEntries.data(), clipEntries.size());
+
+        const uint64_t endPos = (uint64_t)out.tellp();
+        animationChunk.size = endPos - animationChunk.offset;
+        cursor = AlignUp(endPos, 16);
+        WriteZeros(out, cursor - endPos);
+
+        chunks.push_back(animationChunk);
+    }
+
     header.fileBytes = (uint64_t)out.tellp();
 
     out.seekp((std::streamoff)headerOffset, std::ios::beg);
@@ -440,6 +623,20 @@ CookOutput ModelBinWriter::WriteModelBin(const ImportedModel& model, const std::
         assetMap[key] = ref;
     }
 
+    for (const auto& entry : clipEntries)
+    {
+        ArtifactRef ref{};
+        ref.uri = outFile.filename().generic_string();
+        ref.revision = 0;
+        ref.offset = entry.dataOffset;
+        ref.size = entry.dataSize;
+        ref.format = /*CLIP_V1*/ 0x4001;
+        AssetKey key;
+        key.type = ASSET_ANIMATION_CLIP;
+        std::copy(std::begin(entry.clipId), std::end(entry.clipId), key.id.begin());
+        assetMap[key] = ref;
+    }
+
     assetMap[AssetKey{ASSET_MODEL, model.modelId}] = {outFile.generic_string(), 0, 0, std::filesystem::file_size(outFile),
                                                       0x2001};
     if (model.rig.has_value())
@@ -0,0 +1,87 @@
+#include "ShaderPackWriter.h"
+
+#include "REON/Application.h"
+#include "REON/AssetManagement/ShaderPackFormat.h"
+#include "REON/Rendering/Shader.h"
+
+namespace REON::EDITOR
+{
+CookOutput ShaderPackWriter::WriteShaderPack(const std::vector<ShaderPackSource>& shaders,
+                                             const std::filesystem::path& path)
+{
+    std::filesystem::create_directories(path.parent_path());
+
+    // Independent permutations, DXC instances are per thread and the SPIR-V cache makes unchanged ones cheap
+    std::vector<std::vector<char>> code(shaders.size());
+    Application::Get().GetJobSystem().ParallelFor(static_cast<uint32_t>(shaders.size()), 1,
+                                                  [&](uint32_t begin, uint32_t end)
+                                                  {
+                                                      for (uint32_t i = begin; i < end; i++)
+                                                          code[i] = Shader::CompileHLSLSource(shaders[i].source,
+                                                                                              shaders[i].flags);
+                                                  });
+
+    // Build the string table and entries, blobs follow the strings
+    std::vector<ShaderPackEntry> entries;
+    std::string strings;
+    std::unordered_map<std::string, uint32_t> sourceOffsets;
+    uint64_t codeBytes = 0;
+    for (size_t i = 0; i < shaders.size(); i++)
+    {
+        if (code[i].empty())
+        {
+            REON_ERROR("ShaderPackWriter: {} with flags {} failed to compile, leaving it out of the pack",
+                       shaders[i].source, shaders[i].flags);
+            continue;
+        }
+
+        auto [it, inserted] = sourceOffsets.try_emplace(shaders[i].source, (uint32_t)strings.size());
+        if (inserted)
+            strings += shaders[i].source;
+
+        ShaderPackEntry e{};
+        e.sourceOffset = it->second;
+        e.sourceLength = (uint32_t)shaders[i].source.size();
+        e.flags = shaders[i].flags;
+        e.codeOffset = codeBytes; // relative to the blobs until the layout is known
+        e.codeSize = code[i].size();
+        codeBytes += code[i].size();
+        entries.push_back(e);
+    }
+
+    ShaderPackHeader header{};
+    header.headerSize = (uint16_t)sizeof(ShaderPackHeader);
+    header.entryCount = (uint32_t)entries.size();
+    header.entriesOffset = sizeof(ShaderPackHeader);
+    header.stringsOffset = header.entriesOffset + entries.size() * sizeof(ShaderPackEntry);
+
+    const uint64_t codeOffset = header.stringsOffset + strings.size();
+    for (ShaderPackEntry& e : entries)
+        e.codeOffset += codeOffset;
+
+    // Write: header | entries | string table | SPIR-V
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), (std::streamsize)(entries.size() * sizeof(ShaderPackEntry)));
+    out.write(strings.data(), (std::streamsize)strings.size());
+    for (const std::vector<char>& c : code)
+        out.write(c.data(), (std::streamsize)c.size());
+
+    out.flush();
+    if (!out)
+    {
+        REON_ERROR("ShaderPackWriter: write failed " + path.string());
+        return {};
+    }
+
+    ArtifactRef ref{};
+    ref.uri = path.filename().generic_string();
+    ref.offset = 0;
+    ref.size = std::filesystem::file_size(path);
+    ref.flags = ARTIFACT_FLAG_LITTLE_ENDIAN;
+
+    CookOutput output;
+    output.artifacts[AssetKey{ASSET_SHADER_PACK, SHADER_PACK_ASSET_ID}] = ref;
+    return output;
+}
+} // namespace REON::EDITOR
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "CookOutput.h"
+
+#include <string>
+
+namespace REON::EDITOR
+{
+struct ShaderPackSource
+{
+    std::string source; // path the runtime requests the shader with
+    uint32_t flags;     // MaterialShaderFlags
+};
+
+class ShaderPackWriter
+{
+  public:
+    // Compiles every source from the shader files, failed compiles are left out and compile at runtime instead.
+    static CookOutput WriteShaderPack(const std::vector<ShaderPackSource>& shaders, const std::filesystem::path& path);
+};
+} // namespace REON::EDITOR
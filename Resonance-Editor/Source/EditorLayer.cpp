@@ -264,6 +264,65 @@ void EditorLayer::OnImGuiRender()
             if (ImGui::IsItemHovered())
                 ImGui::SetTooltip("Choose how to render the scene view");
             ImGui::PopItemWidth();
+
+            const auto& cullStats = scene->renderManager->GetCullStats();
+            ImGui::SameLine();
+            ImGui::AlignTextToFramePadding();
+            ImGui::TextDisabled("Culled %u/%u (shadow %u, meshlets %u)", cullStats.cameraCulled, cullStats.drawCount,
+                                cullStats.shadowCulled, cullStats.meshletsCulled);
+
+            ImGui::SameLine();
+            bool pipelined = REON::Application::Get().IsFramePipelining();
+            if (ImGui::Checkbox("Pipelined", &pipelined))
+                REON::Application::Get().SetFramePipelining(pipelined);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Simulate the next frame while this one is recorded, adds one frame of latency");
+
+            static const uint32_t threadCounts[] = {1, 2, 4, 8};
+            const uint32_t recordThreads = scene->renderManager->GetRecordingThreadCount();
+            ImGui::SameLine();
+            ImGui::PushItemWidth(50);
+            if (ImGui::BeginCombo("##RecordThreads", std::to_string(recordThreads).c_str()))
+            {
+                for (uint32_t threadCount : threadCounts)
+                {
+                    const bool isSelected = recordThreads == threadCount;
+                    if (ImGui::Selectable(std::to_string(threadCount).c_str(), isSelected))
+                        scene->renderManager->SetRecordingThreadCount(threadCount);
+                    if (isSelected)
+                        ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
+            }
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Threads used to record the draw passes, 1 records inline");
+            ImGui::PopItemWidth();
+
+            ImGui::SameLine();
+            if (scene->renderManager->IsRecordBenchmarkRunning())
+            {
+                ImGui::AlignTextToFramePadding();
+                ImGui::TextDisabled("Benchmarking %u threads", scene->renderManager->GetRecordBenchmarkThreadCount());
+            }
+            else if (ImGui::Button("Benchmark"))
+            {
+                scene->renderManager->StartRecordBenchmark();
+            }
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Record the scene with 1, 2, 4 and 8 threads in turn and log the average record times");
+
+            const auto& recordStats = scene->renderManager->GetRecordStats();
+            ImGui::SameLine();
+            ImGui::AlignTextToFramePadding();
+            ImGui::TextDisabled("Record %.2f ms", recordStats.recordMs);
+            ImGui::SameLine();
+            ImGui::TextDisabled("%u draws", recordStats.drawCalls);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Draw calls over all passes, a multi draw indirect counts as one");
+            ImGui::SameLine();
+            ImGui::TextDisabled("Shadow cache %.0f%%", recordStats.shadowCacheHitRate * 100.0f);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Shadow cascades drawn from their static caster cache instead of redrawn");
         }
         ImGui::EndChild();
 
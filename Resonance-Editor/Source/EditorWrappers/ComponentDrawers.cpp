@@ -18,13 +18,14 @@ void ComponentDrawers::DrawInspector_Transform(std::shared_ptr<Transform> transf
     static bool wasChangingPosition = false;
     if (ImGui::CollapsingHeader("Transform", ImGuiTreeNodeFlags_DefaultOpen))
     {
+        glm::vec3 position = transform->GetLocalPosition();
         DrawFuncs::DrawVec3WithUndoRedo(
-            "position", transform->localPosition, [transform](const glm::vec3& pos) { transform->localPosition = pos; },
-            [transform]() { return transform->localPosition; }, 0.01f, 100.0f);
+            "position", position, [transform](const glm::vec3& pos) { transform->SetLocalPosition(pos); },
+            [transform]() { return transform->GetLocalPosition(); }, 0.01f, 100.0f);
 
         if (transform->eulerDirty)
         {
-            transform->eulerCache = transform->localRotation.getEulerAngles();
+            transform->eulerCache = Quaternion(transform->GetLocalRotation()).getEulerAngles();
             transform->eulerDirty = false;
         }
 
@@ -34,7 +35,9 @@ void ComponentDrawers::DrawInspector_Transform(std::shared_ptr<Transform> transf
                 [transform](const glm::vec3& rot)
                 {
                     transform->eulerCache = glm::radians(rot);
-                    transform->localRotation.setFromEulerAngles(transform->eulerCache);
+                    Quaternion rotation;
+                    rotation.setFromEulerAngles(transform->eulerCache);
+                    transform->SetLocalRotation(rotation);
                     transform->eulerDirty = false;
                 },
                 [transform]() { return glm::degrees(transform->eulerCache); }))
@@ -44,9 +47,10 @@ void ComponentDrawers::DrawInspector_Transform(std::shared_ptr<Transform> transf
             // transform->eulerDirty = false;
         }
 
+        glm::vec3 scale = transform->GetLocalScale();
         DrawFuncs::DrawVec3WithUndoRedo(
-            "Scale", transform->localScale, [transform](const glm::vec3& scale) { transform->localScale = scale; },
-            [transform]() { return transform->localScale; }, 0.01);
+            "Scale", scale, [transform](const glm::vec3& scale) { transform->SetLocalScale(scale); },
+            [transform]() { return transform->GetLocalScale(); }, 0.01);
     }
     ImGui::Dummy(ImVec2(0.0f, 4.0f));
 }
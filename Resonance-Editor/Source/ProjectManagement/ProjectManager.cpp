@@ -483,9 +483,9 @@ void ProjectManager::DeSerializeGameObjectForScene(const nlohmann::json& objectJ
     {
         auto transformJson = objectJson["Transform"];
         auto transform = object->GetTransform();
-        transform->localPosition = Deserialize<glm::vec3>("glm::vec3", transformJson["Position"]);
-        transform->localRotation = Deserialize<Quaternion>("Quaternion", transformJson["Rotation"]);
-        transform->localScale = Deserialize<glm::vec3>("glm::vec3", transformJson["Scale"]);
+        transform->SetLocalPosition(Deserialize<glm::vec3>("glm::vec3", transformJson["Position"]));
+        transform->SetLocalRotation(Deserialize<Quaternion>("Quaternion", transformJson["Rotation"]));
+        transform->SetLocalScale(Deserialize<glm::vec3>("glm::vec3", transformJson["Scale"]));
     }
     else
     {
@@ -577,9 +577,12 @@ nlohmann::json ProjectManager::SerializeGameObject(std::shared_ptr<REON::GameObj
 
     auto transform = object->GetTransform();
     nlohmann::json jsonTransform;
-    jsonTransform["Position"] = serializers["glm::vec3"](&transform->localPosition);
-    jsonTransform["Rotation"] = serializers["Quaternion"](&transform->localRotation);
-    jsonTransform["Scale"] = serializers["glm::vec3"](&transform->localScale);
+    glm::vec3 position = transform->GetLocalPosition();
+    Quaternion rotation(transform->GetLocalRotation());
+    glm::vec3 scale = transform->GetLocalScale();
+    jsonTransform["Position"] = serializers["glm::vec3"](&position);
+    jsonTransform["Rotation"] = serializers["Quaternion"](&rotation);
+    jsonTransform["Scale"] = serializers["glm::vec3"](&scale);
 
     jsonObject["Transform"] = jsonTransform;
 
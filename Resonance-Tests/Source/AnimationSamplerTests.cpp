@@ -0,0 +1,437 @@
+#include "TestRunner.h"
+
+#include "AssetManagement/Assets/Model/RigBuilder.h"
+#include "REON/Rendering/Animation/AnimationSampler.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <random>
+
+namespace REON::TESTS
+{
+
+namespace
+{
+using EDITOR::ImportedModel;
+using EDITOR::ImportedNode;
+using EDITOR::NodeIndex;
+using EDITOR::RigBuilder;
+
+constexpr uint32_t JointCount = 64;
+constexpr uint32_t KeyCount = 30;
+// Sampler against the scalar reference, both interpolate the same keys so only rounding differs
+constexpr float LocalTolerance = 5e-6f;
+// Composed matrices, rounding grows with the depth of the hierarchy
+constexpr float MatrixTolerance = 1e-4f;
+
+struct Fixture
+{
+    std::mt19937 rng{7};
+
+    float Random(float min, float max)
+    {
+        return std::uniform_real_distribution<float>(min, max)(rng);
+    }
+
+    glm::vec3 RandomVector(float min, float max)
+    {
+        return glm::vec3(Random(min, max), Random(min, max), Random(min, max));
+    }
+
+    glm::quat RandomRotation()
+    {
+        return glm::normalize(glm::quat(Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f),
+                                        Random(-1.0f, 1.0f)));
+    }
+
+    glm::mat4 RandomTransform()
+    {
+        return glm::translate(glm::mat4(1.0f), RandomVector(-5.0f, 5.0f)) * glm::mat4_cast(RandomRotation()) *
+               glm::scale(glm::mat4(1.0f), RandomVector(0.5f, 1.5f));
+    }
+};
+
+glm::mat4 LocalMatrix(const glm::vec3& t, const glm::quat& r, const glm::vec3& s)
+{
+    return glm::translate(glm::mat4(1.0f), t) * glm::mat4_cast(r) * glm::scale(glm::mat4(1.0f), s);
+}
+
+float MatrixError(const glm::mat4& a, const glm::mat4& b)
+{
+    float error = 0.0f;
+    for (int c = 0; c < 4; c++)
+    {
+        for (int r = 0; r < 4; r++)
+            error = std::max(error, std::abs(a[c][r] - b[c][r]) / (1.0f + std::abs(b[c][r])));
+    }
+    return error;
+}
+
+// Rig joint as RigLoader builds it from a cooked record
+Rig::Joint JointFromRecord(const RigJointRecord& r)
+{
+    Rig::Joint joint;
+    joint.parentIndex = r.parent;
+    joint.restTranslation = glm::vec3(r.t[0], r.t[1], r.t[2]);
+    joint.restRotation = glm::quat(r.r[3], r.r[0], r.r[1], r.r[2]);
+    joint.restScale = glm::vec3(r.s[0], r.s[1], r.s[2]);
+    std::memcpy(&joint.parentOffset, r.parentOffset, sizeof(r.parentOffset));
+    joint.hasParentOffset = joint.parentOffset != glm::mat4(1.0f);
+    return joint;
+}
+
+// Random rig with joints in parents first order, some of them behind non-joint nodes
+Rig RandomRig(Fixture& f)
+{
+    Rig rig;
+    rig.hasHierarchy = true;
+    rig.joints.resize(JointCount);
+    for (uint32_t j = 0; j < JointCount; j++)
+    {
+        Rig::Joint& joint = rig.joints[j];
+        joint.parentIndex = j == 0 ? -1 : int(f.rng() % j);
+        joint.restTranslation = f.RandomVector(-1.0f, 1.0f);
+        joint.restRotation = f.RandomRotation();
+        joint.restScale = f.RandomVector(0.5f, 1.5f);
+        if (j % 7 == 3)
+        {
+            joint.parentOffset = f.RandomTransform();
+            joint.hasParentOffset = true;
+        }
+    }
+    return rig;
+}
+
+// Clip over a second with KeyCount keys per track, every fifth track is left empty to fall back to the rest pose
+AnimationClip RandomClip(Fixture& f)
+{
+    AnimationClip clip;
+    clip.jointCount = JointCount;
+    clip.duration = 1.0f;
+    clip.tracks.resize(JointCount * AnimationClip::ChannelCount);
+    for (uint32_t j = 0; j < JointCount; j++)
+    {
+        for (uint32_t c = 0; c < AnimationClip::ChannelCount; c++)
+        {
+            if ((j + c) % 5 == 0)
+                continue;
+
+            AnimationClip::Track& track = clip.tracks[j * AnimationClip::ChannelCount + c];
+            track.firstKey = (uint32_t)clip.times.size();
+            track.keyCount = KeyCount;
+            for (uint32_t k = 0; k < KeyCount; k++)
+            {
+                clip.times.push_back(float(k) / float(KeyCount - 1));
+                if (c == AnimationClip::Rotation)
+                {
+                    const glm::quat q = f.RandomRotation();
+                    clip.values.emplace_back(q.x, q.y, q.z, q.w);
+                }
+                else
+                {
+                    clip.values.emplace_back(f.RandomVector(-2.0f, 2.0f), 0.0f);
+                }
+            }
+        }
+    }
+    return clip;
+}
+
+// Scalar sampling of one joint: a linear key search and nlerp through the shorter arc
+void ReferenceLocal(const AnimationClip& clip, const Rig::Joint& joint, uint32_t jointIndex, float time, glm::vec3& t,
+                    glm::quat& r, glm::vec3& s)
+{
+    t = joint.restTranslation;
+    r = joint.restRotation;
+    s = joint.restScale;
+    for (uint32_t c = 0; c < AnimationClip::ChannelCount; c++)
+    {
+        const AnimationClip::Track& track = clip.GetTrack(jointIndex, AnimationClip::Channel(c));
+        if (track.keyCount == 0)
+            continue;
+
+        const float* times = &clip.times[track.firstKey];
+        const glm::vec4* values = &clip.values[track.firstKey];
+        uint32_t from = 0;
+        while (from + 1 < track.keyCount && times[from + 1] <= time)
+            from++;
+        const uint32_t to = std::min(from + 1, track.keyCount - 1);
+        float factor = to == from ? 0.0f : glm::clamp((time - times[from]) / (times[to] - times[from]), 0.0f, 1.0f);
+        if (time <= times[0])
+            factor = 0.0f;
+
+        if (c == AnimationClip::Rotation)
+        {
+            const glm::quat a(values[from].w, values[from].x, values[from].y, values[from].z);
+            glm::quat b(values[to].w, values[to].x, values[to].y, values[to].z);
+            if (glm::dot(a, b) < 0.0f)
+                b = -b;
+            r = glm::normalize(a * (1.0f - factor) + b * factor);
+        }
+        else
+        {
+            (c == AnimationClip::Translation ? t : s) = glm::mix(glm::vec3(values[from]), glm::vec3(values[to]), factor);
+        }
+    }
+}
+
+float LocalError(std::span<const SoaTransform> pose, uint32_t joint, const glm::vec3& t, const glm::quat& r,
+                 const glm::vec3& s)
+{
+    const SoaTransform& g = pose[joint / AnimationSampler::LaneCount];
+    const uint32_t l = joint % AnimationSampler::LaneCount;
+    const float values[] = {g.tx[l], g.ty[l], g.tz[l], g.rx[l], g.ry[l], g.rz[l], g.rw[l], g.sx[l], g.sy[l], g.sz[l]};
+    const float expected[] = {t.x, t.y, t.z, r.x, r.y, r.z, r.w, s.x, s.y, s.z};
+
+    float error = 0.0f;
+    for (size_t i = 0; i < std::size(values); i++)
+        error = std::max(error, std::abs(values[i] - expected[i]) / (1.0f + std::abs(expected[i])));
+    return error;
+}
+
+// Plays the clip forward across loops, then jumps back and outside the keys. Every sample is checked against the
+// reference, so a cursor left on the wrong key after a wrap or a jump shows up at the time it happened.
+void TestCursorSampling()
+{
+    Fixture f;
+    const Rig rig = RandomRig(f);
+    const AnimationClip clip = RandomClip(f);
+
+    std::vector<float> times;
+    float clock = 0.0f;
+    for (int frame = 0; frame < 150; frame++)
+    {
+        times.push_back(clock);
+        clock = std::fmod(clock + 1.0f / 60.0f, clip.duration);
+    }
+    for (float time : {0.99f, 1.0f, 1.2f, 0.05f, 0.6f, 0.3f, -0.1f, 0.75f, 0.75f, 0.2f})
+        times.push_back(time);
+
+    AnimationSampler sampler;
+    std::vector<SoaTransform> pose(AnimationSampler::GetGroupCount(JointCount));
+    std::vector<glm::mat4> modelPose(JointCount);
+    std::vector<glm::mat4> reference(JointCount);
+
+    float worstLocal = 0.0f;
+    float worstModel = 0.0f;
+    for (size_t i = 0; i < times.size(); i++)
+    {
+        const float time = times[i];
+        sampler.Sample(clip, rig, time, pose);
+        AnimationSampler::ComputeModelPose(rig, pose, modelPose);
+
+        float localError = 0.0f;
+        float modelError = 0.0f;
+        for (uint32_t j = 0; j < JointCount; j++)
+        {
+            const Rig::Joint& joint = rig.joints[j];
+            glm::vec3 t, s;
+            glm::quat r;
+            ReferenceLocal(clip, joint, j, time, t, r, s);
+            localError = std::max(localError, LocalError(pose, j, t, r, s));
+
+            const glm::mat4 local = LocalMatrix(t, r, s);
+            reference[j] = joint.parentIndex < 0 ? joint.parentOffset * local
+                                                 : reference[joint.parentIndex] * joint.parentOffset * local;
+            modelError = std::max(modelError, MatrixError(modelPose[j], reference[j]));
+        }
+
+        REON_TEST_CHECK(localError <= LocalTolerance, "sample %zu at %.3f: local pose off the nlerp reference by %g", i,
+                        time, localError);
+        REON_TEST_CHECK(modelError <= MatrixTolerance, "sample %zu at %.3f: model pose off the reference by %g", i,
+                        time, modelError);
+        worstLocal = std::max(worstLocal, localError);
+        worstModel = std::max(worstModel, modelError);
+    }
+
+    std::printf("AnimationSampler: %zu samples, worst local error %g, worst model error %g\n", times.size(),
+                worstLocal, worstModel);
+}
+
+// Node tree with node indices shuffled, so children come before their parents as often as after. Node 0 of the
+// shuffle is the single root.
+std::vector<ImportedNode> RandomNodes(Fixture& f, uint32_t nodeCount, std::vector<NodeIndex>& expectedParents)
+{
+    std::vector<NodeIndex> order(nodeCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), f.rng);
+
+    std::vector<ImportedNode> nodes(nodeCount);
+    expectedParents.assign(nodeCount, UINT32_MAX);
+    for (uint32_t i = 0; i < nodeCount; i++)
+    {
+        ImportedNode& node = nodes[order[i]];
+        node.t = f.RandomVector(-1.0f, 1.0f);
+        node.r = Quaternion(f.RandomRotation());
+        node.s = f.RandomVector(0.5f, 1.5f);
+        // Parents are left to LinkParents, a stale value here has to be overwritten
+        node.parent = NodeIndex(f.rng() % nodeCount);
+        if (i == 0)
+            continue;
+
+        const NodeIndex parent = order[f.rng() % i];
+        nodes[parent].children.push_back(order[i]);
+        expectedParents[order[i]] = parent;
+    }
+    return nodes;
+}
+
+uint32_t CountWrongParents(const std::vector<ImportedNode>& nodes, const std::vector<NodeIndex>& expected)
+{
+    uint32_t wrong = 0;
+    for (size_t n = 0; n < nodes.size(); n++)
+        wrong += nodes[n].parent != expected[n] ? 1 : 0;
+    return wrong;
+}
+
+// Importer side: parents come from the children lists whatever order the nodes were visited in.
+void TestLinkParents()
+{
+    Fixture f;
+    for (int trial = 0; trial < 50; trial++)
+    {
+        std::vector<NodeIndex> expected;
+        std::vector<ImportedNode> nodes = RandomNodes(f, 40, expected);
+        RigBuilder::LinkParents(nodes);
+
+        const uint32_t wrong = CountWrongParents(nodes, expected);
+        REON_TEST_CHECK(wrong == 0, "trial %d: %u of %zu nodes linked to the wrong parent", trial, wrong, nodes.size());
+    }
+}
+
+// World transforms of the objects a model instance creates, one per node under the owner. The owner is the root node's
+// object and already includes the root's own transform.
+std::vector<glm::mat4> ObjectWorlds(const std::vector<ImportedNode>& nodes, const glm::mat4& ownerWorld)
+{
+    std::vector<glm::mat4> worlds(nodes.size());
+    std::vector<NodeIndex> stack;
+    for (NodeIndex n = 0; n < nodes.size(); n++)
+    {
+        if (nodes[n].parent == UINT32_MAX)
+        {
+            worlds[n] = ownerWorld;
+            stack.push_back(n);
+        }
+    }
+    while (!stack.empty())
+    {
+        const NodeIndex n = stack.back();
+        stack.pop_back();
+        for (NodeIndex child : nodes[n].children)
+        {
+            worlds[child] = worlds[n] * RigBuilder::NodeLocalMatrix(nodes[child]);
+            stack.push_back(child);
+        }
+    }
+    return worlds;
+}
+
+// Cook and runtime together: a clip played on the cooked rig has to skin like the joint objects would if they were
+// moved to the same pose. The palette holds joint world times inverse bind, with the owner applied exactly once.
+void TestSkinPalette()
+{
+    Fixture f;
+    for (int trial = 0; trial < 50; trial++)
+    {
+        std::vector<NodeIndex> expectedParents;
+        ImportedModel model;
+        model.nodes = RandomNodes(f, 40, expectedParents);
+        RigBuilder::LinkParents(model.nodes);
+        // Already reported by TestLinkParents, a broken hierarchy could loop forever below
+        if (CountWrongParents(model.nodes, expectedParents) != 0)
+            continue;
+
+        // Every other node is a joint, the root on every other trial
+        model.rig.emplace();
+        for (NodeIndex n = 0; n < model.nodes.size(); n++)
+        {
+            const bool root = model.nodes[n].parent == UINT32_MAX;
+            if (root ? trial % 2 == 0 : f.rng() % 2 == 0)
+                model.rig->jointNodes.push_back(n);
+        }
+        std::shuffle(model.rig->jointNodes.begin(), model.rig->jointNodes.end(), f.rng);
+        RigBuilder::SortJoints(model.nodes, model.rig->jointNodes);
+        const std::vector<NodeIndex>& jointNodes = model.rig->jointNodes;
+        const uint32_t jointCount = (uint32_t)jointNodes.size();
+
+        const std::vector<RigJointRecord> records = RigBuilder::BuildJointRecords(model);
+        Rig rig;
+        rig.hasHierarchy = true;
+        bool parentsFirst = true;
+        for (uint32_t j = 0; j < jointCount; j++)
+        {
+            parentsFirst &= records[j].parent < int32_t(j);
+            rig.joints.push_back(JointFromRecord(records[j]));
+        }
+        REON_TEST_CHECK(parentsFirst, "trial %d: a joint comes before its parent", trial);
+        if (!parentsFirst)
+            continue;
+
+        // A clip holding one random key per channel, and the nodes moved to the same pose
+        AnimationClip clip;
+        clip.jointCount = jointCount;
+        clip.duration = 1.0f;
+        clip.tracks.resize(jointCount * AnimationClip::ChannelCount);
+        std::vector<ImportedNode> posed = model.nodes;
+        for (uint32_t j = 0; j < jointCount; j++)
+        {
+            ImportedNode& node = posed[jointNodes[j]];
+            node.t = f.RandomVector(-1.0f, 1.0f);
+            node.r = Quaternion(f.RandomRotation());
+            node.s = f.RandomVector(0.5f, 1.5f);
+
+            const glm::vec4 values[] = {glm::vec4(node.t, 0.0f), glm::vec4(node.r.x, node.r.y, node.r.z, node.r.w),
+                                        glm::vec4(node.s, 0.0f)};
+            for (uint32_t c = 0; c < AnimationClip::ChannelCount; c++)
+            {
+                clip.tracks[j * AnimationClip::ChannelCount + c] = {(uint32_t)clip.times.size(), 1};
+                clip.times.push_back(0.0f);
+                clip.values.push_back(values[c]);
+            }
+        }
+
+        Rig::Skin skin;
+        for (uint32_t j = 0; j < jointCount; j++)
+        {
+            skin.jointIdx.push_back(j);
+            skin.inverseBindMatrices.push_back(f.RandomTransform());
+        }
+
+        // The owner sits somewhere in the scene at the root's rest transform, a root joint is posed relative to it
+        NodeIndex root = 0;
+        while (model.nodes[root].parent != UINT32_MAX)
+            root++;
+        const glm::mat4 scene = f.RandomTransform();
+        const glm::mat4 ownerWorld = scene * RigBuilder::NodeLocalMatrix(model.nodes[root]);
+        const std::vector<glm::mat4> worlds = ObjectWorlds(posed, scene * RigBuilder::NodeLocalMatrix(posed[root]));
+
+        AnimationSampler sampler;
+        std::vector<SoaTransform> pose(AnimationSampler::GetGroupCount(jointCount));
+        std::vector<glm::mat4> modelPose(jointCount);
+        std::vector<glm::mat4> palette(jointCount);
+        sampler.Sample(clip, rig, 0.5f, pose);
+        AnimationSampler::ComputeModelPose(rig, pose, modelPose);
+        AnimationSampler::ComputeSkinPalette(skin, ownerWorld, modelPose, palette);
+
+        float error = 0.0f;
+        for (uint32_t j = 0; j < jointCount; j++)
+            error = std::max(error, MatrixError(palette[j], worlds[jointNodes[j]] * skin.inverseBindMatrices[j]));
+        REON_TEST_CHECK(error <= MatrixTolerance, "trial %d: palette off the joint objects by %g (%u joints)", trial,
+                        error, jointCount);
+    }
+}
+} // namespace
+
+void RunAnimationSamplerTests()
+{
+    TestCursorSampling();
+    TestLinkParents();
+    TestSkinPalette();
+}
+
+} // namespace REON::TESTS
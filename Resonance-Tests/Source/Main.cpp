@@ -0,0 +1,18 @@
+#include "TestRunner.h"
+
+int main()
+{
+    using namespace REON::TESTS;
+
+    RunShadowCascadeTests();
+    RunRenderGraphTests();
+    RunAnimationSamplerTests();
+
+    if (g_FailedChecks > 0)
+    {
+        std::printf("%d checks failed\n", g_FailedChecks);
+        return 1;
+    }
+    std::printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,278 @@
+#include "TestRunner.h"
+
+#include "REON/Rendering/RenderGraph.h"
+
+#include <random>
+#include <vector>
+
+namespace REON::TESTS
+{
+
+namespace
+{
+constexpr int AliasingGraphCount = 500;
+
+RenderGraph::Resource ImportOutput(RenderGraph& graph, const char* name)
+{
+    const RenderGraph::Resource output = graph.ImportImage(name, VK_NULL_HANDLE, VK_IMAGE_ASPECT_COLOR_BIT);
+    graph.MarkOutput(output);
+    return output;
+}
+
+// Passes only live through what they write, so a pass whose results nobody reads goes, together with the passes that
+// only feed it. Their transients get no memory.
+void TestCulling()
+{
+    RenderGraph graph;
+    const RenderGraphImageDesc desc{1024, 256, 1};
+    const RenderGraph::Resource result = ImportOutput(graph, "Result");
+    const RenderGraph::Resource color = graph.CreateImage("Color", VK_IMAGE_ASPECT_COLOR_BIT, desc);
+    const RenderGraph::Resource unused = graph.CreateImage("Unused", VK_IMAGE_ASPECT_COLOR_BIT, desc);
+    const RenderGraph::Resource unusedChain = graph.CreateImage("UnusedChain", VK_IMAGE_ASPECT_COLOR_BIT, desc);
+
+    const RenderGraph::Pass draw = graph.AddPass("Draw");
+    graph.Write(draw, color, RenderGraphAccess::ColorAttachment);
+
+    const RenderGraph::Pass deadStart = graph.AddPass("DeadStart");
+    graph.Write(deadStart, unused, RenderGraphAccess::ColorAttachment);
+
+    const RenderGraph::Pass deadEnd = graph.AddPass("DeadEnd");
+    graph.Read(deadEnd, unused, RenderGraphAccess::Sampled);
+    graph.Write(deadEnd, unusedChain, RenderGraphAccess::ColorAttachment);
+
+    const RenderGraph::Pass composite = graph.AddPass("Composite");
+    graph.Read(composite, color, RenderGraphAccess::Sampled);
+    graph.Write(composite, result, RenderGraphAccess::ColorAttachment);
+
+    // Overwrites Color after its last reader, nothing sees the result
+    const RenderGraph::Pass overwrite = graph.AddPass("Overwrite");
+    graph.Write(overwrite, color, RenderGraphAccess::ColorAttachment);
+
+    graph.Compile();
+
+    REON_TEST_CHECK(!graph.IsCulled(draw) && !graph.IsCulled(composite), "a pass feeding the output was culled");
+    REON_TEST_CHECK(graph.IsCulled(deadStart) && graph.IsCulled(deadEnd), "passes whose outputs are unread were kept");
+    REON_TEST_CHECK(graph.IsCulled(overwrite), "a write nothing reads afterwards was kept");
+    REON_TEST_CHECK(graph.GetCulledPassCount() == 3, "%u passes culled, expected 3", graph.GetCulledPassCount());
+    REON_TEST_CHECK(graph.GetHeapIndex(unused) == RenderGraph::Invalid &&
+                        graph.GetHeapIndex(unusedChain) == RenderGraph::Invalid,
+                    "transients of culled passes were given memory");
+    REON_TEST_CHECK(graph.GetHeapIndex(color) != RenderGraph::Invalid, "a live transient got no memory");
+}
+
+// One image written, read twice, overwritten and read again. Each write to read, read to write and first read after a
+// layout change is a hazard that needs exactly one barrier, a read following a read needs none.
+void TestBarriers()
+{
+    RenderGraph graph;
+    const RenderGraph::Resource image = graph.ImportImage("Image", VK_NULL_HANDLE, VK_IMAGE_ASPECT_COLOR_BIT);
+    const RenderGraph::Resource first = ImportOutput(graph, "First");
+    const RenderGraph::Resource second = ImportOutput(graph, "Second");
+    const RenderGraph::Resource third = ImportOutput(graph, "Third");
+
+    const RenderGraph::Pass write = graph.AddPass("Write");
+    graph.Write(write, image, RenderGraphAccess::ColorAttachment);
+
+    const RenderGraph::Pass read = graph.AddPass("Read");
+    graph.Read(read, image, RenderGraphAccess::Sampled);
+    graph.Write(read, first, RenderGraphAccess::ColorAttachment);
+
+    const RenderGraph::Pass readAgain = graph.AddPass("ReadAgain");
+    graph.Read(readAgain, image, RenderGraphAccess::Sampled);
+    graph.Write(readAgain, second, RenderGraphAccess::ColorAttachment);
+
+    const RenderGraph::Pass rewrite = graph.AddPass("Rewrite");
+    graph.Write(rewrite, image, RenderGraphAccess::ColorAttachment);
+
+    const RenderGraph::Pass readRewritten = graph.AddPass("ReadRewritten");
+    graph.Read(readRewritten, image, RenderGraphAccess::Sampled);
+    graph.Write(readRewritten, third, RenderGraphAccess::ColorAttachment);
+
+    graph.Compile();
+
+    struct Expected
+    {
+        RenderGraph::Pass pass;
+        size_t barriers;
+    };
+    const Expected expected[] = {{write, 0}, {read, 1}, {readAgain, 0}, {rewrite, 1}, {readRewritten, 1}};
+    for (const Expected& e : expected)
+    {
+        const size_t count = graph.GetBarriersBefore(e.pass).size();
+        REON_TEST_CHECK(!graph.IsCulled(e.pass), "pass %u was culled", e.pass);
+        REON_TEST_CHECK(count == e.barriers, "pass %u has %zu barriers, expected %zu", e.pass, count, e.barriers);
+        REON_TEST_CHECK(graph.GetBarriersAfter(e.pass).empty(), "pass %u has barriers after it", e.pass);
+    }
+
+    const auto& readBarriers = graph.GetBarriersBefore(read);
+    if (readBarriers.size() == 1)
+    {
+        const RenderGraphBarrier& barrier = readBarriers[0];
+        REON_TEST_CHECK(barrier.resource == image, "read barrier is for resource %u", barrier.resource);
+        REON_TEST_CHECK(barrier.oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL &&
+                            barrier.newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                        "read barrier transitions %d to %d", barrier.oldLayout, barrier.newLayout);
+        REON_TEST_CHECK(barrier.srcAccess == VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT &&
+                            barrier.dstAccess == VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                        "read barrier does not make the attachment write visible to sampling");
+    }
+
+    const auto& rewriteBarriers = graph.GetBarriersBefore(rewrite);
+    if (rewriteBarriers.size() == 1)
+    {
+        // Write after read has to wait for the readers before overwriting
+        const RenderGraphBarrier& barrier = rewriteBarriers[0];
+        REON_TEST_CHECK((barrier.srcStages & VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT) != 0,
+                        "rewrite waits on stages %llx, not the readers",
+                        static_cast<unsigned long long>(barrier.srcStages));
+        REON_TEST_CHECK(barrier.dstAccess & VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                        "rewrite barrier does not cover the attachment write");
+    }
+}
+
+// Two transients used by disjoint passes share their memory, two used by the same pass never do.
+void TestAliasing()
+{
+    RenderGraph graph;
+    const RenderGraphImageDesc desc{4096, 256, 1};
+    const RenderGraph::Resource result = ImportOutput(graph, "Result");
+    const RenderGraph::Resource early = graph.CreateImage("Early", VK_IMAGE_ASPECT_COLOR_BIT, desc);
+    const RenderGraph::Resource earlyOther = graph.CreateImage("EarlyOther", VK_IMAGE_ASPECT_COLOR_BIT, desc);
+    const RenderGraph::Resource late = graph.CreateImage("Late", VK_IMAGE_ASPECT_COLOR_BIT, desc);
+
+    const RenderGraph::Pass produce = graph.AddPass("Produce");
+    graph.Write(produce, early, RenderGraphAccess::ColorAttachment);
+    graph.Write(produce, earlyOther, RenderGraphAccess::ColorAttachment);
+
+    const RenderGraph::Pass consume = graph.AddPass("Consume");
+    graph.Read(consume, early, RenderGraphAccess::Sampled);
+    graph.Read(consume, earlyOther, RenderGraphAccess::Sampled);
+    graph.Write(consume, result, RenderGraphAccess::ColorAttachment);
+
+    const RenderGraph::Pass produceLate = graph.AddPass("ProduceLate");
+    graph.Write(produceLate, late, RenderGraphAccess::ColorAttachment);
+
+    const RenderGraph::Pass consumeLate = graph.AddPass("ConsumeLate");
+    graph.Read(consumeLate, late, RenderGraphAccess::Sampled);
+    graph.Attachment(consumeLate, result, RenderGraphAccess::ColorAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                     VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+    graph.Compile();
+
+    REON_TEST_CHECK(graph.GetHeapOffset(early) != graph.GetHeapOffset(earlyOther),
+                    "images alive in the same pass share offset %llu",
+                    static_cast<unsigned long long>(graph.GetHeapOffset(early)));
+    REON_TEST_CHECK(graph.GetHeapIndex(late) == graph.GetHeapIndex(early) &&
+                        (graph.GetHeapOffset(late) == graph.GetHeapOffset(early) ||
+                         graph.GetHeapOffset(late) == graph.GetHeapOffset(earlyOther)),
+                    "an image with a disjoint lifetime did not reuse earlier memory");
+    REON_TEST_CHECK(graph.GetHeaps().size() == 1 && graph.GetHeaps()[0].size == 2 * desc.size,
+                    "heap takes %llu bytes, expected %llu",
+                    static_cast<unsigned long long>(graph.GetHeaps().empty() ? 0 : graph.GetHeaps()[0].size),
+                    static_cast<unsigned long long>(2 * desc.size));
+    REON_TEST_CHECK(graph.GetUnaliasedSize() == 3 * desc.size, "unaliased size %llu",
+                    static_cast<unsigned long long>(graph.GetUnaliasedSize()));
+
+    // The first use of the reused memory waits for the previous occupant
+    const auto& barriers = graph.GetBarriersBefore(produceLate);
+    REON_TEST_CHECK(barriers.size() == 1 && barriers[0].resource == late &&
+                        (barriers[0].srcStages & VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT) != 0,
+                    "aliased image has %zu barriers before its first use", barriers.size());
+}
+
+// Random chains of passes with transients of random sizes, alignments and lifetimes. Whatever the packing decides,
+// images alive at the same time never overlap in memory and every image sits at an aligned offset.
+void TestRandomAliasing()
+{
+    std::mt19937 rng(7);
+    int overlapping = 0, misaligned = 0, unplaced = 0, graphsWithReuse = 0;
+
+    for (int g = 0; g < AliasingGraphCount; g++)
+    {
+        RenderGraph graph;
+        const uint32_t passCount = 2 + rng() % 10;
+        const uint32_t imageCount = 1 + rng() % 12;
+
+        struct Image
+        {
+            RenderGraph::Resource resource;
+            uint32_t first;
+            uint32_t last;
+            RenderGraphImageDesc desc;
+        };
+        std::vector<Image> images(imageCount);
+        for (Image& image : images)
+        {
+            image.first = rng() % passCount;
+            image.last = image.first + rng() % (passCount - image.first);
+            image.desc.alignment = uint64_t(1) << (rng() % 10);
+            image.desc.size = (1 + rng() % 64) * 512;
+            image.desc.memoryTypeBits = 1u << (rng() % 2);
+            image.resource = graph.CreateImage("Transient", VK_IMAGE_ASPECT_COLOR_BIT, image.desc);
+        }
+
+        // Every pass writes an output so none is culled and the lifetimes stay as declared
+        std::vector<RenderGraph::Pass> passes(passCount);
+        for (uint32_t p = 0; p < passCount; p++)
+        {
+            passes[p] = graph.AddPass("Pass");
+            graph.Write(passes[p], ImportOutput(graph, "Output"), RenderGraphAccess::ColorAttachment);
+            for (const Image& image : images)
+            {
+                if (image.first == p)
+                    graph.Write(passes[p], image.resource, RenderGraphAccess::ColorAttachment);
+                else if (p > image.first && p <= image.last)
+                    graph.Read(passes[p], image.resource, RenderGraphAccess::Sampled);
+            }
+        }
+
+        graph.Compile();
+
+        uint64_t heapTotal = 0;
+        for (const RenderGraphHeap& heap : graph.GetHeaps())
+            heapTotal += heap.size;
+        if (heapTotal < graph.GetUnaliasedSize())
+            graphsWithReuse++;
+
+        for (size_t a = 0; a < images.size(); a++)
+        {
+            const Image& image = images[a];
+            const uint32_t heap = graph.GetHeapIndex(image.resource);
+            const uint64_t offset = graph.GetHeapOffset(image.resource);
+            if (heap == RenderGraph::Invalid || offset + image.desc.size > graph.GetHeaps()[heap].size)
+            {
+                unplaced++;
+                continue;
+            }
+            if (offset % image.desc.alignment != 0)
+                misaligned++;
+
+            for (size_t b = a + 1; b < images.size(); b++)
+            {
+                const Image& other = images[b];
+                const bool livesOverlap = image.first <= other.last && other.first <= image.last;
+                const uint64_t otherOffset = graph.GetHeapOffset(other.resource);
+                const bool memoryOverlaps =
+                    offset < otherOffset + other.desc.size && otherOffset < offset + image.desc.size;
+                if (livesOverlap && graph.GetHeapIndex(other.resource) == heap && memoryOverlaps)
+                    overlapping++;
+            }
+        }
+    }
+
+    REON_TEST_CHECK(unplaced == 0, "%d transients were not placed inside their heap", unplaced);
+    REON_TEST_CHECK(misaligned == 0, "%d transients sit at a misaligned offset", misaligned);
+    REON_TEST_CHECK(overlapping == 0, "%d pairs of simultaneously alive transients share memory", overlapping);
+    REON_TEST_CHECK(graphsWithReuse > 0, "no random graph reused any memory");
+}
+} // namespace
+
+void RunRenderGraphTests()
+{
+    TestCulling();
+    TestBarriers();
+    TestAliasing();
+    TestRandomAliasing();
+}
+
+} // namespace REON::TESTS
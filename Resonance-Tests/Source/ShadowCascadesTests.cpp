@@ -0,0 +1,281 @@
+#include "TestRunner.h"
+
+#include "REON/Rendering/ShadowCascades.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <array>
+#include <cmath>
+#include <random>
+
+namespace REON::TESTS
+{
+
+namespace
+{
+constexpr float NearPlane = 0.1f;
+constexpr float FarPlane = 100.0f;
+constexpr uint32_t Resolution = 2048;
+constexpr int PoseCount = 2000;
+constexpr int SamplesPerCascade = 64;
+// Near end of clip space depth, matching how the engine configures glm
+#ifdef GLM_FORCE_DEPTH_ZERO_TO_ONE
+constexpr float MinDepth = 0.0f;
+#else
+constexpr float MinDepth = -1.0f;
+#endif
+
+struct Fixture
+{
+    std::mt19937 rng{1};
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, NearPlane, FarPlane);
+    glm::vec3 lightDirection = glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f));
+    glm::mat4 lightView = glm::lookAtRH(glm::vec3(0.0f), lightDirection,
+                                        glm::normalize(glm::cross(lightDirection, glm::vec3(1.0f, 0.0f, 0.0f))));
+    ShadowCascadeSettings settings{};
+
+    float Random(float min, float max)
+    {
+        return std::uniform_real_distribution<float>(min, max)(rng);
+    }
+
+    glm::mat4 RandomCameraView()
+    {
+        const glm::vec3 eye(Random(-100.0f, 100.0f), Random(0.0f, 20.0f), Random(-100.0f, 100.0f));
+        const glm::vec3 axis =
+            glm::normalize(glm::vec3(Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f)) + 1e-3f);
+        const glm::quat orientation = glm::angleAxis(Random(0.0f, 6.2831853f), axis);
+        return glm::inverse(glm::translate(glm::mat4(1.0f), eye) * glm::mat4_cast(orientation));
+    }
+
+    uint32_t Fit(const glm::mat4& view, std::array<ShadowCascade, ShadowCascades::MaxCascades>& cascades) const
+    {
+        return ShadowCascades::Fit(view, projection, NearPlane, FarPlane, lightView, Resolution, settings, cascades);
+    }
+};
+
+// World space point of the camera at a view depth, through normalized device xy
+glm::vec3 PointInSlice(const glm::mat4& view, const glm::mat4& projection, glm::vec2 ndc, float depth)
+{
+    const glm::mat4 inverseProjection = glm::inverse(projection);
+    glm::vec4 nearPoint = inverseProjection * glm::vec4(ndc, 0.0f, 1.0f);
+    glm::vec4 farPoint = inverseProjection * glm::vec4(ndc, 1.0f, 1.0f);
+    const glm::vec3 a = glm::vec3(nearPoint) / nearPoint.w;
+    const glm::vec3 b = glm::vec3(farPoint) / farPoint.w;
+    const glm::vec3 viewPoint = a + (b - a) * ((-depth - a.z) / (b.z - a.z));
+    return glm::vec3(glm::inverse(view) * glm::vec4(viewPoint, 1.0f));
+}
+
+void TestSplits()
+{
+    std::array<float, 5> splits;
+    ShadowCascades::ComputeSplits(NearPlane, FarPlane, 0.75f, splits);
+    REON_TEST_CHECK(splits.front() == NearPlane && splits.back() == FarPlane, "splits span %f to %f", splits.front(),
+                    splits.back());
+    for (size_t i = 1; i < splits.size(); i++)
+        REON_TEST_CHECK(splits[i - 1] < splits[i], "split %zu at %f is not past %f", i, splits[i], splits[i - 1]);
+
+    ShadowCascades::ComputeSplits(NearPlane, FarPlane, 0.0f, splits);
+    REON_TEST_CHECK(std::abs(splits[2] - (NearPlane + FarPlane) * 0.5f) < 1e-3f, "uniform middle split at %f",
+                    splits[2]);
+
+    ShadowCascades::ComputeSplits(NearPlane, FarPlane, 1.0f, splits);
+    REON_TEST_CHECK(std::abs(splits[2] - std::sqrt(NearPlane * FarPlane)) < 1e-3f, "logarithmic middle split at %f",
+                    splits[2]);
+}
+
+// Every point of a cascade's frustum slice has to land inside the cascade's shadow map, away from the border texels
+// the filter reads past the edge, and inside its depth range together with the casters towards the light.
+void TestCoverage(Fixture& fixture)
+{
+    const float edge = 1.0f - 2.0f * float(ShadowCascades::BorderTexels - 1) / float(Resolution);
+    int outside = 0, outsideDepth = 0, casterClipped = 0, wrongCount = 0;
+
+    for (int pose = 0; pose < PoseCount; pose++)
+    {
+        const glm::mat4 view = fixture.RandomCameraView();
+        std::array<ShadowCascade, ShadowCascades::MaxCascades> cascades;
+        const uint32_t count = fixture.Fit(view, cascades);
+        if (count != fixture.settings.cascadeCount)
+        {
+            wrongCount++;
+            continue;
+        }
+
+        for (uint32_t c = 0; c < count; c++)
+        {
+            const ShadowCascade& cascade = cascades[c];
+            for (int sample = 0; sample < SamplesPerCascade + 8; sample++)
+            {
+                // The slice's eight corners first, they are the points furthest out
+                glm::vec2 ndc;
+                float depth;
+                if (sample < 8)
+                {
+                    ndc = glm::vec2((sample & 1) ? 1.0f : -1.0f, (sample & 2) ? 1.0f : -1.0f);
+                    depth = (sample & 4) ? cascade.farDepth : cascade.nearDepth;
+                }
+                else
+                {
+                    ndc = glm::vec2(fixture.Random(-1.0f, 1.0f), fixture.Random(-1.0f, 1.0f));
+                    depth = fixture.Random(cascade.nearDepth, cascade.farDepth);
+                }
+
+                const glm::vec3 world = PointInSlice(view, fixture.projection, ndc, depth);
+                const glm::vec4 shadow = cascade.viewProj * glm::vec4(world, 1.0f);
+                if (std::abs(shadow.x) > edge || std::abs(shadow.y) > edge)
+                    outside++;
+                if (shadow.z < MinDepth || shadow.z > 1.0f)
+                    outsideDepth++;
+
+                const glm::vec3 caster = world - fixture.lightDirection * fixture.settings.casterDistance * 0.99f;
+                if ((cascade.viewProj * glm::vec4(caster, 1.0f)).z < MinDepth)
+                    casterClipped++;
+            }
+        }
+    }
+
+    REON_TEST_CHECK(wrongCount == 0, "%d poses fit the wrong number of cascades", wrongCount);
+    REON_TEST_CHECK(outside == 0, "%d slice points fell outside their cascade's shadow map", outside);
+    REON_TEST_CHECK(outsideDepth == 0, "%d slice points fell outside their cascade's depth range", outsideDepth);
+    REON_TEST_CHECK(casterClipped == 0, "%d casters within the caster distance were clipped", casterClipped);
+}
+
+// Texels stay the same size however the camera moves or turns, and a translated camera moves the shadow map in whole
+// texels, so a fixed point keeps its position within its texel.
+void TestStability(Fixture& fixture)
+{
+    std::array<float, ShadowCascades::MaxCascades> texelSizes{};
+    int resized = 0, shifted = 0;
+
+    for (int pose = 0; pose < PoseCount; pose++)
+    {
+        const glm::mat4 view = fixture.RandomCameraView();
+        std::array<ShadowCascade, ShadowCascades::MaxCascades> cascades;
+        const uint32_t count = fixture.Fit(view, cascades);
+
+        const glm::vec3 offset(fixture.Random(-2.0f, 2.0f), fixture.Random(-2.0f, 2.0f), fixture.Random(-2.0f, 2.0f));
+        const glm::mat4 movedView = view * glm::translate(glm::mat4(1.0f), -offset);
+        std::array<ShadowCascade, ShadowCascades::MaxCascades> moved;
+        fixture.Fit(movedView, moved);
+
+        const glm::vec3 world = glm::vec3(glm::inverse(view)[3]) + glm::vec3(1.234f, 0.5f, -3.21f);
+        for (uint32_t c = 0; c < count; c++)
+        {
+            if (pose > 0 && cascades[c].texelSize != texelSizes[c])
+                resized++;
+            texelSizes[c] = cascades[c].texelSize;
+
+            const glm::vec2 before = (glm::vec2(cascades[c].viewProj * glm::vec4(world, 1.0f)) * 0.5f + 0.5f) *
+                                     float(Resolution);
+            const glm::vec2 after =
+                (glm::vec2(moved[c].viewProj * glm::vec4(world, 1.0f)) * 0.5f + 0.5f) * float(Resolution);
+            glm::vec2 phase = glm::abs(glm::fract(before) - glm::fract(after));
+            phase = glm::min(phase, 1.0f - phase);
+            if (phase.x > 2e-2f || phase.y > 2e-2f)
+                shifted++;
+        }
+    }
+
+    REON_TEST_CHECK(resized == 0, "cascade texel size changed %d times", resized);
+    REON_TEST_CHECK(shifted == 0, "texel phase shifted under camera translation %d times", shifted);
+}
+
+// A camera walking through the scene keeps finding its cascades in their cache regions for most frames, and wherever
+// a cascade sits in its region, a point lands on the same texel and depth in both, shifted by the cascade's offset.
+void TestCacheRegions(Fixture& fixture)
+{
+    constexpr uint32_t MarginTexels = 256;
+    constexpr int Frames = 600;
+    std::array<ShadowCacheRegion, ShadowCascades::MaxCascades> regions;
+    std::array<bool, ShadowCascades::MaxCascades> fitted{};
+    int lookups = 0, hits = 0, misplaced = 0, depthMismatch = 0, notPlaced = 0;
+
+    const glm::mat4 start = fixture.RandomCameraView();
+    const glm::vec3 forward = -glm::vec3(glm::inverse(start)[2]);
+    for (int frame = 0; frame < Frames; frame++)
+    {
+        // Walking pace at 60 frames per second, turning slowly
+        const glm::mat4 view = glm::rotate(glm::mat4(1.0f), 0.002f * frame, glm::vec3(0.0f, 1.0f, 0.0f)) * start *
+                               glm::translate(glm::mat4(1.0f), -forward * (0.025f * frame));
+        std::array<ShadowCascade, ShadowCascades::MaxCascades> cascades;
+        const uint32_t count = fixture.Fit(view, cascades);
+
+        for (uint32_t c = 0; c < count; c++)
+        {
+            ShadowCascade& cascade = cascades[c];
+            glm::uvec2 offset;
+            lookups++;
+            if (fitted[c] && ShadowCascades::PlaceInCacheRegion(cascade, regions[c], fixture.lightView, offset))
+            {
+                hits++;
+            }
+            else
+            {
+                regions[c] = ShadowCascades::FitCacheRegion(cascade, fixture.lightView, MarginTexels);
+                fitted[c] = true;
+                if (!ShadowCascades::PlaceInCacheRegion(cascade, regions[c], fixture.lightView, offset))
+                {
+                    notPlaced++;
+                    continue;
+                }
+            }
+
+            for (int sample = 0; sample < 8; sample++)
+            {
+                const glm::vec2 ndc(fixture.Random(-1.0f, 1.0f), fixture.Random(-1.0f, 1.0f));
+                const glm::vec3 world =
+                    PointInSlice(view, fixture.projection, ndc, fixture.Random(cascade.nearDepth, cascade.farDepth));
+                const glm::vec3 inCascade = glm::vec3(cascade.viewProj * glm::vec4(world, 1.0f));
+                const glm::vec3 inRegion = glm::vec3(regions[c].viewProj * glm::vec4(world, 1.0f));
+
+                const glm::vec2 cascadeTexel = (glm::vec2(inCascade) * 0.5f + 0.5f) * float(Resolution);
+                const glm::vec2 regionTexel =
+                    (glm::vec2(inRegion) * 0.5f + 0.5f) * float(Resolution + 2 * MarginTexels);
+                const glm::vec2 error = glm::abs(regionTexel - glm::vec2(offset) - cascadeTexel);
+                if (error.x > 1e-2f || error.y > 1e-2f)
+                    misplaced++;
+                if (std::abs(inCascade.z - inRegion.z) > 1e-5f)
+                    depthMismatch++;
+            }
+        }
+    }
+
+    const float hitRate = float(hits) / float(lookups);
+    REON_TEST_CHECK(notPlaced == 0, "%d cascades did not fit the region fitted around them", notPlaced);
+    REON_TEST_CHECK(misplaced == 0, "%d points landed on a different texel of the cache region", misplaced);
+    REON_TEST_CHECK(depthMismatch == 0, "%d points stored a different depth in the cache region", depthMismatch);
+    REON_TEST_CHECK(hitRate > 0.9f, "only %.1f%% of cascades were found in their cache while walking",
+                    hitRate * 100.0f);
+}
+
+void TestCascadeCount(Fixture& fixture)
+{
+    std::array<ShadowCascade, ShadowCascades::MaxCascades> cascades;
+    const glm::mat4 view = fixture.RandomCameraView();
+
+    ShadowCascadeSettings settings = fixture.settings;
+    settings.cascadeCount = 2;
+    const uint32_t count = ShadowCascades::Fit(view, fixture.projection, NearPlane, FarPlane, fixture.lightView,
+                                               Resolution, settings, cascades);
+    REON_TEST_CHECK(count == 2, "fit %u cascades when 2 were asked for", count);
+    REON_TEST_CHECK(cascades[1].farDepth == settings.shadowDistance, "last cascade ends at %f", cascades[1].farDepth);
+
+    const uint32_t tooSmall = ShadowCascades::Fit(view, fixture.projection, NearPlane, FarPlane, fixture.lightView,
+                                                  2 * ShadowCascades::BorderTexels, settings, cascades);
+    REON_TEST_CHECK(tooSmall == 0, "fit %u cascades into a map smaller than its borders", tooSmall);
+}
+} // namespace
+
+void RunShadowCascadeTests()
+{
+    Fixture fixture;
+    TestSplits();
+    TestCoverage(fixture);
+    TestStability(fixture);
+    TestCacheRegions(fixture);
+    TestCascadeCount(fixture);
+}
+
+} // namespace REON::TESTS
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdio>
+
+namespace REON::TESTS
+{
+
+// Counts failed checks across all tests, Main returns non-zero when any failed.
+inline int g_FailedChecks = 0;
+
+// Reports a failed condition with its location and keeps going, so one run lists every failure.
+#define REON_TEST_CHECK(condition, ...)                                                                                \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(condition))                                                                                              \
+        {                                                                                                              \
+            ++::REON::TESTS::g_FailedChecks;                                                                           \
+            std::printf("%s:%d: check failed: %s\n    ", __FILE__, __LINE__, #condition);                              \
+            std::printf(__VA_ARGS__);                                                                                  \
+            std::printf("\n");                                                                                         \
+        }                                                                                                              \
+    } while (0)
+
+void RunShadowCascadeTests();
+void RunRenderGraphTests();
+void RunAnimationSamplerTests();
+
+} // namespace REON::TESTS